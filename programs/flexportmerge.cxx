@@ -0,0 +1,109 @@
+// -*- mode: c++ ; -*-
+/* flexportmerge.cxx
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Schema-checked parallel merge of exported ROOT files
+ *
+ *   Usage :
+ *
+ *     flexportmerge -o merged.root -j 8 --compression 404 run_*.root
+ *
+ * History:
+ *
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <exception>
+
+#include <boost/program_options.hpp>
+
+#include <datatools/logger.h>
+
+#include <falaise/snemo/exports/export_root_merger.h>
+
+int main (int argc_, char ** argv_)
+{
+  namespace po = boost::program_options;
+  namespace sre = snemo::reconstruction::exports;
+  int error_code = EXIT_SUCCESS;
+  try
+    {
+      std::vector<std::string> input_files;
+      std::string output_file;
+      std::string tree_name = "snemodata";
+      unsigned int nthreads = 1;
+      int compression = sre::export_root_merger::COMPRESSION_KEEP;
+      std::string temporary_directory;
+      bool check_only = false;
+
+      po::options_description opts ("Allowed options");
+      opts.add_options ()
+        ("help,h", "print this help")
+        ("verbose,v", "verbose mode")
+        ("input,i", po::value<std::vector<std::string> >(&input_files), "input file (repeatable)")
+        ("output,o", po::value<std::string>(&output_file), "output file")
+        ("tree", po::value<std::string>(&tree_name), "name of the tree (default: snemodata)")
+        ("jobs,j", po::value<unsigned int>(&nthreads), "number of worker threads (default: 1)")
+        ("compression", po::value<int>(&compression),
+         "ROOT compression settings of the output (100*algorithm+level, default: keep)")
+        ("tmpdir", po::value<std::string>(&temporary_directory), "directory of the intermediate files")
+        ("check-only", po::bool_switch(&check_only), "only check the schema of the input files")
+        ;
+      po::positional_options_description args;
+      args.add ("input", -1);
+      po::variables_map vm;
+      po::store (po::command_line_parser (argc_, argv_).options (opts).positional (args).run (), vm);
+      po::notify (vm);
+
+      if (vm.count ("help"))
+        {
+          std::cout << "Usage : flexportmerge [options] input files...\n" << opts << std::endl;
+          return error_code;
+        }
+
+      sre::export_root_merger merger;
+      if (vm.count ("verbose"))
+        {
+          merger.set_logging_priority (datatools::logger::PRIO_DEBUG);
+        }
+      merger.set_tree_name (tree_name);
+      for (size_t i = 0; i < input_files.size (); i++)
+        {
+          merger.add_input_file (input_files[i]);
+        }
+      if (check_only)
+        {
+          merger.check_schemas ();
+          std::clog << "flexportmerge: " << "The input files are compatible." << std::endl;
+          return error_code;
+        }
+      merger.set_output_file (output_file);
+      merger.set_number_of_threads (nthreads);
+      merger.set_compression_settings (compression);
+      if (! temporary_directory.empty ())
+        {
+          merger.set_temporary_directory (temporary_directory);
+        }
+      merger.run ();
+      merger.print (std::clog, "flexportmerge", "");
+    }
+  catch (std::exception & x)
+    {
+      std::cerr << "flexportmerge: error: " << x.what () << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  catch (...)
+    {
+      std::cerr << "flexportmerge: error: " << "unexpected error !" << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  return error_code;
+}
+
+// end of flexportmerge.cxx
@@ -0,0 +1,119 @@
+// -*- mode: c++ ; -*-
+/* flexportskim.cxx
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Skim/slim of exported ROOT files
+ *
+ *   Usage :
+ *
+ *     flexportskim -i run_1.root -i run_2.root -o skim.root \
+ *       --drop-bank trueStepHits --drop-topic CAT \
+ *       --select "Sum$(calibTrackerHits.delayed)>0"
+ *
+ * History:
+ *
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <exception>
+
+#include <boost/program_options.hpp>
+
+#include <datatools/logger.h>
+
+#include <falaise/snemo/exports/export_root_skimmer.h>
+
+int main (int argc_, char ** argv_)
+{
+  namespace po = boost::program_options;
+  namespace sre = snemo::reconstruction::exports;
+  int error_code = EXIT_SUCCESS;
+  try
+    {
+      std::vector<std::string> input_files;
+      std::string output_file;
+      std::string tree_name = "snemodata";
+      std::vector<std::string> dropped_banks;
+      std::vector<std::string> dropped_topics;
+      std::vector<std::string> dropped_patterns;
+      std::string event_list;
+      std::string predicate;
+
+      po::options_description opts ("Allowed options");
+      opts.add_options ()
+        ("help,h", "print this help")
+        ("verbose,v", "verbose mode")
+        ("input,i", po::value<std::vector<std::string> >(&input_files), "input file (repeatable)")
+        ("output,o", po::value<std::string>(&output_file), "output file")
+        ("tree", po::value<std::string>(&tree_name), "name of the tree (default: snemodata)")
+        ("drop-bank", po::value<std::vector<std::string> >(&dropped_banks), "drop a bank (repeatable)")
+        ("drop-topic", po::value<std::vector<std::string> >(&dropped_topics), "drop a topic (repeatable)")
+        ("drop-branch", po::value<std::vector<std::string> >(&dropped_patterns),
+         "drop the branches matching a glob pattern (repeatable)")
+        ("event-list", po::value<std::string>(&event_list), "file of selected 'run event' lines")
+        ("select", po::value<std::string>(&predicate), "entry selection predicate (TTreeFormula)")
+        ;
+      po::variables_map vm;
+      po::store (po::parse_command_line (argc_, argv_, opts), vm);
+      po::notify (vm);
+
+      if (vm.count ("help"))
+        {
+          std::cout << "Usage : flexportskim [options]\n" << opts << std::endl;
+          return error_code;
+        }
+
+      sre::export_root_skimmer skimmer;
+      if (vm.count ("verbose"))
+        {
+          skimmer.set_logging_priority (datatools::logger::PRIO_DEBUG);
+        }
+      skimmer.set_tree_name (tree_name);
+      for (size_t i = 0; i < input_files.size (); i++)
+        {
+          skimmer.add_input_file (input_files[i]);
+        }
+      skimmer.set_output_file (output_file);
+      for (size_t i = 0; i < dropped_banks.size (); i++)
+        {
+          skimmer.drop_bank (dropped_banks[i]);
+        }
+      for (size_t i = 0; i < dropped_topics.size (); i++)
+        {
+          skimmer.drop_topic (dropped_topics[i]);
+        }
+      for (size_t i = 0; i < dropped_patterns.size (); i++)
+        {
+          skimmer.drop_branches (dropped_patterns[i]);
+        }
+      if (! event_list.empty ())
+        {
+          skimmer.load_event_list (event_list);
+        }
+      if (! predicate.empty ())
+        {
+          skimmer.set_predicate (predicate);
+        }
+      skimmer.run ();
+      skimmer.print (std::clog, "flexportskim", "");
+    }
+  catch (std::exception & x)
+    {
+      std::cerr << "flexportskim: error: " << x.what () << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  catch (...)
+    {
+      std::cerr << "flexportskim: error: " << "unexpected error !" << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  return error_code;
+}
+
+// end of flexportskim.cxx
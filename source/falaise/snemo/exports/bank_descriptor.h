@@ -0,0 +1,540 @@
+// -*- mode: c++ ; -*-
+/* bank_descriptor.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Compile-time descriptors of the hit banks
+ *
+ *   A descriptor lists the leaves of a bank type as (leaf name, pointer to
+ *   member) pairs. It is expanded from the leaf list of the bank (see
+ *   export_event.h), which the CAMP declaration of the class is expanded
+ *   from too. The leaf types are deduced from the members at compile time,
+ *   which gives :
+ *
+ *     - the ROOT leaf types (see branch_value_traits),
+ *     - fill kernels copying the members of the elements of a bank in their
+ *       branch storage with no CAMP call nor type conversion : plain, nullable
+ *       and event scope leaves, bitfields of described members and the size
+ *       counter of the bank,
+ *     - a compile-time check of the member types against the 'ctype' of
+ *       the leaves, the type of the branch entries being checked once when
+ *       the kernels are bound.
+ *
+ *   The CAMP reflection remains the reference schema : the fixed size leaves,
+ *   the bitfields of members out of the descriptor, the banks with no
+ *   descriptor and the out of line payloads (ex: CAT informations of the
+ *   calibrated tracker hits) are still filled through CAMP.
+ *
+ * History:
+ *
+ */
+
+#ifndef SNRECONSTRUCTION_EXPORTS_BANK_DESCRIPTOR_H
+#define SNRECONSTRUCTION_EXPORTS_BANK_DESCRIPTOR_H 1
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <falaise/snemo/exports/export_event.h>
+#include <falaise/snemo/exports/root_utils.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      /// \brief Compile-time list of the leaves of a bank type (no descriptor by default)
+      ///
+      /// A specialization provides :
+      ///
+      ///   template<class Visitor> static void visit (Visitor & visitor_);
+      ///
+      /// calling 'visitor_ (leaf_name, &Bank::member)' for each leaf.
+      template<class Bank>
+      struct bank_descriptor;
+
+      /// Visit a leaf of a descriptor, its member type being checked against its 'ctype'
+      template<class Type, class Visitor, class Bank, class T>
+      void visit_descriptor_leaf (Visitor & visitor_, const char * leaf_name_, T Bank::* leaf_)
+      {
+        static_assert (branch_value_traits<T>::TYPE == branch_value_traits<Type>::TYPE,
+                       "The member of a leaf does not store values of its 'ctype'");
+        visitor_ (leaf_name_, leaf_);
+        return;
+      }
+
+      // Descriptor visit of an entry of a leaf list (see export_event.h) :
+#define SNEMO_EXPORTS_DESCRIPTOR_LEAF(Class, Name, Member, Type, Tags) \
+          visit_descriptor_leaf<Type> (visitor_, Name, &Class::Member);
+
+#define SNEMO_EXPORTS_BANK_DESCRIPTOR(Class, Leaves)                   \
+      template<>                                                        \
+      struct bank_descriptor<Class>                                     \
+      {                                                                 \
+        template<class Visitor>                                         \
+        static void visit (Visitor & visitor_)                          \
+        {                                                               \
+          Leaves (SNEMO_EXPORTS_DESCRIPTOR_LEAF)                        \
+          return;                                                       \
+        }                                                               \
+      };
+
+      SNEMO_EXPORTS_BANK_DESCRIPTOR(true_step_hit_type, SNEMO_EXPORTS_TRUE_STEP_HIT_LEAVES)
+      SNEMO_EXPORTS_BANK_DESCRIPTOR(true_gg_hit_type, SNEMO_EXPORTS_TRUE_GG_HIT_LEAVES)
+      SNEMO_EXPORTS_BANK_DESCRIPTOR(true_scin_hit_type, SNEMO_EXPORTS_TRUE_SCIN_HIT_LEAVES)
+      SNEMO_EXPORTS_BANK_DESCRIPTOR(calib_tracker_hit_type, SNEMO_EXPORTS_CALIB_TRACKER_HIT_LEAVES)
+      SNEMO_EXPORTS_BANK_DESCRIPTOR(calib_calorimeter_hit_type, SNEMO_EXPORTS_CALIB_CALORIMETER_HIT_LEAVES)
+
+#undef SNEMO_EXPORTS_BANK_DESCRIPTOR
+#undef SNEMO_EXPORTS_DESCRIPTOR_LEAF
+
+      /// \brief Kernel filling the branch of a leaf from the elements of a bank
+      struct leaf_fill_kernel
+      {
+        virtual ~leaf_fill_kernel ()
+        {
+          return;
+        }
+        virtual void fill (const export_event & event_) const = 0;
+      };
+
+      /// Fill kernels of the branch entries, one slot per entry of a branch manager (null : filled through CAMP)
+      typedef boost::ptr_vector<boost::nullable<leaf_fill_kernel> > fill_kernel_col_type;
+
+      /// \brief Fill kernel copying a member of all the elements of a bank
+      template<class Bank, class T>
+      class member_fill_kernel : public leaf_fill_kernel
+      {
+      public:
+
+        typedef std::vector<Bank> export_event::* bank_member_type;
+        typedef T Bank::* leaf_member_type;
+
+        member_fill_kernel (bank_member_type bank_, leaf_member_type leaf_, typed_branch_entry<T> & entry_)
+          : _bank_ (bank_), _leaf_ (leaf_), _entry_ (entry_)
+        {
+          return;
+        }
+
+        virtual void fill (const export_event & event_) const
+        {
+          const std::vector<Bank> & bank = event_.*_bank_;
+          const unsigned int size = bank.size ();
+          // An empty bank leaves the storage as is (see export_root_event::fill_branch_memory)
+          if (size == 0) return;
+          typename typed_branch_entry<T>::storage_type * values = _entry_.grab_values (size);
+          for (unsigned int i = 0; i < size; i++)
+            {
+              values[i] = branch_value_traits<T>::store (bank[i].*_leaf_);
+            }
+          return;
+        }
+
+      private:
+
+        bank_member_type        _bank_;  /// Bank in the event
+        leaf_member_type        _leaf_;  /// Leaf in the bank elements
+        typed_branch_entry<T> & _entry_; /// Branch storage
+
+      };
+
+      /// Check if a member has the missing value (see branch_entry_type::is_null_value)
+      template<class T>
+      inline bool is_null_member (T value_)
+      {
+        return static_cast<int32_t> (value_) == -1;
+      }
+
+      inline bool is_null_member (bool)
+      {
+        return false;
+      }
+
+      inline bool is_null_member (float value_)
+      {
+        return std::isnan (value_);
+      }
+
+      inline bool is_null_member (double value_)
+      {
+        return std::isnan (value_);
+      }
+
+      /// \brief Fill kernel of a nullable leaf : the non missing values of a member and their counter
+      template<class Bank, class T>
+      class nullable_member_fill_kernel : public leaf_fill_kernel
+      {
+      public:
+
+        typedef std::vector<Bank> export_event::* bank_member_type;
+        typedef T Bank::* leaf_member_type;
+
+        nullable_member_fill_kernel (bank_member_type bank_, leaf_member_type leaf_,
+                                     typed_branch_entry<T> & entry_,
+                                     typed_branch_entry<UInt_t> & counter_)
+          : _bank_ (bank_), _leaf_ (leaf_), _entry_ (entry_), _counter_ (counter_)
+        {
+          return;
+        }
+
+        virtual void fill (const export_event & event_) const
+        {
+          const std::vector<Bank> & bank = event_.*_bank_;
+          const unsigned int size = bank.size ();
+          _counter_.set_value (0);
+          if (size == 0) return;
+          typename typed_branch_entry<T>::storage_type * values = _entry_.grab_values (size);
+          unsigned int number_of_values = 0;
+          for (unsigned int i = 0; i < size; i++)
+            {
+              // Missing values are only flagged in the validity bitmap :
+              const T value = bank[i].*_leaf_;
+              if (is_null_member (value)) continue;
+              values[number_of_values++] = branch_value_traits<T>::store (value);
+            }
+          _counter_.set_value (number_of_values);
+          return;
+        }
+
+      private:
+
+        bank_member_type             _bank_;    /// Bank in the event
+        leaf_member_type             _leaf_;    /// Leaf in the bank elements
+        typed_branch_entry<T> &      _entry_;   /// Branch storage
+        typed_branch_entry<UInt_t> & _counter_; /// Storage of the number of non missing values
+
+      };
+
+      /// \brief Fill kernel of a leaf constant within the event : a single value and its counter,
+      ///        or the members of all the elements if they disagree
+      template<class Bank, class T>
+      class event_scope_fill_kernel : public leaf_fill_kernel
+      {
+      public:
+
+        typedef std::vector<Bank> export_event::* bank_member_type;
+        typedef T Bank::* leaf_member_type;
+
+        event_scope_fill_kernel (bank_member_type bank_, leaf_member_type leaf_,
+                                 typed_branch_entry<T> & entry_,
+                                 typed_branch_entry<UInt_t> & counter_)
+          : _bank_ (bank_), _leaf_ (leaf_), _entry_ (entry_), _counter_ (counter_)
+        {
+          return;
+        }
+
+        virtual void fill (const export_event & event_) const
+        {
+          const std::vector<Bank> & bank = event_.*_bank_;
+          const unsigned int size = bank.size ();
+          _counter_.set_value (0);
+          if (size == 0) return;
+          const T value = bank.front ().*_leaf_;
+          unsigned int number_of_values = 1;
+          for (unsigned int i = 1; i < size; i++)
+            {
+              if (bank[i].*_leaf_ != value)
+                {
+                  number_of_values = size;
+                  break;
+                }
+            }
+          typename typed_branch_entry<T>::storage_type * values = _entry_.grab_values (number_of_values);
+          for (unsigned int i = 0; i < number_of_values; i++)
+            {
+              values[i] = branch_value_traits<T>::store (bank[i].*_leaf_);
+            }
+          _counter_.set_value (number_of_values);
+          return;
+        }
+
+      private:
+
+        bank_member_type             _bank_;    /// Bank in the event
+        leaf_member_type             _leaf_;    /// Leaf in the bank elements
+        typed_branch_entry<T> &      _entry_;   /// Branch storage
+        typed_branch_entry<UInt_t> & _counter_; /// Storage of the number of stored values (1 or the bank size)
+
+      };
+
+      /// \brief Fill kernel of the size counter of a bank
+      template<class Bank>
+      class bank_size_fill_kernel : public leaf_fill_kernel
+      {
+      public:
+
+        typedef std::vector<Bank> export_event::* bank_member_type;
+
+        bank_size_fill_kernel (bank_member_type bank_, typed_branch_entry<UInt_t> & entry_)
+          : _bank_ (bank_), _entry_ (entry_)
+        {
+          return;
+        }
+
+        virtual void fill (const export_event & event_) const
+        {
+          _entry_.set_value ((event_.*_bank_).size ());
+          return;
+        }
+
+      private:
+
+        bank_member_type             _bank_;  /// Bank in the event
+        typed_branch_entry<UInt_t> & _entry_; /// Branch storage
+
+      };
+
+      /// \brief Test of a member of the elements of a bank, giving a bit of a bitfield
+      template<class Bank>
+      struct member_bit_test
+      {
+        virtual ~member_bit_test ()
+        {
+          return;
+        }
+        virtual bool test (const Bank & element_) const = 0;
+      };
+
+      /// \brief Bit of a boolean member, or flag of the non missing value of a member (validity bitmap)
+      template<class Bank, class T>
+      class typed_member_bit_test : public member_bit_test<Bank>
+      {
+      public:
+
+        typed_member_bit_test (T Bank::* leaf_, bool validity_)
+          : _leaf_ (leaf_), _validity_ (validity_)
+        {
+          return;
+        }
+
+        virtual bool test (const Bank & element_) const
+        {
+          const T value = element_.*_leaf_;
+          return _validity_ ? ! is_null_member (value) : value != T ();
+        }
+
+      private:
+
+        T Bank::* _leaf_;     /// Leaf in the bank elements
+        bool      _validity_; /// Flag for a validity bitmap
+
+      };
+
+      /// \brief Fill kernel packing members of all the elements of a bank in a bitfield, the first one in the lowest bit
+      template<class Bank, class Storage>
+      class bitfield_fill_kernel : public leaf_fill_kernel
+      {
+      public:
+
+        typedef std::vector<Bank> export_event::* bank_member_type;
+        typedef boost::ptr_vector<member_bit_test<Bank> > bit_col_type;
+
+        bitfield_fill_kernel (bank_member_type bank_, bit_col_type & bits_, typed_branch_entry<Storage> & entry_)
+          : _bank_ (bank_), _entry_ (entry_)
+        {
+          _bits_.transfer (_bits_.end (), bits_);
+          return;
+        }
+
+        virtual void fill (const export_event & event_) const
+        {
+          const std::vector<Bank> & bank = event_.*_bank_;
+          const unsigned int size = bank.size ();
+          if (size == 0) return;
+          Storage * values = _entry_.grab_values (size);
+          for (unsigned int i = 0; i < size; i++)
+            {
+              uint32_t bits = 0;
+              for (size_t j = 0; j < _bits_.size (); j++)
+                {
+                  if (_bits_[j].test (bank[i])) bits |= (1U << j);
+                }
+              values[i] = static_cast<Storage> (bits);
+            }
+          return;
+        }
+
+      private:
+
+        bank_member_type              _bank_;  /// Bank in the event
+        bit_col_type                  _bits_;  /// Tests of the members (bit rank order)
+        typed_branch_entry<Storage> & _entry_; /// Branch storage
+
+      };
+
+      /// \brief Descriptor visitor building the tests of the members of a bitfield
+      template<class Bank>
+      class member_bit_test_builder
+      {
+      public:
+
+        typedef boost::ptr_vector<boost::nullable<member_bit_test<Bank> > > bit_col_type;
+
+        member_bit_test_builder (const branch_entry_type & entry_)
+          : _entry_ (entry_)
+        {
+          for (size_t i = 0; i < entry_.get_bitfield_members ().size (); i++)
+            {
+              _bits_.push_back (static_cast<member_bit_test<Bank> *> (0));
+            }
+          return;
+        }
+
+        template<class T>
+        void operator() (const char * leaf_name_, T Bank::* leaf_)
+        {
+          const int rank = _entry_.get_bitfield_rank (leaf_name_);
+          if (rank < 0) return;
+          _bits_.replace (rank, new typed_member_bit_test<Bank, T> (leaf_, _entry_.is_validity_bitmap ()));
+          return;
+        }
+
+        /// Transfer the tests, return false if a member has no leaf in the descriptor
+        bool release (boost::ptr_vector<member_bit_test<Bank> > & bits_)
+        {
+          for (size_t i = 0; i < _bits_.size (); i++)
+            {
+              if (_bits_.is_null (i)) return false;
+            }
+          for (size_t i = 0; i < _bits_.size (); i++)
+            {
+              bits_.push_back (_bits_.replace (i, static_cast<member_bit_test<Bank> *> (0)).release ());
+            }
+          return true;
+        }
+
+      private:
+
+        const branch_entry_type & _entry_; /// Bitfield
+        bit_col_type              _bits_;  /// Tests of the members (bit rank order)
+
+      };
+
+      /// \brief Descriptor visitor building the fill kernels of the leaves of a bank
+      template<class Bank>
+      class fill_kernel_builder
+      {
+      public:
+
+        typedef std::vector<Bank> export_event::* bank_member_type;
+
+        fill_kernel_builder (branch_manager & manager_,
+                             const std::string & bank_name_,
+                             bank_member_type bank_,
+                             fill_kernel_col_type & kernels_)
+          : _manager_ (manager_), _bank_name_ (bank_name_), _bank_ (bank_), _kernels_ (kernels_)
+        {
+          return;
+        }
+
+        template<class T>
+        void operator() (const char * leaf_name_, T Bank::* leaf_)
+        {
+          const std::string name = _bank_name_ + '.' + leaf_name_;
+          if (! _manager_.has_branch (name)) return;
+          branch_entry_type & entry = _manager_.grab_branch (name);
+          if (entry.is_inhibited () || entry.is_array_fixed_size () || entry.is_bitfield ()) return;
+          // The type of the entries is checked once, when the kernel is bound to their storage :
+          if (entry.is_event_scope ())
+            {
+              typed_branch_entry<UInt_t> & counter
+                = _manager_.grab_branch (entry.get_array_size_name ()).as<UInt_t> ();
+              _bind (entry, new event_scope_fill_kernel<Bank, T> (_bank_, leaf_, entry.as<T> (), counter));
+            }
+          else if (entry.is_nullable ())
+            {
+              typed_branch_entry<UInt_t> & counter
+                = _manager_.grab_branch (entry.get_array_size_name ()).as<UInt_t> ();
+              _bind (entry, new nullable_member_fill_kernel<Bank, T> (_bank_, leaf_, entry.as<T> (), counter));
+            }
+          else if (entry.is_array ())
+            {
+              _bind (entry, new member_fill_kernel<Bank, T> (_bank_, leaf_, entry.as<T> ()));
+            }
+          return;
+        }
+
+        /// Build the kernels of the size counter and of the bitfields of the bank
+        void build_bank_kernels ()
+        {
+          const std::string size_name = _bank_name_ + "@size";
+          if (_manager_.has_branch (size_name))
+            {
+              branch_entry_type & entry = _manager_.grab_branch (size_name);
+              _bind (entry, new bank_size_fill_kernel<Bank> (_bank_, entry.as<UInt_t> ()));
+            }
+          const branch_manager::bi_col_type & bis = _manager_.get_branch_infos ();
+          for (size_t i = 0; i < bis.size (); i++)
+            {
+              branch_entry_type & entry = *bis[i];
+              if (entry.get_parent_name () != _bank_name_) continue;
+              if (entry.is_inhibited () || ! entry.is_bitfield () || ! entry.is_array ()) continue;
+              member_bit_test_builder<Bank> bit_builder (entry);
+              bank_descriptor<Bank>::visit (bit_builder);
+              typename bitfield_fill_kernel<Bank, UInt_t>::bit_col_type bits;
+              // A bitfield of members out of the descriptor is filled through CAMP :
+              if (! bit_builder.release (bits)) continue;
+              switch (entry.get_type ())
+                {
+                case branch_entry_type::TYPE_UCHAR :
+                  _bind (entry, new bitfield_fill_kernel<Bank, UChar_t> (_bank_, bits, entry.as<UChar_t> ()));
+                  break;
+                case branch_entry_type::TYPE_UINT16 :
+                  _bind (entry, new bitfield_fill_kernel<Bank, UShort_t> (_bank_, bits, entry.as<UShort_t> ()));
+                  break;
+                case branch_entry_type::TYPE_UINT32 :
+                  _bind (entry, new bitfield_fill_kernel<Bank, UInt_t> (_bank_, bits, entry.as<UInt_t> ()));
+                  break;
+                }
+            }
+          return;
+        }
+
+      protected:
+
+        void _bind (const branch_entry_type & entry_, leaf_fill_kernel * kernel_)
+        {
+          const branch_manager::bi_col_type & bis = _manager_.get_branch_infos ();
+          const std::size_t index = std::find (bis.begin (), bis.end (), &entry_) - bis.begin ();
+          _kernels_.replace (index, kernel_);
+          return;
+        }
+
+      private:
+
+        branch_manager &       _manager_;   /// Branches
+        std::string            _bank_name_; /// Name of the bank (ex: "calibTrackerHits")
+        bank_member_type       _bank_;      /// Bank in the event
+        fill_kernel_col_type & _kernels_;   /// Built kernels
+
+      };
+
+      /// Build the fill kernels of the leaves of a bank from its descriptor (one slot per branch entry)
+      template<class Bank>
+      void make_fill_kernels (branch_manager & manager_,
+                              const std::string & bank_name_,
+                              std::vector<Bank> export_event::* bank_,
+                              fill_kernel_col_type & kernels_)
+      {
+        fill_kernel_builder<Bank> builder (manager_, bank_name_, bank_, kernels_);
+        bank_descriptor<Bank>::visit (builder);
+        builder.build_bank_kernels ();
+        return;
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // SNRECONSTRUCTION_EXPORTS_BANK_DESCRIPTOR_H
+
+// end of bank_descriptor.h
@@ -0,0 +1,155 @@
+// -*- mode: c++ ; -*-
+/* column_sink.cc */
+
+#include <falaise/snemo/exports/column_sink.h>
+#include <falaise/snemo/exports/root_utils.h>
+#include <falaise/snemo/exports/native_column_sink.h>
+#if FALAISE_ROOTEXPORTER_WITH_PARQUET == 1
+#include <falaise/snemo/exports/parquet_column_sink.h>
+#endif
+#if FALAISE_ROOTEXPORTER_WITH_HDF5 == 1
+#include <falaise/snemo/exports/hdf5_column_sink.h>
+#endif
+
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/algorithm/string.hpp>
+
+#include <datatools/properties.h>
+#include <datatools/exception.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      column_sink::column_sink ()
+      {
+        return;
+      }
+
+      column_sink::~column_sink ()
+      {
+        return;
+      }
+
+      void column_sink::initialize (const datatools::properties & config_)
+      {
+        if (config_.has_key ("logging.priority"))
+          {
+            set_logging_priority (config_.fetch_string ("logging.priority"));
+          }
+        return;
+      }
+
+      // static
+      bool column_sink::has_format (const std::string & format_)
+      {
+        if (format_ == "native") return true;
+#if FALAISE_ROOTEXPORTER_WITH_PARQUET == 1
+        if (format_ == "parquet") return true;
+#endif
+#if FALAISE_ROOTEXPORTER_WITH_HDF5 == 1
+        if (format_ == "hdf5") return true;
+#endif
+        return false;
+      }
+
+      // static
+      column_sink * column_sink::create (const std::string & format_)
+      {
+        DT_THROW_IF (! has_format (format_), std::logic_error,
+                     "Column export format '" << format_ << "' is not supported !");
+        if (format_ == "native")
+          {
+            return new native_column_sink;
+          }
+#if FALAISE_ROOTEXPORTER_WITH_PARQUET == 1
+        if (format_ == "parquet")
+          {
+            return new parquet_column_sink;
+          }
+#endif
+#if FALAISE_ROOTEXPORTER_WITH_HDF5 == 1
+        if (format_ == "hdf5")
+          {
+            return new hdf5_column_sink;
+          }
+#endif
+        return 0;
+      }
+
+      // static
+      void column_sink::_collect_columns (branch_manager & branch_manager_,
+                                          uint32_t store_bits_,
+                                          std::vector<branch_entry_type *> & columns_)
+      {
+        columns_.clear ();
+        branch_manager::bi_col_type & bis = branch_manager_.grab_branch_infos ();
+        for (size_t i = 0; i < bis.size (); i++)
+          {
+            branch_entry_type & bi = *(bis[i]);
+            if (bi.is_inhibited ()) continue;
+            if (! (bi.get_store_bit () & store_bits_)) continue;
+            // Bank versions are constant : they are stored as metadata
+            if (boost::ends_with (bi.get_name (), "@version")) continue;
+            columns_.push_back (&bi);
+          }
+        return;
+      }
+
+      // static
+      void column_sink::_collect_metadata (branch_manager & branch_manager_,
+                                           uint32_t store_bits_,
+                                           std::map<std::string, std::string> & metadata_)
+      {
+        metadata_.clear ();
+        {
+          std::ostringstream oss;
+          oss << store_bits_;
+          metadata_["export_flags"] = oss.str ();
+        }
+        {
+          std::vector<std::string> layout;
+          branch_manager_.get_layout_flags (layout);
+          metadata_["layout"] = boost::join (layout, ",");
+        }
+        const branch_manager::bank_col_type & banks = branch_manager_.get_banks ();
+        for (size_t i = 0; i < banks.size (); i++)
+          {
+            if (! (banks[i].store_bit & store_bits_)) continue;
+            std::ostringstream oss;
+            oss << banks[i].version;
+            metadata_[banks[i].name + "@version"] = oss.str ();
+          }
+        const branch_manager::bi_col_type & bis = branch_manager_.get_branch_infos ();
+        for (size_t i = 0; i < bis.size (); i++)
+          {
+            const branch_entry_type & bi = *(bis[i]);
+            if (! (bi.get_store_bit () & store_bits_)) continue;
+            if (bi.is_inhibited ()) continue;
+            if (bi.is_validity_bitmap ())
+              {
+                metadata_[bi.get_parent_name () + "@nullable"] = boost::join (bi.get_bitfield_members (), ",");
+              }
+            else if (bi.is_bitfield ())
+              {
+                metadata_[bi.get_name () + "@bitfield"] = boost::join (bi.get_bitfield_members (), ",");
+              }
+            if (bi.is_event_scope ())
+              {
+                metadata_[bi.get_name () + "@scope"] = "event";
+              }
+          }
+        return;
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of column_sink.cc
@@ -0,0 +1,101 @@
+// -*- mode: c++ ; -*-
+/* column_sink.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Abstract sink for column oriented (non-ROOT) export formats
+ *
+ * History:
+ *
+ */
+
+#ifndef SNRECONSTRUCTION_EXPORTS_COLUMN_SINK_H
+#define SNRECONSTRUCTION_EXPORTS_COLUMN_SINK_H 1
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <boost/cstdint.hpp>
+
+#include <falaise/snemo/exports/loggable_support.h>
+
+namespace datatools {
+  class properties;
+}
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      class branch_manager;
+      struct branch_entry_type;
+
+      /// \brief Base class for sinks that store the columns built by a branch manager
+      ///
+      /// A column sink uses the very same bank/leaf schema than the ROOT export
+      /// (see branch_manager::init_bank_from_camp) : it is fed, entry after entry,
+      /// with the branch memory filled by export_root_event::fill_memory.
+      class column_sink : public loggable_support
+      {
+      public:
+
+        /// Default constructor
+        column_sink ();
+
+        /// Destructor
+        virtual ~column_sink ();
+
+        /// Configure the sink from a set of properties (format specific)
+        virtual void initialize (const datatools::properties & config_);
+
+        /// Open a new output file
+        virtual void open (const std::string & filename_,
+                           branch_manager & branch_manager_,
+                           uint32_t store_bits_) = 0;
+
+        /// Store the current content of the branch memory as a new entry
+        virtual void store_entry () = 0;
+
+        /// Close the current output file
+        virtual void close () = 0;
+
+        /// Check if an output file is open
+        virtual bool is_open () const = 0;
+
+        /// Return the label of the format
+        virtual std::string get_format () const = 0;
+
+        /// Check if a given format is supported by this build
+        static bool has_format (const std::string & format_);
+
+        /// Create a new sink for a given format (the caller owns the result)
+        static column_sink * create (const std::string & format_);
+
+      protected:
+
+        /// Collect the stored and active branch entries of a branch manager
+        static void _collect_columns (branch_manager & branch_manager_,
+                                      uint32_t store_bits_,
+                                      std::vector<branch_entry_type *> & columns_);
+
+        /// Collect the file level metadata (bank versions, export flags...)
+        static void _collect_metadata (branch_manager & branch_manager_,
+                                       uint32_t store_bits_,
+                                       std::map<std::string, std::string> & metadata_);
+
+      };
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // SNRECONSTRUCTION_EXPORTS_COLUMN_SINK_H
+
+// end of column_sink.h
@@ -0,0 +1,188 @@
+// -*- mode: c++ ; -*-
+/* event_arena.cc */
+
+#include <falaise/snemo/exports/event_arena.h>
+
+#include <stdexcept>
+#include <algorithm>
+
+#include <datatools/exception.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      // static
+      const std::size_t event_arena::DEFAULT_BLOCK_SIZE;
+
+      event_arena::statistics_type::statistics_type ()
+      {
+        releases = 0;
+        allocations = 0;
+        blocks = 0;
+        capacity = 0;
+        used = 0;
+        high_water = 0;
+        return;
+      }
+
+      event_arena::event_arena (std::size_t block_size_)
+      {
+        DT_THROW_IF (block_size_ == 0, std::logic_error, "Invalid null block size !");
+        _active_ = false;
+        _block_size_ = block_size_;
+        _current_ = 0;
+        _offset_ = 0;
+        _spilled_ = 0;
+        return;
+      }
+
+      event_arena::event_arena (const event_arena & other_)
+      {
+        _active_ = other_._active_;
+        _block_size_ = other_._block_size_;
+        _current_ = 0;
+        _offset_ = 0;
+        _spilled_ = 0;
+        return;
+      }
+
+      event_arena::~event_arena ()
+      {
+        clear ();
+        return;
+      }
+
+      event_arena & event_arena::operator= (const event_arena & other_)
+      {
+        if (this != &other_)
+          {
+            _active_ = other_._active_;
+            _block_size_ = other_._block_size_;
+          }
+        return *this;
+      }
+
+      bool event_arena::is_active () const
+      {
+        return _active_;
+      }
+
+      void event_arena::set_active (bool active_)
+      {
+        _active_ = active_;
+        return;
+      }
+
+      std::size_t event_arena::get_block_size () const
+      {
+        return _block_size_;
+      }
+
+      void * event_arena::allocate (std::size_t size_, std::size_t alignment_)
+      {
+        if (! _active_) return 0;
+        if (_blocks_.empty ())
+          {
+            _add_block (std::max (_block_size_, size_ + alignment_));
+          }
+        while (true)
+          {
+            const block_type & block = _blocks_[_current_];
+            const std::size_t address = reinterpret_cast<std::size_t> (block.data + _offset_);
+            const std::size_t padding = (alignment_ - address % alignment_) % alignment_;
+            if (_offset_ + padding + size_ <= block.size)
+              {
+                void * storage = block.data + _offset_ + padding;
+                _offset_ += padding + size_;
+                _statistics_.allocations++;
+                _statistics_.used = _spilled_ + _offset_;
+                _statistics_.high_water = std::max (_statistics_.high_water, _statistics_.used);
+                return storage;
+              }
+            // The event spills over the next block :
+            _spilled_ += _offset_;
+            _offset_ = 0;
+            if (_current_ + 1 == _blocks_.size ())
+              {
+                _add_block (std::max (2 * block.size, size_ + alignment_));
+              }
+            _current_++;
+          }
+      }
+
+      void event_arena::release ()
+      {
+        _statistics_.releases++;
+        if (_blocks_.size () > 1)
+          {
+            // Merge the blocks, so that the next events fit in a single one :
+            const std::size_t size = std::max (_block_size_, _statistics_.high_water);
+            clear ();
+            _add_block (size);
+          }
+        _current_ = 0;
+        _offset_ = 0;
+        _spilled_ = 0;
+        _statistics_.used = 0;
+        return;
+      }
+
+      void event_arena::clear ()
+      {
+        for (size_t i = 0; i < _blocks_.size (); i++)
+          {
+            delete [] _blocks_[i].data;
+          }
+        _blocks_.clear ();
+        _statistics_.capacity = 0;
+        _statistics_.used = 0;
+        _current_ = 0;
+        _offset_ = 0;
+        _spilled_ = 0;
+        return;
+      }
+
+      const event_arena::statistics_type & event_arena::get_statistics () const
+      {
+        return _statistics_;
+      }
+
+      void event_arena::_add_block (std::size_t size_)
+      {
+        block_type block;
+        block.data = new char [size_];
+        block.size = size_;
+        _blocks_.push_back (block);
+        _statistics_.blocks++;
+        _statistics_.capacity += size_;
+        return;
+      }
+
+      void event_arena::print (std::ostream & out_,
+                               const std::string & title_,
+                               const std::string & indent_) const
+      {
+        if (! title_.empty ())
+          {
+            out_ << indent_ << title_ << ": \n";
+          }
+        out_ << indent_ << "|-- " << "Active      : " << _active_ << "\n";
+        out_ << indent_ << "|-- " << "Block size  : " << _block_size_ << "\n";
+        out_ << indent_ << "|-- " << "Releases    : " << _statistics_.releases << "\n";
+        out_ << indent_ << "|-- " << "Allocations : " << _statistics_.allocations << "\n";
+        out_ << indent_ << "|-- " << "Heap blocks : " << _statistics_.blocks << "\n";
+        out_ << indent_ << "|-- " << "Capacity    : " << _statistics_.capacity << "\n";
+        out_ << indent_ << "`-- " << "High-water  : " << _statistics_.high_water << "\n";
+        return;
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of event_arena.cc
@@ -0,0 +1,128 @@
+// -*- mode: c++ ; -*-
+/* event_arena.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Monotonic memory region for the per-event storage
+ *
+ *   Allocations are carved out of large blocks and are never freed one by
+ *   one : the whole region is released at once at the end of the event and
+ *   its blocks are reused by the next one. When an event needed more than
+ *   one block, the blocks are merged in a single block as large as the
+ *   high-water mark, so that after a few events the region is a single
+ *   allocation reused for the rest of the run.
+ *
+ *   The banks of the export event and the branch buffers are vectors which
+ *   keep their capacity from one event to the other ; the arena serves the
+ *   storage allocated per element (out of line payloads).
+ *
+ * History:
+ *
+ */
+
+#ifndef SNRECONSTRUCTION_EXPORTS_EVENT_ARENA_H
+#define SNRECONSTRUCTION_EXPORTS_EVENT_ARENA_H 1
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <iostream>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      /// \brief Monotonic memory region released at the end of each event
+      class event_arena
+      {
+      public:
+
+        /// Default size of the first block (bytes)
+        static const std::size_t DEFAULT_BLOCK_SIZE = 65536;
+
+        /// Statistics
+        struct statistics_type
+        {
+          std::size_t releases;    /// Number of releases (events)
+          std::size_t allocations; /// Number of allocations
+          std::size_t blocks;      /// Number of blocks allocated from the heap
+          std::size_t capacity;    /// Current capacity (bytes)
+          std::size_t used;        /// Bytes used by the current event
+          std::size_t high_water;  /// Maximum number of bytes used by an event
+          statistics_type ();
+        };
+
+        /// Constructor
+        explicit event_arena (std::size_t block_size_ = DEFAULT_BLOCK_SIZE);
+
+        /// Copy constructor (the copy is an empty region with the same settings)
+        event_arena (const event_arena & other_);
+
+        /// Destructor
+        ~event_arena ();
+
+        /// Assignment (the storage of the region is kept)
+        event_arena & operator= (const event_arena & other_);
+
+        /// Check if the region serves the allocations
+        bool is_active () const;
+
+        /// Set the activity flag (an inactive region returns no storage)
+        void set_active (bool);
+
+        /// Return the size of the first block
+        std::size_t get_block_size () const;
+
+        /// Allocate some storage, return 0 if the region is inactive
+        void * allocate (std::size_t size_, std::size_t alignment_);
+
+        /// Release all the allocations at once (the blocks are kept)
+        void release ();
+
+        /// Free the blocks
+        void clear ();
+
+        /// Return the statistics
+        const statistics_type & get_statistics () const;
+
+        /// Smart print
+        void print (std::ostream & out_ = std::clog,
+                    const std::string & title_ = "",
+                    const std::string & indent_ = "") const;
+
+      protected:
+
+        /// Add a block of at least a given size
+        void _add_block (std::size_t size_);
+
+      private:
+
+        struct block_type
+        {
+          char *      data; /// Storage
+          std::size_t size; /// Size (bytes)
+        };
+
+        bool                    _active_;     /// Activity flag
+        std::size_t             _block_size_; /// Size of the first block
+        std::vector<block_type> _blocks_;     /// Blocks
+        std::size_t             _current_;    /// Index of the current block
+        std::size_t             _offset_;     /// Offset of the first free byte in the current block
+        std::size_t             _spilled_;    /// Bytes used in the blocks before the current one
+        statistics_type         _statistics_; /// Statistics
+
+      };
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // SNRECONSTRUCTION_EXPORTS_EVENT_ARENA_H
+
+// end of event_arena.h
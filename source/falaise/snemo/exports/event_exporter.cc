@@ -3,6 +3,7 @@
 
 #include <falaise/snemo/exports/event_exporter.h>
 #include <falaise/snemo/exports/export_event.h>
+#include <falaise/snemo/exports/task_pool.h>
 
 #include <mctools/simulated_data.h>
 #include <falaise/snemo/datamodels/event_header.h>
@@ -19,8 +20,14 @@
 
 #include <geomtools/manager.h>
 #include <datatools/things_macros.h>
+#include <datatools/handle.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
 
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/algorithm/string/join.hpp>
 #include <boost/foreach.hpp>
 
 
@@ -35,6 +42,32 @@ namespace snemo {
       // namespace scu = snemo::core::utils;
       namespace sre = snemo::reconstruction::exports;
 
+      namespace {
+
+        /// Map the identifiers of the rows of a bank to their indexes
+        template<class Type>
+        void index_rows (const std::vector<Type> & rows_,
+                         int32_t Type::* id_,
+                         std::map<int32_t, int32_t> & indexes_)
+        {
+          indexes_.clear ();
+          for (size_t i = 0; i < rows_.size (); i++)
+            {
+              indexes_[rows_[i].*id_] = i;
+            }
+          return;
+        }
+
+        /// Compare two step hits by start time (missing times last)
+        bool step_hit_less (const true_step_hit_type & hit0_, const true_step_hit_type & hit1_)
+        {
+          if (std::isnan (hit0_.tstart)) return false;
+          if (std::isnan (hit1_.tstart)) return true;
+          return hit0_.tstart < hit1_.tstart;
+        }
+
+      }
+
       bool event_exporter::is_initialized () const
       {
         return _initialized_;
@@ -71,6 +104,43 @@ namespace snemo {
         return;
       }
 
+      event_exporter::reference_counters_type::reference_counters_type ()
+      {
+        reset ();
+        return;
+      }
+
+      void event_exporter::reference_counters_type::reset ()
+      {
+        resolved = 0;
+        unresolved.clear ();
+        return;
+      }
+
+      uint64_t event_exporter::reference_counters_type::get_number_of_unresolved () const
+      {
+        uint64_t n = 0;
+        for (std::map<std::string, uint64_t>::const_iterator i = unresolved.begin ();
+             i != unresolved.end ();
+             i++)
+          {
+            n += i->second;
+          }
+        return n;
+      }
+
+      void event_exporter::reference_counters_type::merge (const reference_counters_type & counters_)
+      {
+        resolved += counters_.resolved;
+        for (std::map<std::string, uint64_t>::const_iterator i = counters_.unresolved.begin ();
+             i != counters_.unresolved.end ();
+             i++)
+          {
+            unresolved[i->first] += i->second;
+          }
+        return;
+      }
+
       void event_exporter::gid_info_type::reset ()
       {
         gid_gg_module_index    = geomtools::geom_id::INVALID_ADDRESS;
@@ -192,11 +262,166 @@ namespace snemo {
         _export_cat_infos_ = xci_;
       }
 
+      bool event_exporter::are_cat_infos_sparse () const
+      {
+        return _sparse_cat_infos_;
+      }
+
+      void event_exporter::set_cat_infos_sparse (bool sparse_)
+      {
+        _sparse_cat_infos_ = sparse_;
+        return;
+      }
+
+      bool event_exporter::are_memberships_offset_encoded () const
+      {
+        return _offset_memberships_;
+      }
+
+      void event_exporter::set_memberships_offset_encoded (bool offsets_)
+      {
+        _offset_memberships_ = offsets_;
+        return;
+      }
+
+      bool event_exporter::are_row_indexes_exported () const
+      {
+        return _row_indexes_;
+      }
+
+      void event_exporter::set_row_indexes_exported (bool indexes_)
+      {
+        _row_indexes_ = indexes_;
+        return;
+      }
+
+      // static
+      const unsigned int event_exporter::DEFAULT_PARALLEL_THRESHOLD;
+
+      unsigned int event_exporter::get_number_of_threads () const
+      {
+        return _number_of_threads_;
+      }
+
+      void event_exporter::set_number_of_threads (unsigned int nthreads_)
+      {
+        DT_THROW_IF (is_initialized (), std::logic_error, "Event exporter is already initialized !");
+        DT_THROW_IF (nthreads_ == 0, std::domain_error, "Invalid number of threads !");
+        _number_of_threads_ = nthreads_;
+        return;
+      }
+
+      unsigned int event_exporter::get_parallel_threshold () const
+      {
+        return _parallel_threshold_;
+      }
+
+      void event_exporter::set_parallel_threshold (unsigned int threshold_)
+      {
+        _parallel_threshold_ = threshold_;
+        return;
+      }
+
+      bool event_exporter::is_event_arena_used () const
+      {
+        return _event_arena_;
+      }
+
+      void event_exporter::set_event_arena_used (bool arena_)
+      {
+        _event_arena_ = arena_;
+        return;
+      }
+
+      bool event_exporter::are_true_scin_hits_unified () const
+      {
+        return _unified_scin_hits_;
+      }
+
+      void event_exporter::set_true_scin_hits_unified (bool unified_)
+      {
+        _unified_scin_hits_ = unified_;
+        return;
+      }
+
+      const event_exporter::reference_counters_type &
+      event_exporter::get_reference_counters () const
+      {
+        return _reference_counters_;
+      }
+
+      void event_exporter::merge_reference_counters (const reference_counters_type & counters_)
+      {
+        _reference_counters_.merge (counters_);
+        return;
+      }
+
+      bool event_exporter::are_hits_sorted_by_cell_key () const
+      {
+        // All the banks with a cell key (all but the step hits) :
+        const std::vector<std::string> & banks = get_sortable_banks ();
+        for (size_t i = 1; i < banks.size (); i++)
+          {
+            if (! is_bank_sorted (banks[i])) return false;
+          }
+        return true;
+      }
+
+      void event_exporter::set_hits_sorted_by_cell_key (bool sort_)
+      {
+        const std::vector<std::string> & banks = get_sortable_banks ();
+        for (size_t i = 1; i < banks.size (); i++)
+          {
+            set_bank_sorted (banks[i], sort_);
+          }
+        return;
+      }
+
+      // static
+      const std::vector<std::string> & event_exporter::get_sortable_banks ()
+      {
+        static const char * const bank_names[] = {
+          "trueStepHits",
+          "trueCaloHits",
+          "trueXcaloHits",
+          "trueGvetoHits",
+          "trueScinHits",
+          "trueGgHits",
+          "calibScinHits",
+          "calibTrackerHits"
+        };
+        // Built in one statement : the initialization is thread-safe
+        static const std::vector<std::string> banks (bank_names,
+                                                     bank_names + sizeof (bank_names) / sizeof (bank_names[0]));
+        return banks;
+      }
+
+      bool event_exporter::is_bank_sorted (const std::string & bank_name_) const
+      {
+        return _sorted_banks_.count (bank_name_) > 0;
+      }
+
+      void event_exporter::set_bank_sorted (const std::string & bank_name_, bool sort_)
+      {
+        const std::vector<std::string> & banks = get_sortable_banks ();
+        DT_THROW_IF (std::find (banks.begin (), banks.end (), bank_name_) == banks.end (), std::logic_error,
+                     "Bank '" << bank_name_ << "' cannot be sorted in detector order !");
+        if (sort_)
+          {
+            _sorted_banks_.insert (bank_name_);
+          }
+        else
+          {
+            _sorted_banks_.erase (bank_name_);
+          }
+        return;
+      }
+
       int event_exporter::get_topic_export_level(const std::string & topic_label_) const
       {
         if (topic_label_ == "CAT")
           {
-            if (_export_cat_infos_) return EXPORT_TOPIC_INCLUDE;
+            if (_export_cat_infos_) return _sparse_cat_infos_ ? EXPORT_TOPIC_SPARSE : EXPORT_TOPIC_INCLUDE;
          }
         return EXPORT_TOPIC_NO_INCLUDE;
       }
@@ -238,6 +463,60 @@ namespace snemo {
             set_cat_infos_exported (true);
           }
 
+        if (setup_.has_flag ("export.sparse_cat_infos"))
+          {
+            set_cat_infos_sparse (true);
+          }
+
+        if (setup_.has_flag ("export.membership_offsets"))
+          {
+            set_memberships_offset_encoded (true);
+          }
+
+        if (setup_.has_flag ("export.row_indexes"))
+          {
+            set_row_indexes_exported (true);
+          }
+
+        if (setup_.has_flag ("export.unified_true_scin_hits"))
+          {
+            set_true_scin_hits_unified (true);
+          }
+
+        if (setup_.has_flag ("export.event_arena"))
+          {
+            set_event_arena_used (true);
+          }
+
+        if (setup_.has_key ("export.threads"))
+          {
+            const int nthreads = setup_.fetch_integer ("export.threads");
+            DT_THROW_IF (nthreads < 1, std::domain_error, "Invalid number of threads (" << nthreads << ") !");
+            set_number_of_threads (nthreads);
+          }
+
+        if (setup_.has_key ("export.parallel_threshold"))
+          {
+            const int threshold = setup_.fetch_integer ("export.parallel_threshold");
+            DT_THROW_IF (threshold < 0, std::domain_error, "Invalid parallel threshold (" << threshold << ") !");
+            set_parallel_threshold (threshold);
+          }
+
+        if (setup_.has_flag ("export.sort_hits_by_cell_key"))
+          {
+            set_hits_sorted_by_cell_key (true);
+          }
+
+        if (setup_.has_key ("export.sorted_banks"))
+          {
+            std::vector<std::string> sorted_banks;
+            setup_.fetch ("export.sorted_banks", sorted_banks);
+            for (size_t i = 0; i < sorted_banks.size (); i++)
+              {
+                set_bank_sorted (sorted_banks[i], true);
+              }
+          }
+
         if (setup_.has_flag ("export.event_header"))
           {
             set_exported (sre::event_exporter::EXPORT_EVENT_HEADER);
@@ -284,6 +563,11 @@ namespace snemo {
             set_exported (sre::event_exporter::EXPORT_ALL);
           }
 
+        if (_number_of_threads_ > 1)
+          {
+            _task_pool_.reset (new task_pool (_number_of_threads_));
+          }
+
         //dump (std::clog);
 
         _initialized_ = true;
@@ -293,6 +577,16 @@ namespace snemo {
       void event_exporter::reset ()
       {
         DT_THROW_IF (! is_initialized (), std::logic_error,  "Event exporter is not initialized ! ");
+        if (_reference_counters_.get_number_of_unresolved () > 0)
+          {
+            for (std::map<std::string, uint64_t>::const_iterator i = _reference_counters_.unresolved.begin ();
+                 i != _reference_counters_.unresolved.end ();
+                 i++)
+              {
+                DT_LOG_WARNING (datatools::logger::PRIO_WARNING,
+                                "Unresolved references '" << i->first << "' : " << i->second);
+              }
+          }
         _initialized_ = false;
         _init_defaults ();
         return;
@@ -316,6 +610,16 @@ namespace snemo {
         _export_flags_ = NO_EXPORT;
         _geom_manager_ = 0;
         _export_cat_infos_ = false;
+        _sparse_cat_infos_ = false;
+        _offset_memberships_ = false;
+        _row_indexes_ = false;
+        _unified_scin_hits_ = false;
+        _event_arena_ = false;
+        _number_of_threads_ = 1;
+        _parallel_threshold_ = DEFAULT_PARALLEL_THRESHOLD;
+        _task_pool_.reset ();
+        _reference_counters_.reset ();
+        _sorted_banks_.clear ();
         return;
       }
 
@@ -368,6 +672,14 @@ namespace snemo {
             out_ << i->first << " : " << "'" << i->second << "'" << std::endl;
           }
 
+        out_ << "|-- " << "Event arena : " << _event_arena_ << std::endl;
+        out_ << "|-- " << "Threads : " << _number_of_threads_ << std::endl;
+        out_ << "|-- " << "Parallel threshold : " << _parallel_threshold_ << " hits" << std::endl;
+        out_ << "|-- " << "Sorted banks : '"
+             << boost::join (_sorted_banks_, ",") << "'" << std::endl;
+        out_ << "|-- " << "Resolved references : " << _reference_counters_.resolved << std::endl;
+        out_ << "|-- " << "Unresolved references : "
+             << _reference_counters_.get_number_of_unresolved () << std::endl;
         out_ << "`-- " << "Export flags : " << '[' << _export_flags_ << ']' << std::endl;
         for (unsigned int bit = 1; bit <= event_exporter::EXPORT_LAST; bit *=2)
           {
@@ -407,6 +719,188 @@ namespace snemo {
           }
 
         ee_.clear_data ();
+        ee_.arena.set_active (_event_arena_);
+        // Large events have their independent banks converted concurrently :
+        if (_task_pool_ && _get_number_of_input_hits (er_) >= _parallel_threshold_)
+          {
+            _export_banks_concurrently (er_, ee_);
+          }
+        else
+          {
+            _export_banks (er_, ee_);
+          }
+
+        // References between banks are stored as row indexes next to the IDs :
+        if (_row_indexes_)
+          {
+            _resolve_references (ee_);
+          }
+
+        // Members of the clusters and trajectories are stored as offsets plus flat hit IDs :
+        if (_offset_memberships_)
+          {
+            ee_.build_membership_banks ();
+          }
+
+        // CAT informations are only stored for the hits and clusters which have some :
+        if (are_cat_infos_exported () && _sparse_cat_infos_)
+          {
+            ee_.build_cat_banks ();
+          }
+
+        // ee_.print (std::clog, "Export event", "DEVEL: ");
+        return 0;
+      }
+
+      namespace {
+
+        /// Copy a bank of an event record, if present, in another one (return the copy, null if none)
+        template<class Bank>
+        Bank * copy_bank (const datatools::things & source_,
+                          datatools::things & target_,
+                          const std::string & label_)
+        {
+          if (! DATATOOLS_THINGS_CHECK_BANK(source_, label_, Bank)) return 0;
+          DATATOOLS_THINGS_CONST_BANK(source_, label_, Bank, bank);
+          Bank & copy = target_.add<Bank> (label_);
+          copy = bank;
+          return &copy;
+        }
+
+        /// Copies of the objects referenced by the handles of a record : an object
+        /// referenced by several handles is copied once, so that the references
+        /// between the banks are kept
+        template<class T>
+        class handle_copier
+        {
+        public:
+
+          /// Re-point a handle at the copy of its object
+          void copy (datatools::handle<T> & handle_)
+          {
+            if (! handle_.has_data ()) return;
+            const T * original = &handle_.get ();
+            typename std::map<const T *, datatools::handle<T> >::iterator found = _copies_.find (original);
+            if (found == _copies_.end ())
+              {
+                found = _copies_.insert (std::make_pair (original, datatools::handle<T> (new T (*original)))).first;
+              }
+            handle_ = found->second;
+            return;
+          }
+
+          /// Re-point the handles of a collection at the copies of their objects
+          void copy (std::vector<datatools::handle<T> > & handles_)
+          {
+            for (size_t i = 0; i < handles_.size (); i++)
+              {
+                copy (handles_[i]);
+              }
+            return;
+          }
+
+        private:
+
+          std::map<const T *, datatools::handle<T> > _copies_; /// Copies by original object
+
+        };
+
+      }
+
+      void event_exporter::copy_record (const sdm::event_record & source_,
+                                        sdm::event_record & target_) const
+      {
+        DT_THROW_IF (! is_initialized (), std::logic_error, "Event exporter is not initialized ! ");
+        target_.clear ();
+        // The copied banks are converted while the next modules process the source record :
+        // the hits, clusters and trajectories are copied too, not shared with the source.
+        copy_bank<sdm::event_header> (source_, target_,
+                                      _bank_labels_.at (sdm::data_info::EVENT_HEADER_LABEL));
+
+        mctools::simulated_data * SD
+          = copy_bank<mctools::simulated_data> (source_, target_,
+                                                _bank_labels_.at (sdm::data_info::SIMULATED_DATA_LABEL));
+        if (SD != 0)
+          {
+            handle_copier<mctools::base_step_hit> step_hits;
+            std::vector<std::string> categories;
+            SD->get_step_hits_categories (categories);
+            for (size_t i = 0; i < categories.size (); i++)
+              {
+                step_hits.copy (SD->grab_step_hits (categories[i]));
+              }
+          }
+
+        handle_copier<sdm::calibrated_tracker_hit> tracker_hits;
+        sdm::calibrated_data * CD
+          = copy_bank<sdm::calibrated_data> (source_, target_,
+                                             _bank_labels_.at (sdm::data_info::CALIBRATED_DATA_LABEL));
+        if (CD != 0)
+          {
+            handle_copier<sdm::calibrated_calorimeter_hit> calorimeter_hits;
+            tracker_hits.copy (CD->calibrated_tracker_hits ());
+            calorimeter_hits.copy (CD->calibrated_calorimeter_hits ());
+          }
+
+        // Only the default solutions are read by the exporter :
+        handle_copier<sdm::tracker_cluster> clusters;
+        const std::string & tcd_label = _bank_labels_.at (sdm::data_info::TRACKER_CLUSTERING_DATA_LABEL);
+        if (DATATOOLS_THINGS_CHECK_BANK(source_, tcd_label, sdm::tracker_clustering_data))
+          {
+            DATATOOLS_THINGS_CONST_BANK(source_, tcd_label, sdm::tracker_clustering_data, source_TCD);
+            sdm::tracker_clustering_data & TCD = target_.add<sdm::tracker_clustering_data> (tcd_label);
+            if (source_TCD.has_default_solution ())
+              {
+                datatools::handle<sdm::tracker_clustering_solution>
+                  solution (new sdm::tracker_clustering_solution (source_TCD.get_default_solution ()));
+                sdm::tracker_clustering_solution::cluster_col_type & solution_clusters
+                  = solution.grab ().grab_clusters ();
+                clusters.copy (solution_clusters);
+                for (size_t i = 0; i < solution_clusters.size (); i++)
+                  {
+                    if (! solution_clusters[i].has_data ()) continue;
+                    tracker_hits.copy (solution_clusters[i].grab ().grab_hits ());
+                  }
+                tracker_hits.copy (solution.grab ().grab_unclustered_hits ());
+                TCD.add_solution (solution, true);
+              }
+          }
+
+        const std::string & ttd_label = _bank_labels_.at (sdm::data_info::TRACKER_TRAJECTORY_DATA_LABEL);
+        if (DATATOOLS_THINGS_CHECK_BANK(source_, ttd_label, sdm::tracker_trajectory_data))
+          {
+            DATATOOLS_THINGS_CONST_BANK(source_, ttd_label, sdm::tracker_trajectory_data, source_TTD);
+            sdm::tracker_trajectory_data & TTD = target_.add<sdm::tracker_trajectory_data> (ttd_label);
+            if (source_TTD.has_default_solution ())
+              {
+                datatools::handle<sdm::tracker_trajectory_solution>
+                  solution (new sdm::tracker_trajectory_solution (source_TTD.get_default_solution ()));
+                handle_copier<sdm::tracker_trajectory> trajectories;
+                sdm::tracker_trajectory_solution::trajectory_col_type & solution_trajectories
+                  = solution.grab ().grab_trajectories ();
+                trajectories.copy (solution_trajectories);
+                for (size_t i = 0; i < solution_trajectories.size (); i++)
+                  {
+                    if (! solution_trajectories[i].has_data ()) continue;
+                    sdm::tracker_trajectory & trajectory = solution_trajectories[i].grab ();
+                    if (trajectory.has_cluster ())
+                      {
+                        datatools::handle<sdm::tracker_cluster> cluster = trajectory.get_cluster_handle ();
+                        clusters.copy (cluster);
+                        trajectory.set_cluster_handle (cluster);
+                      }
+                    tracker_hits.copy (trajectory.grab_orphans ());
+                    // The fitted patterns are polymorphic : they are shared, being never modified once fitted.
+                  }
+                TTD.add_solution (solution, true);
+              }
+          }
+        return;
+      }
+
+      void event_exporter::_export_banks (const datatools::things & er_,
+                                          sre::export_event & ee_)
+      {
         if (is_exported (sre::event_exporter::EXPORT_EVENT_HEADER))
           {
             _export_event_header (er_, ee_);
@@ -437,6 +931,14 @@ namespace snemo {
             _export_calib_tracker_hits (er_, ee_);
           }
 
+        // Hits are stored in detector order ; this is done before any row index,
+        // membership offset or CAT parent index is built, so that all of them
+        // refer to the sorted rows :
+        if (! _sorted_banks_.empty ())
+          {
+            _sort_hits (ee_);
+          }
+
         if (is_exported (sre::event_exporter::EXPORT_TRACKER_CLUSTERING))
           {
             _export_tracker_clustering (er_, ee_);
@@ -446,9 +948,254 @@ namespace snemo {
           {
             _export_tracker_trajectories (er_, ee_);
           }
+        return;
+      }
 
-        // ee_.print (std::clog, "Export event", "DEVEL: ");
-        return 0;
+      void event_exporter::_export_banks_concurrently (const datatools::things & er_,
+                                                       sre::export_event & ee_)
+      {
+        // Each task writes its own banks of the export event ; the calibrated
+        // tracker hits and the clusters share the event arena (CAT payloads)
+        // and are converted by the same task :
+        std::vector<task_pool::task_type> tasks;
+        if (is_exported (EXPORT_EVENT_HEADER) || is_exported (EXPORT_TRUE_PARTICLES))
+          {
+            tasks.push_back ([this, &er_, &ee_] ()
+              {
+                if (is_exported (EXPORT_EVENT_HEADER)) _export_event_header (er_, ee_);
+                if (is_exported (EXPORT_TRUE_PARTICLES)) _export_true_particles (er_, ee_);
+              });
+          }
+        if (is_exported (EXPORT_TRUE_STEP_HITS))
+          {
+            tasks.push_back ([this, &er_, &ee_] () { _export_true_step_hits (er_, ee_); });
+          }
+        if (is_exported (EXPORT_TRUE_HITS))
+          {
+            tasks.push_back ([this, &er_, &ee_] () { _export_true_hits (er_, ee_); });
+          }
+        if (is_exported (EXPORT_CALIB_CALORIMETER_HITS))
+          {
+            tasks.push_back ([this, &er_, &ee_] () { _export_calib_calorimeter_hits (er_, ee_); });
+          }
+        if (is_exported (EXPORT_CALIB_TRACKER_HITS) || is_exported (EXPORT_TRACKER_CLUSTERING))
+          {
+            tasks.push_back ([this, &er_, &ee_] ()
+              {
+                if (is_exported (EXPORT_CALIB_TRACKER_HITS)) _export_calib_tracker_hits (er_, ee_);
+                if (is_exported (EXPORT_TRACKER_CLUSTERING)) _export_tracker_clustering (er_, ee_);
+              });
+          }
+        if (is_exported (EXPORT_TRACKER_TRAJECTORIES))
+          {
+            tasks.push_back ([this, &er_, &ee_] () { _export_tracker_trajectories (er_, ee_); });
+          }
+        _task_pool_->run (tasks);
+
+        // The clusters and trajectories only store hit IDs, the rows of the
+        // hits can thus be sorted once all the banks are converted :
+        if (! _sorted_banks_.empty ())
+          {
+            _sort_hits (ee_);
+          }
+        return;
+      }
+
+      std::size_t event_exporter::_get_number_of_input_hits (const datatools::things & er_) const
+      {
+        std::size_t nhits = 0;
+        const std::string & sd_label = _bank_labels_.at (sdm::data_info::SIMULATED_DATA_LABEL);
+        if (DATATOOLS_THINGS_CHECK_BANK(er_, sd_label, mctools::simulated_data))
+          {
+            DATATOOLS_THINGS_CONST_BANK(er_, sd_label, mctools::simulated_data, SD);
+            static const char * hit_labels[] = { "gg", "calo", "xcalo", "gveto" };
+            for (size_t i = 0; i < sizeof (hit_labels) / sizeof (hit_labels[0]); i++)
+              {
+                if (SD.has_step_hits (hit_labels[i]))
+                  {
+                    nhits += SD.get_number_of_step_hits (hit_labels[i]);
+                  }
+              }
+          }
+        const std::string & cd_label = _bank_labels_.at (sdm::data_info::CALIBRATED_DATA_LABEL);
+        if (DATATOOLS_THINGS_CHECK_BANK(er_, cd_label, sdm::calibrated_data))
+          {
+            DATATOOLS_THINGS_CONST_BANK(er_, cd_label, sdm::calibrated_data, CD);
+            nhits += CD.calibrated_tracker_hits ().size ();
+            nhits += CD.calibrated_calorimeter_hits ().size ();
+          }
+        return nhits;
+      }
+
+      void event_exporter::_sort_hits (sre::export_event & ee_) const
+      {
+        // Stable sorts : hits of the same cell keep their original order
+        if (is_bank_sorted ("trueStepHits"))
+          {
+            std::stable_sort (ee_.true_step_hits.begin (), ee_.true_step_hits.end (),
+                              step_hit_less);
+          }
+        if (is_bank_sorted ("trueCaloHits"))
+          {
+            std::stable_sort (ee_.true_calo_hits.begin (), ee_.true_calo_hits.end (),
+                              cell_key::less<true_scin_hit_type>);
+          }
+        if (is_bank_sorted ("trueXcaloHits"))
+          {
+            std::stable_sort (ee_.true_xcalo_hits.begin (), ee_.true_xcalo_hits.end (),
+                              cell_key::less<true_scin_hit_type>);
+          }
+        if (is_bank_sorted ("trueGvetoHits"))
+          {
+            std::stable_sort (ee_.true_gveto_hits.begin (), ee_.true_gveto_hits.end (),
+                              cell_key::less<true_scin_hit_type>);
+          }
+        if (is_bank_sorted ("trueGgHits"))
+          {
+            std::stable_sort (ee_.true_gg_hits.begin (), ee_.true_gg_hits.end (),
+                              cell_key::less<true_gg_hit_type>);
+          }
+        if (is_bank_sorted ("trueScinHits"))
+          {
+            // The block type is the leading field of the cell key :
+            std::stable_sort (ee_.true_scin_hits.begin (), ee_.true_scin_hits.end (),
+                              cell_key::less<true_scin_hit_type>);
+          }
+        if (is_bank_sorted ("calibScinHits"))
+          {
+            std::stable_sort (ee_.calib_scin_hits.begin (), ee_.calib_scin_hits.end (),
+                              cell_key::less<calib_calorimeter_hit_type>);
+          }
+        if (is_bank_sorted ("calibTrackerHits"))
+          {
+            std::stable_sort (ee_.calib_gg_hits.begin (), ee_.calib_gg_hits.end (),
+                              cell_key::less<calib_tracker_hit_type>);
+          }
+        return;
+      }
+
+      int32_t event_exporter::_resolve_reference (const std::map<int32_t, int32_t> & rows_,
+                                                  int32_t id_,
+                                                  const std::string & link_)
+      {
+        // Negative IDs stand for no reference (ex: unclustered hits) :
+        if (id_ < 0) return constants::INVALID_ID;
+        std::map<int32_t, int32_t>::const_iterator found = rows_.find (id_);
+        if (found == rows_.end ())
+          {
+            _reference_counters_.unresolved[link_]++;
+            return constants::INVALID_ID;
+          }
+        _reference_counters_.resolved++;
+        return found->second;
+      }
+
+      void event_exporter::_resolve_references (sre::export_event & ee_)
+      {
+        std::map<int32_t, int32_t> rows;
+
+        // Only the references to exported banks are resolved :
+        if (is_exported (EXPORT_TRUE_PARTICLES))
+          {
+            index_rows (ee_.true_vertices, &true_vertex_type::vertex_id, rows);
+            for (size_t i = 0; i < ee_.true_particles.size (); i++)
+              {
+                true_particle_type & particle = ee_.true_particles[i];
+                particle.vertex_index = _resolve_reference (rows, particle.vertex_id, "trueParticles.vertexId");
+              }
+          }
+
+        if (is_exported (EXPORT_TRUE_HITS) && is_exported (EXPORT_CALIB_TRACKER_HITS))
+          {
+            index_rows (ee_.true_gg_hits, &true_gg_hit_type::hit_id, rows);
+            for (size_t i = 0; i < ee_.calib_gg_hits.size (); i++)
+              {
+                calib_tracker_hit_type & hit = ee_.calib_gg_hits[i];
+                hit.true_hit_index = _resolve_reference (rows, hit.true_hit_id, "calibTrackerHits.trueHitId");
+              }
+          }
+
+        if (is_exported (EXPORT_TRUE_HITS) && is_exported (EXPORT_CALIB_CALORIMETER_HITS))
+          {
+            // The true hit is searched in the bank of the same block type :
+            std::map<int32_t, int32_t> calo_rows;
+            std::map<int32_t, int32_t> xcalo_rows;
+            std::map<int32_t, int32_t> gveto_rows;
+            if (_unified_scin_hits_)
+              {
+                // The hit IDs are only unique within a block type :
+                for (size_t i = 0; i < ee_.true_scin_hits.size (); i++)
+                  {
+                    const true_scin_hit_type & true_hit = ee_.true_scin_hits[i];
+                    std::map<int32_t, int32_t> * type_rows = &calo_rows;
+                    if (true_hit.type == constants::XCALO_TYPE) type_rows = &xcalo_rows;
+                    else if (true_hit.type == constants::GVETO_TYPE) type_rows = &gveto_rows;
+                    (*type_rows)[true_hit.hit_id] = i;
+                  }
+              }
+            else
+              {
+                index_rows (ee_.true_calo_hits, &true_scin_hit_type::hit_id, calo_rows);
+                index_rows (ee_.true_xcalo_hits, &true_scin_hit_type::hit_id, xcalo_rows);
+                index_rows (ee_.true_gveto_hits, &true_scin_hit_type::hit_id, gveto_rows);
+              }
+            for (size_t i = 0; i < ee_.calib_scin_hits.size (); i++)
+              {
+                calib_calorimeter_hit_type & hit = ee_.calib_scin_hits[i];
+                const std::map<int32_t, int32_t> * type_rows = &calo_rows;
+                if (hit.type == constants::XCALO_TYPE) type_rows = &xcalo_rows;
+                else if (hit.type == constants::GVETO_TYPE) type_rows = &gveto_rows;
+                hit.true_hit_index = _resolve_reference (*type_rows, hit.true_hit_id, "calibScinHits.trueHitId");
+              }
+          }
+
+        std::map<int32_t, int32_t> hit_rows;
+        const bool hits = is_exported (EXPORT_CALIB_TRACKER_HITS);
+        if (hits)
+          {
+            index_rows (ee_.calib_gg_hits, &calib_tracker_hit_type::hit_id, hit_rows);
+          }
+
+        std::map<int32_t, int32_t> cluster_rows;
+        const bool clusters = is_exported (EXPORT_TRACKER_CLUSTERING);
+        if (clusters)
+          {
+            index_rows (ee_.tracker_clusters, &tracker_cluster_type::cluster_id, cluster_rows);
+            for (size_t i = 0; i < ee_.tracker_clustered_hits.size (); i++)
+              {
+                tracker_clustered_hit_type & chit = ee_.tracker_clustered_hits[i];
+                chit.cluster_index = _resolve_reference (cluster_rows, chit.cluster_id, "trackerClusteredHits.clusterId");
+                if (hits)
+                  {
+                    chit.hit_index = _resolve_reference (hit_rows, chit.hit_id, "trackerClusteredHits.hitId");
+                  }
+              }
+          }
+
+        if (is_exported (EXPORT_TRACKER_TRAJECTORIES))
+          {
+            if (clusters)
+              {
+                for (size_t i = 0; i < ee_.tracker_trajectories.size (); i++)
+                  {
+                    tracker_trajectory_type & trajectory = ee_.tracker_trajectories[i];
+                    trajectory.cluster_index = _resolve_reference (cluster_rows, trajectory.cluster_id,
+                                                                   "trackerTrajectories.clusterId");
+                  }
+              }
+            index_rows (ee_.tracker_trajectories, &tracker_trajectory_type::trajectory_id, rows);
+            for (size_t i = 0; i < ee_.tracker_trajectory_orphan_hits.size (); i++)
+              {
+                tracker_trajectory_orphan_hit_type & ohit = ee_.tracker_trajectory_orphan_hits[i];
+                ohit.trajectory_index = _resolve_reference (rows, ohit.trajectory_id,
+                                                            "trackerTrajectoryOrphanHits.trajectoryId");
+                if (hits)
+                  {
+                    ohit.hit_index = _resolve_reference (hit_rows, ohit.hit_id, "trackerTrajectoryOrphanHits.hitId");
+                  }
+              }
+          }
+        return;
       }
 
       const std::map<std::string, std::string> &
@@ -460,7 +1207,7 @@ namespace snemo {
       int event_exporter::_export_event_header (const datatools::things & er_,
                                                 sre::export_event & ee_)
       {
-        const std::string & eh_label = _bank_labels_[sdm::data_info::EVENT_HEADER_LABEL];
+        const std::string & eh_label = _bank_labels_.at (sdm::data_info::EVENT_HEADER_LABEL);
         if (! DATATOOLS_THINGS_CHECK_BANK(er_, eh_label, sdm::event_header))
           {
             DT_THROW_IF (true, std::logic_error, "Missing event header data to be processed !");
@@ -484,7 +1231,7 @@ namespace snemo {
       int event_exporter::_export_true_particles (const datatools::things & er_,
                                                   sre::export_event & ee_)
       {
-        const std::string & sd_label = _bank_labels_ [sdm::data_info::SIMULATED_DATA_LABEL];
+        const std::string & sd_label = _bank_labels_.at (sdm::data_info::SIMULATED_DATA_LABEL);
         if (! DATATOOLS_THINGS_CHECK_BANK(er_, sd_label, mctools::simulated_data))
           {
             DT_THROW_IF (true, std::logic_error, "Missing simulated data to be processed !");
@@ -529,7 +1276,7 @@ namespace snemo {
       int event_exporter::_export_true_step_hits (const datatools::things & er_,
                                                   sre::export_event & ee_)
       {
-        const std::string & sd_label = _bank_labels_ [sdm::data_info::SIMULATED_DATA_LABEL];
+        const std::string & sd_label = _bank_labels_.at (sdm::data_info::SIMULATED_DATA_LABEL);
         if (! DATATOOLS_THINGS_CHECK_BANK(er_, sd_label, mctools::simulated_data))
           {
             DT_THROW_IF (true, std::logic_error, "Missing simulated data to be processed !");
@@ -544,7 +1291,7 @@ namespace snemo {
       int event_exporter::_export_true_hits (const datatools::things & er_,
                                              sre::export_event & ee_)
       {
-        const std::string & sd_label = _bank_labels_[sdm::data_info::SIMULATED_DATA_LABEL];
+        const std::string & sd_label = _bank_labels_.at (sdm::data_info::SIMULATED_DATA_LABEL);
         if (! DATATOOLS_THINGS_CHECK_BANK(er_, sd_label, mctools::simulated_data))
           {
             DT_THROW_IF (true, std::logic_error, "Missing simulated data to be processed !");
@@ -581,6 +1328,7 @@ namespace snemo {
                 true_scin_hit.y2 = sncore_true_scin_hit.get_position_stop ().y () / CLHEP::mm;
                 true_scin_hit.z2 = sncore_true_scin_hit.get_position_stop ().z () / CLHEP::mm;
                 true_scin_hit.delta_energy = sncore_true_scin_hit.get_energy_deposit () / CLHEP::keV;
+                true_scin_hit.encode_cell_key ();
               }
           }
 
@@ -614,6 +1362,7 @@ namespace snemo {
                 true_scin_hit.y2 = sncore_true_scin_hit.get_position_stop ().y () / CLHEP::mm;
                 true_scin_hit.z2 = sncore_true_scin_hit.get_position_stop ().z () / CLHEP::mm;
                 true_scin_hit.delta_energy = sncore_true_scin_hit.get_energy_deposit () / CLHEP::keV;
+                true_scin_hit.encode_cell_key ();
               }
           }
 
@@ -647,9 +1396,27 @@ namespace snemo {
                 true_scin_hit.y2 = sncore_true_scin_hit.get_position_stop ().y () / CLHEP::mm;
                 true_scin_hit.z2 = sncore_true_scin_hit.get_position_stop ().z () / CLHEP::mm;
                 true_scin_hit.delta_energy = sncore_true_scin_hit.get_energy_deposit () / CLHEP::keV;
+                true_scin_hit.encode_cell_key ();
               }
           }
 
+        // The scintillator hits are stored in a single bank, the 'type' column telling the block type :
+        if (_unified_scin_hits_)
+          {
+            ee_.true_scin_hits.reserve (ee_.true_calo_hits.size ()
+                                        + ee_.true_xcalo_hits.size ()
+                                        + ee_.true_gveto_hits.size ());
+            ee_.true_scin_hits.insert (ee_.true_scin_hits.end (),
+                                       ee_.true_calo_hits.begin (), ee_.true_calo_hits.end ());
+            ee_.true_scin_hits.insert (ee_.true_scin_hits.end (),
+                                       ee_.true_xcalo_hits.begin (), ee_.true_xcalo_hits.end ());
+            ee_.true_scin_hits.insert (ee_.true_scin_hits.end (),
+                                       ee_.true_gveto_hits.begin (), ee_.true_gveto_hits.end ());
+            ee_.true_calo_hits.clear ();
+            ee_.true_xcalo_hits.clear ();
+            ee_.true_gveto_hits.clear ();
+          }
+
         // Gg true hits :
         const std::string gg_hit_label = "gg";
         if (SD.has_step_hits (gg_hit_label))
@@ -679,6 +1446,7 @@ namespace snemo {
                 true_gg_hit.xanode = sncore_true_gg_hit.get_position_stop ().x () / CLHEP::mm;
                 true_gg_hit.yanode = sncore_true_gg_hit.get_position_stop ().y () / CLHEP::mm;
                 true_gg_hit.zanode = sncore_true_gg_hit.get_position_stop ().z () / CLHEP::mm;
+                true_gg_hit.encode_cell_key ();
               }
           }
 
@@ -688,7 +1456,7 @@ namespace snemo {
       int event_exporter::_export_calib_calorimeter_hits (const datatools::things & er_,
                                                           sre::export_event & ee_)
       {
-        const std::string & cd_label = _bank_labels_[sdm::data_info::CALIBRATED_DATA_LABEL];
+        const std::string & cd_label = _bank_labels_.at (sdm::data_info::CALIBRATED_DATA_LABEL);
         if (! DATATOOLS_THINGS_CHECK_BANK(er_, cd_label, sdm::calibrated_data))
           {
             DT_THROW_IF (true, std::logic_error, "Missing calibrated data to be processed !");
@@ -741,7 +1509,16 @@ namespace snemo {
             calib_scin_hit.sigma_time = sncore_scin_hit.get_sigma_time()/ CLHEP::ns;
             calib_scin_hit.energy = sncore_scin_hit.get_energy()/ CLHEP::keV;
             calib_scin_hit.sigma_energy = sncore_scin_hit.get_sigma_energy()/ CLHEP::keV;
-            calib_scin_hit.true_hit_id = constants::INVALID_ID;
+            int scin_true_hit_id = constants::INVALID_ID;
+            {
+              if (sncore_scin_hit.get_auxiliaries().has_key(mctools::hit_utils::HIT_MC_HIT_ID_KEY))
+                {
+                  // Extract the hit ID of the associated MC true scintillator hit :
+                  scin_true_hit_id = sncore_scin_hit.get_auxiliaries().fetch_integer (mctools::hit_utils::HIT_MC_HIT_ID_KEY);
+                }
+            }
+            calib_scin_hit.true_hit_id = scin_true_hit_id;
+            calib_scin_hit.encode_cell_key ();
           }
 
         return 0;
@@ -750,7 +1527,7 @@ namespace snemo {
       int event_exporter::_export_calib_tracker_hits (const datatools::things & er_,
                                                       sre::export_event & ee_)
       {
-        const std::string & cd_label = _bank_labels_[sdm::data_info::CALIBRATED_DATA_LABEL];
+        const std::string & cd_label = _bank_labels_.at (sdm::data_info::CALIBRATED_DATA_LABEL);
         if (! DATATOOLS_THINGS_CHECK_BANK(er_, cd_label, sdm::calibrated_data))
           {
             DT_THROW_IF (true, std::logic_error, "Missing calibrated data to be processed !");
@@ -772,6 +1549,7 @@ namespace snemo {
             calib_gg_hit.side = sncore_gg_hit.get_geom_id().get(_gid_infos_.gid_gg_side_index);
             calib_gg_hit.layer = sncore_gg_hit.get_geom_id().get(_gid_infos_.gid_gg_layer_index);
             calib_gg_hit.row = sncore_gg_hit.get_geom_id().get(_gid_infos_.gid_gg_row_index);
+            calib_gg_hit.encode_cell_key ();
             calib_gg_hit.noisy = sncore_gg_hit.is_noisy ();
             calib_gg_hit.delayed = sncore_gg_hit.is_delayed ();
             calib_gg_hit.missing_bottom_cathode = sncore_gg_hit.is_bottom_cathode_missing ();
@@ -803,22 +1581,24 @@ namespace snemo {
                 calib_gg_hit.has_cat_infos = true;
                 if (sncore_gg_hit.get_auxiliaries ().has_flag("CAT_tangency_x"))
                   {
-                    calib_gg_hit.cat_tangency_x = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_tangency_x");
-                    calib_gg_hit.cat_tangency_y = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_tangency_y");
-                    calib_gg_hit.cat_tangency_z = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_tangency_z");
-                    calib_gg_hit.cat_tangency_x_error = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_tangency_x_error");
-                    calib_gg_hit.cat_tangency_y_error = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_tangency_y_error");
-                    calib_gg_hit.cat_tangency_z_error = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_tangency_z_error");
+                    sre::calib_tracker_hit_cat_type & cat = calib_gg_hit.cat.grab (ee_.arena);
+                    cat.cat_tangency_x = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_tangency_x");
+                    cat.cat_tangency_y = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_tangency_y");
+                    cat.cat_tangency_z = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_tangency_z");
+                    cat.cat_tangency_x_error = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_tangency_x_error");
+                    cat.cat_tangency_y_error = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_tangency_y_error");
+                    cat.cat_tangency_z_error = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_tangency_z_error");
                   }
 
                 if (sncore_gg_hit.get_auxiliaries ().has_flag("CAT_helix_x"))
                   {
-                    calib_gg_hit.cat_helix_x = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_helix_x");
-                    calib_gg_hit.cat_helix_y = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_helix_y");
-                    calib_gg_hit.cat_helix_z = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_helix_z");
-                    calib_gg_hit.cat_helix_x_error = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_helix_x_error");
-                    calib_gg_hit.cat_helix_y_error = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_helix_y_error");
-                    calib_gg_hit.cat_helix_z_error = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_helix_z_error");
+                    sre::calib_tracker_hit_cat_type & cat = calib_gg_hit.cat.grab (ee_.arena);
+                    cat.cat_helix_x = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_helix_x");
+                    cat.cat_helix_y = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_helix_y");
+                    cat.cat_helix_z = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_helix_z");
+                    cat.cat_helix_x_error = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_helix_x_error");
+                    cat.cat_helix_y_error = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_helix_y_error");
+                    cat.cat_helix_z_error = sncore_gg_hit.get_auxiliaries ().fetch_real("CAT_helix_z_error");
                   }
               }
           }
@@ -831,7 +1611,7 @@ namespace snemo {
       {
         const datatools::logger::priority local_priority = datatools::logger::PRIO_WARNING;
         DT_LOG_TRACE (local_priority, "Entering...");
-        const std::string & tcd_label = _bank_labels_[sdm::data_info::TRACKER_CLUSTERING_DATA_LABEL];
+        const std::string & tcd_label = _bank_labels_.at (sdm::data_info::TRACKER_CLUSTERING_DATA_LABEL);
         if (! DATATOOLS_THINGS_CHECK_BANK(er_, tcd_label, sdm::tracker_clustering_data))
           {
             DT_THROW_IF (true, std::logic_error, "Missing tracker clustering data to be processed !");
@@ -881,7 +1661,7 @@ namespace snemo {
             TC.has_cat_infos = false;
             if (are_cat_infos_exported())
               {
-                _export_tracker_clustering_cat(sncore_cluster, TC);
+                _export_tracker_clustering_cat(sncore_cluster, TC, ee_.arena);
               }
             DT_LOG_TRACE (local_priority, "# of hits in the current cluster = " << TC.number_of_hits);
             for (size_t hit = 0; hit < TC.number_of_hits; hit++)
@@ -892,6 +1672,7 @@ namespace snemo {
                   ee_.tracker_clustered_hits.push_back (dummy);
                 }
                 sre::tracker_clustered_hit_type & chit = ee_.tracker_clustered_hits.back ();
+                chit.solution_id = TCS_id;
                 chit.hit_id = sncore_cluster.get_hits ().at (hit).get ().get_hit_id ();
                 chit.cluster_id = TC.cluster_id;
               }
@@ -907,6 +1688,7 @@ namespace snemo {
               ee_.tracker_clustered_hits.push_back (dummy);
             }
             sre::tracker_clustered_hit_type & uchit = ee_.tracker_clustered_hits.back ();
+            uchit.solution_id = TCS_id;
             uchit.hit_id = uchit_handle.get ().get_hit_id ();
             uchit.cluster_id = -1;
           }
@@ -917,71 +1699,73 @@ namespace snemo {
 
 
         void event_exporter::_export_tracker_clustering_cat (const sdm::tracker_cluster & cluster_,
-                                                             sre::tracker_cluster_type & tc_)
+                                                             sre::tracker_cluster_type & tc_,
+                                                             sre::event_arena & arena_)
         {
           tc_.has_cat_infos = true;
-          tc_.cat_has_momentum = false;
+          tc_.cat.reset ();
           if (cluster_.get_auxiliaries ().has_flag("CAT_has_momentum"))
             {
-              tc_.cat_has_momentum = true;
-              tc_.cat_momentum_x = cluster_.get_auxiliaries ().fetch_real("CAT_momentum_x");
-              tc_.cat_momentum_y = cluster_.get_auxiliaries ().fetch_real("CAT_momentum_y");
-              tc_.cat_momentum_z = cluster_.get_auxiliaries ().fetch_real("CAT_momentum_z");
+              sre::tracker_cluster_cat_type & cat = tc_.cat.grab (arena_);
+              cat.cat_has_momentum = true;
+              cat.cat_momentum_x = cluster_.get_auxiliaries ().fetch_real("CAT_momentum_x");
+              cat.cat_momentum_y = cluster_.get_auxiliaries ().fetch_real("CAT_momentum_y");
+              cat.cat_momentum_z = cluster_.get_auxiliaries ().fetch_real("CAT_momentum_z");
             }
 
-          tc_.cat_has_charge = false;
           if (cluster_.get_auxiliaries ().has_flag("CAT_charge"))
             {
-              tc_.cat_has_charge = true;
-              tc_.cat_charge = cluster_.get_auxiliaries ().fetch_real("CAT_charge");
+              sre::tracker_cluster_cat_type & cat = tc_.cat.grab (arena_);
+              cat.cat_has_charge = true;
+              cat.cat_charge = cluster_.get_auxiliaries ().fetch_real("CAT_charge");
             }
 
-          tc_.cat_has_helix_vertex = false;
           if (cluster_.get_auxiliaries ().has_flag("CAT_has_helix_vertex"))
             {
-              tc_.cat_has_helix_vertex = true;
-              tc_.cat_helix_vertex_x = cluster_.get_auxiliaries ().fetch_real("CAT_helix_vertex_x");
-              tc_.cat_helix_vertex_y = cluster_.get_auxiliaries ().fetch_real("CAT_helix_vertex_y");
-              tc_.cat_helix_vertex_z = cluster_.get_auxiliaries ().fetch_real("CAT_helix_vertex_z");
-              tc_.cat_helix_vertex_x_error = cluster_.get_auxiliaries ().fetch_real("CAT_helix_vertex_x_error");
-              tc_.cat_helix_vertex_y_error = cluster_.get_auxiliaries ().fetch_real("CAT_helix_vertex_y_error");
-              tc_.cat_helix_vertex_z_error = cluster_.get_auxiliaries ().fetch_real("CAT_helix_vertex_z_error");
+              sre::tracker_cluster_cat_type & cat = tc_.cat.grab (arena_);
+              cat.cat_has_helix_vertex = true;
+              cat.cat_helix_vertex_x = cluster_.get_auxiliaries ().fetch_real("CAT_helix_vertex_x");
+              cat.cat_helix_vertex_y = cluster_.get_auxiliaries ().fetch_real("CAT_helix_vertex_y");
+              cat.cat_helix_vertex_z = cluster_.get_auxiliaries ().fetch_real("CAT_helix_vertex_z");
+              cat.cat_helix_vertex_x_error = cluster_.get_auxiliaries ().fetch_real("CAT_helix_vertex_x_error");
+              cat.cat_helix_vertex_y_error = cluster_.get_auxiliaries ().fetch_real("CAT_helix_vertex_y_error");
+              cat.cat_helix_vertex_z_error = cluster_.get_auxiliaries ().fetch_real("CAT_helix_vertex_z_error");
             }
 
-          tc_.cat_has_helix_decay_vertex = false;
           if (cluster_.get_auxiliaries ().has_flag("CAT_has_helix_decay_vertex"))
             {
-              tc_.cat_has_helix_decay_vertex = true;
-              tc_.cat_helix_decay_vertex_x = cluster_.get_auxiliaries ().fetch_real("CAT_helix_decay_vertex_x");
-              tc_.cat_helix_decay_vertex_y = cluster_.get_auxiliaries ().fetch_real("CAT_helix_decay_vertex_y");
-              tc_.cat_helix_decay_vertex_z = cluster_.get_auxiliaries ().fetch_real("CAT_helix_decay_vertex_z");
-              tc_.cat_helix_decay_vertex_x_error = cluster_.get_auxiliaries ().fetch_real("CAT_helix_decay_vertex_x_error");
-              tc_.cat_helix_decay_vertex_y_error = cluster_.get_auxiliaries ().fetch_real("CAT_helix_decay_vertex_y_error");
-              tc_.cat_helix_decay_vertex_z_error = cluster_.get_auxiliaries ().fetch_real("CAT_helix_decay_vertex_z_error");
+              sre::tracker_cluster_cat_type & cat = tc_.cat.grab (arena_);
+              cat.cat_has_helix_decay_vertex = true;
+              cat.cat_helix_decay_vertex_x = cluster_.get_auxiliaries ().fetch_real("CAT_helix_decay_vertex_x");
+              cat.cat_helix_decay_vertex_y = cluster_.get_auxiliaries ().fetch_real("CAT_helix_decay_vertex_y");
+              cat.cat_helix_decay_vertex_z = cluster_.get_auxiliaries ().fetch_real("CAT_helix_decay_vertex_z");
+              cat.cat_helix_decay_vertex_x_error = cluster_.get_auxiliaries ().fetch_real("CAT_helix_decay_vertex_x_error");
+              cat.cat_helix_decay_vertex_y_error = cluster_.get_auxiliaries ().fetch_real("CAT_helix_decay_vertex_y_error");
+              cat.cat_helix_decay_vertex_z_error = cluster_.get_auxiliaries ().fetch_real("CAT_helix_decay_vertex_z_error");
             }
 
-          tc_.cat_has_tangent_vertex = false;
           if (cluster_.get_auxiliaries ().has_flag("CAT_has_tangent_vertex"))
             {
-              tc_.cat_has_tangent_vertex = true;
-              tc_.cat_tangent_vertex_x = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_vertex_x");
-              tc_.cat_tangent_vertex_y = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_vertex_y");
-              tc_.cat_tangent_vertex_z = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_vertex_z");
-              tc_.cat_tangent_vertex_x_error = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_vertex_x_error");
-              tc_.cat_tangent_vertex_y_error = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_vertex_y_error");
-              tc_.cat_tangent_vertex_z_error = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_vertex_z_error");
+              sre::tracker_cluster_cat_type & cat = tc_.cat.grab (arena_);
+              cat.cat_has_tangent_vertex = true;
+              cat.cat_tangent_vertex_x = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_vertex_x");
+              cat.cat_tangent_vertex_y = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_vertex_y");
+              cat.cat_tangent_vertex_z = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_vertex_z");
+              cat.cat_tangent_vertex_x_error = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_vertex_x_error");
+              cat.cat_tangent_vertex_y_error = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_vertex_y_error");
+              cat.cat_tangent_vertex_z_error = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_vertex_z_error");
             }
 
-          tc_.cat_has_tangent_decay_vertex = false;
           if (cluster_.get_auxiliaries ().has_flag("CAT_has_tangent_decay_vertex"))
             {
-              tc_.cat_has_tangent_decay_vertex = true;
-              tc_.cat_tangent_decay_vertex_x = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_decay_vertex_x");
-              tc_.cat_tangent_decay_vertex_y = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_decay_vertex_y");
-              tc_.cat_tangent_decay_vertex_z = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_decay_vertex_z");
-              tc_.cat_tangent_decay_vertex_x_error = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_decay_vertex_x_error");
-              tc_.cat_tangent_decay_vertex_y_error = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_decay_vertex_y_error");
-              tc_.cat_tangent_decay_vertex_z_error = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_decay_vertex_z_error");
+              sre::tracker_cluster_cat_type & cat = tc_.cat.grab (arena_);
+              cat.cat_has_tangent_decay_vertex = true;
+              cat.cat_tangent_decay_vertex_x = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_decay_vertex_x");
+              cat.cat_tangent_decay_vertex_y = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_decay_vertex_y");
+              cat.cat_tangent_decay_vertex_z = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_decay_vertex_z");
+              cat.cat_tangent_decay_vertex_x_error = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_decay_vertex_x_error");
+              cat.cat_tangent_decay_vertex_y_error = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_decay_vertex_y_error");
+              cat.cat_tangent_decay_vertex_z_error = cluster_.get_auxiliaries ().fetch_real("CAT_tangent_decay_vertex_z_error");
             }
 
           return;
@@ -990,7 +1774,7 @@ namespace snemo {
       int event_exporter::_export_tracker_trajectories (const datatools::things & er_,
                                                         sre::export_event & ee_)
       {
-        const std::string & ttd_label = _bank_labels_[sdm::data_info::TRACKER_TRAJECTORY_DATA_LABEL];
+        const std::string & ttd_label = _bank_labels_.at (sdm::data_info::TRACKER_TRAJECTORY_DATA_LABEL);
         if (! DATATOOLS_THINGS_CHECK_BANK(er_, ttd_label, sdm::tracker_trajectory_data))
           {
             DT_THROW_IF (true, std::logic_error, "Missing tracker trajectory data to be processed !");
@@ -1034,6 +1818,7 @@ namespace snemo {
                 }
                 sre::tracker_trajectory_orphan_hit_type & ohit
                   = ee_.tracker_trajectory_orphan_hits.back ();
+                ohit.solution_id = TTS_id;
                 ohit.hit_id = ohit_handle.get ().get_hit_id ();
                 ohit.trajectory_id = TT.trajectory_id;
               }
@@ -19,9 +19,12 @@
 #define SNRECONSTRUCTION_EXPORTS_EVENT_EXPORTER_H 1
 
 #include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include <datatools/bit_mask.h>
 #include <falaise/snemo/datamodels/data_model.h>
@@ -45,6 +48,8 @@ namespace snemo {
 
       class export_event;
       class tracker_cluster_type;
+      class event_arena;
+      class task_pool;
 
       struct event_exporter
       {
@@ -82,6 +87,7 @@ namespace snemo {
             EXPORT_TOPIC_EXCLUDE    = -1,
             EXPORT_TOPIC_NO_INCLUDE = 0,
             EXPORT_TOPIC_INCLUDE    = 1,
+            EXPORT_TOPIC_SPARSE     = 2, // Topic stored in sparse sub-banks
           };
 
         struct gid_info_type
@@ -116,6 +122,19 @@ namespace snemo {
           void reset ();
         };
 
+        /// Counters of the row index references between banks
+        struct reference_counters_type
+        {
+          uint64_t resolved; /// Number of resolved references
+          std::map<std::string, uint64_t> unresolved; /// Number of unresolved references per link (ex: "calibTrackerHits.trueHitId")
+        public:
+          reference_counters_type ();
+          void reset ();
+          uint64_t get_number_of_unresolved () const;
+          /// Add the counters of another exporter
+          void merge (const reference_counters_type & counters_);
+        };
+
         static std::string get_export_bit_label (unsigned int bit_);
 
       public:
@@ -138,6 +157,58 @@ namespace snemo {
 
         void set_cat_infos_exported (bool);
 
+        bool are_cat_infos_sparse () const;
+
+        void set_cat_infos_sparse (bool);
+
+        bool are_memberships_offset_encoded () const;
+
+        void set_memberships_offset_encoded (bool);
+
+        bool are_true_scin_hits_unified () const;
+
+        /// Store the true calo, xcalo and gveto hits in a single 'trueScinHits' bank
+        void set_true_scin_hits_unified (bool);
+
+        bool are_row_indexes_exported () const;
+
+        void set_row_indexes_exported (bool);
+
+        const reference_counters_type & get_reference_counters () const;
+
+        /// Add the reference counters of another exporter (ex: worker of a pipeline)
+        void merge_reference_counters (const reference_counters_type & counters_);
+
+        /// Default minimum number of input hits of an event converted concurrently
+        static const unsigned int DEFAULT_PARALLEL_THRESHOLD = 1000;
+
+        unsigned int get_number_of_threads () const;
+
+        /// Set the number of threads converting the independent banks of the large events (1 : sequential)
+        void set_number_of_threads (unsigned int);
+
+        unsigned int get_parallel_threshold () const;
+
+        /// Set the minimum number of input hits of an event converted concurrently
+        void set_parallel_threshold (unsigned int);
+
+        bool is_event_arena_used () const;
+
+        /// Allocate the per-event out of line payloads in the arena of the export event
+        void set_event_arena_used (bool);
+
+        bool are_hits_sorted_by_cell_key () const;
+
+        void set_hits_sorted_by_cell_key (bool);
+
+        /// Return the hit banks which can be sorted in detector order
+        static const std::vector<std::string> & get_sortable_banks ();
+
+        bool is_bank_sorted (const std::string & bank_name_) const;
+
+        /// Sort the rows of a hit bank in detector order (cell key, start time for the step hits)
+        void set_bank_sorted (const std::string & bank_name_, bool sort_ = true);
+
         int get_topic_export_level(const std::string & topic_label_) const;
 
         event_exporter ();
@@ -151,6 +222,10 @@ namespace snemo {
         int run (const snemo::datamodel::event_record &,
                  snemo::reconstruction::exports::export_event &);
 
+        /// Copy the data read by the exporter in another event record (the hits are copied, not shared)
+        void copy_record (const snemo::datamodel::event_record & source_,
+                          snemo::datamodel::event_record & target_) const;
+
         uint32_t get_export_flags () const;
 
         void dump (std::ostream & = std::clog) const;
@@ -186,12 +261,32 @@ namespace snemo {
                                         snemo::reconstruction::exports::export_event &);
 
         void _export_tracker_clustering_cat (const snemo::datamodel::tracker_cluster & cluster_,
-                                             snemo::reconstruction::exports::tracker_cluster_type & tc_);
+                                             snemo::reconstruction::exports::tracker_cluster_type & tc_,
+                                             snemo::reconstruction::exports::event_arena & arena_);
 
 
         int _export_tracker_trajectories (const datatools::things &,
                                           snemo::reconstruction::exports::export_event &);
 
+        /// Convert the banks one after the other
+        void _export_banks (const datatools::things &,
+                            snemo::reconstruction::exports::export_event &);
+
+        /// Convert the independent banks concurrently on the task pool
+        void _export_banks_concurrently (const datatools::things &,
+                                         snemo::reconstruction::exports::export_event &);
+
+        /// Return the number of input hits of an event (simulated and calibrated)
+        std::size_t _get_number_of_input_hits (const datatools::things &) const;
+
+        void _sort_hits (snemo::reconstruction::exports::export_event &) const;
+
+        void _resolve_references (snemo::reconstruction::exports::export_event &);
+
+        int32_t _resolve_reference (const std::map<int32_t, int32_t> & rows_,
+                                    int32_t id_,
+                                    const std::string & link_);
+
          const std::map<std::string, std::string> & get_bank_labels () const;
 
       private:
@@ -203,6 +298,16 @@ namespace snemo {
         std::map<std::string, std::string> _bank_labels_; //!< The labels of the bank in the event records
         uint32_t _export_flags_;
         bool     _export_cat_infos_; // Topic = "CAT"
+        bool     _sparse_cat_infos_; //!< Flag to store the CAT informations in sparse sub-banks
+        bool     _offset_memberships_; //!< Flag to store the memberships as offsets in the parent banks
+        bool     _row_indexes_;        //!< Flag to store the row indexes of the referenced rows
+        bool     _unified_scin_hits_;  //!< Flag to store the true scintillator hits of all block types in a single bank
+        bool     _event_arena_;        //!< Flag to allocate the out of line payloads in the event arena
+        unsigned int _number_of_threads_;   //!< Number of threads converting the banks of the large events
+        unsigned int _parallel_threshold_;  //!< Minimum number of input hits of an event converted concurrently
+        boost::scoped_ptr<task_pool> _task_pool_; //!< Pool of threads converting the banks
+        reference_counters_type _reference_counters_; //!< Counters of the resolved/unresolved references
+        std::set<std::string> _sorted_banks_; //!< Hit banks sorted in detector order
 
       };
 
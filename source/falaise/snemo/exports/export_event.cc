@@ -6,6 +6,8 @@
 
 #include <sstream>
 #include <limits>
+#include <map>
+#include <algorithm>
 
 namespace snemo {
 
@@ -21,6 +23,98 @@ namespace snemo {
 
       /***********************************************/
 
+      namespace {
+
+        /// Store an address plus one in a field of a cell key, return false on overflow
+        bool pack_cell_field (uint32_t & key_, int32_t address_, unsigned int shift_, unsigned int nbits_)
+        {
+          if (address_ < 0) return true;
+          const uint32_t value = static_cast<uint32_t>(address_) + 1;
+          if (value >= (1U << nbits_)) return false;
+          key_ |= (value << shift_);
+          return true;
+        }
+
+        int32_t unpack_cell_field (uint32_t key_, unsigned int shift_, unsigned int nbits_)
+        {
+          return static_cast<int32_t>((key_ >> shift_) & ((1U << nbits_) - 1)) - 1;
+        }
+
+      }
+
+      // static
+      const uint32_t cell_key::INVALID_KEY;
+
+      // static
+      uint32_t cell_key::make_tracker (int32_t module_, int32_t side_, int32_t layer_, int32_t row_)
+      {
+        uint32_t key = 0;
+        if (! pack_cell_field (key, module_, 24, 8)
+            || ! pack_cell_field (key, side_,  20, 4)
+            || ! pack_cell_field (key, layer_, 12, 8)
+            || ! pack_cell_field (key, row_,    0, 12)
+            || key == INVALID_KEY)
+          {
+            return INVALID_KEY;
+          }
+        return key;
+      }
+
+      // static
+      void cell_key::decode_tracker (uint32_t key_,
+                                     int32_t & module_, int32_t & side_, int32_t & layer_, int32_t & row_)
+      {
+        if (key_ == INVALID_KEY)
+          {
+            module_ = side_ = layer_ = row_ = constants::INVALID_ID;
+            return;
+          }
+        module_ = unpack_cell_field (key_, 24, 8);
+        side_   = unpack_cell_field (key_, 20, 4);
+        layer_  = unpack_cell_field (key_, 12, 8);
+        row_    = unpack_cell_field (key_,  0, 12);
+        return;
+      }
+
+      // static
+      uint32_t cell_key::make_calorimeter (int32_t type_, int32_t module_, int32_t side_,
+                                           int32_t wall_, int32_t column_, int32_t row_)
+      {
+        uint32_t key = 0;
+        if (! pack_cell_field (key, type_,   28, 4)
+            || ! pack_cell_field (key, module_, 20, 8)
+            || ! pack_cell_field (key, side_,   16, 4)
+            || ! pack_cell_field (key, wall_,   12, 4)
+            || ! pack_cell_field (key, column_,  6, 6)
+            || ! pack_cell_field (key, row_,     0, 6)
+            || key == INVALID_KEY)
+          {
+            return INVALID_KEY;
+          }
+        return key;
+      }
+
+      // static
+      void cell_key::decode_calorimeter (uint32_t key_,
+                                         int32_t & type_, int32_t & module_, int32_t & side_,
+                                         int32_t & wall_, int32_t & column_, int32_t & row_)
+      {
+        if (key_ == INVALID_KEY)
+          {
+            type_ = module_ = side_ = wall_ = column_ = row_ = constants::INVALID_ID;
+            return;
+          }
+        type_   = unpack_cell_field (key_, 28, 4);
+        module_ = unpack_cell_field (key_, 20, 8);
+        side_   = unpack_cell_field (key_, 16, 4);
+        wall_   = unpack_cell_field (key_, 12, 4);
+        column_ = unpack_cell_field (key_,  6, 6);
+        row_    = unpack_cell_field (key_,  0, 6);
+        return;
+      }
+
+      /***********************************************/
+
       event_header_type::event_header_type ()
       {
         reset ();
@@ -74,6 +168,7 @@ namespace snemo {
         pz = constants::INVALID_DOUBLE;
         time = constants::INVALID_DOUBLE;
         vertex_id = constants::INVALID_ID;
+        vertex_index = constants::INVALID_ID;
         return;
       }
 
@@ -89,12 +184,14 @@ namespace snemo {
       {
         hit_id = constants::INVALID_ID;
         true_hit_id = constants::INVALID_ID;
+        true_hit_index = constants::INVALID_ID;
         type = constants::INVALID_ID;
         module = constants::INVALID_ID;
         side = constants::INVALID_ID;
         column = constants::INVALID_ID;
         row = constants::INVALID_ID;
         wall = constants::INVALID_ID;
+        cell_key = exports::cell_key::INVALID_KEY;
         time = constants::INVALID_DOUBLE;
         sigma_time = constants::INVALID_DOUBLE;
         energy = constants::INVALID_DOUBLE;
@@ -102,6 +199,18 @@ namespace snemo {
         return;
       }
 
+      void calib_calorimeter_hit_type::encode_cell_key ()
+      {
+        cell_key = exports::cell_key::make_calorimeter (type, module, side, wall, column, row);
+        return;
+      }
+
+      void calib_calorimeter_hit_type::decode_cell_key ()
+      {
+        exports::cell_key::decode_calorimeter (cell_key, type, module, side, wall, column, row);
+        return;
+      }
+
       /***********************************************/
 
       true_step_hit_type::true_step_hit_type ()
@@ -151,6 +260,7 @@ namespace snemo {
         side = constants::INVALID_ID;
         layer = constants::INVALID_ID;
         row = constants::INVALID_ID;
+        cell_key = exports::cell_key::INVALID_KEY;
 
         tionization = constants::INVALID_DOUBLE;
         xionization = constants::INVALID_DOUBLE;
@@ -166,6 +276,18 @@ namespace snemo {
         return;
       }
 
+      void true_gg_hit_type::encode_cell_key ()
+      {
+        cell_key = exports::cell_key::make_tracker (module, side, layer, row);
+        return;
+      }
+
+      void true_gg_hit_type::decode_cell_key ()
+      {
+        exports::cell_key::decode_tracker (cell_key, module, side, layer, row);
+        return;
+      }
+
       /***********************************************/
 
       true_scin_hit_type::true_scin_hit_type ()
@@ -183,6 +305,7 @@ namespace snemo {
         column = constants::INVALID_ID;
         row = constants::INVALID_ID;
         wall = constants::INVALID_ID;
+        cell_key = exports::cell_key::INVALID_KEY;
 
         tfirst = constants::INVALID_DOUBLE;
         tlast = constants::INVALID_DOUBLE;
@@ -197,6 +320,18 @@ namespace snemo {
         return;
       }
 
+      void true_scin_hit_type::encode_cell_key ()
+      {
+        cell_key = exports::cell_key::make_calorimeter (type, module, side, wall, column, row);
+        return;
+      }
+
+      void true_scin_hit_type::decode_cell_key ()
+      {
+        exports::cell_key::decode_calorimeter (cell_key, type, module, side, wall, column, row);
+        return;
+      }
+
       /***********************************************/
 
       calib_tracker_hit_type::calib_tracker_hit_type ()
@@ -209,10 +344,12 @@ namespace snemo {
       {
         hit_id = constants::INVALID_ID;
         true_hit_id = constants::INVALID_ID;
+        true_hit_index = constants::INVALID_ID;
         module = constants::INVALID_ID;
         side = constants::INVALID_ID;
         layer = constants::INVALID_ID;
         row = constants::INVALID_ID;
+        cell_key = exports::cell_key::INVALID_KEY;
         noisy = false;
         missing_bottom_cathode = false;
         missing_top_cathode = false;
@@ -230,17 +367,42 @@ namespace snemo {
         return;
       }
 
+      void calib_tracker_hit_type::encode_cell_key ()
+      {
+        cell_key = exports::cell_key::make_tracker (module, side, layer, row);
+        return;
+      }
+
+      void calib_tracker_hit_type::decode_cell_key ()
+      {
+        exports::cell_key::decode_tracker (cell_key, module, side, layer, row);
+        return;
+      }
+
       void calib_tracker_hit_type::reset_cat ()
       {
         has_cat_infos = false;
+        cat.reset ();
+        return;
+      }
 
+      /***********************************************/
+
+      calib_tracker_hit_cat_type::calib_tracker_hit_cat_type ()
+      {
+        reset ();
+        return;
+      }
+
+      void calib_tracker_hit_cat_type::reset ()
+      {
+        parent_index = constants::INVALID_ID;
         cat_tangency_x = constants::INVALID_DOUBLE;
         cat_tangency_y = constants::INVALID_DOUBLE;
         cat_tangency_z = constants::INVALID_DOUBLE;
         cat_tangency_x_error = constants::INVALID_DOUBLE;
         cat_tangency_y_error = constants::INVALID_DOUBLE;
         cat_tangency_z_error = constants::INVALID_DOUBLE;
-
         cat_helix_x = constants::INVALID_DOUBLE;
         cat_helix_y = constants::INVALID_DOUBLE;
         cat_helix_z = constants::INVALID_DOUBLE;
@@ -250,6 +412,28 @@ namespace snemo {
         return;
       }
 
+      // static
+      bool calib_tracker_hit_cat_type::is_present (const calib_tracker_hit_type & hit_)
+      {
+        if (! hit_.has_cat_infos || ! hit_.cat.has ()) return false;
+        const calib_tracker_hit_cat_type & cat = hit_.cat.get ();
+        return cat.cat_tangency_x == cat.cat_tangency_x || cat.cat_helix_x == cat.cat_helix_x;
+      }
+
+      void calib_tracker_hit_cat_type::extract (int32_t parent_index_, const calib_tracker_hit_type & hit_)
+      {
+        *this = hit_.cat.value ();
+        parent_index = parent_index_;
+        return;
+      }
+
+      void calib_tracker_hit_cat_type::restore (calib_tracker_hit_type & hit_) const
+      {
+        hit_.has_cat_infos = true;
+        hit_.cat.grab () = *this;
+        return;
+      }
+
       /***********************************************/
 
       tracker_clustered_hit_type::tracker_clustered_hit_type ()
@@ -263,6 +447,8 @@ namespace snemo {
         solution_id = constants::INVALID_ID;
         cluster_id = constants::INVALID_ID;
         hit_id = constants::INVALID_ID;
+        cluster_index = constants::INVALID_ID;
+        hit_index = constants::INVALID_ID;
         return;
       }
 
@@ -282,6 +468,7 @@ namespace snemo {
         side  = constants::INVALID_ID;
         delayed = false;
         number_of_hits = 0;
+        first_hit = 0;
         // CAT specific properties :
         reset_cat();
         return;
@@ -291,15 +478,27 @@ namespace snemo {
       {
         // CAT specific properties :
         has_cat_infos = false;
+        cat.reset ();
+        return;
+      }
+
+      /***********************************************/
+
+      tracker_cluster_cat_type::tracker_cluster_cat_type ()
+      {
+        reset ();
+        return;
+      }
 
+      void tracker_cluster_cat_type::reset ()
+      {
+        parent_index = constants::INVALID_ID;
         cat_has_charge = false;
         cat_charge = constants::INVALID_DOUBLE;
-
         cat_has_momentum = false;
         cat_momentum_x = constants::INVALID_DOUBLE;
         cat_momentum_y = constants::INVALID_DOUBLE;
         cat_momentum_z = constants::INVALID_DOUBLE;
-
         cat_has_helix_vertex = false;
         cat_helix_vertex_x = constants::INVALID_DOUBLE;
         cat_helix_vertex_y = constants::INVALID_DOUBLE;
@@ -307,7 +506,6 @@ namespace snemo {
         cat_helix_vertex_x_error = constants::INVALID_DOUBLE;
         cat_helix_vertex_y_error = constants::INVALID_DOUBLE;
         cat_helix_vertex_z_error = constants::INVALID_DOUBLE;
-
         cat_has_helix_decay_vertex = false;
         cat_helix_decay_vertex_x = constants::INVALID_DOUBLE;
         cat_helix_decay_vertex_y = constants::INVALID_DOUBLE;
@@ -315,7 +513,6 @@ namespace snemo {
         cat_helix_decay_vertex_x_error = constants::INVALID_DOUBLE;
         cat_helix_decay_vertex_y_error = constants::INVALID_DOUBLE;
         cat_helix_decay_vertex_z_error = constants::INVALID_DOUBLE;
-
         cat_has_tangent_vertex = false;
         cat_tangent_vertex_x = constants::INVALID_DOUBLE;
         cat_tangent_vertex_y = constants::INVALID_DOUBLE;
@@ -323,7 +520,6 @@ namespace snemo {
         cat_tangent_vertex_x_error = constants::INVALID_DOUBLE;
         cat_tangent_vertex_y_error = constants::INVALID_DOUBLE;
         cat_tangent_vertex_z_error = constants::INVALID_DOUBLE;
-
         cat_has_tangent_decay_vertex = false;
         cat_tangent_decay_vertex_x = constants::INVALID_DOUBLE;
         cat_tangent_decay_vertex_y = constants::INVALID_DOUBLE;
@@ -331,7 +527,33 @@ namespace snemo {
         cat_tangent_decay_vertex_x_error = constants::INVALID_DOUBLE;
         cat_tangent_decay_vertex_y_error = constants::INVALID_DOUBLE;
         cat_tangent_decay_vertex_z_error = constants::INVALID_DOUBLE;
+        return;
+      }
+
+      // static
+      bool tracker_cluster_cat_type::is_present (const tracker_cluster_type & cluster_)
+      {
+        if (! cluster_.has_cat_infos || ! cluster_.cat.has ()) return false;
+        const tracker_cluster_cat_type & cat = cluster_.cat.get ();
+        return cat.cat_has_charge
+            || cat.cat_has_momentum
+            || cat.cat_has_helix_vertex
+            || cat.cat_has_helix_decay_vertex
+            || cat.cat_has_tangent_vertex
+            || cat.cat_has_tangent_decay_vertex;
+      }
+
+      void tracker_cluster_cat_type::extract (int32_t parent_index_, const tracker_cluster_type & cluster_)
+      {
+        *this = cluster_.cat.value ();
+        parent_index = parent_index_;
+        return;
+      }
 
+      void tracker_cluster_cat_type::restore (tracker_cluster_type & cluster_) const
+      {
+        cluster_.has_cat_infos = true;
+        cluster_.cat.grab () = *this;
         return;
       }
 
@@ -408,8 +630,10 @@ namespace snemo {
         module = constants::INVALID_ID;
         side  = constants::INVALID_ID;
         cluster_id = constants::INVALID_ID;
+        cluster_index = constants::INVALID_ID;
         delayed = false;
         number_of_orphans = 0;
+        first_orphan = 0;
         pattern_id = constants::INVALID_ID;
         return;
       }
@@ -427,6 +651,24 @@ namespace snemo {
         solution_id = constants::INVALID_ID;
         trajectory_id = constants::INVALID_ID;
         hit_id = constants::INVALID_ID;
+        trajectory_index = constants::INVALID_ID;
+        hit_index = constants::INVALID_ID;
+        return;
+      }
+
+      /***********************************************/
+
+      tracker_hit_ref_type::tracker_hit_ref_type ()
+      {
+        reset ();
+        return;
+      }
+
+      void tracker_hit_ref_type::reset ()
+      {
+        solution_id = constants::INVALID_ID;
+        hit_id = constants::INVALID_ID;
+        hit_index = constants::INVALID_ID;
         return;
       }
 
@@ -466,12 +708,15 @@ namespace snemo {
         true_calo_hits.reserve (5);
         true_xcalo_hits.reserve (5);
         true_gveto_hits.reserve (5);
+        true_scin_hits.reserve (5);
         calib_scin_hits.reserve (5);
         calib_gg_hits.reserve (100);
         tracker_clusters.reserve (10);
         tracker_clustered_hits.reserve (100);
+        tracker_cluster_hit_ids.reserve (100);
         tracker_trajectories.reserve (10);
         tracker_trajectory_orphan_hits.reserve (20);
+        tracker_trajectory_orphan_hit_ids.reserve (20);
         tracker_trajectory_patterns.reserve (10);
         return;
       }
@@ -497,19 +742,114 @@ namespace snemo {
         true_calo_hits.clear ();
         true_xcalo_hits.clear ();
         true_gveto_hits.clear ();
+        true_scin_hits.clear ();
         calib_scin_hits.clear ();
         calib_gg_hits.clear ();
+        calib_gg_hits_cat.clear ();
         tracker_clusters.clear ();
+        tracker_clusters_cat.clear ();
         tracker_clustered_hits.clear ();
+        tracker_cluster_hit_ids.clear ();
         tracker_trajectories.clear ();
         tracker_trajectory_orphan_hits.clear ();
+        tracker_trajectory_orphan_hit_ids.clear ();
         tracker_trajectory_vertices.clear ();
         tracker_trajectory_polylines.clear ();
         tracker_trajectory_helices.clear ();
         tracker_trajectory_patterns.clear ();
+        // All the payloads allocated in the arena are gone :
+        arena.release ();
+        return;
+      }
+
+      namespace {
+
+        template<class Type>
+        std::size_t vector_memory (const std::vector<Type> & v_)
+        {
+          return v_.capacity () * sizeof (Type);
+        }
+
+        template<class Type>
+        void shrink_vector (std::vector<Type> & v_)
+        {
+          std::vector<Type> ().swap (v_);
+          return;
+        }
+
+        /// Return the size of the payloads allocated from the heap
+        template<class Type>
+        std::size_t heap_payload_memory (const std::vector<Type> & v_, std::size_t payload_size_)
+        {
+          std::size_t usage = 0;
+          for (size_t i = 0; i < v_.size (); i++)
+            {
+              if (v_[i].cat.has () && ! v_[i].cat.is_in_arena ()) usage += payload_size_;
+            }
+          return usage;
+        }
+
+      }
+
+      void export_event::shrink_data ()
+      {
+        clear_data ();
+        shrink_vector (true_particles);
+        shrink_vector (true_vertices);
+        shrink_vector (true_step_hits);
+        shrink_vector (true_gg_hits);
+        shrink_vector (true_calo_hits);
+        shrink_vector (true_xcalo_hits);
+        shrink_vector (true_gveto_hits);
+        shrink_vector (true_scin_hits);
+        shrink_vector (calib_scin_hits);
+        shrink_vector (calib_gg_hits);
+        shrink_vector (calib_gg_hits_cat);
+        shrink_vector (tracker_clusters);
+        shrink_vector (tracker_clusters_cat);
+        shrink_vector (tracker_clustered_hits);
+        shrink_vector (tracker_cluster_hit_ids);
+        shrink_vector (tracker_trajectories);
+        shrink_vector (tracker_trajectory_orphan_hits);
+        shrink_vector (tracker_trajectory_orphan_hit_ids);
+        shrink_vector (tracker_trajectory_vertices);
+        shrink_vector (tracker_trajectory_polylines);
+        shrink_vector (tracker_trajectory_helices);
+        shrink_vector (tracker_trajectory_patterns);
+        arena.clear ();
         return;
       }
 
+      std::size_t export_event::get_memory_usage () const
+      {
+        std::size_t usage = arena.get_statistics ().capacity;
+        usage += vector_memory (true_particles);
+        usage += vector_memory (true_vertices);
+        usage += vector_memory (true_step_hits);
+        usage += vector_memory (true_gg_hits);
+        usage += vector_memory (true_calo_hits);
+        usage += vector_memory (true_xcalo_hits);
+        usage += vector_memory (true_gveto_hits);
+        usage += vector_memory (true_scin_hits);
+        usage += vector_memory (calib_scin_hits);
+        usage += vector_memory (calib_gg_hits);
+        usage += vector_memory (calib_gg_hits_cat);
+        usage += vector_memory (tracker_clusters);
+        usage += vector_memory (tracker_clusters_cat);
+        usage += vector_memory (tracker_clustered_hits);
+        usage += vector_memory (tracker_cluster_hit_ids);
+        usage += vector_memory (tracker_trajectories);
+        usage += vector_memory (tracker_trajectory_orphan_hits);
+        usage += vector_memory (tracker_trajectory_orphan_hit_ids);
+        usage += vector_memory (tracker_trajectory_vertices);
+        usage += vector_memory (tracker_trajectory_polylines);
+        usage += vector_memory (tracker_trajectory_helices);
+        usage += vector_memory (tracker_trajectory_patterns);
+        usage += heap_payload_memory (calib_gg_hits, sizeof (calib_tracker_hit_cat_type));
+        usage += heap_payload_memory (tracker_clusters, sizeof (tracker_cluster_cat_type));
+        return usage;
+      }
+
       void export_event::print (std::ostream & out_,
                                 const std::string & title_,
                                 const std::string & indent_) const
@@ -540,6 +880,9 @@ namespace snemo {
         out_ << indent_ << "|-- "
              << "True gveto hits: " << true_gveto_hits.size ()
              << std::endl;
+        out_ << indent_ << "|-- "
+             << "True scin hits: " << true_scin_hits.size ()
+             << std::endl;
         out_ << indent_ << "|-- "
              << "True gg hits: " << true_gg_hits.size ()
              << std::endl;
@@ -551,12 +894,22 @@ namespace snemo {
              << "Calib gg hits: " << calib_gg_hits.size ()
              << std::endl;
 
+        out_ << indent_ << "|-- "
+             << "Calib gg hits CAT: " << calib_gg_hits_cat.size ()
+             << std::endl;
+
         out_ << indent_ << "|-- "
              << "Tracker clusters: " << tracker_clusters.size ()
              << std::endl;
+        out_ << indent_ << "|-- "
+             << "Tracker clusters CAT: " << tracker_clusters_cat.size ()
+             << std::endl;
         out_ << indent_ << "|-- "
              << "Tracker clustered hits: " << tracker_clustered_hits.size ()
              << std::endl;
+        out_ << indent_ << "|-- "
+             << "Tracker cluster hit IDs: " << tracker_cluster_hit_ids.size ()
+             << std::endl;
 
         out_ << indent_ << "|-- "
              << "Tracker trajectories: " << tracker_trajectories.size ()
@@ -573,6 +926,9 @@ namespace snemo {
         out_ << indent_ << "|-- "
              << "Tracker trajectory orphan hits: " << tracker_trajectory_orphan_hits.size ()
              << std::endl;
+        out_ << indent_ << "|-- "
+             << "Tracker trajectory orphan hit IDs: " << tracker_trajectory_orphan_hit_ids.size ()
+             << std::endl;
         out_ << indent_ << "`-- "
              << "Tracker trajectory patterns: " << tracker_trajectory_patterns.size ()
              << std::endl;
@@ -622,6 +978,13 @@ namespace snemo {
         return true_gveto_hits.at(i_);
       }
 
+      const true_scin_hit_type &
+      export_event::get_true_scin_hit (int i_) const
+      {
+        audit_vector<true_scin_hit_type> (true_scin_hits, i_);
+        return true_scin_hits.at(i_);
+      }
+
       const true_gg_hit_type &
       export_event::get_true_gg_hit (int i_) const
       {
@@ -643,6 +1006,13 @@ namespace snemo {
         return calib_gg_hits.at(i_);
       }
 
+      const calib_tracker_hit_cat_type &
+      export_event::get_calib_gg_hit_cat (int i_) const
+      {
+        audit_vector<calib_tracker_hit_cat_type> (calib_gg_hits_cat, i_);
+        return calib_gg_hits_cat.at(i_);
+      }
+
       const tracker_clustered_hit_type &
       export_event::get_tracker_clustered_hit (int i_) const
       {
@@ -657,6 +1027,13 @@ namespace snemo {
         return tracker_clusters.at(i_);
       }
 
+      const tracker_cluster_cat_type &
+      export_event::get_tracker_cluster_cat (int i_) const
+      {
+        audit_vector<tracker_cluster_cat_type> (tracker_clusters_cat, i_);
+        return tracker_clusters_cat.at(i_);
+      }
+
       const tracker_trajectory_type &
       export_event::get_tracker_trajectory (int i_) const
       {
@@ -671,6 +1048,20 @@ namespace snemo {
         return tracker_trajectory_orphan_hits.at(i_);
       }
 
+      const tracker_hit_ref_type &
+      export_event::get_tracker_cluster_hit_id (int i_) const
+      {
+        audit_vector<tracker_hit_ref_type> (tracker_cluster_hit_ids, i_);
+        return tracker_cluster_hit_ids.at(i_);
+      }
+
+      const tracker_hit_ref_type &
+      export_event::get_tracker_trajectory_orphan_hit_id (int i_) const
+      {
+        audit_vector<tracker_hit_ref_type> (tracker_trajectory_orphan_hit_ids, i_);
+        return tracker_trajectory_orphan_hit_ids.at(i_);
+      }
+
       const tracker_trajectory_pattern_type &
       export_event::get_tracker_trajectory_pattern (int i_) const
       {
@@ -699,6 +1090,183 @@ namespace snemo {
         return tracker_trajectory_helices.at(i_);
       }
 
+      void export_event::build_cat_banks ()
+      {
+        calib_gg_hits_cat.clear ();
+        for (size_t i = 0; i < calib_gg_hits.size (); i++)
+          {
+            if (! calib_tracker_hit_cat_type::is_present (calib_gg_hits[i])) continue;
+            calib_gg_hits_cat.push_back (calib_tracker_hit_cat_type ());
+            calib_gg_hits_cat.back ().extract (i, calib_gg_hits[i]);
+          }
+        tracker_clusters_cat.clear ();
+        for (size_t i = 0; i < tracker_clusters.size (); i++)
+          {
+            if (! tracker_cluster_cat_type::is_present (tracker_clusters[i])) continue;
+            tracker_clusters_cat.push_back (tracker_cluster_cat_type ());
+            tracker_clusters_cat.back ().extract (i, tracker_clusters[i]);
+          }
+        return;
+      }
+
+      void export_event::expand_cat_banks ()
+      {
+        for (size_t i = 0; i < calib_gg_hits_cat.size (); i++)
+          {
+            const calib_tracker_hit_cat_type & hit_cat = calib_gg_hits_cat[i];
+            if (hit_cat.parent_index < 0 || hit_cat.parent_index >= (int32_t) calib_gg_hits.size ()) continue;
+            hit_cat.restore (calib_gg_hits[hit_cat.parent_index]);
+          }
+        for (size_t i = 0; i < tracker_clusters_cat.size (); i++)
+          {
+            const tracker_cluster_cat_type & cluster_cat = tracker_clusters_cat[i];
+            if (cluster_cat.parent_index < 0 || cluster_cat.parent_index >= (int32_t) tracker_clusters.size ()) continue;
+            cluster_cat.restore (tracker_clusters[cluster_cat.parent_index]);
+          }
+        return;
+      }
+
+      namespace {
+
+        /// Group the member rows by parent : the members of the i-th parent are stored
+        /// from its 'first_' offset, the members without parent are stored last
+        template<class Parent, class Member>
+        void build_offsets (std::vector<Parent> & parents_,
+                            int32_t Parent::* parent_id_,
+                            uint32_t Parent::* count_,
+                            uint32_t Parent::* first_,
+                            const std::vector<Member> & members_,
+                            int32_t Member::* member_parent_id_,
+                            std::vector<tracker_hit_ref_type> & ids_)
+        {
+          std::map<int32_t, size_t> parent_indexes;
+          for (size_t i = 0; i < parents_.size (); i++)
+            {
+              parent_indexes[parents_[i].*parent_id_] = i;
+            }
+          const size_t orphan_slot = parents_.size ();
+          std::vector<uint32_t> counts (parents_.size () + 1, 0);
+          std::vector<size_t> slots (members_.size (), orphan_slot);
+          for (size_t i = 0; i < members_.size (); i++)
+            {
+              std::map<int32_t, size_t>::const_iterator found
+                = parent_indexes.find (members_[i].*member_parent_id_);
+              if (found != parent_indexes.end ()) slots[i] = found->second;
+              counts[slots[i]]++;
+            }
+          std::vector<uint32_t> cursors (counts.size (), 0);
+          uint32_t offset = 0;
+          for (size_t i = 0; i < counts.size (); i++)
+            {
+              cursors[i] = offset;
+              if (i < parents_.size ())
+                {
+                  parents_[i].*first_ = offset;
+                  parents_[i].*count_ = counts[i];
+                }
+              offset += counts[i];
+            }
+          ids_.assign (offset, tracker_hit_ref_type ());
+          for (size_t i = 0; i < members_.size (); i++)
+            {
+              tracker_hit_ref_type & id = ids_[cursors[slots[i]]++];
+              id.solution_id = members_[i].solution_id;
+              id.hit_id = members_[i].hit_id;
+              id.hit_index = members_[i].hit_index;
+            }
+          return;
+        }
+
+        /// Rebuild the member rows from the offsets of the parents
+        template<class Parent, class Member>
+        void expand_offsets (const std::vector<Parent> & parents_,
+                             int32_t Parent::* parent_id_,
+                             uint32_t Parent::* count_,
+                             uint32_t Parent::* first_,
+                             const std::vector<tracker_hit_ref_type> & ids_,
+                             int32_t Member::* member_parent_id_,
+                             int32_t Member::* member_parent_index_,
+                             std::vector<Member> & members_)
+        {
+          members_.clear ();
+          members_.reserve (ids_.size ());
+          std::vector<bool> used (ids_.size (), false);
+          for (size_t i = 0; i < parents_.size (); i++)
+            {
+              const Parent & parent = parents_[i];
+              const size_t first = parent.*first_;
+              const size_t last = std::min (first + parent.*count_, ids_.size ());
+              for (size_t j = first; j < last; j++)
+                {
+                  members_.push_back (Member ());
+                  members_.back ().solution_id = parent.solution_id;
+                  members_.back ().*member_parent_id_ = parent.*parent_id_;
+                  members_.back ().*member_parent_index_ = i;
+                  members_.back ().hit_id = ids_[j].hit_id;
+                  members_.back ().hit_index = ids_[j].hit_index;
+                  used[j] = true;
+                }
+            }
+          for (size_t j = 0; j < ids_.size (); j++)
+            {
+              if (used[j]) continue;
+              // Members with no parent (ex: unclustered hits) :
+              members_.push_back (Member ());
+              members_.back ().solution_id = ids_[j].solution_id;
+              members_.back ().hit_id = ids_[j].hit_id;
+              members_.back ().hit_index = ids_[j].hit_index;
+            }
+          return;
+        }
+
+      }
+
+      void export_event::build_membership_banks ()
+      {
+        build_offsets (tracker_clusters,
+                       &tracker_cluster_type::cluster_id,
+                       &tracker_cluster_type::number_of_hits,
+                       &tracker_cluster_type::first_hit,
+                       tracker_clustered_hits,
+                       &tracker_clustered_hit_type::cluster_id,
+                       tracker_cluster_hit_ids);
+        build_offsets (tracker_trajectories,
+                       &tracker_trajectory_type::trajectory_id,
+                       &tracker_trajectory_type::number_of_orphans,
+                       &tracker_trajectory_type::first_orphan,
+                       tracker_trajectory_orphan_hits,
+                       &tracker_trajectory_orphan_hit_type::trajectory_id,
+                       tracker_trajectory_orphan_hit_ids);
+        return;
+      }
+
+      void export_event::expand_membership_banks ()
+      {
+        if (tracker_clustered_hits.empty () && ! tracker_cluster_hit_ids.empty ())
+          {
+            expand_offsets (tracker_clusters,
+                            &tracker_cluster_type::cluster_id,
+                            &tracker_cluster_type::number_of_hits,
+                            &tracker_cluster_type::first_hit,
+                            tracker_cluster_hit_ids,
+                            &tracker_clustered_hit_type::cluster_id,
+                            &tracker_clustered_hit_type::cluster_index,
+                            tracker_clustered_hits);
+          }
+        if (tracker_trajectory_orphan_hits.empty () && ! tracker_trajectory_orphan_hit_ids.empty ())
+          {
+            expand_offsets (tracker_trajectories,
+                            &tracker_trajectory_type::trajectory_id,
+                            &tracker_trajectory_type::number_of_orphans,
+                            &tracker_trajectory_type::first_orphan,
+                            tracker_trajectory_orphan_hit_ids,
+                            &tracker_trajectory_orphan_hit_type::trajectory_id,
+                            &tracker_trajectory_orphan_hit_type::trajectory_index,
+                            tracker_trajectory_orphan_hits);
+          }
+        return;
+      }
+
       export_event::introspection_activator::introspection_activator ()
       {
         static bool activated = false;
@@ -710,6 +1278,18 @@ namespace snemo {
         return;
       }
 
+      // CAMP property of an entry of a leaf list (see export_event.h), its C++ type being its 'ctype'.
+      //
+      // Only the hit banks have a leaf list : it is shared with their compile-time descriptor
+      // (see bank_descriptor.h), so that their fill kernels cannot drift from the CAMP schema.
+      // The other classes are declared property by property : their banks are small and filled
+      // through CAMP, and several of them have properties a leaf list cannot express (accessors of
+      // the out of line CAT payloads). A class gets a leaf list together with a bank descriptor :
+#define SNEMO_EXPORTS_CAMP_LEAF(Class, Name, Member, Type, Tags) \
+            .property (Name, &Class::Member)                     \
+            .tag ("ctype", #Type)                                \
+            Tags
+
       void export_event::implement_introspection ()
       {
         std::clog << "NOTICE: export_event::implement_introspection: Entering...\n";
@@ -724,12 +1304,14 @@ namespace snemo {
             .tag ("ctype", "int32_t")
             .property ("simulated", &event_header_type::simulated)
             .tag ("ctype", "bool")
+            .tag ("bitfield", "flags")
             .property ("seconds", &event_header_type::seconds)
             .tag ("ctype", "int64_t")
             .property ("picoseconds", &event_header_type::picoseconds)
             .tag ("ctype", "int64_t")
             .property ("export_cat_infos", &event_header_type::export_cat_infos)
             .tag ("ctype", "bool")
+            .tag ("bitfield", "flags")
             ;
 
           camp::Class::declare< true_vertex_type >("true_vertex_type")
@@ -752,7 +1334,7 @@ namespace snemo {
             ;
 
           camp::Class::declare< true_particle_type >("true_particle_type")
-            .tag ("version", 0)
+            .tag ("version", 1)
             .constructor0()
             .property ("trackId", &true_particle_type::track_id)
             .tag ("ctype", "int32_t")
@@ -772,414 +1354,399 @@ namespace snemo {
             .tag ("unit", "ns")
             .property ("vertexId", &true_particle_type::vertex_id)
             .tag ("ctype", "int32_t")
+            .property ("vertexIndex", &true_particle_type::vertex_index)
+            .tag ("ctype", "int32_t")
+            .tag ("row_index", true)
             ;
 
           camp::Class::declare< true_step_hit_type >("true_step_hit_type")
             .tag ("version", 0)
             .constructor0()
-            .property ("hitId", &true_step_hit_type::hit_id)
-            .tag ("ctype", "int32_t")
-            .property ("tStart", &true_step_hit_type::tstart)
-            .tag ("ctype", "double")
-            .tag ("unit", "ns")
-            .property ("xStart", &true_step_hit_type::xstart)
-            .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("yStart", &true_step_hit_type::ystart)
-            .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("zStart", &true_step_hit_type::zstart)
+            SNEMO_EXPORTS_TRUE_STEP_HIT_LEAVES (SNEMO_EXPORTS_CAMP_LEAF)
+            ;
+
+          camp::Class::declare< true_gg_hit_type >("true_gg_hit_type")
+            .tag ("version", 1)
+            .constructor0()
+            SNEMO_EXPORTS_TRUE_GG_HIT_LEAVES (SNEMO_EXPORTS_CAMP_LEAF)
+            ;
+
+          camp::Class::declare< true_scin_hit_type >("true_scin_hit_type")
+            .tag ("version", 1)
+            .constructor0()
+            SNEMO_EXPORTS_TRUE_SCIN_HIT_LEAVES (SNEMO_EXPORTS_CAMP_LEAF)
+            ;
+
+          camp::Class::declare< calib_tracker_hit_type >("calib_tracker_hit_type")
+            .tag ("version", 2)
+            .constructor0()
+            SNEMO_EXPORTS_CALIB_TRACKER_HIT_LEAVES (SNEMO_EXPORTS_CAMP_LEAF)
+
+            // CAT informations (out of line payload) :
+            .property ("catTangencyX", &calib_tracker_hit_type::get_cat<&calib_tracker_hit_cat_type::cat_tangency_x>,
+                       &calib_tracker_hit_type::set_cat<&calib_tracker_hit_cat_type::cat_tangency_x>)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("pxStart", &true_step_hit_type::pxstart)
+            .tag ("topic", "CAT")
+            .property ("catTangencyY", &calib_tracker_hit_type::get_cat<&calib_tracker_hit_cat_type::cat_tangency_y>,
+                       &calib_tracker_hit_type::set_cat<&calib_tracker_hit_cat_type::cat_tangency_y>)
             .tag ("ctype", "double")
-            .tag ("unit", "keV")
-            .property ("pyStart", &true_step_hit_type::pystart)
+            .tag ("topic", "CAT")
+            .property ("catTangencyZ", &calib_tracker_hit_type::get_cat<&calib_tracker_hit_cat_type::cat_tangency_z>,
+                       &calib_tracker_hit_type::set_cat<&calib_tracker_hit_cat_type::cat_tangency_z>)
+            .tag ("topic", "CAT")
             .tag ("ctype", "double")
-            .tag ("unit", "keV")
-            .property ("pzStart", &true_step_hit_type::pzstart)
+            .tag ("topic", "CAT")
+            .property ("catTangencyXError", &calib_tracker_hit_type::get_cat<&calib_tracker_hit_cat_type::cat_tangency_x_error>,
+                       &calib_tracker_hit_type::set_cat<&calib_tracker_hit_cat_type::cat_tangency_x_error>)
             .tag ("ctype", "double")
-            .tag ("unit", "keV")
-            .property ("tStop", &true_step_hit_type::tstop)
+            .tag ("topic", "CAT")
+            .property ("catTangencyYError", &calib_tracker_hit_type::get_cat<&calib_tracker_hit_cat_type::cat_tangency_y_error>,
+                       &calib_tracker_hit_type::set_cat<&calib_tracker_hit_cat_type::cat_tangency_y_error>)
             .tag ("ctype", "double")
-            .tag ("unit", "ns")
-            .property ("xStop", &true_step_hit_type::xstop)
+            .tag ("topic", "CAT")
+            .property ("catTangencyZError", &calib_tracker_hit_type::get_cat<&calib_tracker_hit_cat_type::cat_tangency_z_error>,
+                       &calib_tracker_hit_type::set_cat<&calib_tracker_hit_cat_type::cat_tangency_z_error>)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("yStop", &true_step_hit_type::ystop)
+            .tag ("topic", "CAT")
+            .property ("catHelixX", &calib_tracker_hit_type::get_cat<&calib_tracker_hit_cat_type::cat_helix_x>,
+                       &calib_tracker_hit_type::set_cat<&calib_tracker_hit_cat_type::cat_helix_x>)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("zStop", &true_step_hit_type::zstop)
+            .tag ("topic", "CAT")
+            .property ("catHelixY", &calib_tracker_hit_type::get_cat<&calib_tracker_hit_cat_type::cat_helix_y>,
+                       &calib_tracker_hit_type::set_cat<&calib_tracker_hit_cat_type::cat_helix_y>)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("pxStop", &true_step_hit_type::pxstop)
+            .tag ("topic", "CAT")
+            .property ("catHelixZ", &calib_tracker_hit_type::get_cat<&calib_tracker_hit_cat_type::cat_helix_z>,
+                       &calib_tracker_hit_type::set_cat<&calib_tracker_hit_cat_type::cat_helix_z>)
             .tag ("ctype", "double")
-            .tag ("unit", "keV")
-            .property ("pyStop", &true_step_hit_type::pystop)
+            .tag ("topic", "CAT")
+            .property ("catHelixXError", &calib_tracker_hit_type::get_cat<&calib_tracker_hit_cat_type::cat_helix_x_error>,
+                       &calib_tracker_hit_type::set_cat<&calib_tracker_hit_cat_type::cat_helix_x_error>)
             .tag ("ctype", "double")
-            .tag ("unit", "keV")
-            .property ("pzStop", &true_step_hit_type::pzstop)
+            .tag ("topic", "CAT")
+            .property ("catHelixYError", &calib_tracker_hit_type::get_cat<&calib_tracker_hit_cat_type::cat_helix_y_error>,
+                       &calib_tracker_hit_type::set_cat<&calib_tracker_hit_cat_type::cat_helix_y_error>)
             .tag ("ctype", "double")
-            .tag ("unit", "keV")
-            .property ("deltaEnergy", &true_step_hit_type::delta_energy)
+            .tag ("topic", "CAT")
+            .property ("catHelixZError", &calib_tracker_hit_type::get_cat<&calib_tracker_hit_cat_type::cat_helix_z_error>,
+                       &calib_tracker_hit_type::set_cat<&calib_tracker_hit_cat_type::cat_helix_z_error>)
             .tag ("ctype", "double")
-            .tag ("unit", "keV")
-            ;
+            .tag ("topic", "CAT")
+             ;
 
-          camp::Class::declare< true_gg_hit_type >("true_gg_hit_type")
+          camp::Class::declare< calib_tracker_hit_cat_type >("calib_tracker_hit_cat_type")
             .tag ("version", 0)
+            .tag ("topic", "CAT")
             .constructor0()
-            .property ("hitId", &true_gg_hit_type::hit_id)
-            .tag ("ctype", "int32_t")
-            .property ("module", &true_gg_hit_type::module)
-            .tag ("ctype", "int32_t")
-            .property ("side", &true_gg_hit_type::side)
+            .property ("parentIndex", &calib_tracker_hit_cat_type::parent_index)
             .tag ("ctype", "int32_t")
-            .property ("layer", &true_gg_hit_type::layer)
-            .tag ("ctype", "int32_t")
-            .property ("row", &true_gg_hit_type::row)
-            .tag ("ctype", "int32_t")
-            .property ("tIonization", &true_gg_hit_type::tionization)
+            .property ("catTangencyX", &calib_tracker_hit_cat_type::cat_tangency_x)
             .tag ("ctype", "double")
-            .tag ("unit", "ns")
-            .property ("xIonization", &true_gg_hit_type::xionization)
+            .property ("catTangencyY", &calib_tracker_hit_cat_type::cat_tangency_y)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("yIonization", &true_gg_hit_type::yionization)
+            .property ("catTangencyZ", &calib_tracker_hit_cat_type::cat_tangency_z)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("zIonization", &true_gg_hit_type::zionization)
+            .property ("catTangencyXError", &calib_tracker_hit_cat_type::cat_tangency_x_error)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("pxIonization", &true_gg_hit_type::pxionization)
+            .property ("catTangencyYError", &calib_tracker_hit_cat_type::cat_tangency_y_error)
             .tag ("ctype", "double")
-            .tag ("unit", "keV")
-            .property ("pyIonization", &true_gg_hit_type::pyionization)
+            .property ("catTangencyZError", &calib_tracker_hit_cat_type::cat_tangency_z_error)
             .tag ("ctype", "double")
-            .tag ("unit", "keV")
-            .property ("pzIonization", &true_gg_hit_type::pzionization)
+            .property ("catHelixX", &calib_tracker_hit_cat_type::cat_helix_x)
             .tag ("ctype", "double")
-            .tag ("unit", "keV")
-            .property ("xAnode", &true_gg_hit_type::xanode)
+            .property ("catHelixY", &calib_tracker_hit_cat_type::cat_helix_y)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("yAnode", &true_gg_hit_type::yanode)
+            .property ("catHelixZ", &calib_tracker_hit_cat_type::cat_helix_z)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("zAnode", &true_gg_hit_type::zanode)
+            .property ("catHelixXError", &calib_tracker_hit_cat_type::cat_helix_x_error)
+            .tag ("ctype", "double")
+            .property ("catHelixYError", &calib_tracker_hit_cat_type::cat_helix_y_error)
+            .tag ("ctype", "double")
+            .property ("catHelixZError", &calib_tracker_hit_cat_type::cat_helix_z_error)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
             ;
 
-          camp::Class::declare< true_scin_hit_type >("true_scin_hit_type")
-            .tag ("version", 0)
+          camp::Class::declare< calib_calorimeter_hit_type >("calib_calorimeter_hit_type")
+            .tag ("version", 2)
             .constructor0()
-            .property ("hitId", &true_scin_hit_type::hit_id)
-            .tag ("ctype", "int32_t")
-            .property ("type", &true_scin_hit_type::type)
-            .tag ("ctype", "int32_t")
-            .property ("module", &true_scin_hit_type::module)
-            .tag ("ctype", "int32_t")
-            .property ("side", &true_scin_hit_type::side)
-            .tag ("ctype", "int32_t")
-            .property ("column", &true_scin_hit_type::column)
-            .tag ("ctype", "int32_t")
-            .property ("row", &true_scin_hit_type::row)
-            .tag ("ctype", "int32_t")
-            .property ("wall", &true_scin_hit_type::wall)
-            .tag ("ctype", "int32_t")
-            .property ("tFirst", &true_scin_hit_type::tfirst)
-            .tag ("ctype", "double")
-            .tag ("unit", "ns")
-            .property ("tLast", &true_scin_hit_type::tlast)
-            .tag ("ctype", "double")
-            .tag ("unit", "ns")
-            .property ("x1", &true_scin_hit_type::x1)
-            .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("y1", &true_scin_hit_type::y1)
-            .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("z1", &true_scin_hit_type::z1)
-            .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("x2", &true_scin_hit_type::x2)
-            .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("y2", &true_scin_hit_type::y2)
-            .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("z2", &true_scin_hit_type::z2)
-            .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("deltaEnergy", &true_scin_hit_type::delta_energy)
-            .tag ("ctype", "double")
-            .tag ("unit", "keV")
+            SNEMO_EXPORTS_CALIB_CALORIMETER_HIT_LEAVES (SNEMO_EXPORTS_CAMP_LEAF)
             ;
 
-          camp::Class::declare< calib_tracker_hit_type >("calib_tracker_hit_type")
+          camp::Class::declare< tracker_cluster_cat_type >("tracker_cluster_cat_type")
             .tag ("version", 0)
+            .tag ("topic", "CAT")
             .constructor0()
-            .property ("hitId", &calib_tracker_hit_type::hit_id)
-            .tag ("ctype", "int32_t")
-            .property ("trueHitId", &calib_tracker_hit_type::true_hit_id)
-            .tag ("ctype", "int32_t")
-            .property ("module", &calib_tracker_hit_type::module)
-            .tag ("ctype", "int32_t")
-            .property ("side", &calib_tracker_hit_type::side)
+            .property ("parentIndex", &tracker_cluster_cat_type::parent_index)
             .tag ("ctype", "int32_t")
-            .property ("layer", &calib_tracker_hit_type::layer)
-            .tag ("ctype", "int32_t")
-            .property ("row", &calib_tracker_hit_type::row)
-            .tag ("ctype", "int32_t")
-            .property ("noisy", &calib_tracker_hit_type::noisy)
-            .tag ("ctype", "bool")
-            .property ("missingBottomCathode", &calib_tracker_hit_type::missing_bottom_cathode)
+            .property ("catHasCharge", &tracker_cluster_cat_type::cat_has_charge)
             .tag ("ctype", "bool")
-            .property ("missingTopCathode", &calib_tracker_hit_type::missing_top_cathode)
-            .tag ("ctype", "bool")
-            .property ("delayed", &calib_tracker_hit_type::delayed)
+            .tag ("bitfield", "catFlags")
+            .property ("catCharge", &tracker_cluster_cat_type::cat_charge)
+            .tag ("ctype", "double")
+            .property ("catHasMomentum", &tracker_cluster_cat_type::cat_has_momentum)
             .tag ("ctype", "bool")
-            .property ("delayedTime", &calib_tracker_hit_type::delayed_time)
+            .tag ("bitfield", "catFlags")
+            .property ("catMomentumX", &tracker_cluster_cat_type::cat_momentum_x)
             .tag ("ctype", "double")
-            .tag ("unit", "ns")
-            .property ("delayedTimeError", &calib_tracker_hit_type::delayed_time_error)
+            .property ("catMomentumY", &tracker_cluster_cat_type::cat_momentum_y)
             .tag ("ctype", "double")
-            .tag ("unit", "ns")
-            .property ("x", &calib_tracker_hit_type::x)
+            .property ("catMomentumZ", &tracker_cluster_cat_type::cat_momentum_z)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("y", &calib_tracker_hit_type::y)
+            .property ("catHasHelixVertex", &tracker_cluster_cat_type::cat_has_helix_vertex)
+            .tag ("ctype", "bool")
+            .tag ("bitfield", "catFlags")
+            .property ("catHelixVertexX", &tracker_cluster_cat_type::cat_helix_vertex_x)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("z", &calib_tracker_hit_type::z)
+            .property ("catHelixVertexY", &tracker_cluster_cat_type::cat_helix_vertex_y)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("sigmaZ", &calib_tracker_hit_type::sigma_z)
+            .property ("catHelixVertexZ", &tracker_cluster_cat_type::cat_helix_vertex_z)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("r", &calib_tracker_hit_type::r)
+            .property ("catHelixVertexXError", &tracker_cluster_cat_type::cat_helix_vertex_x_error)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-            .property ("sigmaR", &calib_tracker_hit_type::sigma_r)
+            .property ("catHelixVertexYError", &tracker_cluster_cat_type::cat_helix_vertex_y_error)
             .tag ("ctype", "double")
-            .tag ("unit", "mm")
-
-            // Special CAT clustering infos :
-            .property ("hasCatInfos", &calib_tracker_hit_type::has_cat_infos)
+            .property ("catHelixVertexZError", &tracker_cluster_cat_type::cat_helix_vertex_z_error)
+            .tag ("ctype", "double")
+            .property ("catHasHelixDecayVertex", &tracker_cluster_cat_type::cat_has_helix_decay_vertex)
             .tag ("ctype", "bool")
-            .tag ("topic", "CAT")
-
-            .property ("catTangencyX", &calib_tracker_hit_type::cat_tangency_x)
+            .tag ("bitfield", "catFlags")
+            .property ("catHelixDecayVertexX", &tracker_cluster_cat_type::cat_helix_decay_vertex_x)
             .tag ("ctype", "double")
-            .tag ("topic", "CAT")
-            .property ("catTangencyY", &calib_tracker_hit_type::cat_tangency_y)
+            .property ("catHelixDecayVertexY", &tracker_cluster_cat_type::cat_helix_decay_vertex_y)
             .tag ("ctype", "double")
-            .tag ("topic", "CAT")
-            .property ("catTangencyZ", &calib_tracker_hit_type::cat_tangency_z)
-            .tag ("topic", "CAT")
+            .property ("catHelixDecayVertexZ", &tracker_cluster_cat_type::cat_helix_decay_vertex_z)
             .tag ("ctype", "double")
-            .tag ("topic", "CAT")
-            .property ("catTangencyXError", &calib_tracker_hit_type::cat_tangency_x_error)
+            .property ("catHelixDecayVertexXError", &tracker_cluster_cat_type::cat_helix_decay_vertex_x_error)
             .tag ("ctype", "double")
-            .tag ("topic", "CAT")
-            .property ("catTangencyYError", &calib_tracker_hit_type::cat_tangency_y_error)
+            .property ("catHelixDecayVertexYError", &tracker_cluster_cat_type::cat_helix_decay_vertex_y_error)
             .tag ("ctype", "double")
-            .tag ("topic", "CAT")
-            .property ("catTangencyZError", &calib_tracker_hit_type::cat_tangency_z_error)
+            .property ("catHelixDecayVertexZError", &tracker_cluster_cat_type::cat_helix_decay_vertex_z_error)
             .tag ("ctype", "double")
-            .tag ("topic", "CAT")
-            .property ("catHelixX", &calib_tracker_hit_type::cat_helix_x)
+            .property ("catHasTangentVertex", &tracker_cluster_cat_type::cat_has_tangent_vertex)
+            .tag ("ctype", "bool")
+            .tag ("bitfield", "catFlags")
+            .property ("catTangentVertexX", &tracker_cluster_cat_type::cat_tangent_vertex_x)
             .tag ("ctype", "double")
-            .tag ("topic", "CAT")
-            .property ("catHelixY", &calib_tracker_hit_type::cat_helix_y)
+            .property ("catTangentVertexY", &tracker_cluster_cat_type::cat_tangent_vertex_y)
             .tag ("ctype", "double")
-            .tag ("topic", "CAT")
-            .property ("catHelixZ", &calib_tracker_hit_type::cat_helix_z)
+            .property ("catTangentVertexZ", &tracker_cluster_cat_type::cat_tangent_vertex_z)
             .tag ("ctype", "double")
-            .tag ("topic", "CAT")
-            .property ("catHelixXError", &calib_tracker_hit_type::cat_helix_x_error)
+            .property ("catTangentVertexXError", &tracker_cluster_cat_type::cat_tangent_vertex_x_error)
             .tag ("ctype", "double")
-            .tag ("topic", "CAT")
-            .property ("catHelixYError", &calib_tracker_hit_type::cat_helix_y_error)
+            .property ("catTangentVertexYError", &tracker_cluster_cat_type::cat_tangent_vertex_y_error)
             .tag ("ctype", "double")
-            .tag ("topic", "CAT")
-            .property ("catHelixZError", &calib_tracker_hit_type::cat_helix_z_error)
+            .property ("catTangentVertexZError", &tracker_cluster_cat_type::cat_tangent_vertex_z_error)
             .tag ("ctype", "double")
-            .tag ("topic", "CAT")
-             ;
-
-          camp::Class::declare< calib_calorimeter_hit_type >("calib_calorimeter_hit_type")
-            .tag ("version", 0)
-            .constructor0()
-            .property ("hitId", &calib_calorimeter_hit_type::hit_id)
-            .tag ("ctype", "int32_t")
-            .property ("trueHitId", &calib_calorimeter_hit_type::true_hit_id)
-            .tag ("ctype", "int32_t")
-            .property ("type", &calib_calorimeter_hit_type::type)
-            .tag ("ctype", "int32_t")
-            .property ("module", &calib_calorimeter_hit_type::module)
-            .tag ("ctype", "int32_t")
-            .property ("side", &calib_calorimeter_hit_type::side)
-            .tag ("ctype", "int32_t")
-            .property ("column", &calib_calorimeter_hit_type::column)
-            .tag ("ctype", "int32_t")
-            .property ("row", &calib_calorimeter_hit_type::row)
-            .tag ("ctype", "int32_t")
-            .property ("wall", &calib_calorimeter_hit_type::wall)
-            .tag ("ctype", "int32_t")
-            .property ("time", &calib_calorimeter_hit_type::time)
+            .property ("catHasTangentDecayVertex", &tracker_cluster_cat_type::cat_has_tangent_decay_vertex)
+            .tag ("ctype", "bool")
+            .tag ("bitfield", "catFlags")
+            .property ("catTangentDecayVertexX", &tracker_cluster_cat_type::cat_tangent_decay_vertex_x)
             .tag ("ctype", "double")
-            .tag ("unit", "ns")
-            .property ("sigmaTime", &calib_calorimeter_hit_type::sigma_time)
+            .property ("catTangentDecayVertexY", &tracker_cluster_cat_type::cat_tangent_decay_vertex_y)
             .tag ("ctype", "double")
-            .tag ("unit", "ns")
-            .property ("energy", &calib_calorimeter_hit_type::energy)
+            .property ("catTangentDecayVertexZ", &tracker_cluster_cat_type::cat_tangent_decay_vertex_z)
             .tag ("ctype", "double")
-            .tag ("unit", "keV")
-            .property ("sigmaEnergy", &calib_calorimeter_hit_type::sigma_energy)
+            .property ("catTangentDecayVertexXError", &tracker_cluster_cat_type::cat_tangent_decay_vertex_x_error)
+            .tag ("ctype", "double")
+            .property ("catTangentDecayVertexYError", &tracker_cluster_cat_type::cat_tangent_decay_vertex_y_error)
+            .tag ("ctype", "double")
+            .property ("catTangentDecayVertexZError", &tracker_cluster_cat_type::cat_tangent_decay_vertex_z_error)
             .tag ("ctype", "double")
-            .tag ("unit", "keV")
             ;
 
           camp::Class::declare< tracker_clustered_hit_type >("tracker_clustered_hit_type")
-            .tag ("version", 0)
+            .tag ("version", 1)
             .constructor0()
             .property ("solutionId", &tracker_clustered_hit_type::solution_id)
             .tag ("ctype", "int32_t")
+            .tag ("scope", "event")
             .property ("clusterId", &tracker_clustered_hit_type::cluster_id)
             .tag ("ctype", "int32_t")
             .property ("hitId", &tracker_clustered_hit_type::hit_id)
             .tag ("ctype", "int32_t")
+            .property ("clusterIndex", &tracker_clustered_hit_type::cluster_index)
+            .tag ("ctype", "int32_t")
+            .tag ("row_index", true)
+            .property ("hitIndex", &tracker_clustered_hit_type::hit_index)
+            .tag ("ctype", "int32_t")
+            .tag ("row_index", true)
            ;
 
           camp::Class::declare< tracker_cluster_type >("tracker_cluster_type")
-            .tag ("version", 0)
+            .tag ("version", 1)
             .constructor0()
             .property ("solutionId", &tracker_cluster_type::solution_id)
             .tag ("ctype", "int32_t")
+            .tag ("scope", "event")
             .property ("clusterId", &tracker_cluster_type::cluster_id)
             .tag ("ctype", "int32_t")
             .property ("module", &tracker_cluster_type::module)
             .tag ("ctype", "int32_t")
+            .tag ("nullable", true)
             .property ("side", &tracker_cluster_type::side)
             .tag ("ctype", "int32_t")
+            .tag ("nullable", true)
             .property ("delayed", &tracker_cluster_type::delayed)
             .tag ("ctype", "bool")
+            .tag ("bitfield", "flags")
             .property ("numberOfHits", &tracker_cluster_type::number_of_hits)
             .tag ("ctype", "uint32_t")
+            .property ("firstHit", &tracker_cluster_type::first_hit)
+            .tag ("ctype", "uint32_t")
+            .tag ("membership_offset", true)
 
 
             // Special CAT clustering infos :
             .property ("hasCatInfos", &tracker_cluster_type::has_cat_infos)
             .tag ("ctype", "bool")
+            .tag ("bitfield", "catFlags")
             .tag ("topic", "CAT")
 
-            .property ("catHasCharge", &tracker_cluster_type::cat_has_charge)
+            .property ("catHasCharge", &tracker_cluster_type::get_cat<bool, &tracker_cluster_cat_type::cat_has_charge>,
+                       &tracker_cluster_type::set_cat<bool, &tracker_cluster_cat_type::cat_has_charge>)
             .tag ("ctype", "bool")
+            .tag ("bitfield", "catFlags")
             .tag ("topic", "CAT")
-            .property ("catCharge", &tracker_cluster_type::cat_charge)
+            .property ("catCharge", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_charge>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_charge>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
 
-            .property ("catHasMomentum", &tracker_cluster_type::cat_has_momentum)
+            .property ("catHasMomentum", &tracker_cluster_type::get_cat<bool, &tracker_cluster_cat_type::cat_has_momentum>,
+                       &tracker_cluster_type::set_cat<bool, &tracker_cluster_cat_type::cat_has_momentum>)
             .tag ("ctype", "bool")
+            .tag ("bitfield", "catFlags")
             .tag ("topic", "CAT")
-            .property ("catMomentumX", &tracker_cluster_type::cat_momentum_x)
+            .property ("catMomentumX", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_momentum_x>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_momentum_x>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catMomentumY", &tracker_cluster_type::cat_momentum_y)
+            .property ("catMomentumY", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_momentum_y>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_momentum_y>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catMomentumZ", &tracker_cluster_type::cat_momentum_z)
+            .property ("catMomentumZ", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_momentum_z>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_momentum_z>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
 
-            .property ("catHasHelixVertex", &tracker_cluster_type::cat_has_helix_vertex)
+            .property ("catHasHelixVertex", &tracker_cluster_type::get_cat<bool, &tracker_cluster_cat_type::cat_has_helix_vertex>,
+                       &tracker_cluster_type::set_cat<bool, &tracker_cluster_cat_type::cat_has_helix_vertex>)
             .tag ("ctype", "bool")
+            .tag ("bitfield", "catFlags")
             .tag ("topic", "CAT")
-            .property ("caTHelixVertexX", &tracker_cluster_type::cat_helix_vertex_x)
+            .property ("caTHelixVertexX", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_helix_vertex_x>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_helix_vertex_x>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catHelixVertexY", &tracker_cluster_type::cat_helix_vertex_y)
+            .property ("catHelixVertexY", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_helix_vertex_y>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_helix_vertex_y>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catHelixVertexZ", &tracker_cluster_type::cat_helix_vertex_z)
+            .property ("catHelixVertexZ", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_helix_vertex_z>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_helix_vertex_z>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catHelixVertexXError", &tracker_cluster_type::cat_helix_vertex_x_error)
+            .property ("catHelixVertexXError", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_helix_vertex_x_error>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_helix_vertex_x_error>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catHelixVertexYError", &tracker_cluster_type::cat_helix_vertex_y_error)
+            .property ("catHelixVertexYError", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_helix_vertex_y_error>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_helix_vertex_y_error>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catHelixVertexZError", &tracker_cluster_type::cat_helix_vertex_z_error)
+            .property ("catHelixVertexZError", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_helix_vertex_z_error>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_helix_vertex_z_error>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
 
-            .property ("catHasHelixDecayVertex", &tracker_cluster_type::cat_has_helix_decay_vertex)
+            .property ("catHasHelixDecayVertex", &tracker_cluster_type::get_cat<bool, &tracker_cluster_cat_type::cat_has_helix_decay_vertex>,
+                       &tracker_cluster_type::set_cat<bool, &tracker_cluster_cat_type::cat_has_helix_decay_vertex>)
             .tag ("ctype", "bool")
+            .tag ("bitfield", "catFlags")
             .tag ("topic", "CAT")
-            .property ("catHelixDecayVertexX", &tracker_cluster_type::cat_helix_decay_vertex_x)
+            .property ("catHelixDecayVertexX", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_helix_decay_vertex_x>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_helix_decay_vertex_x>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catHelixDecayVertexY", &tracker_cluster_type::cat_helix_decay_vertex_y)
+            .property ("catHelixDecayVertexY", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_helix_decay_vertex_y>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_helix_decay_vertex_y>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catHelixDecayVertexZ", &tracker_cluster_type::cat_helix_decay_vertex_z)
+            .property ("catHelixDecayVertexZ", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_helix_decay_vertex_z>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_helix_decay_vertex_z>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catHelixDecayVertexXError", &tracker_cluster_type::cat_helix_decay_vertex_x_error)
+            .property ("catHelixDecayVertexXError", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_helix_decay_vertex_x_error>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_helix_decay_vertex_x_error>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catHelixDecayVertexYError", &tracker_cluster_type::cat_helix_decay_vertex_y_error)
+            .property ("catHelixDecayVertexYError", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_helix_decay_vertex_y_error>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_helix_decay_vertex_y_error>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catHelixDecayVertexZError", &tracker_cluster_type::cat_helix_decay_vertex_z_error)
+            .property ("catHelixDecayVertexZError", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_helix_decay_vertex_z_error>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_helix_decay_vertex_z_error>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
 
-            .property ("catHasTangentVertex", &tracker_cluster_type::cat_has_tangent_vertex)
+            .property ("catHasTangentVertex", &tracker_cluster_type::get_cat<bool, &tracker_cluster_cat_type::cat_has_tangent_vertex>,
+                       &tracker_cluster_type::set_cat<bool, &tracker_cluster_cat_type::cat_has_tangent_vertex>)
             .tag ("ctype", "bool")
+            .tag ("bitfield", "catFlags")
             .tag ("topic", "CAT")
-            .property ("catTangentVertexX", &tracker_cluster_type::cat_tangent_vertex_x)
+            .property ("catTangentVertexX", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_tangent_vertex_x>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_tangent_vertex_x>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catTangentVertexY", &tracker_cluster_type::cat_tangent_vertex_y)
+            .property ("catTangentVertexY", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_tangent_vertex_y>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_tangent_vertex_y>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catTangentVertexZ", &tracker_cluster_type::cat_tangent_vertex_z)
+            .property ("catTangentVertexZ", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_tangent_vertex_z>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_tangent_vertex_z>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catTangentVertexXError", &tracker_cluster_type::cat_tangent_vertex_x_error)
+            .property ("catTangentVertexXError", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_tangent_vertex_x_error>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_tangent_vertex_x_error>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catTangentVertexYError", &tracker_cluster_type::cat_tangent_vertex_y_error)
+            .property ("catTangentVertexYError", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_tangent_vertex_y_error>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_tangent_vertex_y_error>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catTangentVertexZError", &tracker_cluster_type::cat_tangent_vertex_z_error)
+            .property ("catTangentVertexZError", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_tangent_vertex_z_error>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_tangent_vertex_z_error>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
 
-            .property ("catHasTangentDecayVertex", &tracker_cluster_type::cat_has_tangent_decay_vertex)
+            .property ("catHasTangentDecayVertex", &tracker_cluster_type::get_cat<bool, &tracker_cluster_cat_type::cat_has_tangent_decay_vertex>,
+                       &tracker_cluster_type::set_cat<bool, &tracker_cluster_cat_type::cat_has_tangent_decay_vertex>)
             .tag ("ctype", "bool")
+            .tag ("bitfield", "catFlags")
             .tag ("topic", "CAT")
-            .property ("catTangentDecayVertexX", &tracker_cluster_type::cat_tangent_decay_vertex_x)
+            .property ("catTangentDecayVertexX", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_tangent_decay_vertex_x>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_tangent_decay_vertex_x>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catTangentDecayVertexY", &tracker_cluster_type::cat_tangent_decay_vertex_y)
+            .property ("catTangentDecayVertexY", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_tangent_decay_vertex_y>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_tangent_decay_vertex_y>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catTangentDecayVertexZ", &tracker_cluster_type::cat_tangent_decay_vertex_z)
+            .property ("catTangentDecayVertexZ", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_tangent_decay_vertex_z>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_tangent_decay_vertex_z>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catTangentDecayVertexXError", &tracker_cluster_type::cat_tangent_decay_vertex_x_error)
+            .property ("catTangentDecayVertexXError", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_tangent_decay_vertex_x_error>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_tangent_decay_vertex_x_error>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catTangentDecayVertexYError", &tracker_cluster_type::cat_tangent_decay_vertex_y_error)
+            .property ("catTangentDecayVertexYError", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_tangent_decay_vertex_y_error>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_tangent_decay_vertex_y_error>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
-            .property ("catTangentDecayVertexZError", &tracker_cluster_type::cat_tangent_decay_vertex_z_error)
+            .property ("catTangentDecayVertexZError", &tracker_cluster_type::get_cat<double, &tracker_cluster_cat_type::cat_tangent_decay_vertex_z_error>,
+                       &tracker_cluster_type::set_cat<double, &tracker_cluster_cat_type::cat_tangent_decay_vertex_z_error>)
             .tag ("ctype", "double")
             .tag ("topic", "CAT")
            ;
@@ -1244,35 +1811,65 @@ namespace snemo {
            ;
 
           camp::Class::declare< tracker_trajectory_type >("tracker_trajectory_type")
-            .tag ("version", 0)
+            .tag ("version", 2)
             .constructor0()
             .property ("solutionId", &tracker_trajectory_type::solution_id)
             .tag ("ctype", "int32_t")
+            .tag ("scope", "event")
             .property ("trajectoryId", &tracker_trajectory_type::trajectory_id)
             .tag ("ctype", "int32_t")
             .property ("module", &tracker_trajectory_type::module)
             .tag ("ctype", "int32_t")
+            .tag ("nullable", true)
             .property ("side", &tracker_trajectory_type::side)
             .tag ("ctype", "int32_t")
+            .tag ("nullable", true)
             .property ("clusterId", &tracker_trajectory_type::cluster_id)
             .tag ("ctype", "int32_t")
+            .property ("clusterIndex", &tracker_trajectory_type::cluster_index)
+            .tag ("ctype", "int32_t")
+            .tag ("row_index", true)
             .property ("delayed", &tracker_trajectory_type::delayed)
             .tag ("ctype", "bool")
+            .tag ("bitfield", "flags")
             .property ("numberOfOrphans", &tracker_trajectory_type::number_of_orphans)
             .tag ("ctype", "uint32_t")
+            .property ("firstOrphan", &tracker_trajectory_type::first_orphan)
+            .tag ("ctype", "uint32_t")
+            .tag ("membership_offset", true)
             .property ("patternId", &tracker_trajectory_type::pattern_id)
             .tag ("ctype", "int32_t")
            ;
 
           camp::Class::declare< tracker_trajectory_orphan_hit_type >("tracker_trajectory_orphan_hit_type")
-            .tag ("version", 0)
+            .tag ("version", 1)
             .constructor0()
             .property ("solutionId", &tracker_trajectory_orphan_hit_type::solution_id)
             .tag ("ctype", "int32_t")
+            .tag ("scope", "event")
             .property ("trajectoryId", &tracker_trajectory_orphan_hit_type::trajectory_id)
             .tag ("ctype", "int32_t")
             .property ("hitId", &tracker_trajectory_orphan_hit_type::hit_id)
             .tag ("ctype", "int32_t")
+            .property ("trajectoryIndex", &tracker_trajectory_orphan_hit_type::trajectory_index)
+            .tag ("ctype", "int32_t")
+            .tag ("row_index", true)
+            .property ("hitIndex", &tracker_trajectory_orphan_hit_type::hit_index)
+            .tag ("ctype", "int32_t")
+            .tag ("row_index", true)
+            ;
+
+          camp::Class::declare< tracker_hit_ref_type >("tracker_hit_ref_type")
+            .tag ("version", 2)
+            .constructor0()
+            .property ("solutionId", &tracker_hit_ref_type::solution_id)
+            .tag ("ctype", "int32_t")
+            .tag ("scope", "event")
+            .property ("hitId", &tracker_hit_ref_type::hit_id)
+            .tag ("ctype", "int32_t")
+            .property ("hitIndex", &tracker_hit_ref_type::hit_index)
+            .tag ("ctype", "int32_t")
+            .tag ("row_index", true)
             ;
 
           camp::Class::declare< tracker_trajectory_pattern_type >("tracker_trajectory_pattern_type")
@@ -1282,6 +1879,7 @@ namespace snemo {
             .tag ("ctype", "int32_t")
             .property ("solutionId", &tracker_trajectory_pattern_type::solution_id)
             .tag ("ctype", "int32_t")
+            .tag ("scope", "event")
             .property ("trajectoryId", &tracker_trajectory_pattern_type::trajectory_id)
             .tag ("ctype", "int32_t")
             .property ("patternType", &tracker_trajectory_pattern_type::pattern_type)
@@ -1351,6 +1949,13 @@ namespace snemo {
                        &export_event::true_gveto_hits)
             .function ("trueGvetoHits@get", &export_event::get_true_gveto_hit)
 
+            // True calo, xcalo and gveto hits (unified bank) :
+            .property ("trueScinHits",      &export_event::true_scin_hits)
+            .property ("trueScinHits@size",
+                       &std::vector<true_scin_hit_type>::size,
+                       &export_event::true_scin_hits)
+            .function ("trueScinHits@get",  &export_event::get_true_scin_hit)
+
             // True gg hits :
             .property ("trueGgHits",        &export_event::true_gg_hits)
             .property ("trueGgHits@size",
@@ -1372,6 +1977,13 @@ namespace snemo {
                        &export_event::calib_gg_hits)
             .function ("calibTrackerHits@get",   &export_event::get_calib_gg_hit)
 
+            // CAT informations of the calibrated tracker hits (sparse) :
+            .property ("calibTrackerHitsCat",       &export_event::calib_gg_hits_cat)
+            .property ("calibTrackerHitsCat@size",
+                       &std::vector<calib_tracker_hit_cat_type>::size,
+                       &export_event::calib_gg_hits_cat)
+            .function ("calibTrackerHitsCat@get",   &export_event::get_calib_gg_hit_cat)
+
             // Tracker clusters :
             .property ("trackerClusters",       &export_event::tracker_clusters)
             .property ("trackerClusters@size",
@@ -1379,6 +1991,13 @@ namespace snemo {
                        &export_event::tracker_clusters)
             .function ("trackerClusters@get",   &export_event::get_tracker_cluster)
 
+            // CAT informations of the tracker clusters (sparse) :
+            .property ("trackerClustersCat",       &export_event::tracker_clusters_cat)
+            .property ("trackerClustersCat@size",
+                       &std::vector<tracker_cluster_cat_type>::size,
+                       &export_event::tracker_clusters_cat)
+            .function ("trackerClustersCat@get",   &export_event::get_tracker_cluster_cat)
+
             // Tracker clustered hits :
             .property ("trackerClusteredHits",       &export_event::tracker_clustered_hits)
             .property ("trackerClusteredHits@size",
@@ -1386,6 +2005,13 @@ namespace snemo {
                        &export_event::tracker_clustered_hits)
             .function ("trackerClusteredHits@get",   &export_event::get_tracker_clustered_hit)
 
+            // Hit IDs of the tracker clusters (offsets) :
+            .property ("trackerClusterHitIds",       &export_event::tracker_cluster_hit_ids)
+            .property ("trackerClusterHitIds@size",
+                       &std::vector<tracker_hit_ref_type>::size,
+                       &export_event::tracker_cluster_hit_ids)
+            .function ("trackerClusterHitIds@get",   &export_event::get_tracker_cluster_hit_id)
+
             // Tracker trajectories :
             .property ("trackerTrajectories",       &export_event::tracker_trajectories)
             .property ("trackerTrajectories@size",
@@ -1400,6 +2026,13 @@ namespace snemo {
                        &export_event::tracker_trajectory_orphan_hits)
             .function ("trackerTrajectoryOrphanHits@get",   &export_event::get_tracker_trajectory_orphan_hit)
 
+            // Hit IDs of the tracker trajectory orphans (offsets) :
+            .property ("trackerTrajectoryOrphanHitIds",       &export_event::tracker_trajectory_orphan_hit_ids)
+            .property ("trackerTrajectoryOrphanHitIds@size",
+                       &std::vector<tracker_hit_ref_type>::size,
+                       &export_event::tracker_trajectory_orphan_hit_ids)
+            .function ("trackerTrajectoryOrphanHitIds@get",   &export_event::get_tracker_trajectory_orphan_hit_id)
+
             // Tracker trajectory patterns:
             .property ("trackerTrajectoryPatterns",       &export_event::tracker_trajectory_patterns)
             .property ("trackerTrajectoryPatterns@size",
@@ -1445,6 +2078,8 @@ namespace snemo {
         std::clog << "NOTICE: export_event::implement_introspection: Exiting.\n";
       }
 
+#undef SNEMO_EXPORTS_CAMP_LEAF
+
     }  // end of namespace exports
 
   }  // end of namespace reconstruction
@@ -21,11 +21,17 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <utility>
+#include <type_traits>
+#include <new>
+#include <cstddef>
 
 #include <boost/cstdint.hpp>
 #include <camp/camptype.hpp>
 #include <camp/class.hpp>
 
+#include <falaise/snemo/exports/event_arena.h>
+
 namespace snemo {
 
   namespace reconstruction {
@@ -63,6 +69,195 @@ namespace snemo {
           };
       };
 
+      /// \brief Packed identifiers of the detector cells
+      ///
+      /// The address of a cell is packed in a single unsigned key, most
+      /// significant field first, so that the keys sort in detector order.
+      /// Each field stores the address plus one, zero standing for a missing
+      /// (negative) address. The all-ones key is reserved for INVALID_KEY :
+      ///
+      ///   tracker     : module[31:24] side[23:20] layer[19:12] row[11:0]
+      ///   calorimeter : type[31:28] module[27:20] side[19:16] wall[15:12] column[11:6] row[5:0]
+      struct cell_key
+      {
+        static const uint32_t INVALID_KEY = 0xFFFFFFFF;
+
+        /// Build the key of a Geiger cell (INVALID_KEY if an address overflows its field)
+        static uint32_t make_tracker (int32_t module_, int32_t side_, int32_t layer_, int32_t row_);
+
+        /// Decode the key of a Geiger cell
+        static void decode_tracker (uint32_t key_,
+                                    int32_t & module_, int32_t & side_, int32_t & layer_, int32_t & row_);
+
+        /// Build the key of a calorimeter block (INVALID_KEY if an address overflows its field)
+        static uint32_t make_calorimeter (int32_t type_, int32_t module_, int32_t side_,
+                                          int32_t wall_, int32_t column_, int32_t row_);
+
+        /// Decode the key of a calorimeter block
+        static void decode_calorimeter (uint32_t key_,
+                                        int32_t & type_, int32_t & module_, int32_t & side_,
+                                        int32_t & wall_, int32_t & column_, int32_t & row_);
+
+        /// Compare two hits by cell key
+        template<class Hit>
+        static bool less (const Hit & hit0_, const Hit & hit1_)
+        {
+          return hit0_.cell_key < hit1_.cell_key;
+        }
+      };
+
+      /// \brief Out of line storage of an optional payload
+      ///
+      /// The payload is only allocated when some value is set, so that the
+      /// records which do not use it keep a single pointer in their hot
+      /// fields. A missing payload reads as a default constructed one.
+      /// The payload may be allocated in an event arena, in which case its
+      /// storage is released with the arena, not by the record.
+      template<class Payload>
+      class lazy_payload
+      {
+      public:
+
+        lazy_payload () : _address_ (0) {}
+
+        lazy_payload (const lazy_payload & other_)
+          : _address_ (other_.has () ? reinterpret_cast<std::size_t> (new Payload (other_.get ())) : 0) {}
+
+        lazy_payload (lazy_payload && other_) noexcept : _address_ (other_._address_)
+        {
+          other_._address_ = 0;
+        }
+
+        ~lazy_payload ()
+        {
+          reset ();
+        }
+
+        lazy_payload & operator= (const lazy_payload & other_)
+        {
+          lazy_payload tmp (other_);
+          swap (tmp);
+          return *this;
+        }
+
+        lazy_payload & operator= (lazy_payload && other_) noexcept
+        {
+          reset ();
+          swap (other_);
+          return *this;
+        }
+
+        void swap (lazy_payload & other_) noexcept
+        {
+          std::swap (_address_, other_._address_);
+          return;
+        }
+
+        /// Check if the payload is allocated
+        bool has () const
+        {
+          return _address_ != 0;
+        }
+
+        /// Check if the payload is allocated in an event arena
+        bool is_in_arena () const
+        {
+          return (_address_ & ARENA_BIT) != 0;
+        }
+
+        /// Return the payload (must be allocated)
+        const Payload & get () const
+        {
+          return *_payload ();
+        }
+
+        /// Return the payload, allocating it from the heap if needed
+        Payload & grab ()
+        {
+          if (_address_ == 0) _address_ = reinterpret_cast<std::size_t> (new Payload);
+          return *_payload ();
+        }
+
+        /// Return the payload, allocating it from an event arena if needed (heap if the arena is inactive)
+        Payload & grab (event_arena & arena_)
+        {
+          static_assert (alignof (Payload) > ARENA_BIT, "Payload alignment leaves no room for the arena bit");
+          if (_address_ == 0)
+            {
+              void * storage = arena_.allocate (sizeof (Payload), alignof (Payload));
+              if (storage == 0) return grab ();
+              _address_ = reinterpret_cast<std::size_t> (new (storage) Payload) | ARENA_BIT;
+            }
+          return *_payload ();
+        }
+
+        /// Return the payload or the default one
+        const Payload & value () const
+        {
+          return _address_ != 0 ? *_payload () : defaults ();
+        }
+
+        /// Release the payload
+        void reset () noexcept
+        {
+          if (_address_ == 0) return;
+          if (is_in_arena ())
+            {
+              _payload ()->~Payload ();
+            }
+          else
+            {
+              delete _payload ();
+            }
+          _address_ = 0;
+          return;
+        }
+
+        /// Return a field of the payload (default value if not allocated)
+        template<class Field>
+        Field get (Field Payload::* field_) const
+        {
+          return value ().*field_;
+        }
+
+        /// Set a field of the payload (default values do not allocate it)
+        template<class Field>
+        void set (Field Payload::* field_, Field value_)
+        {
+          if (_address_ == 0 && _is_default (defaults ().*field_, value_)) return;
+          grab ().*field_ = value_;
+          return;
+        }
+
+        /// Return the default payload
+        static const Payload & defaults ()
+        {
+          static const Payload _defaults;
+          return _defaults;
+        }
+
+      private:
+
+        static const std::size_t ARENA_BIT = 0x1;
+
+        Payload * _payload () const
+        {
+          return reinterpret_cast<Payload *> (_address_ & ~ARENA_BIT);
+        }
+
+        template<class Field>
+        static bool _is_default (const Field & default_, const Field & value_)
+        {
+          // Missing values (NaN) compare equal :
+          return value_ == default_ || (value_ != value_ && default_ != default_);
+        }
+
+      private:
+
+        std::size_t _address_; /// Address of the payload (null if not allocated, lowest bit set if in an arena)
+
+      };
+
       struct event_header_type
       {
       public:
@@ -98,7 +293,7 @@ namespace snemo {
       struct true_particle_type
       {
       public:
-        static const int32_t EXPORT_VERSION = 0;
+        static const int32_t EXPORT_VERSION = 1;
         true_particle_type ();
         void reset ();
       public:
@@ -109,6 +304,7 @@ namespace snemo {
         double  pz; // mm
         double  time; // ns
         int32_t vertex_id;
+        int32_t vertex_index; // row of the vertex in the true vertex bank
       };
 
       struct true_step_hit_type
@@ -136,18 +332,41 @@ namespace snemo {
         double  delta_energy;  // keV
       };
 
+      /// Leaves of the true step hits, in storage order (CAMP declaration and bank descriptor) :
+      ///   LEAF (class, leaf name, member, C++ type, other CAMP tags)
+#define SNEMO_EXPORTS_TRUE_STEP_HIT_LEAVES(LEAF)                                            \
+      LEAF (true_step_hit_type, "hitId",       hit_id,       int32_t, )                     \
+      LEAF (true_step_hit_type, "tStart",      tstart,       double,  .tag ("unit", "ns"))  \
+      LEAF (true_step_hit_type, "xStart",      xstart,       double,  .tag ("unit", "mm"))  \
+      LEAF (true_step_hit_type, "yStart",      ystart,       double,  .tag ("unit", "mm"))  \
+      LEAF (true_step_hit_type, "zStart",      zstart,       double,  .tag ("unit", "mm"))  \
+      LEAF (true_step_hit_type, "pxStart",     pxstart,      double,  .tag ("unit", "keV")) \
+      LEAF (true_step_hit_type, "pyStart",     pystart,      double,  .tag ("unit", "keV")) \
+      LEAF (true_step_hit_type, "pzStart",     pzstart,      double,  .tag ("unit", "keV")) \
+      LEAF (true_step_hit_type, "tStop",       tstop,        double,  .tag ("unit", "ns"))  \
+      LEAF (true_step_hit_type, "xStop",       xstop,        double,  .tag ("unit", "mm"))  \
+      LEAF (true_step_hit_type, "yStop",       ystop,        double,  .tag ("unit", "mm"))  \
+      LEAF (true_step_hit_type, "zStop",       zstop,        double,  .tag ("unit", "mm"))  \
+      LEAF (true_step_hit_type, "pxStop",      pxstop,       double,  .tag ("unit", "keV")) \
+      LEAF (true_step_hit_type, "pyStop",      pystop,       double,  .tag ("unit", "keV")) \
+      LEAF (true_step_hit_type, "pzStop",      pzstop,       double,  .tag ("unit", "keV")) \
+      LEAF (true_step_hit_type, "deltaEnergy", delta_energy, double,  .tag ("unit", "keV"))
+
       struct true_gg_hit_type
       {
       public:
-        static const int32_t EXPORT_VERSION = 0;
+        static const int32_t EXPORT_VERSION = 1;
         true_gg_hit_type ();
         void reset ();
+        void encode_cell_key ();
+        void decode_cell_key ();
       public:
         int32_t hit_id;  // >=0
         int32_t module;  // >=0
         int32_t side;    // 0 for x<0, 1 for x>0
         int32_t layer;   // [0..8]
         int32_t row;     // [0..112]
+        uint32_t cell_key; // packed cell identifier
         double  tionization;  // ns
         double  xionization;  // mm
         double  yionization;  // mm
@@ -160,12 +379,34 @@ namespace snemo {
         double  zanode;       // mm
       };
 
+      /// Leaves of the true Geiger hits, in storage order (CAMP declaration and bank descriptor) :
+      ///   LEAF (class, leaf name, member, C++ type, other CAMP tags)
+#define SNEMO_EXPORTS_TRUE_GG_HIT_LEAVES(LEAF)                                                      \
+      LEAF (true_gg_hit_type, "hitId",        hit_id,       int32_t,  )                             \
+      LEAF (true_gg_hit_type, "module",       module,       int32_t,  .tag ("cell_id", "tracker"))  \
+      LEAF (true_gg_hit_type, "side",         side,         int32_t,  .tag ("cell_id", "tracker"))  \
+      LEAF (true_gg_hit_type, "layer",        layer,        int32_t,  .tag ("cell_id", "tracker"))  \
+      LEAF (true_gg_hit_type, "row",          row,          int32_t,  .tag ("cell_id", "tracker"))  \
+      LEAF (true_gg_hit_type, "cellKey",      cell_key,     uint32_t, .tag ("cell_key", "tracker")) \
+      LEAF (true_gg_hit_type, "tIonization",  tionization,  double,   .tag ("unit", "ns"))          \
+      LEAF (true_gg_hit_type, "xIonization",  xionization,  double,   .tag ("unit", "mm"))          \
+      LEAF (true_gg_hit_type, "yIonization",  yionization,  double,   .tag ("unit", "mm"))          \
+      LEAF (true_gg_hit_type, "zIonization",  zionization,  double,   .tag ("unit", "mm"))          \
+      LEAF (true_gg_hit_type, "pxIonization", pxionization, double,   .tag ("unit", "keV"))         \
+      LEAF (true_gg_hit_type, "pyIonization", pyionization, double,   .tag ("unit", "keV"))         \
+      LEAF (true_gg_hit_type, "pzIonization", pzionization, double,   .tag ("unit", "keV"))         \
+      LEAF (true_gg_hit_type, "xAnode",       xanode,       double,   .tag ("unit", "mm"))          \
+      LEAF (true_gg_hit_type, "yAnode",       yanode,       double,   .tag ("unit", "mm"))          \
+      LEAF (true_gg_hit_type, "zAnode",       zanode,       double,   .tag ("unit", "mm"))
+
       struct true_scin_hit_type
       {
       public:
-        static const int32_t EXPORT_VERSION = 0;
+        static const int32_t EXPORT_VERSION = 1;
         true_scin_hit_type ();
         void reset ();
+        void encode_cell_key ();
+        void decode_cell_key ();
       public:
         int32_t hit_id;  // >=0
         int32_t type;    // >=0
@@ -174,6 +415,7 @@ namespace snemo {
         int32_t column;  // [0..8]
         int32_t row;     // [0..112]
         int32_t wall;    // >=0
+        uint32_t cell_key; // packed cell identifier
         double  tfirst;  // ns
         double  tlast;   // ns
         double  x1;  // mm
@@ -185,24 +427,87 @@ namespace snemo {
         double  delta_energy; // keV
       };
 
-      struct calib_tracker_hit_type
+      /// Leaves of the true scintillator hits, in storage order (CAMP declaration and bank descriptor) :
+      ///   LEAF (class, leaf name, member, C++ type, other CAMP tags)
+#define SNEMO_EXPORTS_TRUE_SCIN_HIT_LEAVES(LEAF)                                                                                \
+      LEAF (true_scin_hit_type, "hitId",       hit_id,       int32_t,  )                                                        \
+      LEAF (true_scin_hit_type, "type",        type,         int32_t,  .tag ("scope", "event") .tag ("cell_id", "calorimeter")) \
+      LEAF (true_scin_hit_type, "module",      module,       int32_t,  .tag ("cell_id", "calorimeter"))                         \
+      LEAF (true_scin_hit_type, "side",        side,         int32_t,  .tag ("cell_id", "calorimeter"))                         \
+      LEAF (true_scin_hit_type, "column",      column,       int32_t,  .tag ("nullable", true) .tag ("cell_id", "calorimeter")) \
+      LEAF (true_scin_hit_type, "row",         row,          int32_t,  .tag ("nullable", true) .tag ("cell_id", "calorimeter")) \
+      LEAF (true_scin_hit_type, "wall",        wall,         int32_t,  .tag ("nullable", true) .tag ("cell_id", "calorimeter")) \
+      LEAF (true_scin_hit_type, "cellKey",     cell_key,     uint32_t, .tag ("cell_key", "calorimeter"))                        \
+      LEAF (true_scin_hit_type, "tFirst",      tfirst,       double,   .tag ("unit", "ns"))                                     \
+      LEAF (true_scin_hit_type, "tLast",       tlast,        double,   .tag ("unit", "ns"))                                     \
+      LEAF (true_scin_hit_type, "x1",          x1,           double,   .tag ("unit", "mm"))                                     \
+      LEAF (true_scin_hit_type, "y1",          y1,           double,   .tag ("unit", "mm"))                                     \
+      LEAF (true_scin_hit_type, "z1",          z1,           double,   .tag ("unit", "mm"))                                     \
+      LEAF (true_scin_hit_type, "x2",          x2,           double,   .tag ("unit", "mm"))                                     \
+      LEAF (true_scin_hit_type, "y2",          y2,           double,   .tag ("unit", "mm"))                                     \
+      LEAF (true_scin_hit_type, "z2",          z2,           double,   .tag ("unit", "mm"))                                     \
+      LEAF (true_scin_hit_type, "deltaEnergy", delta_energy, double,   .tag ("unit", "keV"))
+
+      struct calib_tracker_hit_type;
+
+      /// \brief CAT informations of a calibrated tracker hit (sparse storage)
+      ///
+      /// Only the hits with some CAT informations have a row, 'parent_index'
+      /// being the index of the hit in the calibrated tracker hit bank.
+      ///
+      /// It is also the out of line payload of the CAT informations of the
+      /// hits in memory.
+      struct calib_tracker_hit_cat_type
       {
       public:
         static const int32_t EXPORT_VERSION = 0;
+        calib_tracker_hit_cat_type ();
+        void reset ();
+        /// Check if a hit has some CAT informations
+        static bool is_present (const calib_tracker_hit_type & hit_);
+        /// Copy the CAT informations of a hit
+        void extract (int32_t parent_index_, const calib_tracker_hit_type & hit_);
+        /// Restore the CAT informations of a hit
+        void restore (calib_tracker_hit_type & hit_) const;
+      public:
+        int32_t  parent_index; // >=0
+        double   cat_tangency_x;
+        double   cat_tangency_y;
+        double   cat_tangency_z;
+        double   cat_tangency_x_error;
+        double   cat_tangency_y_error;
+        double   cat_tangency_z_error;
+        double   cat_helix_x;
+        double   cat_helix_y;
+        double   cat_helix_z;
+        double   cat_helix_x_error;
+        double   cat_helix_y_error;
+        double   cat_helix_z_error;
+      };
+
+      struct calib_tracker_hit_type
+      {
+      public:
+        static const int32_t EXPORT_VERSION = 2;
         calib_tracker_hit_type ();
         void reset ();
+        void encode_cell_key ();
+        void decode_cell_key ();
         void reset_cat ();
       public:
         int32_t hit_id;  // >=0
         int32_t true_hit_id;  // >=0
+        int32_t true_hit_index; // row of the true hit in the true tracker hit bank
         int32_t module;  // >=0
         int32_t side;    // 0 for x<0, 1 for x>0
         int32_t layer;   // [0..8]
         int32_t row;     // [0..112]
+        uint32_t cell_key; // packed cell identifier
         bool    noisy;
         bool    missing_bottom_cathode;
         bool    missing_top_cathode;
         bool    delayed;
+        bool    has_cat_infos;
         double  delayed_time; // ns
         double  delayed_time_error; // ns
         double  x;       // mm
@@ -212,61 +517,120 @@ namespace snemo {
         double  r;       // mm
         double  sigma_r; // mm
 
-        // CAT specific auxilairies :
-        bool     has_cat_infos;
-        double   cat_tangency_x;
-        double   cat_tangency_y;
-        double   cat_tangency_z;
-        double   cat_tangency_x_error;
-        double   cat_tangency_y_error;
-        double   cat_tangency_z_error;
+        // CAT specific auxiliaries (out of line) :
+        lazy_payload<calib_tracker_hit_cat_type> cat; /// Allocated only for hits with CAT informations
 
-        double   cat_helix_x;
-        double   cat_helix_y;
-        double   cat_helix_z;
-        double   cat_helix_x_error;
-        double   cat_helix_y_error;
-        double   cat_helix_z_error;
-       };
+        /// Return a CAT information (missing value if none)
+        template<double calib_tracker_hit_cat_type::* Field>
+        double get_cat () const
+        {
+          return cat.get (Field);
+        }
+
+        /// Set a CAT information
+        template<double calib_tracker_hit_cat_type::* Field>
+        void set_cat (double value_)
+        {
+          cat.set (Field, value_);
+          return;
+        }
+      };
+
+      /// Leaves of the calibrated tracker hits, in storage order (CAMP declaration and bank descriptor) :
+      ///   LEAF (class, leaf name, member, C++ type, other CAMP tags)
+#define SNEMO_EXPORTS_CALIB_TRACKER_HIT_LEAVES(LEAF)                                                                                               \
+      LEAF (calib_tracker_hit_type, "hitId",                hit_id,                 int32_t,  )                                                    \
+      LEAF (calib_tracker_hit_type, "trueHitId",            true_hit_id,            int32_t,  )                                                    \
+      LEAF (calib_tracker_hit_type, "trueHitIndex",         true_hit_index,         int32_t,  .tag ("row_index", true))                            \
+      LEAF (calib_tracker_hit_type, "module",               module,                 int32_t,  .tag ("cell_id", "tracker"))                         \
+      LEAF (calib_tracker_hit_type, "side",                 side,                   int32_t,  .tag ("cell_id", "tracker"))                         \
+      LEAF (calib_tracker_hit_type, "layer",                layer,                  int32_t,  .tag ("cell_id", "tracker"))                         \
+      LEAF (calib_tracker_hit_type, "row",                  row,                    int32_t,  .tag ("cell_id", "tracker"))                         \
+      LEAF (calib_tracker_hit_type, "cellKey",              cell_key,               uint32_t, .tag ("cell_key", "tracker"))                        \
+      LEAF (calib_tracker_hit_type, "noisy",                noisy,                  bool,     .tag ("bitfield", "flags"))                          \
+      LEAF (calib_tracker_hit_type, "missingBottomCathode", missing_bottom_cathode, bool,     .tag ("bitfield", "flags"))                          \
+      LEAF (calib_tracker_hit_type, "missingTopCathode",    missing_top_cathode,    bool,     .tag ("bitfield", "flags"))                          \
+      LEAF (calib_tracker_hit_type, "delayed",              delayed,                bool,     .tag ("bitfield", "flags"))                          \
+      LEAF (calib_tracker_hit_type, "delayedTime",          delayed_time,           double,   .tag ("nullable", true) .tag ("unit", "ns"))         \
+      LEAF (calib_tracker_hit_type, "delayedTimeError",     delayed_time_error,     double,   .tag ("nullable", true) .tag ("unit", "ns"))         \
+      LEAF (calib_tracker_hit_type, "x",                    x,                      double,   .tag ("unit", "mm"))                                 \
+      LEAF (calib_tracker_hit_type, "y",                    y,                      double,   .tag ("unit", "mm"))                                 \
+      LEAF (calib_tracker_hit_type, "z",                    z,                      double,   .tag ("unit", "mm"))                                 \
+      LEAF (calib_tracker_hit_type, "sigmaZ",               sigma_z,                double,   .tag ("unit", "mm"))                                 \
+      LEAF (calib_tracker_hit_type, "r",                    r,                      double,   .tag ("unit", "mm"))                                 \
+      LEAF (calib_tracker_hit_type, "sigmaR",               sigma_r,                double,   .tag ("unit", "mm"))                                 \
+      LEAF (calib_tracker_hit_type, "hasCatInfos",          has_cat_infos,          bool,     .tag ("bitfield", "catFlags") .tag ("topic", "CAT"))
+
+      // The vectors of records move their elements when they grow :
+      static_assert (std::is_nothrow_move_constructible<calib_tracker_hit_type>::value,
+                     "calib_tracker_hit_type must be nothrow move constructible");
 
       struct calib_calorimeter_hit_type
       {
       public:
-        static const int32_t EXPORT_VERSION = 0;
+        static const int32_t EXPORT_VERSION = 2;
         calib_calorimeter_hit_type ();
         void reset ();
+        void encode_cell_key ();
+        void decode_cell_key ();
       public:
         int32_t hit_id; // >=0
         int32_t true_hit_id;  // >=0
+        int32_t true_hit_index; // row of the true hit in the true hit bank of the same type
         int32_t type;   // >=0
         int32_t module; // >=0
         int32_t side;   // 0 for x<0, 1 for x>0
         int32_t column; // >=0
         int32_t row;    // >=0
         int32_t wall;   // >=0
+        uint32_t cell_key; // packed cell identifier
         double  time;         // ns
         double  sigma_time;   // ns
         double  energy;       // keV
         double  sigma_energy; // keV
       };
 
-      struct tracker_cluster_type
+      /// Leaves of the calibrated calorimeter hits, in storage order (CAMP declaration and bank descriptor) :
+      ///   LEAF (class, leaf name, member, C++ type, other CAMP tags)
+#define SNEMO_EXPORTS_CALIB_CALORIMETER_HIT_LEAVES(LEAF)                                                                                   \
+      LEAF (calib_calorimeter_hit_type, "hitId",        hit_id,         int32_t,  )                                                        \
+      LEAF (calib_calorimeter_hit_type, "trueHitId",    true_hit_id,    int32_t,  )                                                        \
+      LEAF (calib_calorimeter_hit_type, "trueHitIndex", true_hit_index, int32_t,  .tag ("row_index", true))                                \
+      LEAF (calib_calorimeter_hit_type, "type",         type,           int32_t,  .tag ("cell_id", "calorimeter"))                         \
+      LEAF (calib_calorimeter_hit_type, "module",       module,         int32_t,  .tag ("cell_id", "calorimeter"))                         \
+      LEAF (calib_calorimeter_hit_type, "side",         side,           int32_t,  .tag ("cell_id", "calorimeter"))                         \
+      LEAF (calib_calorimeter_hit_type, "column",       column,         int32_t,  .tag ("nullable", true) .tag ("cell_id", "calorimeter")) \
+      LEAF (calib_calorimeter_hit_type, "row",          row,            int32_t,  .tag ("nullable", true) .tag ("cell_id", "calorimeter")) \
+      LEAF (calib_calorimeter_hit_type, "wall",         wall,           int32_t,  .tag ("nullable", true) .tag ("cell_id", "calorimeter")) \
+      LEAF (calib_calorimeter_hit_type, "cellKey",      cell_key,       uint32_t, .tag ("cell_key", "calorimeter"))                        \
+      LEAF (calib_calorimeter_hit_type, "time",         time,           double,   .tag ("unit", "ns"))                                     \
+      LEAF (calib_calorimeter_hit_type, "sigmaTime",    sigma_time,     double,   .tag ("unit", "ns"))                                     \
+      LEAF (calib_calorimeter_hit_type, "energy",       energy,         double,   .tag ("unit", "keV"))                                    \
+      LEAF (calib_calorimeter_hit_type, "sigmaEnergy",  sigma_energy,   double,   .tag ("unit", "keV"))
+
+      struct tracker_cluster_type;
+
+      /// \brief CAT informations of a tracker cluster (sparse storage)
+      ///
+      /// Only the clusters with some CAT informations have a row, 'parent_index'
+      /// being the index of the cluster in the tracker cluster bank.
+      ///
+      /// It is also the out of line payload of the CAT informations of the
+      /// clusters in memory.
+      struct tracker_cluster_cat_type
       {
       public:
-         tracker_cluster_type ();
         static const int32_t EXPORT_VERSION = 0;
+        tracker_cluster_cat_type ();
         void reset ();
-        void reset_cat ();
+        /// Check if a cluster has some CAT informations
+        static bool is_present (const tracker_cluster_type & cluster_);
+        /// Copy the CAT informations of a cluster
+        void extract (int32_t parent_index_, const tracker_cluster_type & cluster_);
+        /// Restore the CAT informations of a cluster
+        void restore (tracker_cluster_type & cluster_) const;
       public:
-        int32_t  solution_id; // >=0
-        int32_t  cluster_id ; // >=0
-        int32_t  module;      // >=0
-        int32_t  side;        // >=0
-        bool     delayed;
-        uint32_t number_of_hits; // >=0
-
-         // CAT specific properties :
-        bool     has_cat_infos;
+        int32_t  parent_index; // >=0
 
         bool     cat_has_charge;
         double   cat_charge;
@@ -307,18 +671,61 @@ namespace snemo {
         double   cat_tangent_decay_vertex_x_error;
         double   cat_tangent_decay_vertex_y_error;
         double   cat_tangent_decay_vertex_z_error;
-     };
+      };
+
+      struct tracker_cluster_type
+      {
+      public:
+         tracker_cluster_type ();
+        static const int32_t EXPORT_VERSION = 1;
+        void reset ();
+        void reset_cat ();
+      public:
+        int32_t  solution_id; // >=0
+        int32_t  cluster_id ; // >=0
+        int32_t  module;      // >=0
+        int32_t  side;        // >=0
+        uint32_t number_of_hits; // >=0
+        uint32_t first_hit;      // offset of the first hit in the cluster hit ids (CSR)
+
+        bool     delayed;
+
+        // CAT specific properties (out of line) :
+        bool     has_cat_infos;
+        lazy_payload<tracker_cluster_cat_type> cat; /// Allocated only for clusters with CAT informations
+
+        /// Return a CAT information (missing value if none)
+        template<class Type, Type tracker_cluster_cat_type::* Field>
+        Type get_cat () const
+        {
+          return cat.get (Field);
+        }
+
+        /// Set a CAT information
+        template<class Type, Type tracker_cluster_cat_type::* Field>
+        void set_cat (Type value_)
+        {
+          cat.set (Field, value_);
+          return;
+        }
+      };
+
+      // The vectors of records move their elements when they grow :
+      static_assert (std::is_nothrow_move_constructible<tracker_cluster_type>::value,
+                     "tracker_cluster_type must be nothrow move constructible");
 
       struct tracker_clustered_hit_type
       {
       public:
-        static const int32_t EXPORT_VERSION = 0;
+        static const int32_t EXPORT_VERSION = 1;
         tracker_clustered_hit_type ();
         void reset ();
       public:
         int32_t solution_id; // >=0
         int32_t cluster_id;  // >=0
         int32_t hit_id;      // >=0
+        int32_t cluster_index; // row of the cluster in the tracker cluster bank
+        int32_t hit_index;     // row of the hit in the calibrated tracker hit bank
       };
 
       enum trajectory_1d_pattern_type
@@ -333,7 +740,7 @@ namespace snemo {
       {
       public:
         tracker_trajectory_type ();
-        static const int32_t EXPORT_VERSION = 0;
+        static const int32_t EXPORT_VERSION = 2;
         void reset ();
       public:
         int32_t  solution_id;       // >=0
@@ -341,21 +748,42 @@ namespace snemo {
         int32_t  module;            // >=0
         int32_t  side;              // >=0
         int32_t  cluster_id;        // >=0
+        int32_t  cluster_index;     // row of the cluster in the tracker cluster bank
         bool     delayed;           //
         uint32_t number_of_orphans; // >=0
+        uint32_t first_orphan;      // offset of the first orphan in the orphan hit ids (CSR)
         int32_t  pattern_id;        // >=0
       };
 
       struct tracker_trajectory_orphan_hit_type
       {
       public:
-        static const int32_t EXPORT_VERSION = 0;
+        static const int32_t EXPORT_VERSION = 1;
         tracker_trajectory_orphan_hit_type ();
         void reset ();
       public:
         int32_t solution_id;   // >=0
         int32_t trajectory_id; // >=0
         int32_t hit_id;        // >=0
+        int32_t trajectory_index; // row of the trajectory in the tracker trajectory bank
+        int32_t hit_index;        // row of the hit in the calibrated tracker hit bank
+      };
+
+      /// \brief Member hit of a cluster or trajectory (offset encoding)
+      ///
+      /// The members of all the parents are stored in a flat array, the hits
+      /// of a parent being the 'number_of_hits' (or 'number_of_orphans') rows
+      /// starting at its 'first_hit' (or 'first_orphan') offset.
+      struct tracker_hit_ref_type
+      {
+      public:
+        static const int32_t EXPORT_VERSION = 2;
+        tracker_hit_ref_type ();
+        void reset ();
+      public:
+        int32_t solution_id; // >=0 (solution of the members with no parent)
+        int32_t hit_id;    // >=0
+        int32_t hit_index; // row of the hit in the calibrated tracker hit bank
       };
 
       struct vertex_type
@@ -442,6 +870,12 @@ namespace snemo {
         void reset ();
         void clear_data ();
 
+        /// Clear the data and free the storage of the banks and of the arena
+        void shrink_data ();
+
+        /// Return the size of the storage of the banks and payloads (bytes)
+        std::size_t get_memory_usage () const;
+
         const true_vertex_type & get_true_vertex (int i_) const;
 
         const true_particle_type & get_true_particle (int i_) const;
@@ -454,20 +888,30 @@ namespace snemo {
 
         const true_scin_hit_type & get_true_gveto_hit (int i_) const;
 
+        const true_scin_hit_type & get_true_scin_hit (int i_) const;
+
         const true_gg_hit_type & get_true_gg_hit (int i_) const;
 
         const calib_calorimeter_hit_type & get_calib_scin_hit (int i_) const;
 
         const calib_tracker_hit_type & get_calib_gg_hit (int i_) const;
 
+        const calib_tracker_hit_cat_type & get_calib_gg_hit_cat (int i_) const;
+
         const tracker_clustered_hit_type & get_tracker_clustered_hit (int i_) const;
 
         const tracker_cluster_type & get_tracker_cluster (int i_) const;
 
+        const tracker_cluster_cat_type & get_tracker_cluster_cat (int i_) const;
+
         const tracker_trajectory_type & get_tracker_trajectory (int i_) const;
 
         const tracker_trajectory_orphan_hit_type & get_tracker_trajectory_orphan_hit (int i_) const;
 
+        const tracker_hit_ref_type & get_tracker_cluster_hit_id (int i_) const;
+
+        const tracker_hit_ref_type & get_tracker_trajectory_orphan_hit_id (int i_) const;
+
         const tracker_trajectory_pattern_type & get_tracker_trajectory_pattern (int i_) const;
 
         const vertex_type & get_tracker_trajectory_vertex (int i_) const;
@@ -476,6 +920,18 @@ namespace snemo {
 
         const helix_type & get_tracker_trajectory_helix (int i_) const;
 
+        /// Build the sparse CAT banks from the CAT informations of the hits and clusters
+        void build_cat_banks ();
+
+        /// Restore the CAT informations of the hits and clusters from the sparse CAT banks
+        void expand_cat_banks ();
+
+        /// Build the offsets and flat hit ids of the clusters and trajectories from the member rows
+        void build_membership_banks ();
+
+        /// Restore the clustered and orphan hit rows from the offsets and flat hit ids
+        void expand_membership_banks ();
+
         static void implement_introspection ();
 
         struct introspection_activator
@@ -489,6 +945,9 @@ namespace snemo {
 
       public:
 
+        // Per-event storage of the out of line payloads (released by 'clear_data') :
+        event_arena                             arena;
+
         // Event header data :
         event_header_type                       event_header;    /// Event header
 
@@ -499,15 +958,19 @@ namespace snemo {
         std::vector<true_scin_hit_type>         true_calo_hits;  /// True particles
         std::vector<true_scin_hit_type>         true_xcalo_hits; /// True particles
         std::vector<true_scin_hit_type>         true_gveto_hits; /// True particles
+        std::vector<true_scin_hit_type>         true_scin_hits;  /// True calo, xcalo and gveto hits in a single bank ('type' column)
         std::vector<true_gg_hit_type>           true_gg_hits;    /// True particles
 
         // Calibrated data :
         std::vector<calib_calorimeter_hit_type> calib_scin_hits; /// Calibrated scintillator hits
         std::vector<calib_tracker_hit_type>     calib_gg_hits;   /// Calibrated tracker hits
+        std::vector<calib_tracker_hit_cat_type> calib_gg_hits_cat; /// CAT informations of the calibrated tracker hits (sparse)
 
         // Tracker clustering data:
         std::vector<tracker_cluster_type>       tracker_clusters;       /// Tracker clusters
+        std::vector<tracker_cluster_cat_type>   tracker_clusters_cat;   /// CAT informations of the tracker clusters (sparse)
         std::vector<tracker_clustered_hit_type> tracker_clustered_hits; /// Tracker clustered hits
+        std::vector<tracker_hit_ref_type>       tracker_cluster_hit_ids; /// Hits of the clusters, then unclustered hits (offsets)
 
         // Tracker trajectories data:
         std::vector<tracker_trajectory_type>    tracker_trajectories;   /// Tracker trajectories
@@ -515,6 +978,7 @@ namespace snemo {
         std::vector<polyline_type>              tracker_trajectory_polylines;            /// Polylines
         std::vector<helix_type>                 tracker_trajectory_helices;              /// Helices
         std::vector<tracker_trajectory_orphan_hit_type>  tracker_trajectory_orphan_hits; /// Tracker trajectory orphan hit
+        std::vector<tracker_hit_ref_type>       tracker_trajectory_orphan_hit_ids;       /// Orphan hits of the trajectories (offsets)
         std::vector<tracker_trajectory_pattern_type>  tracker_trajectory_patterns;       /// Tracker trajectory patterns
 
       };
@@ -561,11 +1025,14 @@ CAMP_TYPE (snemo::reconstruction::exports::true_step_hit_type);
 CAMP_TYPE (snemo::reconstruction::exports::true_gg_hit_type);
 CAMP_TYPE (snemo::reconstruction::exports::true_scin_hit_type);
 CAMP_TYPE (snemo::reconstruction::exports::calib_tracker_hit_type);
+CAMP_TYPE (snemo::reconstruction::exports::calib_tracker_hit_cat_type);
 CAMP_TYPE (snemo::reconstruction::exports::calib_calorimeter_hit_type);
 CAMP_TYPE (snemo::reconstruction::exports::tracker_cluster_type);
+CAMP_TYPE (snemo::reconstruction::exports::tracker_cluster_cat_type);
 CAMP_TYPE (snemo::reconstruction::exports::tracker_clustered_hit_type);
 CAMP_TYPE (snemo::reconstruction::exports::tracker_trajectory_type);
 CAMP_TYPE (snemo::reconstruction::exports::tracker_trajectory_orphan_hit_type);
+CAMP_TYPE (snemo::reconstruction::exports::tracker_hit_ref_type);
 CAMP_TYPE (snemo::reconstruction::exports::vertex_type);
 CAMP_TYPE (snemo::reconstruction::exports::polyline_type);
 CAMP_TYPE (snemo::reconstruction::exports::helix_type);
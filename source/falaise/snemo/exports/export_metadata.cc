@@ -0,0 +1,506 @@
+// -*- mode: c++ ; -*-
+/* export_metadata.cc */
+
+#include <falaise/snemo/exports/export_metadata.h>
+#include <falaise/snemo/exports/root_utils.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+#include <boost/algorithm/string.hpp>
+
+#include <datatools/exception.h>
+
+#include <TTree.h>
+#include <TBranch.h>
+#include <TList.h>
+#include <TNamed.h>
+#include <TParameter.h>
+#include <TObjArray.h>
+
+#ifndef FALAISE_ROOTEXPORTER_BUILD_ID
+#define FALAISE_ROOTEXPORTER_BUILD_ID "unknown"
+#endif
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      // static
+      const std::string export_metadata::USER_INFO_NAME = "export_metadata";
+
+      // static
+      const int32_t export_metadata::UNKNOWN_VERSION;
+
+      // static
+      std::string export_metadata::get_build_id ()
+      {
+        return FALAISE_ROOTEXPORTER_BUILD_ID;
+      }
+
+      export_metadata::export_metadata ()
+      {
+        reset ();
+        return;
+      }
+
+      void export_metadata::reset ()
+      {
+        export_flags = 0;
+        topics.clear ();
+        layout.clear ();
+        banks.clear ();
+        units.clear ();
+        bitfields.clear ();
+        scopes.clear ();
+        nullables.clear ();
+        leaflists.clear ();
+        build_id.clear ();
+        _legacy_ = false;
+        return;
+      }
+
+      bool export_metadata::is_legacy () const
+      {
+        return _legacy_;
+      }
+
+      void export_metadata::build (const branch_manager & branch_manager_, uint32_t store_bits_)
+      {
+        reset ();
+        export_flags = store_bits_;
+        build_id = get_build_id ();
+        const std::map<std::string, bool> & active_topics = branch_manager_.get_topics ();
+        for (std::map<std::string, bool>::const_iterator i = active_topics.begin ();
+             i != active_topics.end ();
+             i++)
+          {
+            if (branch_manager_.is_active_topic (i->first))
+              {
+                topics.push_back (i->first);
+              }
+          }
+        branch_manager_.get_layout_flags (layout);
+        const branch_manager::bank_col_type & bm_banks = branch_manager_.get_banks ();
+        for (size_t i = 0; i < bm_banks.size (); i++)
+          {
+            if (! (bm_banks[i].store_bit & store_bits_)) continue;
+            bank_type bank;
+            bank.name = bm_banks[i].name;
+            bank.class_id = bm_banks[i].class_id;
+            bank.version = bm_banks[i].version;
+            bank.array = bm_banks[i].array;
+            banks.push_back (bank);
+          }
+        const branch_manager::bi_col_type & bis = branch_manager_.get_branch_infos ();
+        for (size_t i = 0; i < bis.size (); i++)
+          {
+            const branch_entry_type & bi = *(bis[i]);
+            if (! (bi.get_store_bit () & store_bits_)) continue;
+            if (bi.is_inhibited ()) continue;
+            if (bi.is_validity_bitmap ())
+              {
+                nullables[bi.get_parent_name ()] = bi.get_bitfield_members ();
+              }
+            else if (bi.is_bitfield ())
+              {
+                bitfields[bi.get_name ()] = bi.get_bitfield_members ();
+              }
+            if (bi.is_event_scope ())
+              {
+                scopes[bi.get_name ()] = "event";
+              }
+            if (bi.get_unit ().empty ()) continue;
+            units[bi.get_name ()] = bi.get_unit ();
+          }
+        const branch_manager::group_col_type & groups = branch_manager_.get_groups ();
+        for (size_t i = 0; i < groups.size (); i++)
+          {
+            const branch_group_type & group = *(groups[i]);
+            std::vector<std::string> members;
+            for (size_t j = 0; j < group.get_members ().size (); j++)
+              {
+                const branch_entry_type & bi = *(group.get_members ()[j]);
+                if (! (bi.get_store_bit () & store_bits_)) continue;
+                members.push_back (bi.get_name ());
+              }
+            if (members.empty ()) continue;
+            leaflists[group.get_name ()] = members;
+          }
+        return;
+      }
+
+      void export_metadata::store (TTree & tree_) const
+      {
+        TList * user_info = tree_.GetUserInfo ();
+        TObject * former = user_info->FindObject (USER_INFO_NAME.c_str ());
+        if (former != 0)
+          {
+            user_info->Remove (former);
+            delete former;
+          }
+        TList * md = new TList;
+        md->SetName (USER_INFO_NAME.c_str ());
+        md->SetOwner (kTRUE);
+        md->Add (new TParameter<Long64_t> ("export_flags", export_flags));
+        md->Add (new TNamed ("build_id", build_id.c_str ()));
+        md->Add (new TNamed ("topics", boost::join (topics, ",").c_str ()));
+        md->Add (new TNamed ("layout", boost::join (layout, ",").c_str ()));
+        for (size_t i = 0; i < banks.size (); i++)
+          {
+            const bank_type & bank = banks[i];
+            md->Add (new TParameter<Int_t> ((bank.name + "@version").c_str (), bank.version));
+            md->Add (new TNamed ((bank.name + "@class").c_str (), bank.class_id.c_str ()));
+            md->Add (new TParameter<Int_t> ((bank.name + "@array").c_str (), bank.array ? 1 : 0));
+          }
+        for (std::map<std::string, std::string>::const_iterator i = units.begin ();
+             i != units.end ();
+             i++)
+          {
+            md->Add (new TNamed ((i->first + "@unit").c_str (), i->second.c_str ()));
+          }
+        for (std::map<std::string, std::vector<std::string> >::const_iterator i = bitfields.begin ();
+             i != bitfields.end ();
+             i++)
+          {
+            md->Add (new TNamed ((i->first + "@bitfield").c_str (), boost::join (i->second, ",").c_str ()));
+          }
+        for (std::map<std::string, std::string>::const_iterator i = scopes.begin ();
+             i != scopes.end ();
+             i++)
+          {
+            md->Add (new TNamed ((i->first + "@scope").c_str (), i->second.c_str ()));
+          }
+        for (std::map<std::string, std::vector<std::string> >::const_iterator i = nullables.begin ();
+             i != nullables.end ();
+             i++)
+          {
+            md->Add (new TNamed ((i->first + "@nullable").c_str (), boost::join (i->second, ",").c_str ()));
+          }
+        for (std::map<std::string, std::vector<std::string> >::const_iterator i = leaflists.begin ();
+             i != leaflists.end ();
+             i++)
+          {
+            md->Add (new TNamed ((i->first + "@leaflist").c_str (), boost::join (i->second, ",").c_str ()));
+          }
+        user_info->Add (md);
+        return;
+      }
+
+      bool export_metadata::load (TTree & tree_)
+      {
+        reset ();
+        TList * md = dynamic_cast<TList *>(tree_.GetUserInfo ()->FindObject (USER_INFO_NAME.c_str ()));
+        if (md == 0)
+          {
+            return _load_legacy (tree_);
+          }
+        TIter next (md);
+        while (TObject * obj = next ())
+          {
+            const std::string key = obj->GetName ();
+            if (key == "export_flags")
+              {
+                export_flags = static_cast<TParameter<Long64_t> *>(obj)->GetVal ();
+              }
+            else if (key == "build_id")
+              {
+                build_id = obj->GetTitle ();
+              }
+            else if (key == "topics")
+              {
+                const std::string topic_labels = obj->GetTitle ();
+                if (! topic_labels.empty ())
+                  {
+                    boost::split (topics, topic_labels, boost::is_any_of (","));
+                  }
+              }
+            else if (key == "layout")
+              {
+                const std::string layout_labels = obj->GetTitle ();
+                if (! layout_labels.empty ())
+                  {
+                    boost::split (layout, layout_labels, boost::is_any_of (","));
+                  }
+              }
+            else if (boost::ends_with (key, "@version"))
+              {
+                bank_type bank;
+                bank.name = key.substr (0, key.length () - 8);
+                bank.version = static_cast<TParameter<Int_t> *>(obj)->GetVal ();
+                bank.array = false;
+                banks.push_back (bank);
+              }
+            else if (boost::ends_with (key, "@class"))
+              {
+                const std::string bank_name = key.substr (0, key.length () - 6);
+                _grab_bank (bank_name).class_id = obj->GetTitle ();
+              }
+            else if (boost::ends_with (key, "@array"))
+              {
+                const std::string bank_name = key.substr (0, key.length () - 6);
+                _grab_bank (bank_name).array = static_cast<TParameter<Int_t> *>(obj)->GetVal ();
+              }
+            else if (boost::ends_with (key, "@unit"))
+              {
+                units[key.substr (0, key.length () - 5)] = obj->GetTitle ();
+              }
+            else if (boost::ends_with (key, "@bitfield"))
+              {
+                const std::string members = obj->GetTitle ();
+                boost::split (bitfields[key.substr (0, key.length () - 9)], members, boost::is_any_of (","));
+              }
+            else if (boost::ends_with (key, "@scope"))
+              {
+                scopes[key.substr (0, key.length () - 6)] = obj->GetTitle ();
+              }
+            else if (boost::ends_with (key, "@nullable"))
+              {
+                const std::string members = obj->GetTitle ();
+                boost::split (nullables[key.substr (0, key.length () - 9)], members, boost::is_any_of (","));
+              }
+            else if (boost::ends_with (key, "@leaflist"))
+              {
+                const std::string members = obj->GetTitle ();
+                boost::split (leaflists[key.substr (0, key.length () - 9)], members, boost::is_any_of (","));
+              }
+          }
+        return true;
+      }
+
+      bool export_metadata::_load_legacy (TTree & tree_)
+      {
+        TObjArray * branches = tree_.GetListOfBranches ();
+        for (int ibranch = 0; ibranch < branches->GetEntries (); ibranch++)
+          {
+            TBranch * version_branch = static_cast<TBranch *>(branches->At (ibranch));
+            const std::string branch_name = version_branch->GetName ();
+            if (! boost::ends_with (branch_name, "@version")) continue;
+            bank_type bank;
+            bank.name = branch_name.substr (0, branch_name.length () - 8);
+            bank.array = tree_.GetBranch ((bank.name + "@size").c_str ()) != 0;
+            bank.version = UNKNOWN_VERSION;
+            if (tree_.GetEntries () > 0)
+              {
+                UInt_t version = 0;
+                version_branch->SetAddress (&version);
+                version_branch->GetEntry (0);
+                version_branch->ResetAddress ();
+                bank.version = version;
+              }
+            banks.push_back (bank);
+          }
+        _legacy_ = true;
+        return ! banks.empty ();
+      }
+
+      bool export_metadata::has_bank (const std::string & bank_name_) const
+      {
+        for (size_t i = 0; i < banks.size (); i++)
+          {
+            if (banks[i].name == bank_name_) return true;
+          }
+        return false;
+      }
+
+      const export_metadata::bank_type & export_metadata::get_bank (const std::string & bank_name_) const
+      {
+        for (size_t i = 0; i < banks.size (); i++)
+          {
+            if (banks[i].name == bank_name_) return banks[i];
+          }
+        DT_THROW_IF (true, std::logic_error, "No bank named '" << bank_name_ << "' !");
+        return banks.front ();
+      }
+
+      export_metadata::bank_type & export_metadata::_grab_bank (const std::string & bank_name_)
+      {
+        for (size_t i = 0; i < banks.size (); i++)
+          {
+            if (banks[i].name == bank_name_) return banks[i];
+          }
+        DT_THROW_IF (true, std::logic_error, "Invalid metadata for bank '" << bank_name_ << "' !");
+        return banks.front ();
+      }
+
+      void export_metadata::remove_bank (const std::string & bank_name_)
+      {
+        for (std::vector<bank_type>::iterator i = banks.begin (); i != banks.end (); i++)
+          {
+            if (i->name == bank_name_)
+              {
+                banks.erase (i);
+                break;
+              }
+          }
+        const std::string prefix = bank_name_ + '.';
+        for (std::map<std::string, std::string>::iterator i = units.begin (); i != units.end ();)
+          {
+            if (boost::starts_with (i->first, prefix)) units.erase (i++);
+            else i++;
+          }
+        for (std::map<std::string, std::vector<std::string> >::iterator i = bitfields.begin ();
+             i != bitfields.end ();)
+          {
+            if (boost::starts_with (i->first, prefix)) bitfields.erase (i++);
+            else i++;
+          }
+        for (std::map<std::string, std::string>::iterator i = scopes.begin (); i != scopes.end ();)
+          {
+            if (boost::starts_with (i->first, prefix)) scopes.erase (i++);
+            else i++;
+          }
+        nullables.erase (bank_name_);
+        // The shared multi-leaf branches (ex: bank sizes) are kept as they are stored :
+        leaflists.erase (bank_name_);
+        return;
+      }
+
+      void export_metadata::remove_branch (const std::string & branch_name_)
+      {
+        units.erase (branch_name_);
+        bitfields.erase (branch_name_);
+        scopes.erase (branch_name_);
+        leaflists.erase (branch_name_);
+        // The validity bitmap describes the nullable leaves of its bank :
+        if (boost::ends_with (branch_name_, "@valid"))
+          {
+            nullables.erase (branch_name_.substr (0, branch_name_.length () - 6));
+          }
+        return;
+      }
+
+      void export_metadata::remove_topic (const std::string & topic_)
+      {
+        topics.erase (std::remove (topics.begin (), topics.end (), topic_), topics.end ());
+        return;
+      }
+
+      bool export_metadata::has_layout_flag (const std::string & flag_) const
+      {
+        return std::find (layout.begin (), layout.end (), flag_) != layout.end ();
+      }
+
+      bool export_metadata::is_compatible (const export_metadata & other_, std::string & reason_) const
+      {
+        std::ostringstream reason;
+        if (export_flags != other_.export_flags)
+          {
+            reason << "export flags " << export_flags << " and " << other_.export_flags << " differ";
+            reason_ = reason.str ();
+            return false;
+          }
+        std::vector<std::string> sorted_topics = topics;
+        std::vector<std::string> other_sorted_topics = other_.topics;
+        std::sort (sorted_topics.begin (), sorted_topics.end ());
+        std::sort (other_sorted_topics.begin (), other_sorted_topics.end ());
+        if (sorted_topics != other_sorted_topics)
+          {
+            reason << "topics '" << boost::join (topics, ",") << "' and '"
+                   << boost::join (other_.topics, ",") << "' differ";
+            reason_ = reason.str ();
+            return false;
+          }
+        std::vector<std::string> sorted_layout = layout;
+        std::vector<std::string> other_sorted_layout = other_.layout;
+        std::sort (sorted_layout.begin (), sorted_layout.end ());
+        std::sort (other_sorted_layout.begin (), other_sorted_layout.end ());
+        if (sorted_layout != other_sorted_layout)
+          {
+            reason << "layouts '" << boost::join (layout, ",") << "' and '"
+                   << boost::join (other_.layout, ",") << "' differ";
+            reason_ = reason.str ();
+            return false;
+          }
+        if (banks.size () != other_.banks.size ())
+          {
+            reason << "numbers of banks " << banks.size () << " and " << other_.banks.size () << " differ";
+            reason_ = reason.str ();
+            return false;
+          }
+        for (size_t i = 0; i < banks.size (); i++)
+          {
+            const bank_type & bank = banks[i];
+            if (! other_.has_bank (bank.name))
+              {
+                reason << "bank '" << bank.name << "' is missing";
+                reason_ = reason.str ();
+                return false;
+              }
+            const bank_type & other_bank = other_.get_bank (bank.name);
+            if (bank.version != UNKNOWN_VERSION
+                && other_bank.version != UNKNOWN_VERSION
+                && bank.version != other_bank.version)
+              {
+                reason << "bank '" << bank.name << "' has versions " << bank.version
+                       << " and " << other_bank.version;
+                reason_ = reason.str ();
+                return false;
+              }
+          }
+        if (bitfields != other_.bitfields)
+          {
+            reason << "bitfield layouts differ";
+            reason_ = reason.str ();
+            return false;
+          }
+        if (scopes != other_.scopes)
+          {
+            reason << "leaf scopes differ";
+            reason_ = reason.str ();
+            return false;
+          }
+        if (nullables != other_.nullables)
+          {
+            reason << "nullable leaves differ";
+            reason_ = reason.str ();
+            return false;
+          }
+        if (leaflists != other_.leaflists)
+          {
+            reason << "multi-leaf branches differ";
+            reason_ = reason.str ();
+            return false;
+          }
+        return true;
+      }
+
+      void export_metadata::print (std::ostream & out_,
+                                   const std::string & title_,
+                                   const std::string & indent_) const
+      {
+        if (! title_.empty ())
+          {
+            out_ << indent_ << title_ << ": \n";
+          }
+        out_ << indent_ << "|-- " << "Legacy       : " << _legacy_ << "\n";
+        out_ << indent_ << "|-- " << "Export flags : " << export_flags << "\n";
+        out_ << indent_ << "|-- " << "Build ID     : '" << build_id << "'\n";
+        out_ << indent_ << "|-- " << "Topics       : '" << boost::join (topics, ",") << "'\n";
+        out_ << indent_ << "|-- " << "Layout       : '" << boost::join (layout, ",") << "'\n";
+        out_ << indent_ << "|-- " << "Units        : " << units.size () << "\n";
+        out_ << indent_ << "|-- " << "Bitfields    : " << bitfields.size () << "\n";
+        out_ << indent_ << "|-- " << "Event leaves : " << scopes.size () << "\n";
+        out_ << indent_ << "|-- " << "Nullable     : " << nullables.size () << "\n";
+        out_ << indent_ << "|-- " << "Leaf lists   : " << leaflists.size () << "\n";
+        out_ << indent_ << "`-- " << "Banks        : " << banks.size () << "\n";
+        for (size_t i = 0; i < banks.size (); i++)
+          {
+            const bank_type & bank = banks[i];
+            out_ << indent_ << "    " << ((i + 1 == banks.size ()) ? "`-- " : "|-- ")
+                 << "'" << bank.name << "' (" << bank.class_id << ", version " << bank.version
+                 << (bank.array ? ", array" : "") << ")\n";
+          }
+        return;
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of export_metadata.cc
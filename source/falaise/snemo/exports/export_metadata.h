@@ -0,0 +1,162 @@
+// -*- mode: c++ ; -*-
+/* export_metadata.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   File level metadata of the exported ROOT trees
+ *
+ *   The export flags, active topics, layout of the optional leaves, bank
+ *   descriptions (name, CAMP class, schema version), branch units and
+ *   exporter build identifier are stored once
+ *   per file in the 'UserInfo' list of the tree, as a TList named
+ *   'export_metadata' :
+ *
+ *     export_flags           : TParameter<Long64_t>
+ *     build_id               : TNamed
+ *     topics                 : TNamed (comma separated labels)
+ *     layout                 : TNamed (comma separated labels of the optional leaves
+ *                              stored, ex: 'cell_keys,cell_ids')
+ *     <bank>@version         : TParameter<Int_t>
+ *     <bank>@class           : TNamed
+ *     <bank>@array           : TParameter<Int_t>
+ *     <bank>.<leaf>@unit     : TNamed
+ *     <bank>.<group>@bitfield: TNamed (comma separated members, lowest bit first)
+ *     <bank>.<leaf>@scope    : TNamed ("event" for a leaf stored once per event when
+ *                              constant, its '<bank>.<leaf>@size' counter being 1)
+ *     <bank>@nullable        : TNamed (comma separated leaves of the '<bank>@valid' bitmap)
+ *     <group>@leaflist       : TNamed (comma separated leaves of a multi-leaf branch)
+ *
+ *   The bank versions are the versions of the export schema : the optional
+ *   leaves left out by the export configuration are described by the
+ *   layout flags, not by the versions.
+ *
+ *   Files produced before this scheme store the bank versions in per-entry
+ *   '<bank>@version' branches : they are still loaded (legacy mode).
+ *
+ * History:
+ *
+ */
+
+#ifndef SNRECONSTRUCTION_EXPORTS_EXPORT_METADATA_H
+#define SNRECONSTRUCTION_EXPORTS_EXPORT_METADATA_H 1
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+#include <boost/cstdint.hpp>
+
+class TTree;
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      struct branch_manager;
+
+      /// \brief File level metadata of an exported tree
+      struct export_metadata
+      {
+      public:
+
+        /// Name of the metadata list in the tree 'UserInfo'
+        static const std::string USER_INFO_NAME;
+
+        /// Version of a bank with no known version (legacy empty files)
+        static const int32_t UNKNOWN_VERSION = -1;
+
+        /// Description of a bank
+        struct bank_type
+        {
+          std::string name;     /// Name of the bank (ex: "calibTrackerHits")
+          std::string class_id; /// CAMP class identifier (empty in legacy mode)
+          int32_t     version;  /// Export version
+          bool        array;    /// Array flag
+        };
+
+        /// Return the build identifier of the exporter
+        static std::string get_build_id ();
+
+        /// Default constructor
+        export_metadata ();
+
+        /// Reset
+        void reset ();
+
+        /// Build the metadata from the banks of a branch manager
+        void build (const branch_manager & branch_manager_, uint32_t store_bits_);
+
+        /// Store the metadata in the 'UserInfo' of a tree (replaces former metadata)
+        void store (TTree & tree_) const;
+
+        /// Load the metadata from a tree, return false if none is found
+        bool load (TTree & tree_);
+
+        /// Check if the metadata were loaded from legacy '@version' branches
+        bool is_legacy () const;
+
+        /// Check if a bank is described
+        bool has_bank (const std::string & bank_name_) const;
+
+        /// Return the description of a bank
+        const bank_type & get_bank (const std::string & bank_name_) const;
+
+        /// Remove the description of a bank and of its leaves
+        void remove_bank (const std::string & bank_name_);
+
+        /// Remove the description of a branch (unit, bitfield, scope, validity bitmap or multi-leaf branch)
+        void remove_branch (const std::string & branch_name_);
+
+        /// Remove a topic from the active topics
+        void remove_topic (const std::string & topic_);
+
+        /// Check if a layout flag is set
+        bool has_layout_flag (const std::string & flag_) const;
+
+        /// Check if some other metadata are compatible (same flags, topics, layout, banks and versions)
+        bool is_compatible (const export_metadata & other_, std::string & reason_) const;
+
+        /// Smart print
+        void print (std::ostream & out_ = std::clog,
+                    const std::string & title_ = "",
+                    const std::string & indent_ = "") const;
+
+      protected:
+
+        bool _load_legacy (TTree & tree_);
+
+        bank_type & _grab_bank (const std::string & bank_name_);
+
+      public:
+
+        uint32_t                           export_flags; /// Export flags
+        std::vector<std::string>           topics;       /// Active topics
+        std::vector<std::string>           layout;       /// Labels of the optional leaves stored (ex: "cell_keys")
+        std::vector<bank_type>             banks;        /// Banks
+        std::map<std::string, std::string> units;        /// Units of the branches
+        std::map<std::string, std::vector<std::string> > bitfields; /// Members of the bitfield branches
+        std::map<std::string, std::string> scopes;       /// Scope of the branches stored once per event ("event")
+        std::map<std::string, std::vector<std::string> > nullables; /// Nullable leaves of the banks (validity bitmap order)
+        std::map<std::string, std::vector<std::string> > leaflists; /// Leaves of the multi-leaf branches
+        std::string                        build_id;     /// Build identifier of the exporter
+
+      private:
+
+        bool _legacy_; /// Legacy flag
+
+      };
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // SNRECONSTRUCTION_EXPORTS_EXPORT_METADATA_H
+
+// end of export_metadata.h
@@ -0,0 +1,308 @@
+// -*- mode: c++ ; -*-
+/* export_pipeline.cc */
+
+#include <falaise/snemo/exports/export_pipeline.h>
+#include <falaise/snemo/exports/export_event.h>
+
+#include <stdexcept>
+
+#include <datatools/exception.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      export_pipeline::statistics_type::statistics_type ()
+      {
+        submitted = 0;
+        committed = 0;
+        producer_waits = 0;
+        worker_waits = 0;
+        committer_waits = 0;
+        return;
+      }
+
+      export_pipeline::slot_type::slot_type ()
+      {
+        converted = false;
+        return;
+      }
+
+      export_pipeline::slot_type::~slot_type ()
+      {
+        return;
+      }
+
+      export_pipeline::export_pipeline (unsigned int depth_,
+                                        unsigned int number_of_workers_,
+                                        const factory_type & factory_,
+                                        const convert_type & convert_,
+                                        const commit_type & commit_)
+        : _convert_ (convert_),
+          _commit_ (commit_),
+          _free_ (depth_),
+          _acquired_ (0),
+          _spare_ (0),
+          _stop_ (false),
+          _failed_ (false),
+          _submitted_count_ (0),
+          _committed_ (0),
+          _producer_waits_ (0),
+          _worker_waits_ (0),
+          _committer_waits_ (0)
+      {
+        DT_THROW_IF (depth_ == 0, std::domain_error, "Invalid null pipeline depth !");
+        DT_THROW_IF (number_of_workers_ == 0, std::domain_error, "Invalid null number of workers !");
+        DT_THROW_IF (! factory_, std::logic_error, "Missing export event factory !");
+        DT_THROW_IF (! _convert_, std::logic_error, "Missing conversion action !");
+        DT_THROW_IF (! _commit_, std::logic_error, "Missing commit action !");
+        for (unsigned int i = 0; i < depth_; i++)
+          {
+            _slots_.push_back (new slot_type);
+            _slots_.back ().event.reset (factory_ ());
+            DT_THROW_IF (! _slots_.back ().event, std::logic_error, "Export event factory returned no event !");
+            _free_.push (&_slots_.back ());
+          }
+        try
+          {
+            for (unsigned int i = 0; i < number_of_workers_; i++)
+              {
+                _workers_.push_back (std::thread (&export_pipeline::_run_worker, this, i));
+              }
+            _committer_ = std::thread (&export_pipeline::_run_committer, this);
+          }
+        catch (...)
+          {
+            // Stop the threads already started :
+            {
+              std::lock_guard<std::mutex> lock (_mutex_);
+              _stop_ = true;
+            }
+            _wake_workers_.notify_all ();
+            for (size_t i = 0; i < _workers_.size (); i++)
+              {
+                _workers_[i].join ();
+              }
+            throw;
+          }
+        return;
+      }
+
+      export_pipeline::~export_pipeline ()
+      {
+        {
+          std::lock_guard<std::mutex> lock (_mutex_);
+          _stop_ = true;
+        }
+        _wake_workers_.notify_all ();
+        _wake_committer_.notify_one ();
+        for (size_t i = 0; i < _workers_.size (); i++)
+          {
+            _workers_[i].join ();
+          }
+        _committer_.join ();
+        return;
+      }
+
+      unsigned int export_pipeline::get_depth () const
+      {
+        return _slots_.size ();
+      }
+
+      unsigned int export_pipeline::get_number_of_workers () const
+      {
+        return _workers_.size ();
+      }
+
+      datatools::things & export_pipeline::acquire ()
+      {
+        DT_THROW_IF (_acquired_ != 0, std::logic_error, "A slot is already acquired !");
+        _check_error ();
+        if (_spare_ != 0)
+          {
+            std::swap (_acquired_, _spare_);
+            return _acquired_->record;
+          }
+        slot_type * slot = _free_.pop ();
+        while (slot == 0)
+          {
+            // All the slots are being converted or waiting for their commit :
+            _producer_waits_++;
+            {
+              std::unique_lock<std::mutex> lock (_mutex_);
+              _wake_producer_.wait (lock, [this] () { return ! _free_.empty () || _failed_; });
+            }
+            _check_error ();
+            slot = _free_.pop ();
+          }
+        _acquired_ = slot;
+        return _acquired_->record;
+      }
+
+      void export_pipeline::submit ()
+      {
+        DT_THROW_IF (_acquired_ == 0, std::logic_error, "No acquired slot !");
+        {
+          std::lock_guard<std::mutex> lock (_mutex_);
+          _work_.push_back (_acquired_);
+          _order_.push_back (_acquired_);
+          _submitted_count_++;
+        }
+        _acquired_ = 0;
+        _wake_workers_.notify_one ();
+        return;
+      }
+
+      void export_pipeline::release ()
+      {
+        if (_acquired_ == 0) return;
+        _acquired_->record.clear ();
+        _spare_ = _acquired_;
+        _acquired_ = 0;
+        return;
+      }
+
+      void export_pipeline::drain ()
+      {
+        {
+          std::unique_lock<std::mutex> lock (_mutex_);
+          _wake_producer_.wait (lock, [this] () { return _committed_ == _submitted_count_; });
+        }
+        _check_error ();
+        return;
+      }
+
+      export_pipeline::statistics_type export_pipeline::get_statistics () const
+      {
+        std::lock_guard<std::mutex> lock (_mutex_);
+        statistics_type statistics;
+        statistics.submitted = _submitted_count_;
+        statistics.committed = _committed_;
+        statistics.producer_waits = _producer_waits_;
+        statistics.worker_waits = _worker_waits_;
+        statistics.committer_waits = _committer_waits_;
+        return statistics;
+      }
+
+      void export_pipeline::_check_error ()
+      {
+        if (_failed_)
+          {
+            std::rethrow_exception (_error_);
+          }
+        return;
+      }
+
+      void export_pipeline::_run_worker (unsigned int worker_)
+      {
+        std::unique_lock<std::mutex> lock (_mutex_);
+        while (true)
+          {
+            while (_work_.empty () && ! _stop_)
+              {
+                _worker_waits_++;
+                _wake_workers_.wait (lock);
+              }
+            // The submitted records are converted before stopping :
+            if (_work_.empty ()) break;
+            slot_type * slot = _work_.front ();
+            _work_.pop_front ();
+            lock.unlock ();
+            // Once an error occurred, the records are only recycled :
+            if (! _failed_)
+              {
+                try
+                  {
+                    _convert_ (worker_, slot->record, *slot->event);
+                  }
+                catch (...)
+                  {
+                    slot->error = std::current_exception ();
+                  }
+              }
+            lock.lock ();
+            slot->converted = true;
+            if (slot == _order_.front ())
+              {
+                _wake_committer_.notify_one ();
+              }
+          }
+        return;
+      }
+
+      void export_pipeline::_run_committer ()
+      {
+        std::unique_lock<std::mutex> lock (_mutex_);
+        while (true)
+          {
+            while ((_order_.empty () || ! _order_.front ()->converted)
+                   && ! (_stop_ && _order_.empty ()))
+              {
+                _committer_waits_++;
+                _wake_committer_.wait (lock);
+              }
+            if (_order_.empty ()) break;
+            slot_type * slot = _order_.front ();
+            _order_.pop_front ();
+            lock.unlock ();
+            if (! _failed_)
+              {
+                // The first error, in submission order, stops the commits :
+                std::exception_ptr error = slot->error;
+                if (! error)
+                  {
+                    try
+                      {
+                        _commit_ (*slot->event);
+                      }
+                    catch (...)
+                      {
+                        error = std::current_exception ();
+                      }
+                  }
+                if (error)
+                  {
+                    _error_ = error;
+                    _failed_ = true;
+                  }
+              }
+            // The input data are released as soon as possible :
+            slot->record.clear ();
+            slot->error = std::exception_ptr ();
+            lock.lock ();
+            slot->converted = false;
+            _committed_++;
+            _free_.push (slot);
+            _wake_producer_.notify_one ();
+          }
+        return;
+      }
+
+      void export_pipeline::print (std::ostream & out_,
+                                   const std::string & title_,
+                                   const std::string & indent_) const
+      {
+        const statistics_type statistics = get_statistics ();
+        if (! title_.empty ())
+          {
+            out_ << indent_ << title_ << ": \n";
+          }
+        out_ << indent_ << "|-- " << "Depth           : " << get_depth () << "\n";
+        out_ << indent_ << "|-- " << "Workers         : " << get_number_of_workers () << "\n";
+        out_ << indent_ << "|-- " << "Submitted       : " << statistics.submitted << "\n";
+        out_ << indent_ << "|-- " << "Committed       : " << statistics.committed << "\n";
+        out_ << indent_ << "|-- " << "Producer waits  : " << statistics.producer_waits << "\n";
+        out_ << indent_ << "|-- " << "Worker waits    : " << statistics.worker_waits << "\n";
+        out_ << indent_ << "`-- " << "Committer waits : " << statistics.committer_waits << "\n";
+        return;
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of export_pipeline.cc
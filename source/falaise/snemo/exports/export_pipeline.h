@@ -0,0 +1,233 @@
+// -*- mode: c++ ; -*-
+/* export_pipeline.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Pipeline of event records between the conversion and the commit
+ *
+ *   A fixed pool of slots (a copy of an event record plus an export event)
+ *   circulates between three kinds of threads :
+ *
+ *     - the producer (the thread processing the event records) takes a
+ *       free slot, copies a record in it and submits it,
+ *     - the worker threads convert the submitted records in the export
+ *       events of their slots, several records at a time,
+ *     - the committer thread commits the converted events in submission
+ *       order (ex: fill of the tree), then gives the slots back to the free
+ *       list.
+ *
+ *   The free list is a single producer, single consumer lock-free ring.
+ *   An error of a conversion or of a commit stops the commits and is
+ *   rethrown to the producer, the events submitted before it are committed.
+ *
+ * History:
+ *
+ */
+
+#ifndef SNRECONSTRUCTION_EXPORTS_EXPORT_PIPELINE_H
+#define SNRECONSTRUCTION_EXPORTS_EXPORT_PIPELINE_H 1
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <deque>
+#include <iostream>
+#include <functional>
+#include <exception>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <datatools/things.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      struct export_event;
+
+      /// \brief Single producer, single consumer lock-free ring of pointers
+      template<class T>
+      class spsc_ring
+      {
+      public:
+
+        explicit spsc_ring (std::size_t capacity_)
+          : _slots_ (capacity_ + 1, 0), _head_ (0), _tail_ (0) {}
+
+        /// Return the maximum number of items in the ring
+        std::size_t get_capacity () const
+        {
+          return _slots_.size () - 1;
+        }
+
+        /// Push an item (producer only), return false if the ring is full
+        bool push (T * item_)
+        {
+          const std::size_t tail = _tail_.load (std::memory_order_relaxed);
+          const std::size_t next = (tail + 1) % _slots_.size ();
+          if (next == _head_.load (std::memory_order_acquire)) return false;
+          _slots_[tail] = item_;
+          _tail_.store (next, std::memory_order_release);
+          return true;
+        }
+
+        /// Pop an item (consumer only), return 0 if the ring is empty
+        T * pop ()
+        {
+          const std::size_t head = _head_.load (std::memory_order_relaxed);
+          if (head == _tail_.load (std::memory_order_acquire)) return 0;
+          T * item = _slots_[head];
+          _head_.store ((head + 1) % _slots_.size (), std::memory_order_release);
+          return item;
+        }
+
+        /// Check if the ring is empty
+        bool empty () const
+        {
+          return _head_.load (std::memory_order_acquire) == _tail_.load (std::memory_order_acquire);
+        }
+
+      private:
+
+        std::vector<T *>         _slots_; /// Storage (one slot is always free)
+        std::atomic<std::size_t> _head_;  /// Index of the next item to pop
+        std::atomic<std::size_t> _tail_;  /// Index of the next free slot
+
+      };
+
+      /// \brief Pipeline of event records converted concurrently and committed in order
+      class export_pipeline
+      {
+      public:
+
+        /// Creation of the export events of the slots
+        typedef std::function<export_event * ()> factory_type;
+
+        /// Conversion of a record in an export event (worker threads)
+        typedef std::function<void (unsigned int worker_,
+                                    const datatools::things & record_,
+                                    export_event & event_)> convert_type;
+
+        /// Commit of a converted export event (committer thread)
+        typedef std::function<void (export_event & event_)> commit_type;
+
+        /// Statistics
+        struct statistics_type
+        {
+          uint64_t submitted;       /// Number of submitted records
+          uint64_t committed;       /// Number of committed events
+          uint64_t producer_waits;  /// Number of waits for a free slot (conversion or commit bound)
+          uint64_t worker_waits;    /// Number of waits of the workers for a submitted record (producer bound)
+          uint64_t committer_waits; /// Number of waits for the next converted event (conversion bound)
+          statistics_type ();
+        };
+
+        /// Constructor
+        export_pipeline (unsigned int depth_,
+                         unsigned int number_of_workers_,
+                         const factory_type & factory_,
+                         const convert_type & convert_,
+                         const commit_type & commit_);
+
+        /// Destructor (the submitted records are converted and committed)
+        ~export_pipeline ();
+
+        /// Return the number of slots
+        unsigned int get_depth () const;
+
+        /// Return the number of worker threads
+        unsigned int get_number_of_workers () const;
+
+        /// Take a free slot and return its record (producer), wait if none is available
+        datatools::things & acquire ();
+
+        /// Submit the record of the acquired slot (producer)
+        void submit ();
+
+        /// Give back the acquired slot without submitting it (producer, ex: on error)
+        void release ();
+
+        /// Wait until all the submitted records are committed (producer)
+        void drain ();
+
+        /// Return the statistics
+        statistics_type get_statistics () const;
+
+        /// Smart print
+        void print (std::ostream & out_ = std::clog,
+                    const std::string & title_ = "",
+                    const std::string & indent_ = "") const;
+
+      protected:
+
+        /// Main loop of a worker thread
+        void _run_worker (unsigned int worker_);
+
+        /// Main loop of the committer thread
+        void _run_committer ();
+
+        /// Rethrow the first error of the pipeline, if any
+        void _check_error ();
+
+      private:
+
+        export_pipeline (const export_pipeline &);
+        export_pipeline & operator= (const export_pipeline &);
+
+        /// Record and export event circulating in the pipeline
+        struct slot_type
+        {
+          datatools::things                record;    /// Copy of the event record
+          boost::scoped_ptr<export_event>  event;     /// Export event
+          bool                             converted; /// Conversion flag
+          std::exception_ptr               error;     /// Error of the conversion
+          slot_type ();
+          ~slot_type ();
+        };
+
+      private:
+
+        convert_type                 _convert_;   /// Conversion action
+        commit_type                  _commit_;    /// Commit action
+        boost::ptr_vector<slot_type> _slots_;     /// Pool of slots
+        spsc_ring<slot_type>         _free_;      /// Free slots (committer -> producer)
+        std::deque<slot_type *>      _work_;      /// Submitted slots waiting for a worker
+        std::deque<slot_type *>      _order_;     /// Submitted slots not yet committed (submission order)
+        slot_type *                  _acquired_;  /// Slot being filled by the producer
+        slot_type *                  _spare_;     /// Slot given back by the producer
+        std::vector<std::thread>     _workers_;   /// Worker threads
+        std::thread                  _committer_; /// Committer thread
+        mutable std::mutex           _mutex_;     /// Lock of the queues
+        std::condition_variable      _wake_producer_;  /// Notification of a free slot
+        std::condition_variable      _wake_workers_;   /// Notification of a submitted record
+        std::condition_variable      _wake_committer_; /// Notification of a converted event
+        bool                         _stop_;      /// Stop flag
+        std::atomic<bool>            _failed_;    /// Error flag
+        std::exception_ptr           _error_;     /// First error
+        uint64_t                     _submitted_count_; /// Number of submitted records
+        uint64_t                     _committed_;       /// Number of committed events
+        uint64_t                     _producer_waits_;  /// Number of waits of the producer
+        uint64_t                     _worker_waits_;    /// Number of waits of the workers
+        uint64_t                     _committer_waits_; /// Number of waits of the committer
+
+      };
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // SNRECONSTRUCTION_EXPORTS_EXPORT_PIPELINE_H
+
+// end of export_pipeline.h
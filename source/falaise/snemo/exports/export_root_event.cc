@@ -8,6 +8,7 @@
 #include <boost/algorithm/string.hpp>
 
 #include <limits>
+#include <algorithm>
 
 #include <TTree.h>
 
@@ -25,23 +26,63 @@ namespace snemo {
 
       export_root_event::~export_root_event ()
       {
+        _clear_fill_kernels ();
         _branch_manager_.reset ();
         _store_bits_ = 0;
         return;
       }
 
+      uint32_t export_root_event::get_store_bits () const
+      {
+        return _store_bits_;
+      }
+
+      branch_manager & export_root_event::grab_branch_manager ()
+      {
+        return _branch_manager_;
+      }
+
+      void export_root_event::construct (const event_exporter & exporter_)
+      {
+        // The memberships are stored as offsets in their parents plus flat hit IDs :
+        _branch_manager_.set_offset_memberships (exporter_.are_memberships_offset_encoded ());
+        // The row indexes of the referenced rows are stored next to their IDs :
+        _branch_manager_.set_row_indexes (exporter_.are_row_indexes_exported ());
+        // The true scintillator hits of all block types are stored in a single bank :
+        _branch_manager_.set_unified_scin_hits (exporter_.are_true_scin_hits_unified ());
+        std::map<std::string,int> topics;
+        if (exporter_.get_topic_export_level ("CAT") >= event_exporter::EXPORT_TOPIC_INCLUDE)
+          {
+            topics["CAT"] = exporter_.get_topic_export_level ("CAT");
+          }
+        construct (exporter_.get_export_flags (), topics);
+        return;
+      }
+
       void export_root_event::construct (unsigned int store_bits_,
                                          const std::map<std::string,int> topics_,
                                          unsigned int store_version_)
       {
         _store_bits_ = store_bits_;
 
+        // Sparse topics are stored in dedicated sub-banks, not in the parent banks :
+        bool sparse_cat = false;
         for (std::map<std::string,int>::const_iterator i = topics_.begin();
              i != topics_.end();
              i++)
           {
+            if (i->second == event_exporter::EXPORT_TOPIC_SPARSE)
+              {
+                _branch_manager_.add_topic(i->first, event_exporter::EXPORT_TOPIC_NO_INCLUDE);
+                if (i->first == "CAT") sparse_cat = true;
+                continue;
+              }
             _branch_manager_.add_topic(i->first, i->second);
           }
+        // Memberships are stored as offsets in the parents plus flat hit IDs, not as one row per member :
+        const bool csr_memberships = _branch_manager_.is_offset_memberships ();
+        // The true scintillator hits of all block types are stored in a single bank :
+        const bool unified_scin_hits = _branch_manager_.is_unified_scin_hits ();
 
         // EXPORT_EVENT_HEADER :
         if (_store_bits_ & event_exporter::EXPORT_EVENT_HEADER)
@@ -100,21 +141,36 @@ namespace snemo {
             int32_t bank_version;
             bank_description = "true_scin_hit_type";
             bank_export_version<true_scin_hit_type>(bank_version);
-            _branch_manager_.init_bank_from_camp ("trueCaloHits",
-                                                  event_exporter::EXPORT_TRUE_HITS,
-                                                  bank_version,
-                                                  bank_description,
-                                                  branch_entry_type::ARRAY_DATA);
-            _branch_manager_.init_bank_from_camp ("trueXcaloHits",
-                                                  event_exporter::EXPORT_TRUE_HITS,
-                                                  bank_version,
-                                                  bank_description,
-                                                  branch_entry_type::ARRAY_DATA);
-            _branch_manager_.init_bank_from_camp ("trueGvetoHits",
-                                                  event_exporter::EXPORT_TRUE_HITS,
-                                                  bank_version,
-                                                  bank_description,
-                                                  branch_entry_type::ARRAY_DATA);
+            if (unified_scin_hits)
+              {
+                // The block type is not constant within this bank :
+                const bool hoist = _branch_manager_.is_hoist_event_constants ();
+                _branch_manager_.set_hoist_event_constants (false);
+                _branch_manager_.init_bank_from_camp ("trueScinHits",
+                                                      event_exporter::EXPORT_TRUE_HITS,
+                                                      bank_version,
+                                                      bank_description,
+                                                      branch_entry_type::ARRAY_DATA);
+                _branch_manager_.set_hoist_event_constants (hoist);
+              }
+            else
+              {
+                _branch_manager_.init_bank_from_camp ("trueCaloHits",
+                                                      event_exporter::EXPORT_TRUE_HITS,
+                                                      bank_version,
+                                                      bank_description,
+                                                      branch_entry_type::ARRAY_DATA);
+                _branch_manager_.init_bank_from_camp ("trueXcaloHits",
+                                                      event_exporter::EXPORT_TRUE_HITS,
+                                                      bank_version,
+                                                      bank_description,
+                                                      branch_entry_type::ARRAY_DATA);
+                _branch_manager_.init_bank_from_camp ("trueGvetoHits",
+                                                      event_exporter::EXPORT_TRUE_HITS,
+                                                      bank_version,
+                                                      bank_description,
+                                                      branch_entry_type::ARRAY_DATA);
+              }
 
             bank_description = "true_gg_hit_type";
             bank_export_version<true_gg_hit_type>(bank_version);
@@ -151,6 +207,16 @@ namespace snemo {
                                                   bank_version,
                                                   bank_description,
                                                   branch_entry_type::ARRAY_DATA);
+            if (sparse_cat)
+              {
+                bank_description = "calib_tracker_hit_cat_type";
+                bank_export_version<calib_tracker_hit_cat_type>(bank_version);
+                _branch_manager_.init_bank_from_camp ("calibTrackerHitsCat",
+                                                      event_exporter::EXPORT_CALIB_TRACKER_HITS,
+                                                      bank_version,
+                                                      bank_description,
+                                                      branch_entry_type::ARRAY_DATA);
+              }
           }
 
         // EXPORT_TRACKER_CLUSTERING :
@@ -166,14 +232,37 @@ namespace snemo {
                                                   bank_version,
                                                   bank_description,
                                                   branch_entry_type::ARRAY_DATA);
+            if (sparse_cat)
+              {
+                bank_description = "tracker_cluster_cat_type";
+                bank_export_version<tracker_cluster_cat_type>(bank_version);
+                _branch_manager_.init_bank_from_camp ("trackerClustersCat",
+                                                      event_exporter::EXPORT_TRACKER_CLUSTERING,
+                                                      bank_version,
+                                                      bank_description,
+                                                      branch_entry_type::ARRAY_DATA);
+              }
 
-            bank_description = "tracker_clustered_hit_type";
-            bank_export_version<tracker_clustered_hit_type>(bank_version);
-            _branch_manager_.init_bank_from_camp ("trackerClusteredHits",
-                                                  event_exporter::EXPORT_TRACKER_CLUSTERING,
-                                                  bank_version,
-                                                  bank_description,
-                                                  branch_entry_type::ARRAY_DATA);
+            if (csr_memberships)
+              {
+                bank_description = "tracker_hit_ref_type";
+                bank_export_version<tracker_hit_ref_type>(bank_version);
+                _branch_manager_.init_bank_from_camp ("trackerClusterHitIds",
+                                                      event_exporter::EXPORT_TRACKER_CLUSTERING,
+                                                      bank_version,
+                                                      bank_description,
+                                                      branch_entry_type::ARRAY_DATA);
+              }
+            else
+              {
+                bank_description = "tracker_clustered_hit_type";
+                bank_export_version<tracker_clustered_hit_type>(bank_version);
+                _branch_manager_.init_bank_from_camp ("trackerClusteredHits",
+                                                      event_exporter::EXPORT_TRACKER_CLUSTERING,
+                                                      bank_version,
+                                                      bank_description,
+                                                      branch_entry_type::ARRAY_DATA);
+              }
         }
 
         // EXPORT_TRACKER_TRAJECTORIES :
@@ -190,13 +279,26 @@ namespace snemo {
                                                   bank_description,
                                                   branch_entry_type::ARRAY_DATA);
 
-            bank_description = "tracker_trajectory_orphan_hit_type";
-            bank_export_version<tracker_trajectory_orphan_hit_type>(bank_version);
-            _branch_manager_.init_bank_from_camp ("trackerTrajectoryOrphanHits",
-                                                  event_exporter::EXPORT_TRACKER_TRAJECTORIES,
-                                                  bank_version,
-                                                  bank_description,
-                                                  branch_entry_type::ARRAY_DATA);
+            if (csr_memberships)
+              {
+                bank_description = "tracker_hit_ref_type";
+                bank_export_version<tracker_hit_ref_type>(bank_version);
+                _branch_manager_.init_bank_from_camp ("trackerTrajectoryOrphanHitIds",
+                                                      event_exporter::EXPORT_TRACKER_TRAJECTORIES,
+                                                      bank_version,
+                                                      bank_description,
+                                                      branch_entry_type::ARRAY_DATA);
+              }
+            else
+              {
+                bank_description = "tracker_trajectory_orphan_hit_type";
+                bank_export_version<tracker_trajectory_orphan_hit_type>(bank_version);
+                _branch_manager_.init_bank_from_camp ("trackerTrajectoryOrphanHits",
+                                                      event_exporter::EXPORT_TRACKER_TRAJECTORIES,
+                                                      bank_version,
+                                                      bank_description,
+                                                      branch_entry_type::ARRAY_DATA);
+              }
 
             bank_description = "tracker_trajectory_pattern_type";
             bank_export_version<tracker_trajectory_pattern_type>(bank_version);
@@ -207,6 +309,39 @@ namespace snemo {
                                                   branch_entry_type::ARRAY_DATA);
         }
 
+        _build_fill_kernels ();
+        return;
+      }
+
+      void export_root_event::_clear_fill_kernels ()
+      {
+        _fill_kernels_.clear ();
+        return;
+      }
+
+      void export_root_event::_build_fill_kernels ()
+      {
+        _clear_fill_kernels ();
+        // One slot per branch entry :
+        const branch_manager::bi_col_type & bis = _branch_manager_.get_branch_infos ();
+        for (size_t i = 0; i < bis.size (); i++)
+          {
+            _fill_kernels_.push_back (static_cast<leaf_fill_kernel *> (0));
+          }
+        make_fill_kernels<true_step_hit_type> (_branch_manager_, "trueStepHits", &export_event::true_step_hits, _fill_kernels_);
+        make_fill_kernels<true_scin_hit_type> (_branch_manager_, "trueCaloHits", &export_event::true_calo_hits, _fill_kernels_);
+        make_fill_kernels<true_scin_hit_type> (_branch_manager_, "trueXcaloHits", &export_event::true_xcalo_hits, _fill_kernels_);
+        make_fill_kernels<true_scin_hit_type> (_branch_manager_, "trueGvetoHits", &export_event::true_gveto_hits, _fill_kernels_);
+        make_fill_kernels<true_scin_hit_type> (_branch_manager_, "trueScinHits", &export_event::true_scin_hits, _fill_kernels_);
+        make_fill_kernels<true_gg_hit_type> (_branch_manager_, "trueGgHits", &export_event::true_gg_hits, _fill_kernels_);
+        make_fill_kernels<calib_calorimeter_hit_type> (_branch_manager_, "calibScinHits", &export_event::calib_scin_hits, _fill_kernels_);
+        make_fill_kernels<calib_tracker_hit_type> (_branch_manager_, "calibTrackerHits", &export_event::calib_gg_hits, _fill_kernels_);
+        size_t number_of_kernels = 0;
+        for (size_t i = 0; i < _fill_kernels_.size (); i++)
+          {
+            if (! _fill_kernels_.is_null (i)) number_of_kernels++;
+          }
+        DT_LOG_DEBUG (get_logging_priority (), "Number of branches filled through typed kernels : " << number_of_kernels);
         return;
       }
 
@@ -218,6 +353,11 @@ namespace snemo {
             branch_entry_type & bi = *(bis[i]);
             bi.detach_branch ();
           }
+        branch_manager::group_col_type & groups = _branch_manager_.grab_groups ();
+        for (size_t i = 0; i < groups.size (); i++)
+          {
+            groups[i]->detach_branch ();
+          }
         return;
       }
 
@@ -229,10 +369,17 @@ namespace snemo {
             DT_LOG_DEBUG (get_logging_priority (), "Export ROOT event");
             print ();
           }
+        // Multi-leaf branches first : they may hold the size counters of the array branches
+        branch_manager::group_col_type & groups = _branch_manager_.grab_groups ();
+        for (size_t i = 0; i < groups.size (); i++)
+          {
+            groups[i]->make_branch (tree_);
+          }
         branch_manager::bi_col_type & bis = _branch_manager_.grab_branch_infos ();
         for (size_t i = 0; i < bis.size (); i++)
           {
             branch_entry_type & bi = *(bis[i]);
+            if (bi.is_grouped ()) continue;
             if (bi.is_activated ())
               {
                 bi.make_branch (tree_);
@@ -290,6 +437,11 @@ namespace snemo {
         camp::UserObject proxyEE (EE);
         if (boost::ends_with (bi_name, "@size"))
           {
+            if (branch_info_.is_leaf_counter ())
+              {
+                DT_LOG_TRACE (get_logging_priority (), "Branch '" << bi_name << "' is filled with its leaf ! Exiting.");
+                return;
+              }
             DT_LOG_TRACE (get_logging_priority (), "Branch '" << bi_name << "' is the size of a data array !");
             camp::Value bankSizeVal = event_class.property(bi_name).get (proxyEE);
             DT_LOG_TRACE (get_logging_priority (), "Set array size '" << bankSizeVal << "'");
@@ -308,6 +460,40 @@ namespace snemo {
           }
         const bool array = branch_info_.is_array ();
         const camp::Property & propParent = event_class.property(branch_parent_name);
+        if (branch_info_.is_event_scope ())
+          {
+            // Leaf constant within the event : the value is stored once if all the elements agree,
+            // the values of all the elements are stored otherwise :
+            const unsigned int array_size = (dynamic_cast<const camp::ArrayProperty &>(propParent)).size (proxyEE);
+            const camp::Function & getterFunc = event_class.function (branch_parent_name + "@get");
+            camp::Value firstVal;
+            unsigned int number_of_values = 0;
+            for (unsigned int i = 0; i < array_size; i++)
+              {
+                camp::UserObject obj = getterFunc.call (proxyEE, camp::Args (i)).to<camp::UserObject>();
+                camp::Value leafVal = _get_leaf_value (branch_info_, obj.getClass (), obj);
+                if (i == 0)
+                  {
+                    firstVal = leafVal;
+                    number_of_values = 1;
+                  }
+                else if (! (leafVal == firstVal))
+                  {
+                    number_of_values = array_size;
+                  }
+                branch_info_.set_branch_value (leafVal, i);
+              }
+            DT_LOG_TRACE (get_logging_priority (), "Branch '" << bi_name << "' : "
+                          << number_of_values << " values stored over " << array_size << ".");
+            _branch_manager_.grab_branch (branch_info_.get_array_size_name ())
+              .as<UInt_t> ().set_value (number_of_values);
+            return;
+          }
+        if (branch_info_.is_nullable ())
+          {
+            // The counter of the non missing values is updated with the leaf :
+            _branch_manager_.grab_branch (branch_info_.get_array_size_name ()).as<UInt_t> ().set_value (0);
+          }
         if (array)
           {
             // Check if the parent property is an empty array :
@@ -340,7 +526,9 @@ namespace snemo {
               }
             else
               {
-                const std::string & size_prop_name = branch_info_.get_array_size_name ();
+                // A nullable leaf has its own counter but spans the whole bank :
+                const std::string size_prop_name = branch_info_.is_nullable ()
+                  ? branch_parent_name + "@size" : branch_info_.get_array_size_name ();
                 std::ostringstream getter_func_oss;
                 getter_func_oss << branch_parent_name << "@get";
                 std::string getter_func_name = getter_func_oss.str ();
@@ -350,6 +538,7 @@ namespace snemo {
                 camp::Value arraySizeVal = event_class.property(size_prop_name).get (proxyEE);
                 DT_LOG_TRACE (get_logging_priority (), "Array size '" << arraySizeVal << "'.");
                 array_size = arraySizeVal.to<unsigned int> ();
+                unsigned int number_of_values = 0;
                 for (size_t i = 0; i < array_size; i++)
                   {
                     DT_THROW_IF (! event_class.hasFunction (getter_func_name), std::logic_error,
@@ -358,12 +547,26 @@ namespace snemo {
                     const camp::Function & getterFunc = event_class.function (getter_func_name);
                     camp::Value objVal =  getterFunc.call (proxyEE, camp::Args (i));
                     camp::UserObject obj = objVal.to<camp::UserObject>();
-                    camp::Value leafVal = parent_class.property(propName).get (obj);
+                    camp::Value leafVal = _get_leaf_value (branch_info_, parent_class, obj);
+                    if (branch_info_.is_nullable ())
+                      {
+                        // Missing values are only flagged in the validity bitmap :
+                        if (branch_entry_type::is_null_value (leafVal)) continue;
+                        branch_info_.set_branch_value (leafVal, number_of_values++);
+                        continue;
+                      }
                     DT_LOG_TRACE (get_logging_priority (),
                                   "Branch '" << bi_name << "' : setting array [" << i << "] value ("
                                   << leafVal << ")");
                     branch_info_.set_branch_value (leafVal, i);
                   }
+                if (branch_info_.is_nullable ())
+                  {
+                    DT_LOG_TRACE (get_logging_priority (), "Branch '" << bi_name << "' : "
+                                  << number_of_values << " non missing values over " << array_size << ".");
+                    _branch_manager_.grab_branch (branch_info_.get_array_size_name ())
+                      .as<UInt_t> ().set_value (number_of_values);
+                  }
               }
             DT_LOG_TRACE (get_logging_priority (), "Array size is : '" << array_size << "'.");
           }
@@ -374,11 +577,11 @@ namespace snemo {
             const std::string & propName = branch_info_.get_leaf_name ();
             DT_LOG_TRACE (get_logging_priority (), "Property name : '" << propName << "'");
             const camp::Class & parent_class = proxyParent.getClass();
-            DT_THROW_IF (! parent_class.hasProperty (propName), std::logic_error,
+            DT_THROW_IF (! branch_info_.is_bitfield () && ! parent_class.hasProperty (propName), std::logic_error,
                          "Cannot find leaf named '" << propName << "' for branch '" << bi_name
                          << "' as a property of class '" << parent_class.name () << "' !");;
             DT_LOG_TRACE (get_logging_priority (), "Found property '" << propName << "' in class '" << parent_class.name () << "'.");
-            camp::Value leafVal = parent_class.property(propName).get (proxyParent);
+            camp::Value leafVal = _get_leaf_value (branch_info_, parent_class, proxyParent);
             DT_LOG_TRACE (get_logging_priority (), "Branch '" << bi_name << "' : setting scalar value ("
                           << leafVal << ")");
             branch_info_.set_branch_value (leafVal);
@@ -388,6 +591,31 @@ namespace snemo {
        return;
       }
 
+      camp::Value export_root_event::_get_leaf_value (const branch_entry_type & branch_info_,
+                                                      const camp::Class & parent_class_,
+                                                      const camp::UserObject & object_) const
+      {
+        if (! branch_info_.is_bitfield ())
+          {
+            return parent_class_.property (branch_info_.get_leaf_name ()).get (object_);
+          }
+        // Pack the boolean members, the first one in the lowest bit
+        // (validity bitmap : the members are the non missing nullable leaves) :
+        const std::vector<std::string> & members = branch_info_.get_bitfield_members ();
+        uint32_t bits = 0;
+        for (size_t i = 0; i < members.size (); i++)
+          {
+            const camp::Value memberVal = parent_class_.property (members[i]).get (object_);
+            if (branch_info_.is_validity_bitmap ()
+                ? ! branch_entry_type::is_null_value (memberVal)
+                : memberVal.to<bool> ())
+              {
+                bits |= (1U << i);
+              }
+          }
+        return camp::Value (bits);
+      }
+
       void export_root_event::fill_memory ()
       {
         //const camp::Class & event_class = camp::classByName ("export_event");
@@ -396,12 +624,10 @@ namespace snemo {
         camp::UserObject proxyEE (EE);
 
         // Loop on branch infos:
-        for (branch_manager::bi_col_type::iterator bi_iter
-               = _branch_manager_.grab_branch_infos ().begin ();
-             bi_iter != _branch_manager_.grab_branch_infos ().end ();
-             bi_iter++)
+        branch_manager::bi_col_type & bis = _branch_manager_.grab_branch_infos ();
+        for (size_t i = 0; i < bis.size (); i++)
           {
-            branch_entry_type & bi = **bi_iter;
+            branch_entry_type & bi = *(bis[i]);
             DT_LOG_TRACE (get_logging_priority (), "Branch name = " << bi.get_name ());
             // Check if this branch is stored :
             if (! (bi.get_store_bit () & _store_bits_))
@@ -409,8 +635,20 @@ namespace snemo {
                 DT_LOG_TRACE (get_logging_priority (), "Branch '" << bi.get_name () << "' is not stored !");
                 continue;
               }
+            // Leaves with a compile-time descriptor are copied with no CAMP call :
+            if (i < _fill_kernels_.size () && ! _fill_kernels_.is_null (i))
+              {
+                _fill_kernels_[i].fill (EE);
+                continue;
+              }
             fill_branch_memory (bi);
           }
+        // Copy the grouped leaves in the buffers of their multi-leaf branches :
+        branch_manager::group_col_type & groups = _branch_manager_.grab_groups ();
+        for (size_t i = 0; i < groups.size (); i++)
+          {
+            groups[i]->pack ();
+          }
         return;
       }
 
@@ -19,9 +19,11 @@
 #define SNRECONSTRUCTION_EXPORTS_EXPORT_ROOT_EVENT_H 1
 
 #include <iostream>
+#include <vector>
 
 #include <falaise/snemo/exports/export_event.h>
 #include <falaise/snemo/exports/root_utils.h>
+#include <falaise/snemo/exports/bank_descriptor.h>
 #include <falaise/snemo/exports/loggable_support.h>
 
 class TTree;
@@ -32,6 +34,8 @@ namespace snemo {
 
     namespace exports {
 
+      struct event_exporter;
+
       struct export_root_event : public export_event,
                                  public loggable_support
       {
@@ -48,6 +52,9 @@ namespace snemo {
                         const std::map<std::string,int> topics_,
                         unsigned int store_version_ = 0);
 
+        /// Construct the ROOT tree branch structure from the storage modes and topics of an exporter
+        void construct (const event_exporter & exporter_);
+
         /// Setup a ROOT tree from the internal structure of branches
         void setup_tree (TTree * tree_);
 
@@ -60,14 +67,33 @@ namespace snemo {
         /// Fill the memory associated to a given branch
         void fill_branch_memory (branch_entry_type &);
 
+        /// Return the store bits
+        uint32_t get_store_bits () const;
+
+        /// Return a mutable reference to the branch manager
+        branch_manager & grab_branch_manager ();
+
         /// Smart print
         void print (std::ostream & out_ = std::clog,
                     const std::string & title_ = "",
                     const std::string & indent_ = "") const;
 
+      protected:
+
+        /// Return the value of a leaf (or the packed value of a bitfield) from an object
+        camp::Value _get_leaf_value (const branch_entry_type & branch_info_,
+                                     const camp::Class & parent_class_,
+                                     const camp::UserObject & object_) const;
+
+        /// Build the fill kernels of the banks with a compile-time descriptor
+        void _build_fill_kernels ();
+
+        void _clear_fill_kernels ();
+
       private:
         uint32_t       _store_bits_; /// Store bits
         branch_manager _branch_manager_; /// Branch manager
+        fill_kernel_col_type _fill_kernels_; /// Fill kernels of the branch entries (null : filled through CAMP)
 
       };
 
@@ -0,0 +1,348 @@
+// -*- mode: c++ ; -*-
+/* export_root_merger.cc */
+
+#include <falaise/snemo/exports/export_root_merger.h>
+
+#include <cstdio>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <exception>
+#include <thread>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <datatools/exception.h>
+
+#include <TROOT.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <TBranch.h>
+#include <TLeaf.h>
+#include <TObjArray.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      // static
+      const int export_root_merger::COMPRESSION_KEEP;
+
+      export_root_merger::statistics_type::statistics_type ()
+      {
+        entries = 0;
+        input_files = 0;
+        fast_cloned_files = 0;
+        recompressed_files = 0;
+        groups = 0;
+        return;
+      }
+
+      void export_root_merger::statistics_type::add (const statistics_type & other_)
+      {
+        entries += other_.entries;
+        input_files += other_.input_files;
+        fast_cloned_files += other_.fast_cloned_files;
+        recompressed_files += other_.recompressed_files;
+        return;
+      }
+
+      export_root_merger::export_root_merger ()
+      {
+        _tree_name_ = "snemodata";
+        _number_of_threads_ = 1;
+        _compression_ = COMPRESSION_KEEP;
+        return;
+      }
+
+      export_root_merger::~export_root_merger ()
+      {
+        return;
+      }
+
+      void export_root_merger::set_tree_name (const std::string & tree_name_)
+      {
+        _tree_name_ = tree_name_;
+        return;
+      }
+
+      void export_root_merger::add_input_file (const std::string & filename_)
+      {
+        _input_files_.push_back (filename_);
+        return;
+      }
+
+      void export_root_merger::set_output_file (const std::string & filename_)
+      {
+        _output_file_ = filename_;
+        return;
+      }
+
+      void export_root_merger::set_number_of_threads (unsigned int nthreads_)
+      {
+        DT_THROW_IF (nthreads_ == 0, std::domain_error, "Invalid number of threads !");
+        _number_of_threads_ = nthreads_;
+        return;
+      }
+
+      void export_root_merger::set_compression_settings (int compression_)
+      {
+        DT_THROW_IF (compression_ < COMPRESSION_KEEP, std::domain_error,
+                     "Invalid compression settings '" << compression_ << "' !");
+        _compression_ = compression_;
+        return;
+      }
+
+      void export_root_merger::set_temporary_directory (const std::string & directory_)
+      {
+        _temporary_directory_ = directory_;
+        return;
+      }
+
+      const export_root_merger::statistics_type & export_root_merger::get_statistics () const
+      {
+        return _statistics_;
+      }
+
+      // static
+      void export_root_merger::extract_schema (TTree & tree_, schema_type & schema_)
+      {
+        schema_.leaves.clear ();
+        TObjArray * branches = tree_.GetListOfBranches ();
+        for (int i = 0; i < branches->GetEntries (); i++)
+          {
+            TBranch * branch = static_cast<TBranch *>(branches->At (i));
+            TLeaf * leaf = static_cast<TLeaf *>(branch->GetListOfLeaves ()->At (0));
+            std::ostringstream signature;
+            signature << leaf->GetTypeName () << ' ' << leaf->GetTitle ();
+            schema_.leaves[branch->GetName ()] = signature.str ();
+          }
+        schema_.metadata.load (tree_);
+        return;
+      }
+
+      void export_root_merger::check_schemas () const
+      {
+        DT_LOG_TRACE (get_logging_priority (), "Entering...");
+        schema_type reference;
+        for (size_t ifile = 0; ifile < _input_files_.size (); ifile++)
+          {
+            const std::string & input_name = _input_files_[ifile];
+            boost::scoped_ptr<TFile> input_file (TFile::Open (input_name.c_str (), "READ"));
+            DT_THROW_IF (! input_file || input_file->IsZombie (), std::runtime_error,
+                         "Cannot open input file '" << input_name << "' !");
+            TTree * input_tree = dynamic_cast<TTree *>(input_file->Get (_tree_name_.c_str ()));
+            DT_THROW_IF (input_tree == 0, std::runtime_error,
+                         "No tree '" << _tree_name_ << "' in input file '" << input_name << "' !");
+            schema_type schema;
+            extract_schema (*input_tree, schema);
+            input_file->Close ();
+            if (ifile == 0)
+              {
+                reference = schema;
+                continue;
+              }
+            for (std::map<std::string, std::string>::const_iterator i = reference.leaves.begin ();
+                 i != reference.leaves.end (); i++)
+              {
+                std::map<std::string, std::string>::const_iterator found = schema.leaves.find (i->first);
+                DT_THROW_IF (found == schema.leaves.end (), std::logic_error,
+                             "Branch '" << i->first << "' is missing in input file '" << input_name << "' !");
+                DT_THROW_IF (found->second != i->second, std::logic_error,
+                             "Branch '" << i->first << "' has type '" << found->second
+                             << "' in input file '" << input_name << "' but '" << i->second
+                             << "' in input file '" << _input_files_.front () << "' !");
+              }
+            DT_THROW_IF (schema.leaves.size () != reference.leaves.size (), std::logic_error,
+                         "Input file '" << input_name << "' has " << schema.leaves.size ()
+                         << " branches but input file '" << _input_files_.front () << "' has "
+                         << reference.leaves.size () << " !");
+            std::string reason;
+            DT_THROW_IF (! reference.metadata.is_compatible (schema.metadata, reason), std::logic_error,
+                         "Input file '" << input_name << "' is not compatible with input file '"
+                         << _input_files_.front () << "' : " << reason << " !");
+          }
+        DT_LOG_DEBUG (get_logging_priority (), "The schemas of the "
+                      << _input_files_.size () << " input files are compatible.");
+        DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+        return;
+      }
+
+      std::string export_root_merger::_intermediate_filename (unsigned int group_) const
+      {
+        std::string directory;
+        std::string basename = _output_file_;
+        const std::size_t slash = _output_file_.rfind ('/');
+        if (slash != std::string::npos)
+          {
+            directory = _output_file_.substr (0, slash + 1);
+            basename = _output_file_.substr (slash + 1);
+          }
+        if (! _temporary_directory_.empty ())
+          {
+            directory = _temporary_directory_ + '/';
+          }
+        std::ostringstream filename;
+        filename << directory << '.' << basename << ".part" << group_;
+        return filename.str ();
+      }
+
+      void export_root_merger::_merge_files (const std::vector<std::string> & inputs_,
+                                             const std::string & output_,
+                                             int compression_,
+                                             statistics_type & statistics_) const
+      {
+        boost::scoped_ptr<TFile> output_file;
+        TTree * output_tree = 0;
+        for (size_t ifile = 0; ifile < inputs_.size (); ifile++)
+          {
+            const std::string & input_name = inputs_[ifile];
+            DT_LOG_DEBUG (get_logging_priority (), "Merging input file '" << input_name
+                          << "' into '" << output_ << "'...");
+            boost::scoped_ptr<TFile> input_file (TFile::Open (input_name.c_str (), "READ"));
+            DT_THROW_IF (! input_file || input_file->IsZombie (), std::runtime_error,
+                         "Cannot open input file '" << input_name << "' !");
+            TTree * input_tree = dynamic_cast<TTree *>(input_file->Get (_tree_name_.c_str ()));
+            DT_THROW_IF (input_tree == 0, std::runtime_error,
+                         "No tree '" << _tree_name_ << "' in input file '" << input_name << "' !");
+            if (output_tree == 0)
+              {
+                const int compression = (compression_ == COMPRESSION_KEEP)
+                  ? input_file->GetCompressionSettings () : compression_;
+                output_file.reset (new TFile (output_.c_str (), "RECREATE",
+                                              "SuperNEMO event record ROOT export",
+                                              compression));
+                DT_THROW_IF (output_file->IsZombie (), std::runtime_error,
+                             "Cannot create output file '" << output_ << "' !");
+                output_file->cd ();
+                output_tree = input_tree->CloneTree (0);
+                output_tree->SetDirectory (output_file.get ());
+              }
+            else
+              {
+                input_tree->CopyAddresses (output_tree);
+              }
+            // Baskets are only copied as is when the compression does not change :
+            const bool fast = input_file->GetCompressionSettings () == output_file->GetCompressionSettings ();
+            const Long64_t copied = output_tree->CopyEntries (input_tree, -1, fast ? "fast" : "");
+            DT_THROW_IF (copied < 0, std::runtime_error, "Merge of file '" << input_name << "' failed !");
+            statistics_.entries += input_tree->GetEntries ();
+            statistics_.input_files++;
+            if (fast) statistics_.fast_cloned_files++;
+            else statistics_.recompressed_files++;
+            input_tree->CopyAddresses (output_tree, kTRUE);
+            input_file->Close ();
+          }
+        output_file->cd ();
+        output_tree->Write ();
+        output_file->Close ();
+        return;
+      }
+
+      void export_root_merger::run ()
+      {
+        DT_LOG_TRACE (get_logging_priority (), "Entering...");
+        DT_THROW_IF (_input_files_.empty (), std::logic_error, "Missing input files !");
+        DT_THROW_IF (_output_file_.empty (), std::logic_error, "Missing output file !");
+        _statistics_ = statistics_type ();
+        check_schemas ();
+
+        // Each group should at least merge two files :
+        unsigned int ngroups = std::min<std::size_t> (_number_of_threads_, _input_files_.size () / 2);
+        if (ngroups <= 1)
+          {
+            _merge_files (_input_files_, _output_file_, _compression_, _statistics_);
+            DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+            return;
+          }
+
+        ROOT::EnableThreadSafety ();
+        std::vector<std::vector<std::string> > group_inputs (ngroups);
+        std::vector<std::string> group_outputs (ngroups);
+        std::vector<statistics_type> group_statistics (ngroups);
+        std::vector<std::exception_ptr> group_errors (ngroups);
+        for (size_t ifile = 0; ifile < _input_files_.size (); ifile++)
+          {
+            // Contiguous groups preserve the order of the entries :
+            group_inputs[ifile * ngroups / _input_files_.size ()].push_back (_input_files_[ifile]);
+          }
+        std::vector<std::thread> workers;
+        for (unsigned int igroup = 0; igroup < ngroups; igroup++)
+          {
+            group_outputs[igroup] = _intermediate_filename (igroup);
+            workers.push_back (std::thread ([this, igroup, &group_inputs, &group_outputs,
+                                             &group_statistics, &group_errors] ()
+              {
+                try
+                  {
+                    _merge_files (group_inputs[igroup], group_outputs[igroup],
+                                  _compression_, group_statistics[igroup]);
+                  }
+                catch (...)
+                  {
+                    group_errors[igroup] = std::current_exception ();
+                  }
+              }));
+          }
+        for (size_t i = 0; i < workers.size (); i++)
+          {
+            workers[i].join ();
+          }
+        for (unsigned int igroup = 0; igroup < ngroups; igroup++)
+          {
+            if (group_errors[igroup])
+              {
+                for (size_t i = 0; i < group_outputs.size (); i++)
+                  {
+                    std::remove (group_outputs[i].c_str ());
+                  }
+                std::rethrow_exception (group_errors[igroup]);
+              }
+            _statistics_.add (group_statistics[igroup]);
+          }
+
+        // The intermediate files already have the requested compression :
+        statistics_type final_statistics;
+        _merge_files (group_outputs, _output_file_, COMPRESSION_KEEP, final_statistics);
+        _statistics_.groups = ngroups;
+        for (size_t i = 0; i < group_outputs.size (); i++)
+          {
+            std::remove (group_outputs[i].c_str ());
+          }
+        DT_LOG_DEBUG (get_logging_priority (), "Output file '" << _output_file_ << "' has "
+                      << final_statistics.entries << " entries.");
+        DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+        return;
+      }
+
+      void export_root_merger::print (std::ostream & out_,
+                                      const std::string & title_,
+                                      const std::string & indent_) const
+      {
+        if (! title_.empty ())
+          {
+            out_ << indent_ << title_ << ": \n";
+          }
+        out_ << indent_ << "|-- " << "Input files        : " << _input_files_.size () << "\n";
+        out_ << indent_ << "|-- " << "Output file        : '" << _output_file_ << "'\n";
+        out_ << indent_ << "|-- " << "Threads            : " << _number_of_threads_ << "\n";
+        out_ << indent_ << "|-- " << "Compression        : ";
+        if (_compression_ == COMPRESSION_KEEP) out_ << "<keep>";
+        else out_ << _compression_;
+        out_ << "\n";
+        out_ << indent_ << "|-- " << "Groups             : " << _statistics_.groups << "\n";
+        out_ << indent_ << "|-- " << "Entries            : " << _statistics_.entries << "\n";
+        out_ << indent_ << "|-- " << "Fast cloned files  : " << _statistics_.fast_cloned_files << "\n";
+        out_ << indent_ << "`-- " << "Recompressed files : " << _statistics_.recompressed_files << "\n";
+        return;
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of export_root_merger.cc
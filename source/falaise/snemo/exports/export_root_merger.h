@@ -0,0 +1,148 @@
+// -*- mode: c++ ; -*-
+/* export_root_merger.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Merge of exported ROOT files
+ *
+ *   Before merging, the schema of all input files is checked against the
+ *   first one : same set of branches, same leaf types and compatible file
+ *   level metadata (export flags, topics, bank versions). Files produced
+ *   with different export flags or topics are thus rejected instead of
+ *   yielding broken trees.
+ *
+ *   The inputs are split in groups which are merged in parallel into
+ *   intermediate files, then the intermediate files are merged into the
+ *   output file. Baskets are copied without decompression (fast cloning)
+ *   unless a new compression setting is requested, in which case the
+ *   recompression is done by the worker threads.
+ *
+ * History:
+ *
+ */
+
+#ifndef SNRECONSTRUCTION_EXPORTS_EXPORT_ROOT_MERGER_H
+#define SNRECONSTRUCTION_EXPORTS_EXPORT_ROOT_MERGER_H 1
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+#include <boost/cstdint.hpp>
+
+#include <Rtypes.h>
+
+#include <falaise/snemo/exports/loggable_support.h>
+#include <falaise/snemo/exports/export_metadata.h>
+
+class TTree;
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      /// \brief Merge tool for exported ROOT files
+      class export_root_merger : public loggable_support
+      {
+      public:
+
+        /// Keep the compression settings of the input files
+        static const int COMPRESSION_KEEP = -1;
+
+        /// Run statistics
+        struct statistics_type
+        {
+          Long64_t     entries;           /// Number of merged entries
+          unsigned int input_files;       /// Number of input files
+          unsigned int fast_cloned_files; /// Number of files copied by fast cloning
+          unsigned int recompressed_files;/// Number of recompressed files
+          unsigned int groups;            /// Number of intermediate groups
+          statistics_type ();
+          void add (const statistics_type &);
+        };
+
+        /// Schema of an exported tree
+        struct schema_type
+        {
+          std::map<std::string, std::string> leaves;   /// Type signature of the branches
+          export_metadata                    metadata; /// File level metadata
+        };
+
+        /// Default constructor
+        export_root_merger ();
+
+        /// Destructor
+        virtual ~export_root_merger ();
+
+        /// Set the name of the tree
+        void set_tree_name (const std::string & tree_name_);
+
+        /// Add an input file
+        void add_input_file (const std::string & filename_);
+
+        /// Set the output file
+        void set_output_file (const std::string & filename_);
+
+        /// Set the number of worker threads
+        void set_number_of_threads (unsigned int nthreads_);
+
+        /// Set the ROOT compression settings of the output (ex: 404 for LZ4 level 4)
+        void set_compression_settings (int compression_);
+
+        /// Set the directory of the intermediate files (default: the output directory)
+        void set_temporary_directory (const std::string & directory_);
+
+        /// Check the schema of the input files
+        void check_schemas () const;
+
+        /// Run the merge
+        void run ();
+
+        /// Return the statistics of the last run
+        const statistics_type & get_statistics () const;
+
+        /// Smart print
+        void print (std::ostream & out_ = std::clog,
+                    const std::string & title_ = "",
+                    const std::string & indent_ = "") const;
+
+        /// Extract the schema of an exported tree
+        static void extract_schema (TTree & tree_, schema_type & schema_);
+
+      protected:
+
+        /// Merge a list of files into an output file
+        void _merge_files (const std::vector<std::string> & inputs_,
+                           const std::string & output_,
+                           int compression_,
+                           statistics_type & statistics_) const;
+
+        /// Build the name of an intermediate file
+        std::string _intermediate_filename (unsigned int group_) const;
+
+      private:
+
+        std::string              _tree_name_;     /// Name of the tree
+        std::vector<std::string> _input_files_;   /// Input files
+        std::string              _output_file_;   /// Output file
+        unsigned int             _number_of_threads_; /// Number of worker threads
+        int                      _compression_;   /// Compression settings of the output
+        std::string              _temporary_directory_; /// Directory of the intermediate files
+        statistics_type          _statistics_;    /// Statistics
+
+      };
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // SNRECONSTRUCTION_EXPORTS_EXPORT_ROOT_MERGER_H
+
+// end of export_root_merger.h
@@ -0,0 +1,847 @@
+// -*- mode: c++ ; -*-
+/* export_root_reader.cc */
+
+#include <falaise/snemo/exports/export_root_reader.h>
+#include <falaise/snemo/exports/event_exporter.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <datatools/exception.h>
+
+#include <camp/userobject.hpp>
+
+#include <TChain.h>
+#include <TTree.h>
+#include <TBranch.h>
+#include <TFile.h>
+#include <TObjArray.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      /// Restore the cell identifiers of a hit from its cell key
+      template<class Type>
+      struct cell_key_decoder
+      {
+        static void decode (Type &) {}
+      };
+
+      template<>
+      struct cell_key_decoder<true_gg_hit_type>
+      {
+        static void decode (true_gg_hit_type & hit_) { hit_.decode_cell_key (); }
+      };
+
+      template<>
+      struct cell_key_decoder<true_scin_hit_type>
+      {
+        static void decode (true_scin_hit_type & hit_) { hit_.decode_cell_key (); }
+      };
+
+      template<>
+      struct cell_key_decoder<calib_tracker_hit_type>
+      {
+        static void decode (calib_tracker_hit_type & hit_) { hit_.decode_cell_key (); }
+      };
+
+      template<>
+      struct cell_key_decoder<calib_calorimeter_hit_type>
+      {
+        static void decode (calib_calorimeter_hit_type & hit_) { hit_.decode_cell_key (); }
+      };
+
+      /// Binding of a bank on a member of the export event
+      struct bank_binder
+      {
+        virtual ~bank_binder () {}
+        /// Check the version of the bank stored in a file
+        virtual bool check_version (int32_t version_) const = 0;
+        /// Resize the bank in an export event
+        virtual void resize (export_event & event_, unsigned int size_) const = 0;
+        /// Return a reference to an element of the bank
+        virtual camp::UserObject element (export_event & event_, unsigned int index_) const = 0;
+        /// Restore the cell identifiers of the elements of the bank from their cell keys
+        virtual void decode_cell_keys (export_event & event_) const = 0;
+      };
+
+      template<class Type>
+      struct scalar_bank_binder : public bank_binder
+      {
+        Type export_event::* member;
+        scalar_bank_binder (Type export_event::* member_) : member (member_) {}
+        virtual bool check_version (int32_t version_) const
+        {
+          return bank_check_export_version<Type> (version_);
+        }
+        virtual void resize (export_event & event_, unsigned int size_) const
+        {
+          (event_.*member).reset ();
+          return;
+        }
+        virtual camp::UserObject element (export_event & event_, unsigned int index_) const
+        {
+          return camp::UserObject (event_.*member);
+        }
+        virtual void decode_cell_keys (export_event & event_) const
+        {
+          cell_key_decoder<Type>::decode (event_.*member);
+          return;
+        }
+      };
+
+      template<class Type>
+      struct array_bank_binder : public bank_binder
+      {
+        std::vector<Type> export_event::* member;
+        array_bank_binder (std::vector<Type> export_event::* member_) : member (member_) {}
+        virtual bool check_version (int32_t version_) const
+        {
+          return bank_check_export_version<Type> (version_);
+        }
+        virtual void resize (export_event & event_, unsigned int size_) const
+        {
+          (event_.*member).assign (size_, Type ());
+          return;
+        }
+        virtual camp::UserObject element (export_event & event_, unsigned int index_) const
+        {
+          return camp::UserObject ((event_.*member)[index_]);
+        }
+        virtual void decode_cell_keys (export_event & event_) const
+        {
+          for (size_t i = 0; i < (event_.*member).size (); i++)
+            {
+              cell_key_decoder<Type>::decode ((event_.*member)[i]);
+            }
+          return;
+        }
+      };
+
+      namespace {
+
+        struct bank_binding_type
+        {
+          std::string                        class_id;
+          boost::shared_ptr<bank_binder>     binder;
+        };
+
+        template<class Type>
+        void add_scalar_binding (std::map<std::string, bank_binding_type> & bindings_,
+                                 const std::string & bank_name_,
+                                 const std::string & class_id_,
+                                 Type export_event::* member_)
+        {
+          bank_binding_type & binding = bindings_[bank_name_];
+          binding.class_id = class_id_;
+          binding.binder.reset (new scalar_bank_binder<Type> (member_));
+          return;
+        }
+
+        template<class Type>
+        void add_array_binding (std::map<std::string, bank_binding_type> & bindings_,
+                                const std::string & bank_name_,
+                                const std::string & class_id_,
+                                std::vector<Type> export_event::* member_)
+        {
+          bank_binding_type & binding = bindings_[bank_name_];
+          binding.class_id = class_id_;
+          binding.binder.reset (new array_bank_binder<Type> (member_));
+          return;
+        }
+
+        /// Return the bindings of the banks built by export_root_event::construct
+        const std::map<std::string, bank_binding_type> & get_bank_bindings ()
+        {
+          static std::map<std::string, bank_binding_type> bindings;
+          if (bindings.empty ())
+            {
+              add_scalar_binding (bindings, "header", "event_header_type", &export_event::event_header);
+              add_array_binding (bindings, "trueVertices", "true_vertex_type", &export_event::true_vertices);
+              add_array_binding (bindings, "trueParticles", "true_particle_type", &export_event::true_particles);
+              add_array_binding (bindings, "trueStepHits", "true_step_hit_type", &export_event::true_step_hits);
+              add_array_binding (bindings, "trueCaloHits", "true_scin_hit_type", &export_event::true_calo_hits);
+              add_array_binding (bindings, "trueXcaloHits", "true_scin_hit_type", &export_event::true_xcalo_hits);
+              add_array_binding (bindings, "trueGvetoHits", "true_scin_hit_type", &export_event::true_gveto_hits);
+              add_array_binding (bindings, "trueScinHits", "true_scin_hit_type", &export_event::true_scin_hits);
+              add_array_binding (bindings, "trueGgHits", "true_gg_hit_type", &export_event::true_gg_hits);
+              add_array_binding (bindings, "calibScinHits", "calib_calorimeter_hit_type", &export_event::calib_scin_hits);
+              add_array_binding (bindings, "calibTrackerHits", "calib_tracker_hit_type", &export_event::calib_gg_hits);
+              add_array_binding (bindings, "trackerClusters", "tracker_cluster_type", &export_event::tracker_clusters);
+              add_array_binding (bindings, "calibTrackerHitsCat", "calib_tracker_hit_cat_type",
+                                 &export_event::calib_gg_hits_cat);
+              add_array_binding (bindings, "trackerClustersCat", "tracker_cluster_cat_type",
+                                 &export_event::tracker_clusters_cat);
+              add_array_binding (bindings, "trackerClusteredHits", "tracker_clustered_hit_type",
+                                 &export_event::tracker_clustered_hits);
+              add_array_binding (bindings, "trackerClusterHitIds", "tracker_hit_ref_type",
+                                 &export_event::tracker_cluster_hit_ids);
+              add_array_binding (bindings, "trackerTrajectories", "tracker_trajectory_type",
+                                 &export_event::tracker_trajectories);
+              add_array_binding (bindings, "trackerTrajectoryOrphanHits", "tracker_trajectory_orphan_hit_type",
+                                 &export_event::tracker_trajectory_orphan_hits);
+              add_array_binding (bindings, "trackerTrajectoryOrphanHitIds", "tracker_hit_ref_type",
+                                 &export_event::tracker_trajectory_orphan_hit_ids);
+              add_array_binding (bindings, "trackerTrajectoryPatterns", "tracker_trajectory_pattern_type",
+                                 &export_event::tracker_trajectory_patterns);
+            }
+          return bindings;
+        }
+
+      }
+
+      // static
+      std::string export_root_reader::get_bank_class_id (const std::string & bank_name_)
+      {
+        const std::map<std::string, bank_binding_type> & bindings = get_bank_bindings ();
+        std::map<std::string, bank_binding_type>::const_iterator found = bindings.find (bank_name_);
+        if (found == bindings.end ())
+          {
+            return "";
+          }
+        return found->second.class_id;
+      }
+
+      export_root_reader::export_root_reader ()
+      {
+        _initialized_ = false;
+        _tree_name_ = "snemodata";
+        _cache_size_ = DEFAULT_CACHE_SIZE;
+        _tree_number_ = -1;
+        _local_entry_ = -1;
+        return;
+      }
+
+      export_root_reader::~export_root_reader ()
+      {
+        if (is_initialized ())
+          {
+            reset ();
+          }
+        return;
+      }
+
+      bool export_root_reader::is_initialized () const
+      {
+        return _initialized_;
+      }
+
+      void export_root_reader::set_tree_name (const std::string & tree_name_)
+      {
+        DT_THROW_IF (is_initialized (), std::logic_error, "Reader is already initialized !");
+        _tree_name_ = tree_name_;
+        return;
+      }
+
+      void export_root_reader::add_file (const std::string & filename_)
+      {
+        DT_THROW_IF (is_initialized (), std::logic_error, "Reader is already initialized !");
+        _filenames_.push_back (filename_);
+        return;
+      }
+
+      void export_root_reader::select_bank (const std::string & bank_name_)
+      {
+        DT_THROW_IF (is_initialized (), std::logic_error, "Reader is already initialized !");
+        _selected_banks_.insert (bank_name_);
+        return;
+      }
+
+      void export_root_reader::select_topic (const std::string & topic_)
+      {
+        DT_THROW_IF (is_initialized (), std::logic_error, "Reader is already initialized !");
+        _selected_topics_.insert (topic_);
+        return;
+      }
+
+      void export_root_reader::set_cache_size (Long64_t cache_size_)
+      {
+        DT_THROW_IF (is_initialized (), std::logic_error, "Reader is already initialized !");
+        _cache_size_ = cache_size_;
+        return;
+      }
+
+      void export_root_reader::initialize ()
+      {
+        DT_LOG_TRACE (get_logging_priority (), "Entering...");
+        DT_THROW_IF (is_initialized (), std::logic_error, "Reader is already initialized !");
+        DT_THROW_IF (_filenames_.empty (), std::logic_error, "Missing input files !");
+        _chain_.reset (new TChain (_tree_name_.c_str ()));
+        for (size_t i = 0; i < _filenames_.size (); i++)
+          {
+            DT_THROW_IF (_chain_->Add (_filenames_[i].c_str (), 0) == 0, std::runtime_error,
+                         "Cannot find tree '" << _tree_name_ << "' in file '" << _filenames_[i] << "' !");
+          }
+        DT_THROW_IF (_chain_->LoadTree (0) < 0, std::runtime_error, "Input files have no entry !");
+        _discover_banks ();
+        _setup_branches ();
+        _initialized_ = true;
+        DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+        return;
+      }
+
+      void export_root_reader::reset ()
+      {
+        DT_THROW_IF (! is_initialized (), std::logic_error, "Reader is not initialized !");
+        _initialized_ = false;
+        _works_.clear ();
+        _branch_manager_.reset ();
+        _banks_.clear ();
+        _metadata_.reset ();
+        _chain_.reset (0);
+        _tree_number_ = -1;
+        _local_entry_ = -1;
+        _filenames_.clear ();
+        _selected_banks_.clear ();
+        _selected_topics_.clear ();
+        return;
+      }
+
+      Long64_t export_root_reader::get_number_of_entries () const
+      {
+        DT_THROW_IF (! is_initialized (), std::logic_error, "Reader is not initialized !");
+        return _chain_->GetEntries ();
+      }
+
+      const std::vector<export_root_reader::bank_info_type> & export_root_reader::get_banks () const
+      {
+        return _banks_;
+      }
+
+      const export_metadata & export_root_reader::get_metadata () const
+      {
+        return _metadata_;
+      }
+
+      bool export_root_reader::has_bank (const std::string & bank_name_) const
+      {
+        for (size_t i = 0; i < _banks_.size (); i++)
+          {
+            if (_banks_[i].name == bank_name_) return true;
+          }
+        return false;
+      }
+
+      const export_root_reader::bank_info_type &
+      export_root_reader::get_bank (const std::string & bank_name_) const
+      {
+        for (size_t i = 0; i < _banks_.size (); i++)
+          {
+            if (_banks_[i].name == bank_name_) return _banks_[i];
+          }
+        DT_THROW_IF (true, std::logic_error, "No bank named '" << bank_name_ << "' !");
+        return _banks_.front ();
+      }
+
+      void export_root_reader::_discover_banks ()
+      {
+        const std::map<std::string, bank_binding_type> & bindings = get_bank_bindings ();
+        DT_THROW_IF (! _metadata_.load (*_chain_->GetTree ()), std::runtime_error,
+                     "No export metadata in file '" << _chain_->GetFile ()->GetName () << "' !");
+        if (_metadata_.is_legacy ())
+          {
+            DT_LOG_DEBUG (get_logging_priority (), "Bank versions are read from legacy '@version' branches.");
+          }
+        for (size_t ibank = 0; ibank < _metadata_.banks.size (); ibank++)
+          {
+            const export_metadata::bank_type & md_bank = _metadata_.banks[ibank];
+            bank_info_type bank;
+            bank.name = md_bank.name;
+            std::map<std::string, bank_binding_type>::const_iterator found = bindings.find (bank.name);
+            if (found == bindings.end ())
+              {
+                DT_LOG_WARNING (get_logging_priority (), "Unknown bank '" << bank.name << "' is ignored !");
+                continue;
+              }
+            bank.class_id = found->second.class_id;
+            DT_THROW_IF (! md_bank.class_id.empty () && md_bank.class_id != bank.class_id, std::logic_error,
+                         "Bank '" << bank.name << "' was exported from class '" << md_bank.class_id
+                         << "' instead of '" << bank.class_id << "' !");
+            bank.array = md_bank.array;
+            bank.version = md_bank.version;
+            DT_THROW_IF (! found->second.binder->check_version (bank.version), std::logic_error,
+                         "Bank '" << bank.name << "' has version " << bank.version
+                         << " which is not supported by class '" << bank.class_id << "' !");
+            bank.selected = _selected_banks_.empty () || _selected_banks_.count (bank.name);
+            // Sub-banks of a topic (ex: sparse CAT banks) are read with their topic :
+            const camp::Class & bank_class = camp::classByName (bank.class_id);
+            if (bank.selected && ! _selected_banks_.count (bank.name) && bank_class.hasTag ("topic"))
+              {
+                bank.selected = _selected_topics_.count (bank_class.tag ("topic").to<std::string> ());
+              }
+            DT_LOG_DEBUG (get_logging_priority (), "Found bank '" << bank.name << "' (version "
+                          << bank.version << ")" << (bank.selected ? " : selected" : ""));
+            _banks_.push_back (bank);
+          }
+        for (std::set<std::string>::const_iterator i = _selected_banks_.begin ();
+             i != _selected_banks_.end ();
+             i++)
+          {
+            DT_THROW_IF (! has_bank (*i), std::logic_error,
+                         "Selected bank '" << *i << "' is not available in the input files !");
+          }
+        return;
+      }
+
+      void export_root_reader::_setup_branches ()
+      {
+        const std::map<std::string, bank_binding_type> & bindings = get_bank_bindings ();
+        for (std::set<std::string>::const_iterator i = _selected_topics_.begin ();
+             i != _selected_topics_.end ();
+             i++)
+          {
+            _branch_manager_.add_topic (*i, event_exporter::EXPORT_TOPIC_INCLUDE);
+          }
+        // The membership offsets are needed to expand the flat hit IDs :
+        _branch_manager_.set_offset_memberships (_metadata_.has_layout_flag ("offset_memberships"));
+        // The row indexes are read whenever the files have them :
+        _branch_manager_.set_row_indexes (_metadata_.has_layout_flag ("row_indexes"));
+
+        // Cell keys and cell identifiers are read if available :
+        _branch_manager_.set_cell_keys (true);
+        _branch_manager_.set_cell_ids (true);
+
+        // Boolean leaves are read from bitfield branches if the files were produced so :
+        _branch_manager_.set_pack_bitfields (! _metadata_.bitfields.empty ());
+
+
+        // Nullable leaves are read with their counter and validity bitmap :
+        _branch_manager_.set_null_bitmaps (! _metadata_.nullables.empty ());
+
+        // Leaves stored in multi-leaf branches :
+        std::map<std::string, std::string> leaf_groups;
+        for (std::map<std::string, std::vector<std::string> >::const_iterator i = _metadata_.leaflists.begin ();
+             i != _metadata_.leaflists.end ();
+             i++)
+          {
+            for (size_t j = 0; j < i->second.size (); j++)
+              {
+                leaf_groups[i->second[j]] = i->first;
+              }
+          }
+
+        // Only the selected branches are read :
+        _chain_->SetBranchStatus ("*", 0);
+        const unsigned int store_bit = 0x1;
+        std::vector<std::string> active_branches;
+        for (size_t ibank = 0; ibank < _banks_.size (); ibank++)
+          {
+            const bank_info_type & bank = _banks_[ibank];
+            if (! bank.selected) continue;
+            // Leaves constant within an event are broadcast to all the elements of their bank
+            // (not all banks of a class hoist them, ex: the unified 'trueScinHits' bank) :
+            bool hoist = false;
+            for (std::map<std::string, std::string>::const_iterator i = _metadata_.scopes.begin ();
+                 i != _metadata_.scopes.end ();
+                 i++)
+              {
+                if (boost::starts_with (i->first, bank.name + '.')) hoist = true;
+              }
+            _branch_manager_.set_hoist_event_constants (hoist);
+            _branch_manager_.init_bank_from_camp (bank.name, store_bit, bank.version, bank.class_id, bank.array);
+            const camp::Class & bank_class = camp::classByName (bank.class_id);
+            bank_work_type work;
+            work.info = &bank;
+            work.binder = bindings.find (bank.name)->second.binder.get ();
+            work.size.entry = 0;
+            work.size.branch = 0;
+            work.validity = -1;
+            if (bank.array)
+              {
+                const std::string size_name = bank.name + "@size";
+                work.size.entry = &_branch_manager_.grab_branch (size_name);
+                work.size.entry->as<UInt_t> ().set_value (0);
+                _activate_leaf (*work.size.entry, leaf_groups, active_branches);
+              }
+            bool has_cell_key = false;
+            bool has_cell_ids = false;
+            branch_manager::bi_col_type & bis = _branch_manager_.grab_branch_infos ();
+            for (size_t i = 0; i < bis.size (); i++)
+              {
+                branch_entry_type & be = *(bis[i]);
+                if (be.get_parent_name () != bank.name) continue;
+                if (be.is_inhibited ()) continue;
+                // The counters are read with their nullable or event scope leaf :
+                if (be.is_leaf_counter ()) continue;
+                if (! leaf_groups.count (be.get_name ())
+                    && _chain_->GetBranch (be.get_name ().c_str ()) == 0)
+                  {
+                    DT_LOG_DEBUG (get_logging_priority (), "Branch '" << be.get_name ()
+                                  << "' was not exported in the input files.");
+                    continue;
+                  }
+                if (! be.is_array ())
+                  {
+                    be.set_branch_value (camp::Value (0));
+                  }
+                leaf_type leaf;
+                leaf.entry = &be;
+                leaf.branch = 0;
+                leaf.counter = 0;
+                leaf.counter_branch = 0;
+                leaf.null_bit = -1;
+                if (be.is_nullable () || be.is_event_scope ())
+                  {
+                    leaf.counter = &_branch_manager_.grab_branch (be.get_array_size_name ());
+                    leaf.counter->as<UInt_t> ().set_value (0);
+                    _activate_leaf (*leaf.counter, leaf_groups, active_branches);
+                  }
+                work.leaves.push_back (leaf);
+                std::vector<const camp::Property *> members;
+                if (be.is_validity_bitmap ())
+                  {
+                    // Not bound to any property : used to place the nullable values
+                    work.validity = work.leaves.size () - 1;
+                    work.props.push_back (0);
+                  }
+                else if (be.is_bitfield ())
+                  {
+                    const std::vector<std::string> & member_names = be.get_bitfield_members ();
+                    for (size_t imember = 0; imember < member_names.size (); imember++)
+                      {
+                        members.push_back (&bank_class.property (member_names[imember]));
+                      }
+                    work.props.push_back (0);
+                  }
+                else
+                  {
+                    work.props.push_back (&bank_class.property (be.get_leaf_name ()));
+                  }
+                work.members.push_back (members);
+                if (work.props.back () != 0)
+                  {
+                    has_cell_key |= work.props.back ()->hasTag ("cell_key");
+                    has_cell_ids |= work.props.back ()->hasTag ("cell_id");
+                  }
+                _activate_leaf (be, leaf_groups, active_branches);
+              }
+            // The cell identifiers are decoded if only the cell keys were exported :
+            work.decode_cell_keys = has_cell_key && ! has_cell_ids;
+            if (work.validity >= 0)
+              {
+                const branch_entry_type & be_valid = *work.leaves[work.validity].entry;
+                for (size_t i = 0; i < work.leaves.size (); i++)
+                  {
+                    if (! work.leaves[i].entry->is_nullable ()) continue;
+                    work.leaves[i].null_bit = be_valid.get_bitfield_rank (work.leaves[i].entry->get_leaf_name ());
+                  }
+              }
+            _works_.push_back (work);
+          }
+        for (size_t i = 0; i < active_branches.size (); i++)
+          {
+            _chain_->SetBranchStatus (active_branches[i].c_str (), 1);
+          }
+
+        // The cache is restricted to the selected branches :
+        if (_cache_size_ > 0)
+          {
+            _chain_->SetCacheSize (_cache_size_);
+            for (size_t i = 0; i < active_branches.size (); i++)
+              {
+                _chain_->AddBranchToCache (active_branches[i].c_str (), kFALSE);
+              }
+            _chain_->StopCacheLearningPhase ();
+          }
+        DT_LOG_DEBUG (get_logging_priority (), "Number of active branches : " << active_branches.size ());
+        return;
+      }
+
+      void export_root_reader::_activate_leaf (branch_entry_type & entry_,
+                                               const std::map<std::string, std::string> & leaf_groups_,
+                                               std::vector<std::string> & active_branches_)
+      {
+        std::map<std::string, std::string>::const_iterator found = leaf_groups_.find (entry_.get_name ());
+        if (found == leaf_groups_.end ())
+          {
+            active_branches_.push_back (entry_.get_name ());
+            return;
+          }
+        // The leaf is read with its multi-leaf branch :
+        if (! entry_.is_grouped ())
+          {
+            _branch_manager_.add_to_group (found->second, entry_);
+          }
+        if (std::find (active_branches_.begin (), active_branches_.end (), found->second)
+            == active_branches_.end ())
+          {
+            active_branches_.push_back (found->second);
+          }
+        return;
+      }
+
+      void export_root_reader::_update_tree ()
+      {
+        TTree * tree = _chain_->GetTree ();
+        {
+          // All files must have been produced with the same export configuration :
+          export_metadata metadata;
+          std::string reason;
+          DT_THROW_IF (! metadata.load (*tree) || ! _metadata_.is_compatible (metadata, reason),
+                       std::logic_error,
+                       "File '" << _chain_->GetFile ()->GetName () << "' is not compatible with file '"
+                       << _filenames_.front () << "' : " << reason << " !");
+        }
+        branch_manager::group_col_type & groups = _branch_manager_.grab_groups ();
+        for (size_t i = 0; i < groups.size (); i++)
+          {
+            groups[i]->bind_branch (tree->GetBranch (groups[i]->get_name ().c_str ()));
+          }
+        for (size_t iwork = 0; iwork < _works_.size (); iwork++)
+          {
+            bank_work_type & work = _works_[iwork];
+            if (work.size.entry != 0 && ! work.size.entry->is_grouped ())
+              {
+                work.size.branch = tree->GetBranch (work.size.entry->get_name ().c_str ());
+                work.size.branch->SetAddress (work.size.entry->get_address ());
+              }
+            for (size_t i = 0; i < work.leaves.size (); i++)
+              {
+                if (work.leaves[i].entry->is_grouped ()) continue;
+                work.leaves[i].branch = tree->GetBranch (work.leaves[i].entry->get_name ().c_str ());
+                DT_THROW_IF (work.leaves[i].branch == 0, std::runtime_error,
+                             "Branch '" << work.leaves[i].entry->get_name () << "' is missing in file '"
+                             << _chain_->GetFile ()->GetName () << "' !");
+                if (work.leaves[i].counter != 0 && ! work.leaves[i].counter->is_grouped ())
+                  {
+                    work.leaves[i].counter_branch = tree->GetBranch (work.leaves[i].counter->get_name ().c_str ());
+                    DT_THROW_IF (work.leaves[i].counter_branch == 0, std::runtime_error,
+                                 "Branch '" << work.leaves[i].counter->get_name () << "' is missing in file '"
+                                 << _chain_->GetFile ()->GetName () << "' !");
+                    work.leaves[i].counter_branch->SetAddress (work.leaves[i].counter->get_address ());
+                  }
+              }
+          }
+        _tree_number_ = _chain_->GetTreeNumber ();
+        return;
+      }
+
+      bool export_root_reader::load_entry (Long64_t entry_)
+      {
+        DT_THROW_IF (! is_initialized (), std::logic_error, "Reader is not initialized !");
+        const Long64_t local_entry = _chain_->LoadTree (entry_);
+        if (local_entry < 0)
+          {
+            return false;
+          }
+        if (_chain_->GetTreeNumber () != _tree_number_)
+          {
+            _update_tree ();
+          }
+        branch_manager::group_col_type & groups = _branch_manager_.grab_groups ();
+        for (size_t i = 0; i < groups.size (); i++)
+          {
+            groups[i]->get_branch ()->GetEntry (local_entry);
+            groups[i]->unpack ();
+          }
+        for (size_t iwork = 0; iwork < _works_.size (); iwork++)
+          {
+            bank_work_type & work = _works_[iwork];
+            unsigned int size = 1;
+            if (work.size.entry != 0)
+              {
+                if (work.size.branch != 0) work.size.branch->GetEntry (local_entry);
+                size = work.size.entry->as<UInt_t> ().get_value ();
+              }
+            for (size_t i = 0; i < work.leaves.size (); i++)
+              {
+                leaf_type & leaf = work.leaves[i];
+                if (leaf.entry->is_array ())
+                  {
+                    unsigned int array_size
+                      = leaf.entry->has_fixed_size () ? leaf.entry->get_array_fixed_size () : size;
+                    if (leaf.counter != 0)
+                      {
+                        // Only the non missing values of a nullable leaf are stored,
+                        // and a single value of an event scope leaf constant within the event :
+                        if (leaf.counter_branch != 0) leaf.counter_branch->GetEntry (local_entry);
+                        array_size = leaf.counter->as<UInt_t> ().get_value ();
+                      }
+                    if (array_size == 0) continue;
+                    leaf.entry->set_size (array_size);
+                  }
+                // The grouped leaves have been read with their multi-leaf branch :
+                if (leaf.branch == 0) continue;
+                // The storage may have been reallocated by the resize :
+                leaf.branch->SetAddress (leaf.entry->get_address ());
+                leaf.branch->GetEntry (local_entry);
+              }
+          }
+        _local_entry_ = local_entry;
+        return true;
+      }
+
+      void export_root_reader::fill_event (export_event & event_) const
+      {
+        DT_THROW_IF (_local_entry_ < 0, std::logic_error, "No entry has been loaded !");
+        event_.clear_data ();
+        for (size_t iwork = 0; iwork < _works_.size (); iwork++)
+          {
+            const bank_work_type & work = _works_[iwork];
+            unsigned int size = 1;
+            if (work.size.entry != 0)
+              {
+                size = work.size.entry->as<UInt_t> ().get_value ();
+              }
+            work.binder->resize (event_, size);
+            // Ranks of the next stored values of the nullable leaves :
+            std::vector<unsigned int> next_values (work.leaves.size (), 0);
+            for (unsigned int index = 0; index < size; index++)
+              {
+                camp::UserObject element = work.binder->element (event_, index);
+                uint32_t valid_bits = 0;
+                if (work.validity >= 0)
+                  {
+                    valid_bits = work.leaves[work.validity].entry->get_branch_value (index).to<uint32_t> ();
+                  }
+                for (size_t i = 0; i < work.leaves.size (); i++)
+                  {
+                    const branch_entry_type & be = *work.leaves[i].entry;
+                    const int null_bit = work.leaves[i].null_bit;
+                    if (be.is_nullable ())
+                      {
+                        if (null_bit >= 0 && ((valid_bits >> null_bit) & 0x1))
+                          {
+                            work.props[i]->set (element, be.get_branch_value (next_values[i]++));
+                          }
+                        else
+                          {
+                            work.props[i]->set (element, branch_entry_type::get_null_value (be.get_type ()));
+                          }
+                        continue;
+                      }
+                    unsigned int rank = be.is_array () ? index : 0;
+                    if (be.is_event_scope () && work.leaves[i].counter->as<UInt_t> ().get_value () == 1)
+                      {
+                        // The value constant within the event is broadcast to all the elements :
+                        rank = 0;
+                      }
+                    if (work.props[i] != 0)
+                      {
+                        work.props[i]->set (element, be.get_branch_value (rank));
+                        continue;
+                      }
+                    const uint32_t bits = be.get_branch_value (rank).to<uint32_t> ();
+                    const std::vector<const camp::Property *> & members = work.members[i];
+                    for (size_t imember = 0; imember < members.size (); imember++)
+                      {
+                        members[imember]->set (element, camp::Value ((bits >> imember) & 0x1 ? true : false));
+                      }
+                  }
+              }
+            if (work.decode_cell_keys)
+              {
+                work.binder->decode_cell_keys (event_);
+              }
+          }
+        // The CAT informations stored in sparse banks are restored in their parents :
+        event_.expand_cat_banks ();
+        // The member rows are rebuilt from the offsets of their parents :
+        event_.expand_membership_banks ();
+        return;
+      }
+
+      bool export_root_reader::get_flag (const std::string & bank_name_,
+                                         const std::string & leaf_name_,
+                                         unsigned int index_) const
+      {
+        DT_THROW_IF (_local_entry_ < 0, std::logic_error, "No entry has been loaded !");
+        for (size_t iwork = 0; iwork < _works_.size (); iwork++)
+          {
+            const bank_work_type & work = _works_[iwork];
+            if (work.info->name != bank_name_) continue;
+            if (work.size.entry != 0)
+              {
+                const unsigned int size = work.size.entry->as<UInt_t> ().get_value ();
+                DT_THROW_IF (index_ >= size, std::range_error,
+                             "Invalid index " << index_ << " in bank '" << bank_name_ << "' !");
+              }
+            for (size_t i = 0; i < work.leaves.size (); i++)
+              {
+                const branch_entry_type & be = *work.leaves[i].entry;
+                unsigned int rank = be.is_array () ? index_ : 0;
+                if (be.is_event_scope () && work.leaves[i].counter->as<UInt_t> ().get_value () == 1)
+                  {
+                    rank = 0;
+                  }
+                if (be.is_validity_bitmap ()) continue;
+                if (be.is_bitfield ())
+                  {
+                    const int bit = be.get_bitfield_rank (leaf_name_);
+                    if (bit < 0) continue;
+                    return (be.get_branch_value (rank).to<uint32_t> () >> bit) & 0x1;
+                  }
+                if (be.get_leaf_name () == leaf_name_)
+                  {
+                    return be.get_branch_value (rank).to<bool> ();
+                  }
+              }
+            DT_THROW_IF (true, std::logic_error,
+                         "No boolean leaf '" << leaf_name_ << "' in bank '" << bank_name_ << "' !");
+          }
+        DT_THROW_IF (true, std::logic_error, "Bank '" << bank_name_ << "' is not selected !");
+        return false;
+      }
+
+      bool export_root_reader::read_entry (Long64_t entry_, export_event & event_)
+      {
+        if (! load_entry (entry_))
+          {
+            return false;
+          }
+        fill_event (event_);
+        return true;
+      }
+
+      const void * export_root_reader::_get_column_address (const std::string & branch_name_,
+                                                            int type_,
+                                                            unsigned int & size_)
+      {
+        DT_THROW_IF (_local_entry_ < 0, std::logic_error, "No entry has been loaded !");
+        DT_THROW_IF (! _branch_manager_.has_branch (branch_name_), std::logic_error,
+                     "Branch '" << branch_name_ << "' is not selected !");
+        branch_entry_type & be = _branch_manager_.grab_branch (branch_name_);
+        DT_THROW_IF (be.get_type () != type_, std::logic_error,
+                     "Branch '" << branch_name_ << "' has type '"
+                     << branch_entry_type::get_branch_type_label (be.get_type ()) << "' !");
+        size_ = _branch_manager_.get_array_size (be);
+        return be.get_address ();
+      }
+
+      void export_root_reader::print (std::ostream & out_,
+                                      const std::string & title_,
+                                      const std::string & indent_) const
+      {
+        if (! title_.empty ())
+          {
+            out_ << indent_ << title_ << ": \n";
+          }
+        out_ << indent_ << "|-- " << "Initialized : " << is_initialized () << "\n";
+        out_ << indent_ << "|-- " << "Tree name   : '" << _tree_name_ << "'\n";
+        out_ << indent_ << "|-- " << "Files       : " << _filenames_.size () << "\n";
+        out_ << indent_ << "|-- " << "Cache size  : " << _cache_size_ << "\n";
+        out_ << indent_ << "`-- " << "Banks       : " << _banks_.size () << "\n";
+        for (size_t i = 0; i < _banks_.size (); i++)
+          {
+            const bank_info_type & bank = _banks_[i];
+            out_ << indent_ << "    " << ((i + 1 == _banks_.size ()) ? "`-- " : "|-- ")
+                 << "'" << bank.name << "' (" << bank.class_id << ", version " << bank.version
+                 << (bank.array ? ", array" : "") << (bank.selected ? ", selected" : "") << ")\n";
+          }
+        return;
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of export_root_reader.cc
@@ -0,0 +1,228 @@
+// -*- mode: c++ ; -*-
+/* export_root_reader.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Typed reader of the ROOT files produced by the export_root_module
+ *
+ *   The banks stored in the files are discovered from the file level
+ *   metadata (or the legacy '@version' branches) and their versions are
+ *   checked against the export versions of the compiled classes. Only the selected
+ *   banks (and topics) are activated in the tree and registered in the
+ *   TTreeCache so that reading a single bank only costs its own I/O.
+ *
+ *   Boolean leaves packed in bitfield branches are unpacked in the export
+ *   event; the 'get_flag' accessor reads them from the loaded entry. The cell
+ *   identifiers of the hits are decoded from the packed cell keys when
+ *   only the latter were exported.
+ *
+ *   Usage :
+ *
+ *     export_root_reader reader;
+ *     reader.add_file ("run_1.root");
+ *     reader.select_bank ("calibTrackerHits");
+ *     reader.initialize ();
+ *     export_event event;
+ *     for (Long64_t i = 0; i < reader.get_number_of_entries (); i++) {
+ *       reader.read_entry (i, event);
+ *       ...
+ *     }
+ *
+ * History:
+ *
+ */
+
+#ifndef SNRECONSTRUCTION_EXPORTS_EXPORT_ROOT_READER_H
+#define SNRECONSTRUCTION_EXPORTS_EXPORT_ROOT_READER_H 1
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <iostream>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <falaise/snemo/exports/export_event.h>
+#include <falaise/snemo/exports/export_metadata.h>
+#include <falaise/snemo/exports/root_utils.h>
+#include <falaise/snemo/exports/loggable_support.h>
+#include <falaise/snemo/exports/native_columnar_format.h>
+
+class TChain;
+class TBranch;
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      struct bank_binder;
+
+      /// \brief Reader of exported ROOT files
+      class export_root_reader : public loggable_support
+      {
+      public:
+
+        static const Long64_t DEFAULT_CACHE_SIZE = 10000000; // 10 MB
+
+        /// Description of a bank found in the input files
+        struct bank_info_type
+        {
+          std::string name;       /// Name of the bank (ex: "calibTrackerHits")
+          std::string class_id;   /// CAMP class identifier (ex: "calib_tracker_hit_type")
+          bool        array;      /// Array flag
+          int32_t     version;    /// Export version of the bank
+          bool        selected;   /// Selection flag
+        };
+
+        /// Return the CAMP class identifier of a known bank (empty if unknown)
+        static std::string get_bank_class_id (const std::string & bank_name_);
+
+        /// Default constructor
+        export_root_reader ();
+
+        /// Destructor
+        virtual ~export_root_reader ();
+
+        /// Set the name of the tree
+        void set_tree_name (const std::string & tree_name_);
+
+        /// Add an input file
+        void add_file (const std::string & filename_);
+
+        /// Select a bank to be read (all banks are read if none is selected)
+        void select_bank (const std::string & bank_name_);
+
+        /// Select a topic to be read (ex: "CAT")
+        void select_topic (const std::string & topic_);
+
+        /// Set the size of the TTreeCache (0 : no cache)
+        void set_cache_size (Long64_t cache_size_);
+
+        /// Open the files, discover the banks and activate the selected branches
+        void initialize ();
+
+        /// Close the files
+        void reset ();
+
+        /// Check initialization flag
+        bool is_initialized () const;
+
+        /// Return the total number of entries
+        Long64_t get_number_of_entries () const;
+
+        /// Return the banks found in the input files
+        const std::vector<bank_info_type> & get_banks () const;
+
+        /// Return the metadata of the first input file
+        const export_metadata & get_metadata () const;
+
+        /// Check if a bank is available in the input files
+        bool has_bank (const std::string & bank_name_) const;
+
+        /// Return the description of a bank
+        const bank_info_type & get_bank (const std::string & bank_name_) const;
+
+        /// Load the selected branches of a given entry in the reader memory
+        bool load_entry (Long64_t entry_);
+
+        /// Copy the loaded banks in an export event
+        void fill_event (export_event & event_) const;
+
+        /// Load a given entry and copy it in an export event
+        bool read_entry (Long64_t entry_, export_event & event_);
+
+        /// Return a boolean leaf of the loaded entry, whether it is packed in a bitfield or not
+        /// (ex: get_flag ("calibTrackerHits", "delayed", 3))
+        bool get_flag (const std::string & bank_name_,
+                       const std::string & leaf_name_,
+                       unsigned int index_ = 0) const;
+
+        /// Return a typed view on the loaded values of a branch (ex: "calibTrackerHits.x")
+        template<class T>
+        column_span<T> get_column (const std::string & branch_name_);
+
+        /// Smart print
+        void print (std::ostream & out_ = std::clog,
+                    const std::string & title_ = "",
+                    const std::string & indent_ = "") const;
+
+      protected:
+
+        void _discover_banks ();
+
+        void _setup_branches ();
+
+        /// Activate the branch of a leaf (its multi-leaf branch if it is grouped in the files)
+        void _activate_leaf (branch_entry_type & entry_,
+                             const std::map<std::string, std::string> & leaf_groups_,
+                             std::vector<std::string> & active_branches_);
+
+        void _update_tree ();
+
+        const void * _get_column_address (const std::string & branch_name_,
+                                          int type_,
+                                          unsigned int & size_);
+
+      private:
+
+        /// Branch of the input tree associated to a branch entry
+        struct leaf_type
+        {
+          branch_entry_type * entry;  /// Memory of the branch
+          TBranch *           branch; /// Current branch in the input tree
+          branch_entry_type * counter;        /// Memory of the counter of a nullable or event scope leaf (0 : none)
+          TBranch *           counter_branch; /// Current counter branch in the input tree
+          int                 null_bit;       /// Rank of a nullable leaf in the validity bitmap (-1 : none)
+        };
+
+        /// Working data of a selected bank
+        struct bank_work_type
+        {
+          const bank_info_type *    info;   /// Description of the bank
+          const bank_binder *       binder; /// Binding on the export event members
+          leaf_type                 size;   /// Size branch (array banks)
+          std::vector<leaf_type>    leaves; /// Leaf branches
+          std::vector<const camp::Property *> props; /// CAMP properties of the leaves (0 for bitfields)
+          std::vector<std::vector<const camp::Property *> > members; /// CAMP properties of the bitfield members
+          bool                      decode_cell_keys; /// Flag to decode the cell identifiers from the cell keys
+          int                       validity; /// Index of the validity bitmap in the leaves (-1 : none)
+        };
+
+        bool                        _initialized_;   /// Initialization flag
+        std::string                 _tree_name_;     /// Name of the tree
+        std::vector<std::string>    _filenames_;     /// Input files
+        std::set<std::string>       _selected_banks_;  /// Selected banks
+        std::set<std::string>       _selected_topics_; /// Selected topics
+        Long64_t                    _cache_size_;    /// Size of the TTreeCache
+        boost::scoped_ptr<TChain>   _chain_;         /// Input chain
+        int                         _tree_number_;   /// Index of the current tree in the chain
+        Long64_t                    _local_entry_;   /// Index of the loaded entry in the current tree
+        export_metadata             _metadata_;      /// Metadata of the first input file
+        std::vector<bank_info_type> _banks_;         /// Banks found in the input files
+        branch_manager              _branch_manager_;  /// Memory of the selected branches
+        std::vector<bank_work_type> _works_;         /// Working data of the selected banks
+
+      };
+
+      template<class T>
+      column_span<T> export_root_reader::get_column (const std::string & branch_name_)
+      {
+        unsigned int size = 0;
+        const void * address = _get_column_address (branch_name_, native_column_traits<T>::type, size);
+        return column_span<T> (static_cast<const T *>(address), size);
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // SNRECONSTRUCTION_EXPORTS_EXPORT_ROOT_READER_H
+
+// end of export_root_reader.h
@@ -0,0 +1,446 @@
+// -*- mode: c++ ; -*-
+/* export_root_skimmer.cc */
+
+#include <falaise/snemo/exports/export_root_skimmer.h>
+#include <falaise/snemo/exports/export_root_reader.h>
+#include <falaise/snemo/exports/export_metadata.h>
+
+#include <fnmatch.h>
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <datatools/exception.h>
+
+#include <camp/class.hpp>
+#include <camp/classget.hpp>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TBranch.h>
+#include <TLeaf.h>
+#include <TObjArray.h>
+#include <TTreeFormula.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      export_root_skimmer::statistics_type::statistics_type ()
+      {
+        input_entries = 0;
+        output_entries = 0;
+        fast_cloned_files = 0;
+        dropped_branches = 0;
+        return;
+      }
+
+      export_root_skimmer::export_root_skimmer ()
+      {
+        _tree_name_ = "snemodata";
+        return;
+      }
+
+      export_root_skimmer::~export_root_skimmer ()
+      {
+        return;
+      }
+
+      void export_root_skimmer::set_tree_name (const std::string & tree_name_)
+      {
+        _tree_name_ = tree_name_;
+        return;
+      }
+
+      void export_root_skimmer::add_input_file (const std::string & filename_)
+      {
+        _input_files_.push_back (filename_);
+        return;
+      }
+
+      void export_root_skimmer::set_output_file (const std::string & filename_)
+      {
+        _output_file_ = filename_;
+        return;
+      }
+
+      void export_root_skimmer::drop_bank (const std::string & bank_name_)
+      {
+        _dropped_banks_.insert (bank_name_);
+        return;
+      }
+
+      void export_root_skimmer::drop_topic (const std::string & topic_)
+      {
+        _dropped_topics_.insert (topic_);
+        return;
+      }
+
+      void export_root_skimmer::drop_branches (const std::string & pattern_)
+      {
+        _dropped_patterns_.push_back (pattern_);
+        return;
+      }
+
+      void export_root_skimmer::select_event (int32_t run_number_, int32_t event_number_)
+      {
+        _event_list_.insert (std::make_pair (run_number_, event_number_));
+        return;
+      }
+
+      void export_root_skimmer::load_event_list (const std::string & filename_)
+      {
+        std::ifstream list (filename_.c_str ());
+        DT_THROW_IF (! list, std::runtime_error, "Cannot open event list file '" << filename_ << "' !");
+        std::string line;
+        while (std::getline (list, line))
+          {
+            if (line.empty () || line[0] == '#') continue;
+            std::istringstream line_iss (line);
+            int32_t run_number;
+            int32_t event_number;
+            line_iss >> run_number >> event_number;
+            DT_THROW_IF (! line_iss, std::logic_error,
+                         "Invalid line '" << line << "' in event list file '" << filename_ << "' !");
+            select_event (run_number, event_number);
+          }
+        DT_LOG_DEBUG (get_logging_priority (), "Event list has " << _event_list_.size () << " events.");
+        return;
+      }
+
+      void export_root_skimmer::set_predicate (const std::string & predicate_)
+      {
+        _predicate_ = predicate_;
+        return;
+      }
+
+      bool export_root_skimmer::has_entry_selection () const
+      {
+        return ! _event_list_.empty () || ! _predicate_.empty ();
+      }
+
+      const export_root_skimmer::statistics_type & export_root_skimmer::get_statistics () const
+      {
+        return _statistics_;
+      }
+
+      bool export_root_skimmer::is_dropped (const std::string & branch_name_) const
+      {
+        const std::string bank_name = branch_name_.substr (0, branch_name_.find_first_of (".@"));
+        if (_dropped_banks_.count (bank_name))
+          {
+            return true;
+          }
+        for (size_t i = 0; i < _dropped_patterns_.size (); i++)
+          {
+            if (fnmatch (_dropped_patterns_[i].c_str (), branch_name_.c_str (), 0) == 0)
+              {
+                return true;
+              }
+          }
+        if (! _dropped_topics_.empty ())
+          {
+            const std::size_t dot = branch_name_.find ('.');
+            if (dot == std::string::npos) return false;
+            const std::string class_id = export_root_reader::get_bank_class_id (bank_name);
+            if (class_id.empty ()) return false;
+            const camp::Class & bank_class = camp::classByName (class_id);
+            if (bank_class.hasTag ("topic")
+                && _dropped_topics_.count (bank_class.tag ("topic").to<std::string> ()))
+              {
+                return true;
+              }
+            const std::string leaf_name = branch_name_.substr (dot + 1);
+            const camp::Property * leaf_prop_ptr = 0;
+            if (bank_class.hasProperty (leaf_name))
+              {
+                leaf_prop_ptr = &bank_class.property (leaf_name);
+              }
+            else
+              {
+                // A bitfield branch has the topic of its members :
+                for (std::size_t iprop = 0; iprop < bank_class.propertyCount (); iprop++)
+                  {
+                    const camp::Property & prop = bank_class.property (iprop);
+                    if (prop.hasTag ("bitfield")
+                        && prop.tag ("bitfield").to<std::string> () == leaf_name)
+                      {
+                        leaf_prop_ptr = &prop;
+                        break;
+                      }
+                  }
+              }
+            if (leaf_prop_ptr == 0) return false;
+            const camp::Property & leaf_prop = *leaf_prop_ptr;
+            if (leaf_prop.hasTag ("topic")
+                && _dropped_topics_.count (leaf_prop.tag ("topic").to<std::string> ()))
+              {
+                return true;
+              }
+          }
+        return false;
+      }
+
+      unsigned int export_root_skimmer::_apply_branch_status (TTree * tree_,
+                                                              std::set<std::string> & dropped_) const
+      {
+        dropped_.clear ();
+        std::set<std::string> dropped;
+        std::set<std::string> kept_banks;
+        std::set<std::string> kept_counters;
+        TObjArray * branches = tree_->GetListOfBranches ();
+        for (int i = 0; i < branches->GetEntries (); i++)
+          {
+            TBranch * branch = static_cast<TBranch *>(branches->At (i));
+            const std::string branch_name = branch->GetName ();
+            if (is_dropped (branch_name))
+              {
+                dropped.insert (branch_name);
+                continue;
+              }
+            if (branch_name.find ('.') != std::string::npos)
+              {
+                kept_banks.insert (branch_name.substr (0, branch_name.find ('.')));
+              }
+            // Counters of the kept array leaves (bank sizes, nullable and event scope leaf counters) :
+            TObjArray * leaves = branch->GetListOfLeaves ();
+            for (int j = 0; j < leaves->GetEntries (); j++)
+              {
+                const TLeaf * leaf_count = static_cast<TLeaf *>(leaves->At (j))->GetLeafCount ();
+                if (leaf_count != 0)
+                  {
+                    kept_counters.insert (leaf_count->GetBranch ()->GetName ());
+                  }
+              }
+          }
+        unsigned int counter = 0;
+        for (std::set<std::string>::const_iterator i = dropped.begin (); i != dropped.end (); i++)
+          {
+            if (kept_counters.count (*i))
+              {
+                DT_LOG_WARNING (get_logging_priority (), "Branch '" << *i
+                                << "' is kept because it counts the values of kept leaves !");
+                continue;
+              }
+            // The size and validity branches of the banks with kept leaves are mandatory :
+            const std::size_t at = i->find ('@');
+            if (at != std::string::npos && kept_banks.count (i->substr (0, at)))
+              {
+                DT_LOG_WARNING (get_logging_priority (), "Branch '" << *i << "' is kept because the bank '"
+                                << i->substr (0, at) << "' still has leaves !");
+                continue;
+              }
+            tree_->SetBranchStatus (i->c_str (), 0);
+            dropped_.insert (*i);
+            counter++;
+          }
+        return counter;
+      }
+
+      bool export_root_skimmer::_has_kept_branch (TTree * tree_, const std::string & bank_name_) const
+      {
+        TObjArray * branches = tree_->GetListOfBranches ();
+        for (int i = 0; i < branches->GetEntries (); i++)
+          {
+            const std::string branch_name = branches->At (i)->GetName ();
+            if (branch_name == bank_name_
+                || boost::starts_with (branch_name, bank_name_ + '.')
+                || boost::starts_with (branch_name, bank_name_ + '@'))
+              {
+                return true;
+              }
+          }
+        return false;
+      }
+
+      Long64_t export_root_skimmer::_copy_selected_entries (TTree * input_, TTree * output_) const
+      {
+        boost::scoped_ptr<TTreeFormula> predicate;
+        boost::scoped_ptr<TTreeFormula> run_number;
+        boost::scoped_ptr<TTreeFormula> event_number;
+        std::vector<TTreeFormula *> formulas;
+        if (! _predicate_.empty ())
+          {
+            predicate.reset (new TTreeFormula ("predicate", _predicate_.c_str (), input_));
+            DT_THROW_IF (predicate->GetNdim () == 0, std::logic_error,
+                         "Invalid selection predicate '" << _predicate_ << "' !");
+            formulas.push_back (predicate.get ());
+          }
+        if (! _event_list_.empty ())
+          {
+            run_number.reset (new TTreeFormula ("run_number", "header.runNumber", input_));
+            event_number.reset (new TTreeFormula ("event_number", "header.eventNumber", input_));
+            DT_THROW_IF (run_number->GetNdim () == 0 || event_number->GetNdim () == 0, std::logic_error,
+                         "The event list needs the 'header' bank !");
+            formulas.push_back (run_number.get ());
+            formulas.push_back (event_number.get ());
+          }
+        // The branches used by the selection must be readable, even if they are not copied :
+        for (size_t i = 0; i < formulas.size (); i++)
+          {
+            for (int j = 0; j < formulas[i]->GetNcodes (); j++)
+              {
+                TLeaf * leaf = formulas[i]->GetLeaf (j);
+                if (leaf == 0) continue;
+                leaf->GetBranch ()->ResetBit (kDoNotProcess);
+                if (leaf->GetLeafCount () != 0)
+                  {
+                    leaf->GetLeafCount ()->GetBranch ()->ResetBit (kDoNotProcess);
+                  }
+              }
+          }
+
+        Long64_t counter = 0;
+        const Long64_t nentries = input_->GetEntries ();
+        for (Long64_t ientry = 0; ientry < nentries; ientry++)
+          {
+            input_->LoadTree (ientry);
+            if (predicate)
+              {
+                predicate->GetNdata ();
+                if (predicate->EvalInstance () == 0) continue;
+              }
+            if (run_number)
+              {
+                run_number->GetNdata ();
+                event_number->GetNdata ();
+                const std::pair<int32_t, int32_t> id ((int32_t) run_number->EvalInstance (),
+                                                      (int32_t) event_number->EvalInstance ());
+                if (! _event_list_.count (id)) continue;
+              }
+            input_->GetEntry (ientry);
+            output_->Fill ();
+            counter++;
+          }
+        return counter;
+      }
+
+      void export_root_skimmer::run ()
+      {
+        DT_LOG_TRACE (get_logging_priority (), "Entering...");
+        DT_THROW_IF (_input_files_.empty (), std::logic_error, "Missing input files !");
+        DT_THROW_IF (_output_file_.empty (), std::logic_error, "Missing output file !");
+        _statistics_ = statistics_type ();
+        boost::scoped_ptr<TFile> output_file;
+        TTree * output_tree = 0;
+        export_metadata reference_metadata;
+        for (size_t ifile = 0; ifile < _input_files_.size (); ifile++)
+          {
+            const std::string & input_name = _input_files_[ifile];
+            DT_LOG_DEBUG (get_logging_priority (), "Processing input file '" << input_name << "'...");
+            boost::scoped_ptr<TFile> input_file (TFile::Open (input_name.c_str (), "READ"));
+            DT_THROW_IF (! input_file || input_file->IsZombie (), std::runtime_error,
+                         "Cannot open input file '" << input_name << "' !");
+            TTree * input_tree = dynamic_cast<TTree *>(input_file->Get (_tree_name_.c_str ()));
+            DT_THROW_IF (input_tree == 0, std::runtime_error,
+                         "No tree '" << _tree_name_ << "' in input file '" << input_name << "' !");
+            // The metadata are loaded before the legacy version branches may be disabled :
+            export_metadata metadata;
+            metadata.load (*input_tree);
+            std::set<std::string> dropped_branches;
+            const unsigned int dropped = _apply_branch_status (input_tree, dropped_branches);
+            if (output_tree == 0)
+              {
+                reference_metadata = metadata;
+                // Fast cloning requires the same compression settings than the input :
+                output_file.reset (new TFile (_output_file_.c_str (), "RECREATE",
+                                              "SuperNEMO event record ROOT export",
+                                              input_file->GetCompressionSettings ()));
+                DT_THROW_IF (output_file->IsZombie (), std::runtime_error,
+                             "Cannot create output file '" << _output_file_ << "' !");
+                output_file->cd ();
+                output_tree = input_tree->CloneTree (0);
+                output_tree->SetDirectory (output_file.get ());
+                _statistics_.dropped_branches = dropped;
+                // The cloned metadata must not describe the dropped branches, banks and topics :
+                for (std::set<std::string>::const_iterator i = dropped_branches.begin ();
+                     i != dropped_branches.end (); i++)
+                  {
+                    metadata.remove_branch (*i);
+                  }
+                std::vector<std::string> dropped_banks;
+                for (size_t ibank = 0; ibank < metadata.banks.size (); ibank++)
+                  {
+                    const std::string & bank_name = metadata.banks[ibank].name;
+                    if (! _has_kept_branch (output_tree, bank_name)) dropped_banks.push_back (bank_name);
+                  }
+                for (size_t ibank = 0; ibank < dropped_banks.size (); ibank++)
+                  {
+                    metadata.remove_bank (dropped_banks[ibank]);
+                  }
+                for (std::set<std::string>::const_iterator i = _dropped_topics_.begin ();
+                     i != _dropped_topics_.end (); i++)
+                  {
+                    metadata.remove_topic (*i);
+                  }
+                metadata.store (*output_tree);
+              }
+            else
+              {
+                std::string reason;
+                DT_THROW_IF (! reference_metadata.is_compatible (metadata, reason), std::logic_error,
+                             "Input file '" << input_name << "' is not compatible with input file '"
+                             << _input_files_.front () << "' : " << reason << " !");
+                input_tree->CopyAddresses (output_tree);
+              }
+            _statistics_.input_entries += input_tree->GetEntries ();
+            if (has_entry_selection ())
+              {
+                _statistics_.output_entries += _copy_selected_entries (input_tree, output_tree);
+              }
+            else
+              {
+                // Copy the compressed baskets of the kept branches :
+                const Long64_t copied = output_tree->CopyEntries (input_tree, -1, "fast");
+                DT_THROW_IF (copied < 0, std::runtime_error, "Fast cloning of file '" << input_name << "' failed !");
+                _statistics_.output_entries += input_tree->GetEntries ();
+                _statistics_.fast_cloned_files++;
+              }
+            // Detach the output tree from the buffers of the input tree before closing it :
+            input_tree->CopyAddresses (output_tree, kTRUE);
+            input_file->Close ();
+          }
+        output_file->cd ();
+        output_tree->Write ();
+        output_file->Close ();
+        DT_LOG_DEBUG (get_logging_priority (), "Output file '" << _output_file_ << "' has "
+                      << _statistics_.output_entries << " entries.");
+        DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+        return;
+      }
+
+      void export_root_skimmer::print (std::ostream & out_,
+                                       const std::string & title_,
+                                       const std::string & indent_) const
+      {
+        if (! title_.empty ())
+          {
+            out_ << indent_ << title_ << ": \n";
+          }
+        out_ << indent_ << "|-- " << "Input files       : " << _input_files_.size () << "\n";
+        out_ << indent_ << "|-- " << "Output file       : '" << _output_file_ << "'\n";
+        out_ << indent_ << "|-- " << "Dropped banks     : " << _dropped_banks_.size () << "\n";
+        out_ << indent_ << "|-- " << "Dropped topics    : " << _dropped_topics_.size () << "\n";
+        out_ << indent_ << "|-- " << "Dropped patterns  : " << _dropped_patterns_.size () << "\n";
+        out_ << indent_ << "|-- " << "Event list        : " << _event_list_.size () << " events\n";
+        out_ << indent_ << "|-- " << "Predicate         : '" << _predicate_ << "'\n";
+        out_ << indent_ << "|-- " << "Input entries     : " << _statistics_.input_entries << "\n";
+        out_ << indent_ << "|-- " << "Output entries    : " << _statistics_.output_entries << "\n";
+        out_ << indent_ << "|-- " << "Dropped branches  : " << _statistics_.dropped_branches << "\n";
+        out_ << indent_ << "`-- " << "Fast cloned files : " << _statistics_.fast_cloned_files << "\n";
+        return;
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of export_root_skimmer.cc
@@ -0,0 +1,143 @@
+// -*- mode: c++ ; -*-
+/* export_root_skimmer.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Skim (entry selection) and slim (branch removal) of exported ROOT files
+ *
+ *   Branches are dropped by bank name, by topic (from the CAMP 'topic' tags
+ *   of the bank classes) or by glob pattern on the branch names. Entries are
+ *   selected from a list of (run, event) numbers and/or a TTreeFormula
+ *   predicate (ex: "header.simulated==0", "Sum$(calibTrackerHits.delayed)>0").
+ *
+ *   When no entry selection is requested, the compressed baskets of the
+ *   kept branches are copied without being decompressed (fast cloning).
+ *
+ * History:
+ *
+ */
+
+#ifndef SNRECONSTRUCTION_EXPORTS_EXPORT_ROOT_SKIMMER_H
+#define SNRECONSTRUCTION_EXPORTS_EXPORT_ROOT_SKIMMER_H 1
+
+#include <string>
+#include <vector>
+#include <set>
+#include <utility>
+#include <iostream>
+
+#include <boost/cstdint.hpp>
+
+#include <Rtypes.h>
+
+#include <falaise/snemo/exports/loggable_support.h>
+
+class TTree;
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      /// \brief Skim/slim tool for exported ROOT files
+      class export_root_skimmer : public loggable_support
+      {
+      public:
+
+        /// Run statistics
+        struct statistics_type
+        {
+          Long64_t input_entries;    /// Number of input entries
+          Long64_t output_entries;   /// Number of output entries
+          unsigned int fast_cloned_files; /// Number of input files copied by fast cloning
+          unsigned int dropped_branches;  /// Number of dropped branches
+          statistics_type ();
+        };
+
+        /// Default constructor
+        export_root_skimmer ();
+
+        /// Destructor
+        virtual ~export_root_skimmer ();
+
+        /// Set the name of the tree
+        void set_tree_name (const std::string & tree_name_);
+
+        /// Add an input file
+        void add_input_file (const std::string & filename_);
+
+        /// Set the output file
+        void set_output_file (const std::string & filename_);
+
+        /// Drop all branches of a bank (ex: "trueStepHits")
+        void drop_bank (const std::string & bank_name_);
+
+        /// Drop all branches with a given topic (ex: "CAT")
+        void drop_topic (const std::string & topic_);
+
+        /// Drop all branches matching a glob pattern (ex: "calibTrackerHits.cat*")
+        void drop_branches (const std::string & pattern_);
+
+        /// Select entries from a file of "run event" lines
+        void load_event_list (const std::string & filename_);
+
+        /// Select a (run, event) pair
+        void select_event (int32_t run_number_, int32_t event_number_);
+
+        /// Select entries with a TTreeFormula predicate
+        void set_predicate (const std::string & predicate_);
+
+        /// Check if an entry selection is requested
+        bool has_entry_selection () const;
+
+        /// Run the skim
+        void run ();
+
+        /// Return the statistics of the last run
+        const statistics_type & get_statistics () const;
+
+        /// Smart print
+        void print (std::ostream & out_ = std::clog,
+                    const std::string & title_ = "",
+                    const std::string & indent_ = "") const;
+
+        /// Check if a branch has to be dropped
+        bool is_dropped (const std::string & branch_name_) const;
+
+      protected:
+
+        /// Disable the dropped branches of an input tree, return their number
+        unsigned int _apply_branch_status (TTree * tree_, std::set<std::string> & dropped_) const;
+
+        /// Check if a tree has some branches of a bank
+        bool _has_kept_branch (TTree * tree_, const std::string & bank_name_) const;
+
+        /// Copy the selected entries of an input tree
+        Long64_t _copy_selected_entries (TTree * input_, TTree * output_) const;
+
+      private:
+
+        std::string                             _tree_name_;    /// Name of the tree
+        std::vector<std::string>                _input_files_;  /// Input files
+        std::string                             _output_file_;  /// Output file
+        std::set<std::string>                   _dropped_banks_;   /// Dropped banks
+        std::set<std::string>                   _dropped_topics_;  /// Dropped topics
+        std::vector<std::string>                _dropped_patterns_; /// Dropped branch patterns
+        std::set<std::pair<int32_t, int32_t> >  _event_list_;   /// Selected (run, event) pairs
+        std::string                             _predicate_;    /// Selection predicate
+        statistics_type                         _statistics_;   /// Statistics
+
+      };
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // SNRECONSTRUCTION_EXPORTS_EXPORT_ROOT_SKIMMER_H
+
+// end of export_root_skimmer.h
@@ -0,0 +1,492 @@
+// -*- mode: c++ ; -*-
+/* hdf5_column_sink.cc */
+
+#include <falaise/snemo/exports/hdf5_column_sink.h>
+#include <falaise/snemo/exports/root_utils.h>
+
+#include <map>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/algorithm/string.hpp>
+
+#include <datatools/properties.h>
+#include <datatools/exception.h>
+#include <datatools/logger.h>
+
+#include <hdf5.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      namespace {
+
+        hid_t hdf5_native_type (int type_)
+        {
+          switch (type_)
+            {
+            case branch_entry_type::TYPE_BOOLEAN : return H5T_NATIVE_UINT8;
+            case branch_entry_type::TYPE_CHAR    : return H5T_NATIVE_INT8;
+            case branch_entry_type::TYPE_UCHAR   : return H5T_NATIVE_UINT8;
+            case branch_entry_type::TYPE_INT16   : return H5T_NATIVE_INT16;
+            case branch_entry_type::TYPE_UINT16  : return H5T_NATIVE_UINT16;
+            case branch_entry_type::TYPE_INT32   : return H5T_NATIVE_INT32;
+            case branch_entry_type::TYPE_UINT32  : return H5T_NATIVE_UINT32;
+            case branch_entry_type::TYPE_INT64   : return H5T_NATIVE_INT64;
+            case branch_entry_type::TYPE_UINT64  : return H5T_NATIVE_UINT64;
+            case branch_entry_type::TYPE_FLOAT   : return H5T_NATIVE_FLOAT;
+            case branch_entry_type::TYPE_DOUBLE  : return H5T_NATIVE_DOUBLE;
+            }
+          DT_THROW_IF (true, std::logic_error, "Unsupported branch type (" << type_ << ") !");
+          return -1;
+        }
+
+        void check_hdf5 (herr_t status_, const std::string & what_)
+        {
+          DT_THROW_IF (status_ < 0, std::runtime_error, "HDF5 error while " << what_ << " !");
+          return;
+        }
+
+        hid_t check_hdf5_id (hid_t id_, const std::string & what_)
+        {
+          DT_THROW_IF (id_ < 0, std::runtime_error, "HDF5 error while " << what_ << " !");
+          return id_;
+        }
+
+        void write_string_attribute (hid_t object_, const std::string & name_, const std::string & value_)
+        {
+          const hid_t atype = check_hdf5_id (H5Tcopy (H5T_C_S1), "copying the string type");
+          H5Tset_size (atype, value_.size () + 1);
+          const hid_t aspace = H5Screate (H5S_SCALAR);
+          const hid_t attr = H5Acreate2 (object_, name_.c_str (), atype, aspace, H5P_DEFAULT, H5P_DEFAULT);
+          const herr_t status = attr < 0 ? -1 : H5Awrite (attr, atype, value_.c_str ());
+          if (attr >= 0) H5Aclose (attr);
+          H5Sclose (aspace);
+          H5Tclose (atype);
+          check_hdf5 (status, "writing attribute '" + name_ + "'");
+          return;
+        }
+
+      }
+
+      /// HDF5 and threading working data
+      struct hdf5_column_sink::work_type
+      {
+        /// Output dataset
+        struct dataset_type
+        {
+          std::string       path;       /// Path of the dataset in the file
+          hid_t             id;         /// HDF5 dataset
+          hid_t             mem_type;   /// HDF5 native type of the values
+          unsigned int      value_size; /// Size of a value in bytes
+          uint64_t          size;       /// Number of values written (writer thread)
+          std::vector<char> buffer;     /// Values waiting to be submitted (main thread)
+        };
+
+        /// Source column
+        struct stream_type
+        {
+          branch_entry_type * entry;   /// Source branch entry
+          std::size_t         dataset; /// Values dataset
+          int                 offsets; /// Offsets dataset for '@size' columns (-1 : none)
+          uint64_t            total;   /// Cumulated number of items (for offsets)
+        };
+
+        /// Chunk waiting for the writer thread
+        struct job_type
+        {
+          std::size_t       dataset; /// Target dataset
+          std::vector<char> data;    /// Values
+        };
+
+        std::string                  filename;
+        branch_manager *             bm;
+        hid_t                        file;
+        std::map<std::string, hid_t> groups;
+        std::vector<dataset_type>    datasets;
+        std::vector<stream_type>     streams;
+        uint64_t                     number_of_entries;
+
+        std::thread                  writer;
+        std::mutex                   mutex;
+        std::condition_variable      work_ready;
+        std::condition_variable      work_done;
+        std::deque<job_type>         jobs;
+        bool                         stop;
+        std::string                  error;
+
+        work_type () : bm (0), file (-1), number_of_entries (0), stop (false) {}
+
+        /// Close the HDF5 datasets, groups and file
+        void close_handles ()
+        {
+          for (size_t i = 0; i < datasets.size (); i++)
+            {
+              H5Dclose (datasets[i].id);
+            }
+          datasets.clear ();
+          for (std::map<std::string, hid_t>::const_iterator i = groups.begin ();
+               i != groups.end ();
+               i++)
+            {
+              H5Gclose (i->second);
+            }
+          groups.clear ();
+          if (file >= 0)
+            {
+              H5Fclose (file);
+              file = -1;
+            }
+          return;
+        }
+      };
+
+      hdf5_column_sink::hdf5_column_sink ()
+      {
+        _chunk_size_ = DEFAULT_CHUNK_SIZE;
+        _compression_level_ = DEFAULT_COMPRESSION_LEVEL;
+        _shuffle_ = true;
+        _max_pending_chunks_ = DEFAULT_MAX_PENDING_CHUNKS;
+        return;
+      }
+
+      hdf5_column_sink::~hdf5_column_sink ()
+      {
+        if (is_open ())
+          {
+            try
+              {
+                close ();
+              }
+            catch (std::exception & error)
+              {
+                DT_LOG_ERROR (get_logging_priority (), error.what ());
+              }
+          }
+        return;
+      }
+
+      void hdf5_column_sink::initialize (const datatools::properties & config_)
+      {
+        this->column_sink::initialize (config_);
+        DT_THROW_IF (is_open (), std::logic_error, "Sink is open ! Cannot change its configuration !");
+        if (config_.has_key ("chunk_size"))
+          {
+            const int chunk_size = config_.fetch_integer ("chunk_size");
+            DT_THROW_IF (chunk_size < 1, std::domain_error, "Invalid chunk size (" << chunk_size << ") !");
+            _chunk_size_ = chunk_size;
+          }
+        if (config_.has_key ("compression_level"))
+          {
+            const int level = config_.fetch_integer ("compression_level");
+            DT_THROW_IF (level < 0 || level > 9, std::domain_error,
+                         "Invalid compression level (" << level << ") !");
+            _compression_level_ = level;
+          }
+        if (config_.has_key ("shuffle"))
+          {
+            _shuffle_ = config_.fetch_boolean ("shuffle");
+          }
+        if (config_.has_key ("max_pending_chunks"))
+          {
+            const int max_pending = config_.fetch_integer ("max_pending_chunks");
+            DT_THROW_IF (max_pending < 1, std::domain_error,
+                         "Invalid maximum number of pending chunks (" << max_pending << ") !");
+            _max_pending_chunks_ = max_pending;
+          }
+        return;
+      }
+
+      bool hdf5_column_sink::is_open () const
+      {
+        return _work_.get () != 0;
+      }
+
+      std::string hdf5_column_sink::get_format () const
+      {
+        return "hdf5";
+      }
+
+      void hdf5_column_sink::open (const std::string & filename_,
+                                   branch_manager & branch_manager_,
+                                   uint32_t store_bits_)
+      {
+        DT_LOG_TRACE (get_logging_priority (), "Entering...");
+        DT_THROW_IF (is_open (), std::logic_error, "Sink is already open !");
+        // The working data are only published once the writer thread runs,
+        // so that a failure leaves the sink closed :
+        boost::scoped_ptr<work_type> work_ptr (new work_type);
+        work_type & work = *work_ptr;
+        work.filename = filename_;
+        work.bm = &branch_manager_;
+        work.file = H5Fcreate (filename_.c_str (), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+        DT_THROW_IF (work.file < 0, std::runtime_error, "Cannot create HDF5 file '" << filename_ << "' !");
+        hid_t dcpl = -1;
+        hid_t space = -1;
+        try
+          {
+            // File level metadata :
+            std::map<std::string, std::string> metadata;
+            _collect_metadata (branch_manager_, store_bits_, metadata);
+            for (std::map<std::string, std::string>::const_iterator i = metadata.begin ();
+                 i != metadata.end ();
+                 i++)
+              {
+                write_string_attribute (work.file, i->first, i->second);
+              }
+
+            // Dataset creation properties, tuned for appending full chunks :
+            dcpl = check_hdf5_id (H5Pcreate (H5P_DATASET_CREATE), "creating the dataset properties");
+            const hsize_t chunk_dims[1] = { _chunk_size_ };
+            H5Pset_chunk (dcpl, 1, chunk_dims);
+            if (_compression_level_ > 0)
+              {
+                if (_shuffle_) H5Pset_shuffle (dcpl);
+                H5Pset_deflate (dcpl, _compression_level_);
+              }
+            const hsize_t dims[1] = { 0 };
+            const hsize_t max_dims[1] = { H5S_UNLIMITED };
+            space = check_hdf5_id (H5Screate_simple (1, dims, max_dims), "creating the dataspace");
+
+            std::vector<branch_entry_type *> entries;
+            _collect_columns (branch_manager_, store_bits_, entries);
+            for (size_t i = 0; i < entries.size (); i++)
+              {
+                branch_entry_type & be = *entries[i];
+                const bool size_column = boost::ends_with (be.get_name (), "@size");
+                std::string bank = be.get_parent_name ();
+                std::string leaf = be.get_leaf_name ();
+                if (size_column && bank.empty ())
+                  {
+                    bank = be.get_name ().substr (0, be.get_name ().find ('@'));
+                    leaf = "@size";
+                  }
+                if (work.groups.find (bank) == work.groups.end ())
+                  {
+                    work.groups[bank] = check_hdf5_id (H5Gcreate2 (work.file, bank.c_str (),
+                                                                   H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+                                                       "creating group '" + bank + "'");
+                  }
+                const hid_t group = work.groups[bank];
+                std::vector<std::string> dataset_leaves;
+                std::vector<hid_t> dataset_types;
+                dataset_leaves.push_back (leaf);
+                dataset_types.push_back (hdf5_native_type (be.get_type ()));
+                if (size_column)
+                  {
+                    // "@offsets" for a bank, "<leaf>@offsets" for the counter of a nullable leaf :
+                    dataset_leaves.push_back (leaf.substr (0, leaf.length () - 5) + "@offsets");
+                    dataset_types.push_back (H5T_NATIVE_UINT64);
+                  }
+                work_type::stream_type stream;
+                stream.entry = &be;
+                stream.offsets = -1;
+                stream.total = 0;
+                for (size_t j = 0; j < dataset_leaves.size (); j++)
+                  {
+                    work_type::dataset_type dataset;
+                    dataset.path = "/" + bank + "/" + dataset_leaves[j];
+                    dataset.mem_type = dataset_types[j];
+                    dataset.value_size = H5Tget_size (dataset.mem_type);
+                    dataset.size = 0;
+                    dataset.id = check_hdf5_id (H5Dcreate2 (group, dataset_leaves[j].c_str (), dataset.mem_type,
+                                                            space, H5P_DEFAULT, dcpl, H5P_DEFAULT),
+                                                "creating dataset '" + dataset.path + "'");
+                    dataset.buffer.reserve (_chunk_size_ * dataset.value_size);
+                    if (j == 0)
+                      {
+                        stream.dataset = work.datasets.size ();
+                      }
+                    else
+                      {
+                        stream.offsets = work.datasets.size ();
+                      }
+                    // Registered at once, so that it is closed on failure :
+                    work.datasets.push_back (dataset);
+                    if (j == 0)
+                      {
+                        // Same metadata than the ROOT branches :
+                        const hid_t id = work.datasets.back ().id;
+                        write_string_attribute (id, "ctype", branch_entry_type::get_branch_type_label (be.get_type ()));
+                        if (! be.get_unit ().empty ()) write_string_attribute (id, "unit", be.get_unit ());
+                        if (! be.get_topic ().empty ()) write_string_attribute (id, "topic", be.get_topic ());
+                        if (be.is_array () && be.has_fixed_size ())
+                          {
+                            std::ostringstream oss;
+                            oss << be.get_array_fixed_size ();
+                            write_string_attribute (id, "fixed_size", oss.str ());
+                          }
+                      }
+                  }
+                work.streams.push_back (stream);
+              }
+            H5Sclose (space);
+            space = -1;
+            H5Pclose (dcpl);
+            dcpl = -1;
+
+            // From now on, only the writer thread talks to the HDF5 library :
+            work.writer = std::thread (&hdf5_column_sink::_run_writer, this, &work);
+          }
+        catch (...)
+          {
+            if (space >= 0) H5Sclose (space);
+            if (dcpl >= 0) H5Pclose (dcpl);
+            work.close_handles ();
+            throw;
+          }
+        _work_.swap (work_ptr);
+        DT_LOG_DEBUG (get_logging_priority (), "HDF5 file '" << filename_ << "' is open with "
+                      << work.datasets.size () << " datasets.");
+        DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+        return;
+      }
+
+      void hdf5_column_sink::store_entry ()
+      {
+        DT_THROW_IF (! is_open (), std::logic_error, "Sink is not open !");
+        _check_writer ();
+        work_type & work = *_work_;
+        for (size_t i = 0; i < work.streams.size (); i++)
+          {
+            work_type::stream_type & stream = work.streams[i];
+            branch_entry_type & be = *stream.entry;
+            const unsigned int n = work.bm->get_array_size (be);
+            work_type::dataset_type & dataset = work.datasets[stream.dataset];
+            if (n > 0)
+              {
+                const char * data = static_cast<const char *>(be.get_address ());
+                dataset.buffer.insert (dataset.buffer.end (), data, data + n * dataset.value_size);
+              }
+            if (stream.offsets >= 0)
+              {
+                stream.total += *static_cast<const UInt_t *>(be.get_address ());
+                const char * total = reinterpret_cast<const char *>(&stream.total);
+                std::vector<char> & offsets = work.datasets[stream.offsets].buffer;
+                offsets.insert (offsets.end (), total, total + sizeof (uint64_t));
+              }
+          }
+        work.number_of_entries++;
+        for (size_t i = 0; i < work.datasets.size (); i++)
+          {
+            if (work.datasets[i].buffer.size () >= _chunk_size_ * work.datasets[i].value_size)
+              {
+                _submit (i);
+              }
+          }
+        return;
+      }
+
+      void hdf5_column_sink::_submit (std::size_t dataset_)
+      {
+        work_type & work = *_work_;
+        work_type::dataset_type & dataset = work.datasets[dataset_];
+        if (dataset.buffer.empty ()) return;
+        work_type::job_type job;
+        job.dataset = dataset_;
+        job.data.swap (dataset.buffer);
+        dataset.buffer.reserve (_chunk_size_ * dataset.value_size);
+        std::unique_lock<std::mutex> lock (work.mutex);
+        // Bound the memory used by the pending chunks :
+        while (work.jobs.size () >= _max_pending_chunks_ && work.error.empty ())
+          {
+            work.work_done.wait (lock);
+          }
+        work.jobs.push_back (job);
+        work.work_ready.notify_one ();
+        return;
+      }
+
+      void hdf5_column_sink::_run_writer (work_type * work_)
+      {
+        work_type & work = *work_;
+        while (true)
+          {
+            work_type::job_type job;
+            {
+              std::unique_lock<std::mutex> lock (work.mutex);
+              while (work.jobs.empty () && ! work.stop)
+                {
+                  work.work_ready.wait (lock);
+                }
+              if (work.jobs.empty ()) break;
+              job.dataset = work.jobs.front ().dataset;
+              job.data.swap (work.jobs.front ().data);
+              work.jobs.pop_front ();
+              work.work_done.notify_one ();
+              if (! work.error.empty ()) continue;
+            }
+            work_type::dataset_type & dataset = work.datasets[job.dataset];
+            const hsize_t count[1] = { job.data.size () / dataset.value_size };
+            const hsize_t start[1] = { dataset.size };
+            const hsize_t new_size[1] = { dataset.size + count[0] };
+            try
+              {
+                check_hdf5 (H5Dset_extent (dataset.id, new_size), "extending dataset '" + dataset.path + "'");
+                const hid_t file_space = H5Dget_space (dataset.id);
+                H5Sselect_hyperslab (file_space, H5S_SELECT_SET, start, NULL, count, NULL);
+                const hid_t mem_space = H5Screate_simple (1, count, NULL);
+                const herr_t status = H5Dwrite (dataset.id, dataset.mem_type, mem_space, file_space,
+                                                H5P_DEFAULT, job.data.data ());
+                H5Sclose (mem_space);
+                H5Sclose (file_space);
+                check_hdf5 (status, "writing dataset '" + dataset.path + "'");
+                dataset.size = new_size[0];
+              }
+            catch (std::exception & error)
+              {
+                std::lock_guard<std::mutex> lock (work.mutex);
+                work.error = error.what ();
+                work.work_done.notify_all ();
+              }
+          }
+        return;
+      }
+
+      void hdf5_column_sink::_check_writer () const
+      {
+        std::lock_guard<std::mutex> lock (_work_->mutex);
+        DT_THROW_IF (! _work_->error.empty (), std::runtime_error,
+                     "HDF5 writer thread failed for file '" << _work_->filename << "' : " << _work_->error);
+        return;
+      }
+
+      void hdf5_column_sink::close ()
+      {
+        DT_LOG_TRACE (get_logging_priority (), "Entering...");
+        if (! is_open ()) return;
+        work_type & work = *_work_;
+        for (size_t i = 0; i < work.datasets.size (); i++)
+          {
+            _submit (i);
+          }
+        {
+          std::lock_guard<std::mutex> lock (work.mutex);
+          work.stop = true;
+          work.work_ready.notify_one ();
+        }
+        work.writer.join ();
+        work.close_handles ();
+        const std::string error = work.error;
+        DT_LOG_DEBUG (get_logging_priority (), "HDF5 file '" << work.filename << "' is closed ("
+                      << work.number_of_entries << " entries).");
+        _work_.reset (0);
+        DT_THROW_IF (! error.empty (), std::runtime_error, "HDF5 writer thread failed : " << error);
+        DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+        return;
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of hdf5_column_sink.cc
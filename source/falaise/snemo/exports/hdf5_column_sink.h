@@ -0,0 +1,112 @@
+// -*- mode: c++ ; -*-
+/* hdf5_column_sink.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   HDF5 export sink (only built when the HDF5 library is available)
+ *
+ *   Each bank is stored in a HDF5 group "/<bank>" :
+ *     - each leaf is an extendable, chunked and compressed 1D dataset
+ *       "/<bank>/<leaf>" (the values of array banks are concatenated),
+ *     - array banks have a "/<bank>/@size" dataset (one item per event,
+ *       mirroring the '@size' branch) and a "/<bank>/@offsets" dataset
+ *       with the cumulated end offset of each event,
+ *     - nullable leaves (see the 'null_bitmaps' option) have their own
+ *       "/<bank>/<leaf>@size" and "/<bank>/<leaf>@offsets" datasets,
+ *     - leaf datasets have "unit", "topic" and "ctype" attributes taken
+ *       from the CAMP reflection tags,
+ *     - bank versions and export flags are attributes of the root group.
+ *
+ *   Full chunks are handed to a background thread that appends them to
+ *   the datasets ; all HDF5 calls are done from that thread while the
+ *   file is open.
+ *
+ * History:
+ *
+ */
+
+#ifndef SNRECONSTRUCTION_EXPORTS_HDF5_COLUMN_SINK_H
+#define SNRECONSTRUCTION_EXPORTS_HDF5_COLUMN_SINK_H 1
+
+#include <string>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <falaise/snemo/exports/column_sink.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      /// \brief Column sink for the HDF5 format
+      class hdf5_column_sink : public column_sink
+      {
+      public:
+
+        static const unsigned int DEFAULT_CHUNK_SIZE = 16384;
+        static const int          DEFAULT_COMPRESSION_LEVEL = 4;
+        static const unsigned int DEFAULT_MAX_PENDING_CHUNKS = 64;
+
+        /// Default constructor
+        hdf5_column_sink ();
+
+        /// Destructor
+        virtual ~hdf5_column_sink ();
+
+        /// Configure the sink
+        virtual void initialize (const datatools::properties & config_);
+
+        /// Open a new output file
+        virtual void open (const std::string & filename_,
+                           branch_manager & branch_manager_,
+                           uint32_t store_bits_);
+
+        /// Store the current content of the branch memory as a new entry
+        virtual void store_entry ();
+
+        /// Close the current output file
+        virtual void close ();
+
+        /// Check if an output file is open
+        virtual bool is_open () const;
+
+        /// Return the label of the format
+        virtual std::string get_format () const;
+
+      protected:
+
+        struct work_type; /// HDF5 and threading working data (opaque)
+
+        /// Hand the buffered values of a dataset to the writer thread
+        void _submit (std::size_t dataset_);
+
+        /// Main loop of the writer thread
+        void _run_writer (work_type * work_);
+
+        /// Throw if the writer thread has failed
+        void _check_writer () const;
+
+      private:
+
+        unsigned int                 _chunk_size_;         /// Number of values per chunk
+        int                          _compression_level_;  /// Deflate level (0 : no compression)
+        bool                         _shuffle_;            /// Shuffle filter flag
+        unsigned int                 _max_pending_chunks_; /// Maximum number of chunks waiting for the writer
+        boost::scoped_ptr<work_type> _work_;               /// Working data of the open file
+
+      };
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // SNRECONSTRUCTION_EXPORTS_HDF5_COLUMN_SINK_H
+
+// end of hdf5_column_sink.h
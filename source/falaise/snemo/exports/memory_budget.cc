@@ -0,0 +1,196 @@
+// -*- mode: c++ ; -*-
+/* memory_budget.cc */
+
+#include <falaise/snemo/exports/memory_budget.h>
+
+#include <stdexcept>
+#include <algorithm>
+
+#include <datatools/exception.h>
+
+#include <TTree.h>
+#include <TBranch.h>
+#include <TBasket.h>
+#include <TObjArray.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      // static
+      const double memory_budget::DEFAULT_FLUSH_FRACTION = 0.9;
+
+      // static
+      const double memory_budget::MINIMAL_BASKET_FRACTION = 0.1;
+
+      // static
+      const double memory_budget::REARM_FRACTION = 0.8;
+
+      memory_budget::usage_type::usage_type ()
+      {
+        baskets = 0;
+        buffers = 0;
+        events = 0;
+        return;
+      }
+
+      std::size_t memory_budget::usage_type::get_total () const
+      {
+        return baskets + buffers + events;
+      }
+
+      memory_budget::statistics_type::statistics_type ()
+      {
+        checks = 0;
+        flushes = 0;
+        shrinks = 0;
+        return;
+      }
+
+      // static
+      std::size_t memory_budget::compute_basket_memory (TTree & tree_)
+      {
+        // The branches of the export are not split : each of them holds its write basket
+        // in memory, with a buffer which grows up to the size of the largest cluster
+        std::size_t memory = 0;
+        TObjArray * branches = tree_.GetListOfBranches ();
+        for (int i = 0; i < branches->GetEntries (); i++)
+          {
+            TBranch * branch = static_cast<TBranch *>(branches->At (i));
+            const TBasket * basket = branch->GetBasket (branch->GetWriteBasket ());
+            if (basket != 0)
+              {
+                memory += basket->GetBufferSize ();
+              }
+          }
+        return memory;
+      }
+
+      memory_budget::memory_budget ()
+      {
+        _limit_ = 0;
+        _flush_fraction_ = DEFAULT_FLUSH_FRACTION;
+        _armed_ = true;
+        return;
+      }
+
+      bool memory_budget::is_active () const
+      {
+        return _limit_ > 0;
+      }
+
+      std::size_t memory_budget::get_limit () const
+      {
+        return _limit_;
+      }
+
+      void memory_budget::set_limit (std::size_t limit_)
+      {
+        _limit_ = limit_;
+        return;
+      }
+
+      double memory_budget::get_flush_fraction () const
+      {
+        return _flush_fraction_;
+      }
+
+      void memory_budget::set_flush_fraction (double fraction_)
+      {
+        DT_THROW_IF (fraction_ <= 0.0 || fraction_ > 1.0, std::domain_error,
+                     "Invalid flush fraction (" << fraction_ << ") !");
+        _flush_fraction_ = fraction_;
+        return;
+      }
+
+      bool memory_budget::setup_tree (TTree & tree_) const
+      {
+        if (! is_active ()) return true;
+        // A number of entries per cluster (positive) or no auto-flush (null) is a choice of the user :
+        if (tree_.GetAutoFlush () >= 0) return false;
+        // Smaller clusters flush the baskets more often ; the budget itself is enforced by the checks :
+        const Long64_t cluster_bytes = static_cast<Long64_t> (_limit_ * MINIMAL_BASKET_FRACTION);
+        if (tree_.GetAutoFlush () < -cluster_bytes)
+          {
+            tree_.SetAutoFlush (-cluster_bytes);
+          }
+        return true;
+      }
+
+      bool memory_budget::check (TTree & tree_, const usage_type & usage_)
+      {
+        if (! is_active ()) return false;
+        _statistics_.checks++;
+        if (usage_.get_total () > _statistics_.peak.get_total ())
+          {
+            _statistics_.peak = usage_;
+          }
+        const std::size_t threshold = static_cast<std::size_t> (_limit_ * _flush_fraction_);
+        if (usage_.get_total () < static_cast<std::size_t> (threshold * REARM_FRACTION))
+          {
+            _armed_ = true;
+          }
+        if (usage_.get_total () <= threshold) return false;
+        if (! _armed_ && usage_.get_total () <= _limit_) return false;
+        _armed_ = false;
+
+        // The baskets get what the other storages leave, with a minimal share :
+        const std::size_t others = usage_.buffers + usage_.events;
+        const std::size_t minimal_baskets = static_cast<std::size_t> (_limit_ * MINIMAL_BASKET_FRACTION);
+        const std::size_t basket_target = std::max (threshold > others ? threshold - others : 0,
+                                                    minimal_baskets);
+        if (usage_.baskets > basket_target)
+          {
+            tree_.FlushBaskets ();
+            tree_.OptimizeBaskets (basket_target, 1.1, "");
+            _statistics_.flushes++;
+          }
+        if (others + minimal_baskets > threshold)
+          {
+            _statistics_.shrinks++;
+            return true;
+          }
+        return false;
+      }
+
+      void memory_budget::reset_statistics ()
+      {
+        _statistics_ = statistics_type ();
+        _armed_ = true;
+        return;
+      }
+
+      const memory_budget::statistics_type & memory_budget::get_statistics () const
+      {
+        return _statistics_;
+      }
+
+      void memory_budget::print (std::ostream & out_,
+                                 const std::string & title_,
+                                 const std::string & indent_) const
+      {
+        if (! title_.empty ())
+          {
+            out_ << indent_ << title_ << ": \n";
+          }
+        out_ << indent_ << "|-- " << "Limit          : " << _limit_ << "\n";
+        out_ << indent_ << "|-- " << "Flush fraction : " << _flush_fraction_ << "\n";
+        out_ << indent_ << "|-- " << "Checks         : " << _statistics_.checks << "\n";
+        out_ << indent_ << "|-- " << "Flushes        : " << _statistics_.flushes << "\n";
+        out_ << indent_ << "|-- " << "Shrinks        : " << _statistics_.shrinks << "\n";
+        out_ << indent_ << "|-- " << "Peak baskets   : " << _statistics_.peak.baskets << "\n";
+        out_ << indent_ << "|-- " << "Peak buffers   : " << _statistics_.peak.buffers << "\n";
+        out_ << indent_ << "|-- " << "Peak events    : " << _statistics_.peak.events << "\n";
+        out_ << indent_ << "`-- " << "Peak total     : " << _statistics_.peak.get_total () << "\n";
+        return;
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of memory_budget.cc
@@ -0,0 +1,135 @@
+// -*- mode: c++ ; -*-
+/* memory_budget.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Memory budget of an export tree
+ *
+ *   The memory of the export is shared by three storages :
+ *
+ *     - the baskets of the branches of the output tree,
+ *     - the buffers addressed by the branches (branch manager),
+ *     - the banks and payloads of the export events.
+ *
+ *   The usage is checked after each fill of the tree. Above a fraction of
+ *   the budget, the baskets are flushed to the file and resized so that
+ *   they fit in what the other storages leave ; if the other storages alone
+ *   exceed the budget, the storage of the export events and of the branch
+ *   buffers has to be shrunk. Once it has acted, the budget only acts again
+ *   when the usage has come back under a lower fraction of the budget, or
+ *   when it exceeds the budget itself, so that a steady usage close to the
+ *   threshold does not flush nor shrink at each fill.
+ *   The peak usage is recorded between two resets (one per output file).
+ *
+ * History:
+ *
+ */
+
+#ifndef SNRECONSTRUCTION_EXPORTS_MEMORY_BUDGET_H
+#define SNRECONSTRUCTION_EXPORTS_MEMORY_BUDGET_H 1
+
+#include <cstddef>
+#include <string>
+#include <iostream>
+
+class TTree;
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      /// \brief Memory budget of the baskets, branch buffers and export events
+      class memory_budget
+      {
+      public:
+
+        /// Default fraction of the budget above which the baskets are flushed
+        static const double DEFAULT_FLUSH_FRACTION;
+
+        /// Minimal fraction of the budget left to the baskets
+        static const double MINIMAL_BASKET_FRACTION;
+
+        /// Fraction of the flush threshold under which the budget acts again
+        static const double REARM_FRACTION;
+
+        /// Memory usage (bytes)
+        struct usage_type
+        {
+          std::size_t baskets; /// Baskets of the tree
+          std::size_t buffers; /// Buffers addressed by the branches
+          std::size_t events;  /// Banks and payloads of the export events
+          usage_type ();
+          std::size_t get_total () const;
+        };
+
+        /// Statistics
+        struct statistics_type
+        {
+          usage_type  peak;    /// Usage at the peak of the total usage
+          std::size_t checks;  /// Number of checks
+          std::size_t flushes; /// Number of flushes and resizes of the baskets
+          std::size_t shrinks; /// Number of requests to shrink the export events
+          statistics_type ();
+        };
+
+        /// Return the memory of the baskets of a tree (bytes)
+        static std::size_t compute_basket_memory (TTree & tree_);
+
+        /// Constructor
+        memory_budget ();
+
+        /// Check if a budget is set
+        bool is_active () const;
+
+        /// Return the budget (bytes, 0 : no budget)
+        std::size_t get_limit () const;
+
+        /// Set the budget (bytes, 0 : no budget)
+        void set_limit (std::size_t limit_);
+
+        /// Return the fraction of the budget above which the baskets are flushed
+        double get_flush_fraction () const;
+
+        /// Set the fraction of the budget above which the baskets are flushed
+        void set_flush_fraction (double fraction_);
+
+        /// Bound the size of the clusters of a new tree, return false if the tree has a
+        /// number of entries per cluster set by the user, which is kept
+        bool setup_tree (TTree & tree_) const;
+
+        /// Check the usage after a fill, return true if the export events should be shrunk
+        bool check (TTree & tree_, const usage_type & usage_);
+
+        /// Reset the statistics and allow the budget to act (new file)
+        void reset_statistics ();
+
+        /// Return the statistics
+        const statistics_type & get_statistics () const;
+
+        /// Smart print
+        void print (std::ostream & out_ = std::clog,
+                    const std::string & title_ = "",
+                    const std::string & indent_ = "") const;
+
+      private:
+
+        std::size_t     _limit_;          /// Budget (bytes)
+        double          _flush_fraction_; /// Fraction of the budget above which the baskets are flushed
+        bool            _armed_;          /// Flag allowing the budget to act
+        statistics_type _statistics_;     /// Statistics
+
+      };
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // SNRECONSTRUCTION_EXPORTS_MEMORY_BUDGET_H
+
+// end of memory_budget.h
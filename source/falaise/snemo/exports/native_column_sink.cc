@@ -0,0 +1,329 @@
+// -*- mode: c++ ; -*-
+/* native_column_sink.cc */
+
+#include <falaise/snemo/exports/native_column_sink.h>
+#include <falaise/snemo/exports/root_utils.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include <datatools/properties.h>
+#include <datatools/exception.h>
+#include <datatools/logger.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      native_column_sink::native_column_sink ()
+      {
+        _page_entries_ = DEFAULT_PAGE_ENTRIES;
+        _branch_manager_ = 0;
+        _store_bits_ = 0;
+        _position_ = 0;
+        _number_of_entries_ = 0;
+        _page_fill_ = 0;
+        return;
+      }
+
+      native_column_sink::~native_column_sink ()
+      {
+        if (is_open ())
+          {
+            try
+              {
+                close ();
+              }
+            catch (std::exception & error)
+              {
+                DT_LOG_ERROR (get_logging_priority (), error.what ());
+              }
+          }
+        return;
+      }
+
+      void native_column_sink::initialize (const datatools::properties & config_)
+      {
+        this->column_sink::initialize (config_);
+        if (config_.has_key ("page_entries"))
+          {
+            const int page_entries = config_.fetch_integer ("page_entries");
+            DT_THROW_IF (page_entries < 1, std::domain_error,
+                         "Invalid number of entries per page (" << page_entries << ") !");
+            set_page_entries (page_entries);
+          }
+        return;
+      }
+
+      void native_column_sink::set_page_entries (unsigned int page_entries_)
+      {
+        DT_THROW_IF (is_open (), std::logic_error, "Sink is open ! Cannot change the page size !");
+        _page_entries_ = page_entries_;
+        return;
+      }
+
+      unsigned int native_column_sink::get_page_entries () const
+      {
+        return _page_entries_;
+      }
+
+      bool native_column_sink::is_open () const
+      {
+        return _out_.get () != 0;
+      }
+
+      std::string native_column_sink::get_format () const
+      {
+        return "native";
+      }
+
+      void native_column_sink::_write (const void * data_, uint64_t size_)
+      {
+        _out_->write (static_cast<const char *>(data_), size_);
+        DT_THROW_IF (! *_out_, std::runtime_error, "Write error in file '" << _filename_ << "' !");
+        _position_ += size_;
+        return;
+      }
+
+      void native_column_sink::_pad ()
+      {
+        static const char zeros[native_columnar_format::ALIGNMENT] = { 0 };
+        const uint64_t next = native_columnar_format::aligned (_position_);
+        if (next > _position_)
+          {
+            _write (zeros, next - _position_);
+          }
+        return;
+      }
+
+      void native_column_sink::open (const std::string & filename_,
+                                     branch_manager & branch_manager_,
+                                     uint32_t store_bits_)
+      {
+        DT_LOG_TRACE (get_logging_priority (), "Entering...");
+        DT_THROW_IF (is_open (), std::logic_error, "Sink is already open !");
+        _out_.reset (new std::ofstream (filename_.c_str (), std::ios::out | std::ios::binary | std::ios::trunc));
+        if (! *_out_)
+          {
+            _out_.reset (0);
+            DT_THROW_IF (true, std::runtime_error, "Cannot open native columnar file '" << filename_ << "' !");
+          }
+        _filename_ = filename_;
+        _branch_manager_ = &branch_manager_;
+        _store_bits_ = store_bits_;
+        _position_ = 0;
+        _number_of_entries_ = 0;
+        _page_fill_ = 0;
+        _pages_.clear ();
+
+        // Build the column descriptors from the branch entries :
+        std::vector<branch_entry_type *> entries;
+        _collect_columns (branch_manager_, store_bits_, entries);
+        _collect_metadata (branch_manager_, store_bits_, _metadata_);
+        _buffers_.clear ();
+        _columns_.clear ();
+        _buffers_.resize (entries.size ());
+        _columns_.resize (entries.size ());
+        for (size_t i = 0; i < entries.size (); i++)
+          {
+            branch_entry_type & be = *entries[i];
+            native_column_info & info = _columns_[i];
+            info.name  = be.get_name ();
+            info.bank  = be.get_parent_name ();
+            if (info.bank.empty ())
+              {
+                info.bank = info.name.substr (0, info.name.find ('@'));
+              }
+            info.leaf  = be.get_leaf_name ();
+            info.unit  = be.get_unit ();
+            info.topic = be.get_topic ();
+            info.type  = be.get_type ();
+            info.array = be.is_array ();
+            if (info.array && ! be.has_fixed_size ())
+              {
+                info.size_column = be.get_array_size_name ();
+              }
+            column_buffer_type & buffer = _buffers_[i];
+            buffer.entry = &be;
+            buffer.value_size = branch_entry_type::get_type_size (be.get_type ());
+            buffer.values_count = 0;
+            buffer.offsets.assign (1, 0);
+          }
+
+        // Header :
+        const uint32_t version = native_columnar_format::FORMAT_VERSION;
+        const uint32_t endian_marker = native_columnar_format::ENDIAN_MARKER;
+        const uint64_t reserved = 0;
+        _write (native_columnar_format::HEADER_MAGIC, 8);
+        _write (&version, sizeof (version));
+        _write (&endian_marker, sizeof (endian_marker));
+        _write (&reserved, sizeof (reserved));
+        _write (&reserved, sizeof (reserved));
+        DT_LOG_DEBUG (get_logging_priority (), "Native columnar file '" << _filename_ << "' is open with "
+                      << _columns_.size () << " columns.");
+        DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+        return;
+      }
+
+      void native_column_sink::store_entry ()
+      {
+        DT_THROW_IF (! is_open (), std::logic_error, "Sink is not open !");
+        for (size_t i = 0; i < _buffers_.size (); i++)
+          {
+            column_buffer_type & buffer = _buffers_[i];
+            branch_entry_type & be = *buffer.entry;
+            const unsigned int n = _branch_manager_->get_array_size (be);
+            if (n > 0)
+              {
+                const char * data = static_cast<const char *>(be.get_address ());
+                buffer.values.insert (buffer.values.end (), data, data + n * buffer.value_size);
+                buffer.values_count += n;
+              }
+            if (be.is_array ())
+              {
+                buffer.offsets.push_back (buffer.offsets.back () + n);
+              }
+          }
+        _page_fill_++;
+        _number_of_entries_++;
+        if (_page_fill_ >= _page_entries_)
+          {
+            _flush_page ();
+          }
+        return;
+      }
+
+      void native_column_sink::_flush_page ()
+      {
+        if (_page_fill_ == 0) return;
+        DT_LOG_TRACE (get_logging_priority (), "Flushing page #" << _pages_.size ()
+                      << " with " << _page_fill_ << " entries...");
+        native_page_info page;
+        page.first_entry = _number_of_entries_ - _page_fill_;
+        page.entries = _page_fill_;
+        page.chunks.resize (_buffers_.size ());
+        for (size_t i = 0; i < _buffers_.size (); i++)
+          {
+            column_buffer_type & buffer = _buffers_[i];
+            native_column_chunk & chunk = page.chunks[i];
+            _pad ();
+            chunk.values_offset = _position_;
+            chunk.values_count = buffer.values_count;
+            if (! buffer.values.empty ())
+              {
+                _write (buffer.values.data (), buffer.values.size ());
+              }
+            chunk.offsets_offset = 0;
+            if (_columns_[i].array)
+              {
+                _pad ();
+                chunk.offsets_offset = _position_;
+                _write (buffer.offsets.data (), buffer.offsets.size () * sizeof (uint32_t));
+              }
+            buffer.values.clear ();
+            buffer.values_count = 0;
+            buffer.offsets.assign (1, 0);
+          }
+        _pages_.push_back (page);
+        _page_fill_ = 0;
+        return;
+      }
+
+      namespace {
+
+        void encode_string (std::vector<char> & footer_, const std::string & value_)
+        {
+          const uint32_t length = value_.size ();
+          const char * l = reinterpret_cast<const char *>(&length);
+          footer_.insert (footer_.end (), l, l + sizeof (length));
+          footer_.insert (footer_.end (), value_.begin (), value_.end ());
+          return;
+        }
+
+        template<class T>
+        void encode (std::vector<char> & footer_, T value_)
+        {
+          const char * v = reinterpret_cast<const char *>(&value_);
+          footer_.insert (footer_.end (), v, v + sizeof (T));
+          return;
+        }
+
+      }
+
+      void native_column_sink::_write_footer ()
+      {
+        std::vector<char> footer;
+        encode<uint32_t> (footer, _columns_.size ());
+        for (size_t i = 0; i < _columns_.size (); i++)
+          {
+            const native_column_info & info = _columns_[i];
+            encode_string (footer, info.name);
+            encode_string (footer, info.bank);
+            encode_string (footer, info.leaf);
+            encode_string (footer, info.unit);
+            encode_string (footer, info.topic);
+            encode_string (footer, info.size_column);
+            encode<int32_t> (footer, info.type);
+            encode<uint8_t> (footer, info.array ? 1 : 0);
+          }
+        encode<uint32_t> (footer, _metadata_.size ());
+        for (std::map<std::string, std::string>::const_iterator i = _metadata_.begin ();
+             i != _metadata_.end ();
+             i++)
+          {
+            encode_string (footer, i->first);
+            encode_string (footer, i->second);
+          }
+        encode<uint32_t> (footer, _pages_.size ());
+        for (size_t ipage = 0; ipage < _pages_.size (); ipage++)
+          {
+            const native_page_info & page = _pages_[ipage];
+            encode<uint64_t> (footer, page.first_entry);
+            encode<uint32_t> (footer, page.entries);
+            for (size_t icol = 0; icol < page.chunks.size (); icol++)
+              {
+                encode<uint64_t> (footer, page.chunks[icol].values_offset);
+                encode<uint64_t> (footer, page.chunks[icol].values_count);
+                encode<uint64_t> (footer, page.chunks[icol].offsets_offset);
+              }
+          }
+        _pad ();
+        const uint64_t footer_offset = _position_;
+        const uint64_t footer_size = footer.size ();
+        _write (footer.data (), footer.size ());
+        _write (&footer_offset, sizeof (footer_offset));
+        _write (&footer_size, sizeof (footer_size));
+        _write (native_columnar_format::TRAILER_MAGIC, 8);
+        return;
+      }
+
+      void native_column_sink::close ()
+      {
+        DT_LOG_TRACE (get_logging_priority (), "Entering...");
+        if (! is_open ()) return;
+        _flush_page ();
+        _write_footer ();
+        _out_->close ();
+        _out_.reset (0);
+        DT_LOG_DEBUG (get_logging_priority (), "Native columnar file '" << _filename_ << "' is closed ("
+                      << _number_of_entries_ << " entries, " << _pages_.size () << " pages, "
+                      << _position_ << " bytes).");
+        _buffers_.clear ();
+        _columns_.clear ();
+        _pages_.clear ();
+        _metadata_.clear ();
+        _branch_manager_ = 0;
+        _filename_.clear ();
+        DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+        return;
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of native_column_sink.cc
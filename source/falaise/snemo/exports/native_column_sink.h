@@ -0,0 +1,117 @@
+// -*- mode: c++ ; -*-
+/* native_column_sink.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Writer for the native chunked columnar export format
+ *
+ * History:
+ *
+ */
+
+#ifndef SNRECONSTRUCTION_EXPORTS_NATIVE_COLUMN_SINK_H
+#define SNRECONSTRUCTION_EXPORTS_NATIVE_COLUMN_SINK_H 1
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <falaise/snemo/exports/column_sink.h>
+#include <falaise/snemo/exports/native_columnar_format.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      /// \brief Column sink for the native memory-mappable columnar format
+      class native_column_sink : public column_sink
+      {
+      public:
+
+        static const unsigned int DEFAULT_PAGE_ENTRIES = 4096;
+
+        /// Default constructor
+        native_column_sink ();
+
+        /// Destructor
+        virtual ~native_column_sink ();
+
+        /// Configure the sink
+        virtual void initialize (const datatools::properties & config_);
+
+        /// Set the number of entries per page
+        void set_page_entries (unsigned int page_entries_);
+
+        /// Return the number of entries per page
+        unsigned int get_page_entries () const;
+
+        /// Open a new output file
+        virtual void open (const std::string & filename_,
+                           branch_manager & branch_manager_,
+                           uint32_t store_bits_);
+
+        /// Store the current content of the branch memory as a new entry
+        virtual void store_entry ();
+
+        /// Close the current output file
+        virtual void close ();
+
+        /// Check if an output file is open
+        virtual bool is_open () const;
+
+        /// Return the label of the format
+        virtual std::string get_format () const;
+
+      protected:
+
+        void _write (const void * data_, uint64_t size_);
+
+        void _pad ();
+
+        void _flush_page ();
+
+        void _write_footer ();
+
+      private:
+
+        /// In-memory page of a column
+        struct column_buffer_type
+        {
+          branch_entry_type *   entry;        /// The source branch entry
+          unsigned int          value_size;   /// Size of a value in bytes
+          std::vector<char>     values;       /// Values of the current page
+          uint64_t              values_count; /// Number of values in the current page
+          std::vector<uint32_t> offsets;      /// Offsets of the current page (array columns)
+        };
+
+        unsigned int                       _page_entries_;      /// Number of entries per page
+        std::string                        _filename_;          /// Name of the current file
+        boost::scoped_ptr<std::ofstream>   _out_;               /// Output stream
+        branch_manager *                   _branch_manager_;    /// Source branch manager
+        uint32_t                           _store_bits_;        /// Store bits
+        uint64_t                           _position_;          /// Current position in the file
+        uint64_t                           _number_of_entries_; /// Number of stored entries
+        uint32_t                           _page_fill_;         /// Number of entries in the current page
+        std::vector<column_buffer_type>    _buffers_;           /// Column buffers
+        std::vector<native_column_info>    _columns_;           /// Column descriptors
+        std::vector<native_page_info>      _pages_;             /// Page index
+        std::map<std::string, std::string> _metadata_;          /// File metadata
+
+      };
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // SNRECONSTRUCTION_EXPORTS_NATIVE_COLUMN_SINK_H
+
+// end of native_column_sink.h
@@ -0,0 +1,368 @@
+// -*- mode: c++ ; -*-
+/* native_columnar_format.cc */
+
+#include <falaise/snemo/exports/native_columnar_format.h>
+
+#include <cstring>
+#include <algorithm>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <datatools/exception.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      const char native_columnar_format::HEADER_MAGIC[8]  = { 'S', 'N', 'C', 'O', 'L', '0', '0', '1' };
+      const char native_columnar_format::TRAILER_MAGIC[8] = { 'S', 'N', 'C', 'O', 'L', 'E', 'N', 'D' };
+
+      // static
+      uint64_t native_columnar_format::aligned (uint64_t offset_)
+      {
+        return (offset_ + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+      }
+
+      // static
+      unsigned int native_columnar_format::get_type_size (int type_)
+      {
+        switch (type_)
+          {
+          case TYPE_BOOLEAN : return 1;
+          case TYPE_CHAR    : return 1;
+          case TYPE_UCHAR   : return 1;
+          case TYPE_INT16   : return 2;
+          case TYPE_UINT16  : return 2;
+          case TYPE_INT32   : return 4;
+          case TYPE_UINT32  : return 4;
+          case TYPE_INT64   : return 8;
+          case TYPE_UINT64  : return 8;
+          case TYPE_FLOAT   : return 4;
+          case TYPE_DOUBLE  : return 8;
+          }
+        return 0;
+      }
+
+      namespace {
+
+        /// Sequential decoder of the footer
+        struct footer_decoder
+        {
+          footer_decoder (const char * data_, uint64_t size_)
+            : data (data_), size (size_), pos (0) {}
+
+          template<class T>
+          T read ()
+          {
+            DT_THROW_IF (sizeof (T) > size - pos, std::runtime_error,
+                         "Truncated footer in native columnar file !");
+            T value;
+            std::memcpy (&value, data + pos, sizeof (T));
+            pos += sizeof (T);
+            return value;
+          }
+
+          std::string read_string ()
+          {
+            const uint32_t length = read<uint32_t> ();
+            DT_THROW_IF (length > size - pos, std::runtime_error,
+                         "Truncated footer in native columnar file !");
+            std::string value (data + pos, length);
+            pos += length;
+            return value;
+          }
+
+          const char * data;
+          uint64_t     size;
+          uint64_t     pos;
+        };
+
+      }
+
+      native_column_reader::native_column_reader ()
+      {
+        _fd_ = -1;
+        _map_ = 0;
+        _map_size_ = 0;
+        _number_of_entries_ = 0;
+        return;
+      }
+
+      native_column_reader::~native_column_reader ()
+      {
+        close ();
+        return;
+      }
+
+      bool native_column_reader::is_open () const
+      {
+        return _map_ != 0;
+      }
+
+      void native_column_reader::open (const std::string & filename_)
+      {
+        DT_THROW_IF (is_open (), std::logic_error, "Reader is already open !");
+        _fd_ = ::open (filename_.c_str (), O_RDONLY);
+        DT_THROW_IF (_fd_ < 0, std::runtime_error, "Cannot open file '" << filename_ << "' !");
+        struct stat file_stat;
+        if (::fstat (_fd_, &file_stat) != 0)
+          {
+            ::close (_fd_);
+            _fd_ = -1;
+            DT_THROW_IF (true, std::runtime_error, "Cannot stat file '" << filename_ << "' !");
+          }
+        _map_size_ = file_stat.st_size;
+        if (_map_size_ < native_columnar_format::HEADER_SIZE + native_columnar_format::TRAILER_SIZE)
+          {
+            ::close (_fd_);
+            _fd_ = -1;
+            DT_THROW_IF (true, std::runtime_error, "File '" << filename_ << "' is too short !");
+          }
+        void * addr = ::mmap (0, _map_size_, PROT_READ, MAP_SHARED, _fd_, 0);
+        if (addr == MAP_FAILED)
+          {
+            ::close (_fd_);
+            _fd_ = -1;
+            DT_THROW_IF (true, std::runtime_error, "Cannot map file '" << filename_ << "' !");
+          }
+        _map_ = static_cast<const char *>(addr);
+        _filename_ = filename_;
+        try
+          {
+            _parse_footer ();
+          }
+        catch (...)
+          {
+            close ();
+            throw;
+          }
+        return;
+      }
+
+      void native_column_reader::close ()
+      {
+        if (_map_ != 0)
+          {
+            ::munmap (const_cast<char *>(_map_), _map_size_);
+            _map_ = 0;
+          }
+        if (_fd_ >= 0)
+          {
+            ::close (_fd_);
+            _fd_ = -1;
+          }
+        _map_size_ = 0;
+        _number_of_entries_ = 0;
+        _filename_.clear ();
+        _columns_.clear ();
+        _column_dict_.clear ();
+        _metadata_.clear ();
+        _pages_.clear ();
+        return;
+      }
+
+      const char * native_column_reader::_raw (uint64_t offset_, uint64_t size_) const
+      {
+        // The range is checked with no overflow, the offset and size may come from a corrupt footer :
+        DT_THROW_IF (size_ > _map_size_ || offset_ > _map_size_ - size_, std::range_error,
+                     "Invalid range of " << size_ << " bytes at offset " << offset_
+                     << " in file '" << _filename_ << "' !");
+        return _map_ + offset_;
+      }
+
+      void native_column_reader::_parse_footer ()
+      {
+        DT_THROW_IF (std::memcmp (_map_, native_columnar_format::HEADER_MAGIC, 8) != 0,
+                     std::runtime_error, "File '" << _filename_ << "' is not a native columnar file !");
+        uint32_t version;
+        uint32_t endian_marker;
+        std::memcpy (&version, _map_ + 8, sizeof (uint32_t));
+        std::memcpy (&endian_marker, _map_ + 12, sizeof (uint32_t));
+        DT_THROW_IF (version > native_columnar_format::FORMAT_VERSION, std::runtime_error,
+                     "Unsupported format version " << version << " in file '" << _filename_ << "' !");
+        DT_THROW_IF (endian_marker != native_columnar_format::ENDIAN_MARKER, std::runtime_error,
+                     "File '" << _filename_ << "' was written with a different byte order !");
+
+        const char * trailer = _raw (_map_size_ - native_columnar_format::TRAILER_SIZE,
+                                     native_columnar_format::TRAILER_SIZE);
+        DT_THROW_IF (std::memcmp (trailer + 16, native_columnar_format::TRAILER_MAGIC, 8) != 0,
+                     std::runtime_error, "File '" << _filename_ << "' has no valid trailer (truncated file ?) !");
+        uint64_t footer_offset;
+        uint64_t footer_size;
+        std::memcpy (&footer_offset, trailer, sizeof (uint64_t));
+        std::memcpy (&footer_size, trailer + 8, sizeof (uint64_t));
+
+        footer_decoder decoder (_raw (footer_offset, footer_size), footer_size);
+        const uint32_t ncolumns = decoder.read<uint32_t> ();
+        _columns_.reserve (ncolumns);
+        for (uint32_t icol = 0; icol < ncolumns; icol++)
+          {
+            native_column_info info;
+            info.name        = decoder.read_string ();
+            info.bank        = decoder.read_string ();
+            info.leaf        = decoder.read_string ();
+            info.unit        = decoder.read_string ();
+            info.topic       = decoder.read_string ();
+            info.size_column = decoder.read_string ();
+            info.type        = decoder.read<int32_t> ();
+            info.array       = decoder.read<uint8_t> () != 0;
+            _column_dict_[info.name] = _columns_.size ();
+            _columns_.push_back (info);
+          }
+        const uint32_t nmetadata = decoder.read<uint32_t> ();
+        for (uint32_t imeta = 0; imeta < nmetadata; imeta++)
+          {
+            const std::string key = decoder.read_string ();
+            _metadata_[key] = decoder.read_string ();
+          }
+        const uint32_t npages = decoder.read<uint32_t> ();
+        _pages_.reserve (npages);
+        for (uint32_t ipage = 0; ipage < npages; ipage++)
+          {
+            native_page_info page;
+            page.first_entry = decoder.read<uint64_t> ();
+            page.entries     = decoder.read<uint32_t> ();
+            page.chunks.resize (ncolumns);
+            for (uint32_t icol = 0; icol < ncolumns; icol++)
+              {
+                native_column_chunk & chunk = page.chunks[icol];
+                chunk.values_offset  = decoder.read<uint64_t> ();
+                chunk.values_count   = decoder.read<uint64_t> ();
+                chunk.offsets_offset = decoder.read<uint64_t> ();
+              }
+            _number_of_entries_ += page.entries;
+            _pages_.push_back (page);
+          }
+        return;
+      }
+
+      uint64_t native_column_reader::get_number_of_entries () const
+      {
+        return _number_of_entries_;
+      }
+
+      std::size_t native_column_reader::get_number_of_pages () const
+      {
+        return _pages_.size ();
+      }
+
+      const native_page_info & native_column_reader::get_page (std::size_t page_) const
+      {
+        DT_THROW_IF (page_ >= _pages_.size (), std::range_error, "Invalid page index " << page_ << " !");
+        return _pages_[page_];
+      }
+
+      namespace {
+        struct page_entry_compare
+        {
+          bool operator() (uint64_t entry_, const native_page_info & page_) const
+          {
+            return entry_ < page_.first_entry;
+          }
+        };
+      }
+
+      std::size_t native_column_reader::get_page_of_entry (uint64_t entry_) const
+      {
+        DT_THROW_IF (entry_ >= _number_of_entries_, std::range_error, "Invalid entry " << entry_ << " !");
+        std::vector<native_page_info>::const_iterator found
+          = std::upper_bound (_pages_.begin (), _pages_.end (), entry_, page_entry_compare ());
+        return (found - _pages_.begin ()) - 1;
+      }
+
+      const std::vector<native_column_info> & native_column_reader::get_columns () const
+      {
+        return _columns_;
+      }
+
+      bool native_column_reader::has_column (const std::string & name_) const
+      {
+        return _column_dict_.find (name_) != _column_dict_.end ();
+      }
+
+      std::size_t native_column_reader::get_column_index (const std::string & name_) const
+      {
+        std::map<std::string, std::size_t>::const_iterator found = _column_dict_.find (name_);
+        DT_THROW_IF (found == _column_dict_.end (), std::logic_error,
+                     "No column named '" << name_ << "' in file '" << _filename_ << "' !");
+        return found->second;
+      }
+
+      const std::map<std::string, std::string> & native_column_reader::get_metadata () const
+      {
+        return _metadata_;
+      }
+
+      const void * native_column_reader::_chunk_values (std::size_t column_,
+                                                        std::size_t page_,
+                                                        int type_) const
+      {
+        const native_column_info & info = _columns_[column_];
+        DT_THROW_IF (info.type != type_, std::logic_error,
+                     "Column '" << info.name << "' has type " << info.type
+                     << " ; requested type is " << type_ << " !");
+        const native_column_chunk & chunk = get_page (page_).chunks[column_];
+        const uint64_t type_size = native_columnar_format::get_type_size (info.type);
+        DT_THROW_IF (chunk.values_count > _map_size_ / type_size, std::range_error,
+                     "Invalid number of values (" << chunk.values_count << ") of column '" << info.name
+                     << "' in file '" << _filename_ << "' !");
+        return _raw (chunk.values_offset, chunk.values_count * type_size);
+      }
+
+      column_span<uint32_t> native_column_reader::get_offsets (const std::string & name_,
+                                                               std::size_t page_) const
+      {
+        const std::size_t icol = get_column_index (name_);
+        DT_THROW_IF (! _columns_[icol].array, std::logic_error,
+                     "Column '" << name_ << "' is not an array column !");
+        const native_page_info & page = get_page (page_);
+        const native_column_chunk & chunk = page.chunks[icol];
+        const uint64_t noffsets = static_cast<uint64_t> (page.entries) + 1;
+        const char * addr = _raw (chunk.offsets_offset, noffsets * sizeof (uint32_t));
+        return column_span<uint32_t> (reinterpret_cast<const uint32_t *>(addr), noffsets);
+      }
+
+      void native_column_reader::print (std::ostream & out_,
+                                        const std::string & title_,
+                                        const std::string & indent_) const
+      {
+        if (! title_.empty ())
+          {
+            out_ << indent_ << title_ << " : " << std::endl;
+          }
+        out_ << indent_ << "|-- " << "File     : '" << _filename_ << "'" << std::endl;
+        out_ << indent_ << "|-- " << "Entries  : " << _number_of_entries_ << std::endl;
+        out_ << indent_ << "|-- " << "Pages    : " << _pages_.size () << std::endl;
+        out_ << indent_ << "|-- " << "Metadata : " << _metadata_.size () << std::endl;
+        for (std::map<std::string, std::string>::const_iterator i = _metadata_.begin ();
+             i != _metadata_.end ();
+             i++)
+          {
+            out_ << indent_ << "|   " << "|-- " << i->first << " = '" << i->second << "'" << std::endl;
+          }
+        out_ << indent_ << "`-- " << "Columns  : " << _columns_.size () << std::endl;
+        for (size_t i = 0; i < _columns_.size (); i++)
+          {
+            const native_column_info & info = _columns_[i];
+            out_ << indent_ << "    " << (i + 1 == _columns_.size () ? "`-- " : "|-- ")
+                 << info.name << " (type=" << info.type;
+            if (info.array) out_ << ", size=" << info.size_column;
+            if (! info.unit.empty ()) out_ << ", unit=" << info.unit;
+            out_ << ")" << std::endl;
+          }
+        return;
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of native_columnar_format.cc
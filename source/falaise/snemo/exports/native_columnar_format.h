@@ -0,0 +1,256 @@
+// -*- mode: c++ ; -*-
+/* native_columnar_format.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Native chunked columnar export format and its memory mapped reader
+ *
+ *   File layout (all integers use the native byte order, see 'endian_marker') :
+ *
+ *     header  : magic "SNCOL001", uint32 format version, uint32 endian marker,
+ *               uint64 reserved, uint64 reserved
+ *     pages   : for each page and each column (8-bytes aligned) :
+ *                 - the fixed-width values of the column,
+ *                 - for array columns : the uint32 offsets array (entries+1 items)
+ *                   built from the '@size' column of the bank
+ *     footer  : the column descriptors, the file metadata and the page index
+ *     trailer : uint64 footer offset, uint64 footer size, magic "SNCOLEND"
+ *
+ *   The reader maps the file in memory and hands out typed spans over the
+ *   column pages without copying nor deserializing the data.
+ *
+ * History:
+ *
+ */
+
+#ifndef SNRECONSTRUCTION_EXPORTS_NATIVE_COLUMNAR_FORMAT_H
+#define SNRECONSTRUCTION_EXPORTS_NATIVE_COLUMNAR_FORMAT_H 1
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/cstdint.hpp>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      struct native_columnar_format
+      {
+        static const char     HEADER_MAGIC[8];  /// Magic tag at the beginning of the file
+        static const char     TRAILER_MAGIC[8]; /// Magic tag at the end of the file
+        static const uint32_t FORMAT_VERSION = 1;
+        static const uint32_t ENDIAN_MARKER  = 0x01020304;
+        static const uint32_t HEADER_SIZE    = 32;
+        static const uint32_t TRAILER_SIZE   = 24;
+        static const uint32_t ALIGNMENT      = 8;
+
+        /// Column value types (same codes than branch_entry_type::branch_type)
+        enum column_type
+          {
+            TYPE_UNDEFINED = 0,
+            TYPE_BOOLEAN = 1, // stored as uint8_t
+            TYPE_CHAR    = 2,
+            TYPE_UCHAR   = 3,
+            TYPE_INT16   = 4,
+            TYPE_UINT16  = 5,
+            TYPE_INT32   = 6,
+            TYPE_UINT32  = 7,
+            TYPE_INT64   = 8,
+            TYPE_UINT64  = 9,
+            TYPE_FLOAT   = 10,
+            TYPE_DOUBLE  = 11
+          };
+
+        static uint64_t aligned (uint64_t offset_);
+
+        static unsigned int get_type_size (int type_);
+      };
+
+      /// Compile-time mapping of C++ types onto column value types
+      template<class T> struct native_column_traits;
+      template<> struct native_column_traits<bool>     { static const int type = native_columnar_format::TYPE_BOOLEAN; };
+      template<> struct native_column_traits<int8_t>   { static const int type = native_columnar_format::TYPE_CHAR; };
+      template<> struct native_column_traits<uint8_t>  { static const int type = native_columnar_format::TYPE_UCHAR; };
+      template<> struct native_column_traits<int16_t>  { static const int type = native_columnar_format::TYPE_INT16; };
+      template<> struct native_column_traits<uint16_t> { static const int type = native_columnar_format::TYPE_UINT16; };
+      template<> struct native_column_traits<int32_t>  { static const int type = native_columnar_format::TYPE_INT32; };
+      template<> struct native_column_traits<uint32_t> { static const int type = native_columnar_format::TYPE_UINT32; };
+      template<> struct native_column_traits<int64_t>  { static const int type = native_columnar_format::TYPE_INT64; };
+      template<> struct native_column_traits<uint64_t> { static const int type = native_columnar_format::TYPE_UINT64; };
+      template<> struct native_column_traits<float>    { static const int type = native_columnar_format::TYPE_FLOAT; };
+      template<> struct native_column_traits<double>   { static const int type = native_columnar_format::TYPE_DOUBLE; };
+
+      /// Non-owning typed view on a contiguous range of mapped values
+      template<class T>
+      struct column_span
+      {
+      public:
+        column_span () : _data_ (0), _size_ (0) {}
+        column_span (const T * data_, std::size_t size_) : _data_ (data_), _size_ (size_) {}
+        const T * data () const { return _data_; }
+        std::size_t size () const { return _size_; }
+        bool empty () const { return _size_ == 0; }
+        const T * begin () const { return _data_; }
+        const T * end () const { return _data_ + _size_; }
+        const T & operator[] (std::size_t i_) const { return _data_[i_]; }
+        column_span<T> subspan (std::size_t first_, std::size_t count_) const
+        {
+          return column_span<T> (_data_ + first_, count_);
+        }
+      private:
+        const T *   _data_; /// Address of the first value
+        std::size_t _size_; /// Number of values
+      };
+
+      /// Descriptor of a column stored in a native columnar file
+      struct native_column_info
+      {
+        std::string name;        /// Full name of the column (ex: "calibTrackerHits.x")
+        std::string bank;        /// Name of the bank (ex: "calibTrackerHits")
+        std::string leaf;        /// Name of the leaf (ex: "x")
+        std::string unit;        /// Unit
+        std::string topic;       /// Topic
+        std::string size_column; /// Name of the size column for array columns
+        int32_t     type;        /// Value type
+        bool        array;       /// Array flag
+      };
+
+      /// Location of a column chunk in a page
+      struct native_column_chunk
+      {
+        uint64_t values_offset;  /// Offset of the first value in the file
+        uint64_t values_count;   /// Number of values
+        uint64_t offsets_offset; /// Offset of the offsets array in the file (0 for scalar columns)
+      };
+
+      /// Page index
+      struct native_page_info
+      {
+        uint64_t first_entry; /// Index of the first entry in the page
+        uint32_t entries;     /// Number of entries in the page
+        std::vector<native_column_chunk> chunks; /// Column chunks (same order than columns)
+      };
+
+      /// \brief Zero-copy reader of native columnar files
+      class native_column_reader
+      {
+      public:
+
+        /// Default constructor
+        native_column_reader ();
+
+        /// Destructor
+        ~native_column_reader ();
+
+        /// Map a file in memory
+        void open (const std::string & filename_);
+
+        /// Unmap the current file
+        void close ();
+
+        /// Check if a file is mapped
+        bool is_open () const;
+
+        /// Return the total number of entries
+        uint64_t get_number_of_entries () const;
+
+        /// Return the number of pages
+        std::size_t get_number_of_pages () const;
+
+        /// Return the page index
+        const native_page_info & get_page (std::size_t page_) const;
+
+        /// Return the page that contains a given entry
+        std::size_t get_page_of_entry (uint64_t entry_) const;
+
+        /// Return the column descriptors
+        const std::vector<native_column_info> & get_columns () const;
+
+        /// Check if a column exists
+        bool has_column (const std::string & name_) const;
+
+        /// Return the index of a column
+        std::size_t get_column_index (const std::string & name_) const;
+
+        /// Return the file metadata
+        const std::map<std::string, std::string> & get_metadata () const;
+
+        /// Return the typed values of a column in a given page
+        template<class T>
+        column_span<T> get_values (const std::string & name_, std::size_t page_) const;
+
+        /// Return the offsets (entries+1 items) of an array column in a given page
+        column_span<uint32_t> get_offsets (const std::string & name_, std::size_t page_) const;
+
+        /// Return the typed values of a column for a given entry
+        template<class T>
+        column_span<T> get_entry_values (const std::string & name_, uint64_t entry_) const;
+
+        /// Smart print
+        void print (std::ostream & out_ = std::clog,
+                    const std::string & title_ = "",
+                    const std::string & indent_ = "") const;
+
+      protected:
+
+        const char * _raw (uint64_t offset_, uint64_t size_) const;
+
+        const void * _chunk_values (std::size_t column_, std::size_t page_, int type_) const;
+
+        void _parse_footer ();
+
+      private:
+
+        std::string _filename_;   /// Name of the mapped file
+        int         _fd_;         /// File descriptor
+        const char * _map_;       /// Address of the mapped file
+        uint64_t    _map_size_;   /// Size of the mapped file
+        uint64_t    _number_of_entries_;
+        std::vector<native_column_info>     _columns_;
+        std::map<std::string, std::size_t>  _column_dict_;
+        std::map<std::string, std::string>  _metadata_;
+        std::vector<native_page_info>       _pages_;
+      };
+
+      template<class T>
+      column_span<T> native_column_reader::get_values (const std::string & name_,
+                                                      std::size_t page_) const
+      {
+        const std::size_t icol = get_column_index (name_);
+        const void * addr = _chunk_values (icol, page_, native_column_traits<T>::type);
+        return column_span<T> (static_cast<const T *>(addr),
+                               _pages_[page_].chunks[icol].values_count);
+      }
+
+      template<class T>
+      column_span<T> native_column_reader::get_entry_values (const std::string & name_,
+                                                            uint64_t entry_) const
+      {
+        const std::size_t page = get_page_of_entry (entry_);
+        const std::size_t local = entry_ - _pages_[page].first_entry;
+        column_span<T> values = get_values<T> (name_, page);
+        if (! _columns_[get_column_index (name_)].array)
+          {
+            return values.subspan (local, 1);
+          }
+        column_span<uint32_t> offsets = get_offsets (name_, page);
+        return values.subspan (offsets[local], offsets[local + 1] - offsets[local]);
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // SNRECONSTRUCTION_EXPORTS_NATIVE_COLUMNAR_FORMAT_H
+
+// end of native_columnar_format.h
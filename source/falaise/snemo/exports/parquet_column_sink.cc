@@ -0,0 +1,437 @@
+// -*- mode: c++ ; -*-
+/* parquet_column_sink.cc */
+
+#include <falaise/snemo/exports/parquet_column_sink.h>
+#include <falaise/snemo/exports/root_utils.h>
+
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+#include <boost/algorithm/string.hpp>
+
+#include <datatools/properties.h>
+#include <datatools/exception.h>
+#include <datatools/logger.h>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/properties.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      namespace {
+
+        void check_arrow_status (const arrow::Status & status_, const std::string & what_)
+        {
+          DT_THROW_IF (! status_.ok (), std::runtime_error,
+                       "Arrow/Parquet error while " << what_ << " : " << status_.ToString () << " !");
+          return;
+        }
+
+        std::shared_ptr<arrow::DataType> arrow_type (int type_)
+        {
+          switch (type_)
+            {
+            case branch_entry_type::TYPE_BOOLEAN : return arrow::boolean ();
+            case branch_entry_type::TYPE_CHAR    : return arrow::int8 ();
+            case branch_entry_type::TYPE_UCHAR   : return arrow::uint8 ();
+            case branch_entry_type::TYPE_INT16   : return arrow::int16 ();
+            case branch_entry_type::TYPE_UINT16  : return arrow::uint16 ();
+            case branch_entry_type::TYPE_INT32   : return arrow::int32 ();
+            case branch_entry_type::TYPE_UINT32  : return arrow::uint32 ();
+            case branch_entry_type::TYPE_INT64   : return arrow::int64 ();
+            case branch_entry_type::TYPE_UINT64  : return arrow::uint64 ();
+            case branch_entry_type::TYPE_FLOAT   : return arrow::float32 ();
+            case branch_entry_type::TYPE_DOUBLE  : return arrow::float64 ();
+            }
+          DT_THROW_IF (true, std::logic_error, "Unsupported branch type (" << type_ << ") !");
+          return arrow::null ();
+        }
+
+        arrow::Compression::type arrow_compression (const std::string & label_)
+        {
+          if (label_ == "none")   return arrow::Compression::UNCOMPRESSED;
+          if (label_ == "snappy") return arrow::Compression::SNAPPY;
+          if (label_ == "gzip")   return arrow::Compression::GZIP;
+          if (label_ == "lz4")    return arrow::Compression::LZ4;
+          if (label_ == "zstd")   return arrow::Compression::ZSTD;
+          DT_THROW_IF (true, std::logic_error, "Unsupported Parquet compression codec '" << label_ << "' !");
+          return arrow::Compression::UNCOMPRESSED;
+        }
+
+        template<class ArrowType>
+        arrow::Status append_typed (arrow::ArrayBuilder * builder_, const void * values_, int64_t n_)
+        {
+          typedef typename arrow::TypeTraits<ArrowType>::BuilderType builder_type;
+          typedef typename ArrowType::c_type value_type;
+          return static_cast<builder_type *>(builder_)->AppendValues (static_cast<const value_type *>(values_), n_);
+        }
+
+        /// Append a contiguous range of branch values to an Arrow builder
+        arrow::Status append_values (arrow::ArrayBuilder * builder_, int type_, const void * values_, int64_t n_)
+        {
+          switch (type_)
+            {
+            case branch_entry_type::TYPE_BOOLEAN :
+              // Booleans are stored as unsigned chars in the branch memory :
+              return static_cast<arrow::BooleanBuilder *>(builder_)->AppendValues (static_cast<const uint8_t *>(values_), n_);
+            case branch_entry_type::TYPE_CHAR    : return append_typed<arrow::Int8Type> (builder_, values_, n_);
+            case branch_entry_type::TYPE_UCHAR   : return append_typed<arrow::UInt8Type> (builder_, values_, n_);
+            case branch_entry_type::TYPE_INT16   : return append_typed<arrow::Int16Type> (builder_, values_, n_);
+            case branch_entry_type::TYPE_UINT16  : return append_typed<arrow::UInt16Type> (builder_, values_, n_);
+            case branch_entry_type::TYPE_INT32   : return append_typed<arrow::Int32Type> (builder_, values_, n_);
+            case branch_entry_type::TYPE_UINT32  : return append_typed<arrow::UInt32Type> (builder_, values_, n_);
+            case branch_entry_type::TYPE_INT64   : return append_typed<arrow::Int64Type> (builder_, values_, n_);
+            case branch_entry_type::TYPE_UINT64  : return append_typed<arrow::UInt64Type> (builder_, values_, n_);
+            case branch_entry_type::TYPE_FLOAT   : return append_typed<arrow::FloatType> (builder_, values_, n_);
+            case branch_entry_type::TYPE_DOUBLE  : return append_typed<arrow::DoubleType> (builder_, values_, n_);
+            }
+          return arrow::Status::TypeError ("Unsupported branch type");
+        }
+
+        std::shared_ptr<arrow::Field> arrow_field (const std::string & name_,
+                                                   const std::shared_ptr<arrow::DataType> & type_,
+                                                   const branch_entry_type * entry_)
+        {
+          std::vector<std::string> keys;
+          std::vector<std::string> values;
+          if (entry_ != 0)
+            {
+              if (! entry_->get_unit ().empty ())
+                {
+                  keys.push_back ("unit");
+                  values.push_back (entry_->get_unit ());
+                }
+              if (! entry_->get_topic ().empty ())
+                {
+                  keys.push_back ("topic");
+                  values.push_back (entry_->get_topic ());
+                }
+            }
+          if (keys.empty ())
+            {
+              return arrow::field (name_, type_, false);
+            }
+          return arrow::field (name_, type_, false, arrow::key_value_metadata (keys, values));
+        }
+
+      }
+
+      /// Arrow/Parquet working data
+      struct parquet_column_sink::work_type
+      {
+        /// Source column
+        struct column_entry_type
+        {
+          branch_entry_type *  entry;   /// Source branch entry
+          arrow::ArrayBuilder * builder; /// Builder of the values
+        };
+
+        /// Top-level Parquet column (flat leaf, list of leaves or list of structs)
+        struct output_type
+        {
+          std::string                          name;    /// Column name
+          bool                                 list;    /// List flag
+          arrow::StructBuilder *               items;   /// Builder of the list items (list of structs only)
+          std::shared_ptr<arrow::ArrayBuilder> builder; /// Top-level builder
+          std::vector<column_entry_type>       members; /// Source columns
+        };
+
+        std::string                                  filename;
+        branch_manager *                             bm;
+        std::vector<output_type>                     outputs;
+        std::shared_ptr<arrow::Schema>               schema;
+        std::shared_ptr<arrow::io::FileOutputStream> outfile;
+        std::unique_ptr<parquet::arrow::FileWriter>  writer;
+        int64_t                                      row_fill;
+        uint64_t                                     number_of_entries;
+        unsigned int                                 number_of_row_groups;
+
+        work_type () : bm (0), row_fill (0), number_of_entries (0), number_of_row_groups (0) {}
+      };
+
+      parquet_column_sink::parquet_column_sink ()
+      {
+        _row_group_entries_ = DEFAULT_ROW_GROUP_ENTRIES;
+        _compression_ = "zstd";
+        _dictionary_ = true;
+        _statistics_ = true;
+        return;
+      }
+
+      parquet_column_sink::~parquet_column_sink ()
+      {
+        if (is_open ())
+          {
+            try
+              {
+                close ();
+              }
+            catch (std::exception & error)
+              {
+                DT_LOG_ERROR (get_logging_priority (), error.what ());
+              }
+          }
+        return;
+      }
+
+      void parquet_column_sink::initialize (const datatools::properties & config_)
+      {
+        this->column_sink::initialize (config_);
+        DT_THROW_IF (is_open (), std::logic_error, "Sink is open ! Cannot change its configuration !");
+        if (config_.has_key ("row_group_entries"))
+          {
+            const int row_group_entries = config_.fetch_integer ("row_group_entries");
+            DT_THROW_IF (row_group_entries < 1, std::domain_error,
+                         "Invalid number of entries per row group (" << row_group_entries << ") !");
+            _row_group_entries_ = row_group_entries;
+          }
+        if (config_.has_key ("compression"))
+          {
+            _compression_ = config_.fetch_string ("compression");
+            arrow_compression (_compression_);
+          }
+        if (config_.has_key ("dictionary"))
+          {
+            _dictionary_ = config_.fetch_boolean ("dictionary");
+          }
+        if (config_.has_key ("statistics"))
+          {
+            _statistics_ = config_.fetch_boolean ("statistics");
+          }
+        return;
+      }
+
+      bool parquet_column_sink::is_open () const
+      {
+        return _work_.get () != 0;
+      }
+
+      std::string parquet_column_sink::get_format () const
+      {
+        return "parquet";
+      }
+
+      void parquet_column_sink::open (const std::string & filename_,
+                                      branch_manager & branch_manager_,
+                                      uint32_t store_bits_)
+      {
+        DT_LOG_TRACE (get_logging_priority (), "Entering...");
+        DT_THROW_IF (is_open (), std::logic_error, "Sink is already open !");
+        boost::scoped_ptr<work_type> work (new work_type);
+        work->filename = filename_;
+        work->bm = &branch_manager_;
+        arrow::MemoryPool * pool = arrow::default_memory_pool ();
+
+        // Group the columns : array leaves sharing a '@size' counter make a bank
+        std::vector<branch_entry_type *> entries;
+        _collect_columns (branch_manager_, store_bits_, entries);
+        std::map<std::string, size_t> bank_outputs;
+        for (size_t i = 0; i < entries.size (); i++)
+          {
+            branch_entry_type & be = *entries[i];
+            // The list lengths already encode the bank sizes :
+            if (boost::ends_with (be.get_name (), "@size")) continue;
+            // Nullable and event scope leaves have their own lengths : they are stored as standalone lists
+            if (be.is_array () && ! be.has_fixed_size () && ! be.is_nullable () && ! be.is_event_scope ())
+              {
+                const std::string & bank = be.get_parent_name ();
+                std::map<std::string, size_t>::const_iterator found = bank_outputs.find (bank);
+                if (found == bank_outputs.end ())
+                  {
+                    bank_outputs[bank] = work->outputs.size ();
+                    work->outputs.push_back (work_type::output_type ());
+                    work->outputs.back ().name = bank;
+                    work->outputs.back ().list = true;
+                    work->outputs.back ().items = 0;
+                  }
+                work_type::column_entry_type column;
+                column.entry = &be;
+                column.builder = 0;
+                work->outputs[bank_outputs[bank]].members.push_back (column);
+                continue;
+              }
+            work->outputs.push_back (work_type::output_type ());
+            work_type::output_type & output = work->outputs.back ();
+            output.name = be.get_name ();
+            output.list = be.is_array ();
+            output.items = 0;
+            work_type::column_entry_type column;
+            column.entry = &be;
+            column.builder = 0;
+            output.members.push_back (column);
+          }
+
+        // Build the Arrow schema and the builders :
+        std::vector<std::shared_ptr<arrow::Field> > fields;
+        for (size_t i = 0; i < work->outputs.size (); i++)
+          {
+            work_type::output_type & output = work->outputs[i];
+            if (output.list && ! output.members.front ().entry->has_fixed_size ())
+              {
+                std::vector<std::shared_ptr<arrow::Field> > item_fields;
+                std::vector<std::shared_ptr<arrow::ArrayBuilder> > item_builders;
+                for (size_t j = 0; j < output.members.size (); j++)
+                  {
+                    const branch_entry_type * be = output.members[j].entry;
+                    std::shared_ptr<arrow::DataType> type = arrow_type (be->get_type ());
+                    arrow::Result<std::unique_ptr<arrow::ArrayBuilder> > builder = arrow::MakeBuilder (type, pool);
+                    check_arrow_status (builder.status (), "creating a column builder");
+                    item_builders.push_back (std::shared_ptr<arrow::ArrayBuilder> (std::move (*builder)));
+                    output.members[j].builder = item_builders.back ().get ();
+                    item_fields.push_back (arrow_field (be->get_leaf_name (), type, be));
+                  }
+                std::shared_ptr<arrow::DataType> item_type = arrow::struct_ (item_fields);
+                std::shared_ptr<arrow::StructBuilder> items
+                  = std::make_shared<arrow::StructBuilder> (item_type, pool, item_builders);
+                output.items = items.get ();
+                std::shared_ptr<arrow::DataType> list_type = arrow::list (item_type);
+                output.builder = std::make_shared<arrow::ListBuilder> (pool, items, list_type);
+                fields.push_back (arrow_field (output.name, list_type, 0));
+              }
+            else
+              {
+                const branch_entry_type * be = output.members.front ().entry;
+                std::shared_ptr<arrow::DataType> type = arrow_type (be->get_type ());
+                arrow::Result<std::unique_ptr<arrow::ArrayBuilder> > builder = arrow::MakeBuilder (type, pool);
+                check_arrow_status (builder.status (), "creating a column builder");
+                std::shared_ptr<arrow::ArrayBuilder> value_builder (std::move (*builder));
+                output.members.front ().builder = value_builder.get ();
+                if (output.list)
+                  {
+                    std::shared_ptr<arrow::DataType> list_type = arrow::list (type);
+                    output.builder = std::make_shared<arrow::ListBuilder> (pool, value_builder, list_type);
+                    fields.push_back (arrow_field (output.name, list_type, be));
+                  }
+                else
+                  {
+                    output.builder = value_builder;
+                    fields.push_back (arrow_field (output.name, type, be));
+                  }
+              }
+          }
+        std::map<std::string, std::string> metadata;
+        _collect_metadata (branch_manager_, store_bits_, metadata);
+        std::vector<std::string> metadata_keys;
+        std::vector<std::string> metadata_values;
+        for (std::map<std::string, std::string>::const_iterator i = metadata.begin ();
+             i != metadata.end ();
+             i++)
+          {
+            metadata_keys.push_back (i->first);
+            metadata_values.push_back (i->second);
+          }
+        work->schema = arrow::schema (fields, arrow::key_value_metadata (metadata_keys, metadata_values));
+
+        // Open the Parquet file :
+        arrow::Result<std::shared_ptr<arrow::io::FileOutputStream> > outfile
+          = arrow::io::FileOutputStream::Open (filename_);
+        check_arrow_status (outfile.status (), "opening file '" + filename_ + "'");
+        work->outfile = *outfile;
+        parquet::WriterProperties::Builder props_builder;
+        props_builder.compression (arrow_compression (_compression_));
+        props_builder.max_row_group_length (_row_group_entries_);
+        if (_dictionary_) props_builder.enable_dictionary ();
+        else props_builder.disable_dictionary ();
+        if (_statistics_) props_builder.enable_statistics ();
+        else props_builder.disable_statistics ();
+        std::shared_ptr<parquet::ArrowWriterProperties> arrow_props
+          = parquet::ArrowWriterProperties::Builder ().store_schema ()->build ();
+        arrow::Result<std::unique_ptr<parquet::arrow::FileWriter> > writer
+          = parquet::arrow::FileWriter::Open (*work->schema, pool, work->outfile,
+                                              props_builder.build (), arrow_props);
+        check_arrow_status (writer.status (), "creating the Parquet writer for '" + filename_ + "'");
+        work->writer = std::move (*writer);
+        _work_.swap (work);
+        DT_LOG_DEBUG (get_logging_priority (), "Parquet file '" << filename_ << "' is open with "
+                      << _work_->outputs.size () << " columns.");
+        DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+        return;
+      }
+
+      void parquet_column_sink::store_entry ()
+      {
+        DT_THROW_IF (! is_open (), std::logic_error, "Sink is not open !");
+        work_type & work = *_work_;
+        for (size_t i = 0; i < work.outputs.size (); i++)
+          {
+            work_type::output_type & output = work.outputs[i];
+            unsigned int n = 1;
+            if (output.list)
+              {
+                n = work.bm->get_array_size (*output.members.front ().entry);
+                check_arrow_status (static_cast<arrow::ListBuilder *>(output.builder.get ())->Append (),
+                                    "appending a list");
+                if (output.items != 0)
+                  {
+                    check_arrow_status (output.items->AppendValues (n, 0), "appending list items");
+                  }
+              }
+            if (n == 0) continue;
+            for (size_t j = 0; j < output.members.size (); j++)
+              {
+                branch_entry_type & be = *output.members[j].entry;
+                check_arrow_status (append_values (output.members[j].builder, be.get_type (),
+                                                   be.get_address (), n),
+                                    "appending the values of column '" + be.get_name () + "'");
+              }
+          }
+        work.row_fill++;
+        work.number_of_entries++;
+        if (work.row_fill >= (int64_t) _row_group_entries_)
+          {
+            _flush_row_group ();
+          }
+        return;
+      }
+
+      void parquet_column_sink::_flush_row_group ()
+      {
+        work_type & work = *_work_;
+        if (work.row_fill == 0) return;
+        DT_LOG_TRACE (get_logging_priority (), "Writing row group #" << work.number_of_row_groups
+                      << " with " << work.row_fill << " entries...");
+        std::vector<std::shared_ptr<arrow::Array> > arrays;
+        arrays.reserve (work.outputs.size ());
+        for (size_t i = 0; i < work.outputs.size (); i++)
+          {
+            std::shared_ptr<arrow::Array> array;
+            check_arrow_status (work.outputs[i].builder->Finish (&array),
+                                "finishing column '" + work.outputs[i].name + "'");
+            arrays.push_back (array);
+          }
+        std::shared_ptr<arrow::Table> table = arrow::Table::Make (work.schema, arrays, work.row_fill);
+        check_arrow_status (work.writer->WriteTable (*table, work.row_fill), "writing a row group");
+        work.number_of_row_groups++;
+        work.row_fill = 0;
+        return;
+      }
+
+      void parquet_column_sink::close ()
+      {
+        DT_LOG_TRACE (get_logging_priority (), "Entering...");
+        if (! is_open ()) return;
+        _flush_row_group ();
+        check_arrow_status (_work_->writer->Close (), "closing the Parquet writer");
+        check_arrow_status (_work_->outfile->Close (), "closing file '" + _work_->filename + "'");
+        DT_LOG_DEBUG (get_logging_priority (), "Parquet file '" << _work_->filename << "' is closed ("
+                      << _work_->number_of_entries << " entries, "
+                      << _work_->number_of_row_groups << " row groups).");
+        _work_.reset (0);
+        DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+        return;
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of parquet_column_sink.cc
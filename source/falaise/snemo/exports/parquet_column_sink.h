@@ -0,0 +1,93 @@
+// -*- mode: c++ ; -*-
+/* parquet_column_sink.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Apache Arrow/Parquet export sink (only built when the Arrow and
+ *   Parquet libraries are available)
+ *
+ *   One Parquet row is written per event :
+ *     - the leaves of scalar banks are flat columns named "<bank>.<leaf>",
+ *     - array banks (all leaves sharing the same '@size' counter) are
+ *       stored as a single list<struct<leaf...>> column named "<bank>",
+ *     - fixed size array leaves are stored as list<leaf> columns.
+ *
+ * History:
+ *
+ */
+
+#ifndef SNRECONSTRUCTION_EXPORTS_PARQUET_COLUMN_SINK_H
+#define SNRECONSTRUCTION_EXPORTS_PARQUET_COLUMN_SINK_H 1
+
+#include <string>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <falaise/snemo/exports/column_sink.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      /// \brief Column sink for the Apache Parquet format
+      class parquet_column_sink : public column_sink
+      {
+      public:
+
+        static const unsigned int DEFAULT_ROW_GROUP_ENTRIES = 16384;
+
+        /// Default constructor
+        parquet_column_sink ();
+
+        /// Destructor
+        virtual ~parquet_column_sink ();
+
+        /// Configure the sink
+        virtual void initialize (const datatools::properties & config_);
+
+        /// Open a new output file
+        virtual void open (const std::string & filename_,
+                           branch_manager & branch_manager_,
+                           uint32_t store_bits_);
+
+        /// Store the current content of the branch memory as a new entry
+        virtual void store_entry ();
+
+        /// Close the current output file
+        virtual void close ();
+
+        /// Check if an output file is open
+        virtual bool is_open () const;
+
+        /// Return the label of the format
+        virtual std::string get_format () const;
+
+      protected:
+
+        void _flush_row_group ();
+
+      private:
+
+        struct work_type; /// Arrow/Parquet working data (opaque)
+
+        unsigned int                 _row_group_entries_; /// Number of entries per row group
+        std::string                  _compression_;       /// Compression codec label
+        bool                         _dictionary_;        /// Dictionary encoding flag
+        bool                         _statistics_;        /// Column statistics flag
+        boost::scoped_ptr<work_type> _work_;              /// Working data of the open file
+
+      };
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // SNRECONSTRUCTION_EXPORTS_PARQUET_COLUMN_SINK_H
+
+// end of parquet_column_sink.h
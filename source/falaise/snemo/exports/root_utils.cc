@@ -7,12 +7,18 @@
 #include <stdexcept>
 #include <limits>
 #include <typeinfo>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
 
 #include <TTree.h>
 #include <TBranch.h>
+#include <TLeaf.h>
+#include <TObjArray.h>
 
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/join.hpp>
 #include <camp/class.hpp>
 
 #include <datatools/exception.h>
@@ -106,6 +112,25 @@ namespace snemo {
         return TYPE_UNDEFINED;
       }
 
+      // static
+      std::string branch_entry_type::get_branch_type_label (int bt_)
+      {
+        switch (bt_)
+          {
+          case TYPE_BOOLEAN : return "bool";
+          case TYPE_CHAR    : return "int8_t";
+          case TYPE_UCHAR   : return "uint8_t";
+          case TYPE_INT16   : return "int16_t";
+          case TYPE_UINT16  : return "uint16_t";
+          case TYPE_INT32   : return "int32_t";
+          case TYPE_UINT32  : return "uint32_t";
+          case TYPE_INT64   : return "int64_t";
+          case TYPE_UINT64  : return "uint64_t";
+          case TYPE_FLOAT   : return "float";
+          case TYPE_DOUBLE  : return "double";
+          }
+        return "";
+      }
 
       // static
       char branch_entry_type::get_leaf_type_symbol (int bt_)
@@ -148,6 +173,50 @@ namespace snemo {
         return ltn;
       }
 
+      // static
+      unsigned int branch_entry_type::get_type_size (int bt_)
+      {
+        switch (bt_)
+          {
+          case TYPE_BOOLEAN : return sizeof (UChar_t);
+          case TYPE_CHAR    : return sizeof (Char_t);
+          case TYPE_UCHAR   : return sizeof (UChar_t);
+          case TYPE_INT16   : return sizeof (Short_t);
+          case TYPE_UINT16  : return sizeof (UShort_t);
+          case TYPE_INT32   : return sizeof (Int_t);
+          case TYPE_UINT32  : return sizeof (UInt_t);
+          case TYPE_INT64   : return sizeof (Long64_t);
+          case TYPE_UINT64  : return sizeof (ULong64_t);
+          case TYPE_FLOAT   : return sizeof (Float_t);
+          case TYPE_DOUBLE  : return sizeof (Double_t);
+          }
+        return 0;
+      }
+
+      // static
+      bool branch_entry_type::is_null_value (const camp::Value & value_)
+      {
+        if (value_.type () == camp::realType)
+          {
+            return std::isnan (value_.to<double> ());
+          }
+        if (value_.type () == camp::intType)
+          {
+            return value_.to<int32_t> () == -1;
+          }
+        return false;
+      }
+
+      // static
+      camp::Value branch_entry_type::get_null_value (int type_)
+      {
+        if (type_ == TYPE_FLOAT || type_ == TYPE_DOUBLE)
+          {
+            return camp::Value (std::numeric_limits<double>::quiet_NaN ());
+          }
+        return camp::Value (-1);
+      }
+
       branch_entry_type::branch_entry_type()
       {
         _inhibit_ = false;
@@ -165,6 +234,10 @@ namespace snemo {
         _buffer_size_ = DEFAULT_BUFFER_SIZE;
         _array_fixed_size_ = 0;
         _array_size_name_ = "";
+        _event_scope_ = false;
+        _nullable_ = false;
+        _validity_bitmap_ = false;
+        _group_name_ = "";
         _address_ = 0;
         _branch_ = 0;
         return;
@@ -172,7 +245,43 @@ namespace snemo {
 
       branch_entry_type::~branch_entry_type()
       {
-        reset ();
+        detach_branch ();
+        return;
+      }
+
+      // static
+      branch_entry_type * branch_entry_type::create (int type_)
+      {
+        switch (type_)
+          {
+          case TYPE_BOOLEAN : return new typed_branch_entry<bool>;
+          case TYPE_CHAR    : return new typed_branch_entry<Char_t>;
+          case TYPE_UCHAR   : return new typed_branch_entry<UChar_t>;
+          case TYPE_INT16   : return new typed_branch_entry<Short_t>;
+          case TYPE_UINT16  : return new typed_branch_entry<UShort_t>;
+          case TYPE_INT32   : return new typed_branch_entry<Int_t>;
+          case TYPE_UINT32  : return new typed_branch_entry<UInt_t>;
+          case TYPE_INT64   : return new typed_branch_entry<Long64_t>;
+          case TYPE_UINT64  : return new typed_branch_entry<ULong64_t>;
+          case TYPE_FLOAT   : return new typed_branch_entry<Float_t>;
+          case TYPE_DOUBLE  : return new typed_branch_entry<Double_t>;
+          }
+        DT_THROW_IF (true, std::logic_error, "Type '" << type_ << "' is not allowed !");
+        return 0;
+      }
+
+      void branch_entry_type::_check_type (int type_) const
+      {
+        DT_THROW_IF (type_ != _type_, std::logic_error,
+                     "Branch '" << _name_ << "' stores '" << get_branch_type_label (_type_)
+                     << "' values, not '" << get_branch_type_label (type_) << "' ones !");
+        return;
+      }
+
+      void branch_entry_type::_check_rank (unsigned int rank_, unsigned int size_) const
+      {
+        DT_THROW_IF (rank_ >= size_, std::range_error,
+                     "Invalid rank " << rank_ << " for branch '" << _name_ << "' !");
         return;
       }
 
@@ -189,24 +298,18 @@ namespace snemo {
         _topic_ = "";
 
         _store_bit_ = 0;
-        _type_ = TYPE_UNDEFINED;
         _array_ = false;
         _buffer_size_ = DEFAULT_BUFFER_SIZE;
         _array_fixed_size_ = 0;
         _array_size_name_ = "";
+        _bitfield_members_.clear ();
+        _event_scope_ = false;
+        _nullable_ = false;
+        _validity_bitmap_ = false;
+        _group_name_ = "";
         _address_ = 0;
         _branch_ = 0;
-        _bvalues_.clear ();
-        _cvalues_.clear ();
-        _ucvalues_.clear ();
-        _svalues_.clear ();
-        _usvalues_.clear ();
-        _ivalues_.clear ();
-        _uivalues_.clear ();
-        _lvalues_.clear ();
-        _ulvalues_.clear ();
-        _fvalues_.clear ();
-        _dvalues_.clear ();
+        _clear_values ();
         return;
       }
 
@@ -310,6 +413,26 @@ namespace snemo {
                 out_ << indent_ << "|-- " << "Array size name  : '" << _array_size_name_ << "'" << std::endl;
               }
           }
+        if (is_bitfield ())
+          {
+            out_ << indent_ << "|-- " << "Bitfield    : '" << boost::join (_bitfield_members_, ",") << "'" << std::endl;
+          }
+        if (_event_scope_)
+          {
+            out_ << indent_ << "|-- " << "Scope       : 'event'" << std::endl;
+          }
+        if (_nullable_)
+          {
+            out_ << indent_ << "|-- " << "Nullable    : 'Yes'" << std::endl;
+          }
+        if (_validity_bitmap_)
+          {
+            out_ << indent_ << "|-- " << "Validity    : 'Yes'" << std::endl;
+          }
+        if (! _group_name_.empty ())
+          {
+            out_ << indent_ << "|-- " << "Group       : '" << _group_name_ << "'" << std::endl;
+          }
         out_ << indent_ << "|-- " << "Address     : " << _address_ << std::endl;
         out_ << indent_ << "|-- " << "Values      : " << std::endl;
         out_ << indent_ << "`-- " << "Branch      : " << _branch_ << std::endl;
@@ -318,46 +441,10 @@ namespace snemo {
 
       branch_entry_type & branch_entry_type::set_type (int type_)
       {
-        switch (type_)
-          {
-          case TYPE_BOOLEAN :
-            _type_ = type_;
-            break;
-          case TYPE_CHAR :
-            _type_ = type_;
-            break;
-          case TYPE_UCHAR :
-            _type_ = type_;
-            break;
-          case TYPE_INT16 :
-            _type_ = type_;
-            break;
-          case TYPE_UINT16 :
-            _type_ = type_;
-            break;
-          case TYPE_INT32 :
-            _type_ = type_;
-            break;
-          case TYPE_UINT32 :
-            _type_ = type_;
-            break;
-          case TYPE_INT64 :
-            _type_ = type_;
-            break;
-          case TYPE_UINT64 :
-            _type_ = type_;
-            break;
-          case TYPE_FLOAT :
-            _type_ = type_;
-            break;
-          case TYPE_DOUBLE :
-            _type_ = type_;
-            break;
-          default:
-            _type_ = TYPE_UNDEFINED;
-            DT_THROW_IF (true, std::logic_error, "Type '" << type_ << "' is not allowed !");
-          }
-        _type_ = type_;
+        // The storage is chosen at creation (see 'create') :
+        DT_THROW_IF (type_ != _type_, std::logic_error,
+                     "Cannot change the type of branch '" << _name_ << "' from '"
+                     << get_branch_type_label (_type_) << "' to '" << get_branch_type_label (type_) << "' !");
         return *this;
       }
 
@@ -413,6 +500,120 @@ namespace snemo {
         return _leaf_name_;
       }
 
+      branch_entry_type & branch_entry_type::set_bitfield_members (const std::vector<std::string> & members_)
+      {
+        DT_THROW_IF (members_.empty (), std::logic_error, "Empty bitfield is not allowed !");
+        DT_THROW_IF (members_.size () > 8 * get_type_size (_type_), std::logic_error,
+                     "Too many bitfield members (" << members_.size () << ") for branch '" << _name_ << "' !");
+        _bitfield_members_ = members_;
+        return *this;
+      }
+
+      bool branch_entry_type::is_bitfield () const
+      {
+        return ! _bitfield_members_.empty ();
+      }
+
+      const std::vector<std::string> & branch_entry_type::get_bitfield_members () const
+      {
+        return _bitfield_members_;
+      }
+
+      branch_entry_type & branch_entry_type::set_event_scope (bool event_scope_)
+      {
+        DT_THROW_IF (! _array_ && event_scope_, std::logic_error,
+                     "Event scope branch '" << _name_ << "' must be an array !");
+        _event_scope_ = event_scope_;
+        return *this;
+      }
+
+      bool branch_entry_type::is_event_scope () const
+      {
+        return _event_scope_;
+      }
+
+      branch_entry_type & branch_entry_type::set_nullable (bool nullable_)
+      {
+        DT_THROW_IF (! _array_ && nullable_, std::logic_error,
+                     "Nullable branch '" << _name_ << "' must be an array !");
+        _nullable_ = nullable_;
+        return *this;
+      }
+
+      bool branch_entry_type::is_nullable () const
+      {
+        return _nullable_;
+      }
+
+      bool branch_entry_type::is_leaf_counter () const
+      {
+        // The bank size branches have no parent :
+        return ! _parent_name_.empty ()
+          && _name_.size () > 5 && _name_.compare (_name_.size () - 5, 5, "@size") == 0;
+      }
+
+      branch_entry_type & branch_entry_type::set_validity_bitmap (bool validity_bitmap_)
+      {
+        DT_THROW_IF (validity_bitmap_ && ! is_bitfield (), std::logic_error,
+                     "Validity bitmap '" << _name_ << "' must be a bitfield !");
+        _validity_bitmap_ = validity_bitmap_;
+        return *this;
+      }
+
+      bool branch_entry_type::is_validity_bitmap () const
+      {
+        return _validity_bitmap_;
+      }
+
+      branch_entry_type & branch_entry_type::set_group_name (const std::string & group_name_)
+      {
+        DT_THROW_IF (_array_ && ! group_name_.empty (), std::logic_error,
+                     "Array branch '" << _name_ << "' cannot be grouped !");
+        _group_name_ = group_name_;
+        return *this;
+      }
+
+      std::size_t branch_entry_type::get_memory_usage () const
+      {
+        return _memory_usage ();
+      }
+
+      void branch_entry_type::swap_values (branch_entry_type & other_)
+      {
+        _check_type (other_.get_type ());
+        _swap_values (other_);
+        // The branches are re-pointed at their new storages :
+        _compute_address ();
+        other_._compute_address ();
+        return;
+      }
+
+      void branch_entry_type::shrink_values ()
+      {
+        if (! _array_ || has_fixed_size ()) return;
+        _shrink_values ();
+        return;
+      }
+
+      bool branch_entry_type::is_grouped () const
+      {
+        return ! _group_name_.empty ();
+      }
+
+      const std::string & branch_entry_type::get_group_name () const
+      {
+        return _group_name_;
+      }
+
+      int branch_entry_type::get_bitfield_rank (const std::string & member_) const
+      {
+        for (size_t i = 0; i < _bitfield_members_.size (); i++)
+          {
+            if (_bitfield_members_[i] == member_) return i;
+          }
+        return -1;
+      }
+
       const std::string & branch_entry_type::get_title () const
       {
         return _title_;
@@ -461,49 +662,6 @@ namespace snemo {
         return *this;
       }
 
-      template<class T>
-      void branch_entry_type::_set_value_in_vector (std::vector<T> & v_,
-                                                    const T & value_address_,
-                                                    unsigned int rank_)
-      {
-        if (rank_ >= v_.size ())
-          {
-            T * current_addr = v_.data();
-            v_.resize (rank_ + 1);
-            if (v_.data() != current_addr)
-              {
-                /*
-                std::clog << "_set_value_in_vector: "
-                          << "New address for vector of type '" << typeid(T).name () << "'."
-                          << "\n";
-                */
-                this->_compute_address ();
-              }
-          }
-        v_[rank_] = value_address_;
-        /*
-        if(sizeof(T) == 4 && typeid(T) == typeid(int32_t))
-          {
-            std::clog << "************** v_[size=" << v_.size () << "] : add "
-                      << value_address_ << " at rank " << rank_ << std::endl;
-          for (int i = 0; i <= rank_; i++)
-          {
-          std::clog << "  Contents:  v_[" << i << "] = ";
-          if (sizeof (v_[i]) == 1 )
-          {
-          std::clog << (int) v_[i];
-          }
-          else
-          {
-          std::clog << v_[i];
-          }
-          std::clog << std::endl;
-          }
-          }
-        */
-        return;
-      }
-
       bool branch_entry_type::is_array_fixed_size () const
       {
         return _array_fixed_size_ != ARRAY_NO_FIXED_SIZE;
@@ -521,79 +679,16 @@ namespace snemo {
                          "Array rank overflow (" << rank_ << ">=" << _array_fixed_size_
                          << ") is not allowed for branch '" << get_name () << " !");
           }
-        switch (_type_)
-          {
-          case TYPE_BOOLEAN :
-            {
-              bool val = camp_value_.to<bool>();
-              UChar_t boolchar = val ? 1 : 0;
-              _set_value_in_vector<UChar_t> (_bvalues_, boolchar, rank_);
-            }
-            break;
-          case TYPE_CHAR :
-            {
-              Char_t val = camp_value_.to<Char_t>();
-              _set_value_in_vector<Char_t> (_cvalues_, val, rank_);
-            }
-            break;
-          case TYPE_UCHAR :
-            {
-              UChar_t val = camp_value_.to<UChar_t>();
-              _set_value_in_vector<UChar_t> (_ucvalues_, val, rank_);
-            }
-            break;
-          case TYPE_INT16 :
-            {
-              Short_t val = camp_value_.to<Short_t>();
-              _set_value_in_vector<Short_t> (_svalues_, val, rank_);
-            }
-            break;
-          case TYPE_UINT16 :
-            {
-              UShort_t val = camp_value_.to<UShort_t>();
-              _set_value_in_vector<UShort_t> (_usvalues_, val, rank_);
-            }
-            break;
-          case TYPE_INT32 :
-            {
-              Int_t val = camp_value_.to<Int_t>();
-              _set_value_in_vector<Int_t> (_ivalues_, val, rank_);
-            }
-            break;
-          case TYPE_UINT32 :
-            {
-              UInt_t val = camp_value_.to<UInt_t>();
-              _set_value_in_vector<UInt_t> (_uivalues_, val, rank_);
-            }
-            break;
-          case TYPE_INT64 :
-            {
-              Long64_t val = camp_value_.to<Long64_t>();
-              _set_value_in_vector<Long64_t> (_lvalues_, val, rank_);
-            }
-            break;
-          case TYPE_UINT64 :
-            {
-              ULong64_t val = camp_value_.to<ULong64_t>();
-              _set_value_in_vector<ULong64_t> (_ulvalues_, val, rank_);
-            }
-            break;
-          case TYPE_FLOAT :
-            {
-              Float_t val = camp_value_.to<Float_t>();
-              _set_value_in_vector<Float_t> (_fvalues_, val, rank_);
-            }
-            break;
-          case TYPE_DOUBLE :
-            {
-              Double_t val = camp_value_.to<Double_t>();
-              _set_value_in_vector<Double_t> (_dvalues_, val, rank_);
-            }
-            break;
-          }
+        _store_value (camp_value_, rank_);
         return;
       }
 
+      camp::Value branch_entry_type::get_branch_value (unsigned int rank_) const
+      {
+        DT_THROW_IF (! _array_ && rank_ > 0, std::logic_error, "Rank > 0 (" << rank_ << ") is not allowed for scalar value !");
+        return _load_value (rank_);
+      }
+
       void branch_entry_type::set_size (unsigned int size_)
       {
         DT_THROW_IF (!is_locked (), std::logic_error, "Branch entry is not locked ! Cannot set size !");
@@ -610,97 +705,7 @@ namespace snemo {
           {
             return;
           }
-        switch (_type_)
-          {
-          case TYPE_BOOLEAN :
-            if (size_ == 0)
-              {
-                _bvalues_.clear ();
-                break;
-              }
-            _bvalues_.assign (size_, 0);
-            break;
-          case TYPE_CHAR :
-            if (size_ == 0)
-              {
-                _cvalues_.clear ();
-                break;
-              }
-            _cvalues_.assign (size_, 0);
-            break;
-          case TYPE_UCHAR :
-            if (size_ == 0)
-              {
-                _ucvalues_.clear ();
-                break;
-              }
-            _ucvalues_.assign (size_, 0);
-            break;
-          case TYPE_INT16 :
-            if (size_ == 0)
-              {
-                _svalues_.clear ();
-                break;
-              }
-            _svalues_.assign (size_, -1);
-            break;
-          case TYPE_UINT16 :
-            if (size_ == 0)
-              {
-                _usvalues_.clear ();
-                break;
-              }
-            _usvalues_.assign (size_, -1);
-            break;
-          case TYPE_INT32 :
-            if (size_ == 0)
-              {
-                _ivalues_.clear ();
-                break;
-              }
-            _ivalues_.assign (size_, -1);
-            break;
-          case TYPE_UINT32 :
-            if (size_ == 0)
-              {
-                _uivalues_.clear ();
-                break;
-              }
-            _uivalues_.assign (size_, 0xFFFFFFFF);
-            break;
-          case TYPE_INT64 :
-            if (size_ == 0)
-              {
-                _lvalues_.clear ();
-                break;
-              }
-            _lvalues_.assign (size_, -1L);
-            break;
-          case TYPE_UINT64 :
-            if (size_ == 0)
-              {
-                _ulvalues_.clear ();
-                break;
-              }
-            _ulvalues_.assign (size_, 0xFFFFFFFFFFFFFFFF);
-            break;
-          case TYPE_FLOAT :
-            if (size_ == 0)
-              {
-                _fvalues_.clear ();
-                break;
-              }
-            _fvalues_.assign (size_, std::numeric_limits<float>::quiet_NaN());
-            break;
-          case TYPE_DOUBLE :
-            if (size_ == 0)
-              {
-                _dvalues_.clear ();
-                break;
-              }
-            _dvalues_.assign (size_, std::numeric_limits<double>::quiet_NaN());
-            break;
-          }
+        _resize (size_);
         _compute_address ();
         return;
       }
@@ -726,75 +731,7 @@ namespace snemo {
 
       void branch_entry_type::_compute_address ()
       {
-        switch (_type_)
-          {
-          case TYPE_BOOLEAN :
-            {
-              _bvalues_.reserve (1);
-              _address_ = static_cast<void *>(_bvalues_.data ());
-            }
-            break;
-          case TYPE_CHAR :
-            {
-              _cvalues_.reserve (1);
-              _address_ = static_cast<void *>(_cvalues_.data ());
-            }
-            break;
-          case TYPE_UCHAR :
-            {
-              _ucvalues_.reserve (1);
-              _address_ = static_cast<void *>(_ucvalues_.data ());
-            }
-            break;
-          case TYPE_INT16 :
-            {
-              _svalues_.reserve (1);
-              _address_ = static_cast<void *>(_svalues_.data ());
-            }
-            break;
-          case TYPE_UINT16 :
-            {
-              _usvalues_.reserve (1);
-              _address_ = static_cast<void *>(_usvalues_.data ());
-            }
-            break;
-          case TYPE_INT32 :
-            {
-              _ivalues_.reserve (1);
-              _address_ = static_cast<void *>(_ivalues_.data ());
-            }
-            break;
-          case TYPE_UINT32 :
-            {
-              _uivalues_.reserve (1);
-              _address_ = static_cast<void *>(_uivalues_.data ());
-            }
-            break;
-          case TYPE_INT64 :
-            {
-              _lvalues_.reserve (1);
-              _address_ = static_cast<void *>(_lvalues_.data ());
-            }
-            break;
-          case TYPE_UINT64 :
-            {
-              _ulvalues_.reserve (1);
-              _address_ = static_cast<void *>(_ulvalues_.data ());
-            }
-            break;
-          case TYPE_FLOAT :
-            {
-              _fvalues_.reserve (1);
-              _address_ = static_cast<void *>(_fvalues_.data ());
-            }
-            break;
-          case TYPE_DOUBLE :
-            {
-              _dvalues_.reserve (1);
-              _address_ = static_cast<void *>(_dvalues_.data ());
-            }
-            break;
-          }
+        _address_ = _data ();
         _update_branch_address ();
         return;
       }
@@ -884,9 +821,171 @@ namespace snemo {
         return;
       }
 
+      /* Multi-leaf branch */
+
+      branch_group_type::branch_group_type (const std::string & name_)
+      {
+        _name_ = name_;
+        _branch_ = 0;
+        return;
+      }
+
+      const std::string & branch_group_type::get_name () const
+      {
+        return _name_;
+      }
+
+      void branch_group_type::add_member (branch_entry_type & member_)
+      {
+        DT_THROW_IF (_branch_ != 0, std::logic_error,
+                     "Multi-leaf branch '" << _name_ << "' is already attached to a tree !");
+        DT_THROW_IF (member_.is_array (), std::logic_error,
+                     "Array branch '" << member_.get_name () << "' cannot be a leaf of '" << _name_ << "' !");
+        _members_.push_back (&member_);
+        return;
+      }
+
+      const std::vector<branch_entry_type *> & branch_group_type::get_members () const
+      {
+        return _members_;
+      }
+
+      void branch_group_type::_layout ()
+      {
+        // Largest types first : all the leaves are aligned in the buffer
+        std::vector<branch_entry_type *> members;
+        for (unsigned int size = 8; size > 0; size /= 2)
+          {
+            for (size_t i = 0; i < _members_.size (); i++)
+              {
+                if (branch_entry_type::get_type_size (_members_[i]->get_type ()) == size)
+                  {
+                    members.push_back (_members_[i]);
+                  }
+              }
+          }
+        _members_ = members;
+        _offsets_.clear ();
+        unsigned int offset = 0;
+        for (size_t i = 0; i < _members_.size (); i++)
+          {
+            _offsets_.push_back (offset);
+            offset += branch_entry_type::get_type_size (_members_[i]->get_type ());
+          }
+        _buffer_.assign ((offset + sizeof (ULong64_t) - 1) / sizeof (ULong64_t), 0);
+        return;
+      }
+
+      std::string branch_group_type::get_leaflist () const
+      {
+        std::ostringstream leaflist;
+        for (size_t i = 0; i < _members_.size (); i++)
+          {
+            if (i > 0) leaflist << ':';
+            leaflist << _members_[i]->get_name () << '/'
+                     << branch_entry_type::get_leaf_type_symbol (_members_[i]->get_type ());
+          }
+        return leaflist.str ();
+      }
+
+      TBranch * branch_group_type::make_branch (TTree * tree_, unsigned int buffer_size_)
+      {
+        DT_THROW_IF (_members_.empty (), std::logic_error, "Multi-leaf branch '" << _name_ << "' has no leaf !");
+        _layout ();
+        _branch_ = tree_->Branch (_name_.c_str (), &_buffer_[0], get_leaflist ().c_str (), buffer_size_);
+        return _branch_;
+      }
+
+      void branch_group_type::bind_branch (TBranch * branch_)
+      {
+        DT_THROW_IF (branch_ == 0, std::logic_error, "Missing multi-leaf branch '" << _name_ << "' !");
+        // The layout of the file is used : it may have more leaves than the members
+        _offsets_.clear ();
+        unsigned int size = 0;
+        TObjArray * leaves = branch_->GetListOfLeaves ();
+        for (int ileaf = 0; ileaf < leaves->GetEntries (); ileaf++)
+          {
+            const TLeaf * leaf = static_cast<const TLeaf *>(leaves->At (ileaf));
+            size = std::max (size, static_cast<unsigned int> (leaf->GetOffset () + leaf->GetLenType () * leaf->GetLen ()));
+          }
+        for (size_t i = 0; i < _members_.size (); i++)
+          {
+            const branch_entry_type & member = *_members_[i];
+            const TLeaf * leaf = static_cast<const TLeaf *>(leaves->FindObject (member.get_name ().c_str ()));
+            DT_THROW_IF (leaf == 0, std::logic_error,
+                         "No leaf '" << member.get_name () << "' in multi-leaf branch '" << _name_ << "' !");
+            DT_THROW_IF (static_cast<unsigned int> (leaf->GetLenType ())
+                         != branch_entry_type::get_type_size (member.get_type ()),
+                         std::logic_error,
+                         "Leaf '" << member.get_name () << "' of multi-leaf branch '" << _name_
+                         << "' has not the expected type !");
+            _offsets_.push_back (leaf->GetOffset ());
+          }
+        _buffer_.assign ((size + sizeof (ULong64_t) - 1) / sizeof (ULong64_t), 0);
+        _branch_ = branch_;
+        _branch_->SetAddress (&_buffer_[0]);
+        return;
+      }
+
+      void branch_group_type::detach_branch ()
+      {
+        _branch_ = 0;
+        return;
+      }
+
+      TBranch * branch_group_type::get_branch () const
+      {
+        return _branch_;
+      }
+
+      std::size_t branch_group_type::get_memory_usage () const
+      {
+        return _buffer_.capacity () * sizeof (ULong64_t);
+      }
+
+      void branch_group_type::pack ()
+      {
+        char * buffer = reinterpret_cast<char *>(&_buffer_[0]);
+        for (size_t i = 0; i < _members_.size (); i++)
+          {
+            branch_entry_type & member = *_members_[i];
+            std::memcpy (buffer + _offsets_[i], member.get_address (),
+                         branch_entry_type::get_type_size (member.get_type ()));
+          }
+        return;
+      }
+
+      void branch_group_type::unpack ()
+      {
+        const char * buffer = reinterpret_cast<const char *>(&_buffer_[0]);
+        for (size_t i = 0; i < _members_.size (); i++)
+          {
+            branch_entry_type & member = *_members_[i];
+            std::memcpy (member.get_address (), buffer + _offsets_[i],
+                         branch_entry_type::get_type_size (member.get_type ()));
+          }
+        return;
+      }
+
+      /* Branch manager */
+
+      // static
+      const std::string branch_manager::SIZE_GROUP_NAME = "bankSizes";
+
       branch_manager::branch_manager ()
       {
         _debug_ = false;
+        _version_branches_ = false;
+        _pack_bitfields_ = false;
+        _cell_keys_ = false;
+        _cell_ids_ = true;
+        _hoist_event_constants_ = false;
+        _null_bitmaps_ = false;
+        _row_indexes_ = false;
+        _offset_memberships_ = false;
+        _unified_scin_hits_ = false;
+        _leaflist_scalar_banks_ = false;
+        _group_size_counters_ = false;
         return;
       }
 
@@ -913,7 +1012,7 @@ namespace snemo {
       {
         DT_THROW_IF (_branch_dict_.find (name_) != _branch_dict_.end(), std::logic_error,
                      "Branch named '" << name_ << "' already exists !");
-        _branch_infos_.push_back ( new branch_entry_type);
+        _branch_infos_.push_back (branch_entry_type::create (type_));
         branch_entry_type & be = *_branch_infos_.back ();
         be.set (name_, type_, array_);
         _branch_dict_[name_] = &be;
@@ -928,7 +1027,235 @@ namespace snemo {
             delete _branch_infos_[i];
           }
         _branch_infos_.clear ();
+        for (size_t i = 0; i < _groups_.size (); i++)
+          {
+            delete _groups_[i];
+          }
+        _groups_.clear ();
         _active_topics_.clear ();
+        _banks_.clear ();
+        return;
+      }
+
+      const std::map<std::string, bool> & branch_manager::get_topics () const
+      {
+        return _active_topics_;
+      }
+
+      const branch_manager::bank_col_type & branch_manager::get_banks () const
+      {
+        return _banks_;
+      }
+
+      bool branch_manager::has_version_branches () const
+      {
+        return _version_branches_;
+      }
+
+      void branch_manager::set_version_branches (bool version_branches_)
+      {
+        _version_branches_ = version_branches_;
+        return;
+      }
+
+      bool branch_manager::is_pack_bitfields () const
+      {
+        return _pack_bitfields_;
+      }
+
+      void branch_manager::set_pack_bitfields (bool pack_bitfields_)
+      {
+        _pack_bitfields_ = pack_bitfields_;
+        return;
+      }
+
+      // static
+      int branch_manager::get_bitfield_type (unsigned int number_of_members_)
+      {
+        if (number_of_members_ <= 8) return branch_entry_type::TYPE_UCHAR;
+        if (number_of_members_ <= 16) return branch_entry_type::TYPE_UINT16;
+        return branch_entry_type::TYPE_UINT32;
+      }
+
+      bool branch_manager::is_cell_keys () const
+      {
+        return _cell_keys_;
+      }
+
+      void branch_manager::set_cell_keys (bool cell_keys_)
+      {
+        _cell_keys_ = cell_keys_;
+        return;
+      }
+
+      bool branch_manager::is_cell_ids () const
+      {
+        return _cell_ids_;
+      }
+
+      void branch_manager::set_cell_ids (bool cell_ids_)
+      {
+        _cell_ids_ = cell_ids_;
+        return;
+      }
+
+      bool branch_manager::is_hoist_event_constants () const
+      {
+        return _hoist_event_constants_;
+      }
+
+      void branch_manager::set_hoist_event_constants (bool hoist_)
+      {
+        _hoist_event_constants_ = hoist_;
+        return;
+      }
+
+      bool branch_manager::is_null_bitmaps () const
+      {
+        return _null_bitmaps_;
+      }
+
+      void branch_manager::set_null_bitmaps (bool null_bitmaps_)
+      {
+        _null_bitmaps_ = null_bitmaps_;
+        return;
+      }
+
+      bool branch_manager::is_row_indexes () const
+      {
+        return _row_indexes_;
+      }
+
+      void branch_manager::set_row_indexes (bool row_indexes_)
+      {
+        _row_indexes_ = row_indexes_;
+        return;
+      }
+
+      bool branch_manager::is_offset_memberships () const
+      {
+        return _offset_memberships_;
+      }
+
+      void branch_manager::set_offset_memberships (bool offsets_)
+      {
+        _offset_memberships_ = offsets_;
+        return;
+      }
+
+      bool branch_manager::is_unified_scin_hits () const
+      {
+        return _unified_scin_hits_;
+      }
+
+      void branch_manager::set_unified_scin_hits (bool unified_)
+      {
+        _unified_scin_hits_ = unified_;
+        return;
+      }
+
+      bool branch_manager::is_leaflist_scalar_banks () const
+      {
+        return _leaflist_scalar_banks_;
+      }
+
+      void branch_manager::set_leaflist_scalar_banks (bool leaflist_)
+      {
+        _leaflist_scalar_banks_ = leaflist_;
+        return;
+      }
+
+      bool branch_manager::is_group_size_counters () const
+      {
+        return _group_size_counters_;
+      }
+
+      void branch_manager::set_group_size_counters (bool group_)
+      {
+        _group_size_counters_ = group_;
+        return;
+      }
+
+      void branch_manager::get_layout_flags (std::vector<std::string> & flags_) const
+      {
+        flags_.clear ();
+        if (_cell_keys_) flags_.push_back ("cell_keys");
+        if (_cell_ids_) flags_.push_back ("cell_ids");
+        if (_row_indexes_) flags_.push_back ("row_indexes");
+        if (_offset_memberships_) flags_.push_back ("offset_memberships");
+        if (_unified_scin_hits_) flags_.push_back ("unified_scin_hits");
+        return;
+      }
+
+      void branch_manager::add_to_group (const std::string & group_name_, branch_entry_type & branch_entry_)
+      {
+        DT_THROW_IF (branch_entry_.is_grouped (), std::logic_error,
+                     "Branch '" << branch_entry_.get_name () << "' is already a leaf of '"
+                     << branch_entry_.get_group_name () << "' !");
+        branch_group_type * group = 0;
+        for (size_t i = 0; i < _groups_.size (); i++)
+          {
+            if (_groups_[i]->get_name () == group_name_) group = _groups_[i];
+          }
+        if (group == 0)
+          {
+            DT_THROW_IF (has_branch (group_name_), std::logic_error,
+                         "Multi-leaf branch '" << group_name_ << "' has the name of a branch !");
+            _groups_.push_back (new branch_group_type (group_name_));
+            group = _groups_.back ();
+          }
+        group->add_member (branch_entry_);
+        branch_entry_.set_group_name (group_name_);
+        return;
+      }
+
+      const branch_manager::group_col_type & branch_manager::get_groups () const
+      {
+        return _groups_;
+      }
+
+      branch_manager::group_col_type & branch_manager::grab_groups ()
+      {
+        return _groups_;
+      }
+
+      std::size_t branch_manager::get_memory_usage () const
+      {
+        std::size_t usage = 0;
+        for (size_t i = 0; i < _branch_infos_.size (); i++)
+          {
+            usage += _branch_infos_[i]->get_memory_usage ();
+          }
+        for (size_t i = 0; i < _groups_.size (); i++)
+          {
+            usage += _groups_[i]->get_memory_usage ();
+          }
+        return usage;
+      }
+
+      void branch_manager::swap_values (branch_manager & other_)
+      {
+        DT_THROW_IF (other_._branch_infos_.size () != _branch_infos_.size ()
+                     || other_._groups_.size () != _groups_.size (),
+                     std::logic_error, "Branch managers have different structures !");
+        for (size_t i = 0; i < _branch_infos_.size (); i++)
+          {
+            _branch_infos_[i]->swap_values (*other_._branch_infos_[i]);
+          }
+        // The grouped scalar leaves are copied in the buffers of their multi-leaf branches :
+        for (size_t i = 0; i < _groups_.size (); i++)
+          {
+            _groups_[i]->pack ();
+          }
+        return;
+      }
+
+      void branch_manager::shrink_values ()
+      {
+        for (size_t i = 0; i < _branch_infos_.size (); i++)
+          {
+            _branch_infos_[i]->shrink_values ();
+          }
         return;
       }
 
@@ -947,6 +1274,16 @@ namespace snemo {
         return false;
       }
 
+      unsigned int branch_manager::get_array_size (branch_entry_type & branch_entry_)
+      {
+        if (! branch_entry_.is_array ()) return 1;
+        if (branch_entry_.has_fixed_size ()) return branch_entry_.get_array_fixed_size ();
+        branch_entry_type & be_size = grab_branch (branch_entry_.get_array_size_name ());
+        DT_THROW_IF (be_size.get_type () != branch_entry_type::TYPE_UINT32, std::logic_error,
+                     "Size branch '" << be_size.get_name () << "' is not an unsigned integer !");
+        return *static_cast<const UInt_t *>(be_size.get_address ());
+      }
+
       // static
       bool branch_manager::check_camp_type (const std::string & branch_name_,
                                             camp::Type camp_type_,
@@ -1004,29 +1341,88 @@ namespace snemo {
                                 branch_entry_type::TYPE_UINT32,
                                 branch_entry_type::SCALAR_DATA);
             be_array_size.set_store_bit (store_bit_);
+            if (_group_size_counters_)
+              {
+                add_to_group (SIZE_GROUP_NAME, be_array_size);
+              }
             be_array_size.lock ();
           }
         {
-          std::ostringstream branch_version_oss;
-          branch_version_oss << bank_name_
-                             << "@version";
-          std::string branch_version_name = branch_version_oss.str ();
-          branch_entry_type & be_version =
-            add_branch_entry (branch_version_name,
-                              branch_entry_type::TYPE_UINT32,
-                              branch_entry_type::SCALAR_DATA);
-          be_version.set_store_bit (store_bit_);
-          be_version.lock ();
-          camp::Value bankVersionVal = bank_version_;
-          be_version.set_branch_value (bankVersionVal, 0);
+          bank_entry_type bank;
+          bank.name = bank_name_;
+          bank.class_id = camp_class_id_;
+          bank.version = bank_version_;
+          bank.array = array_;
+          bank.store_bit = store_bit_;
+          _banks_.push_back (bank);
         }
+        // The bank versions are normally stored once per file (see export_metadata) :
+        if (_version_branches_)
+          {
+            std::ostringstream branch_version_oss;
+            branch_version_oss << bank_name_
+                               << "@version";
+            std::string branch_version_name = branch_version_oss.str ();
+            branch_entry_type & be_version =
+              add_branch_entry (branch_version_name,
+                                branch_entry_type::TYPE_UINT32,
+                                branch_entry_type::SCALAR_DATA);
+            be_version.set_store_bit (store_bit_);
+            be_version.lock ();
+            camp::Value bankVersionVal = bank_version_;
+            be_version.set_branch_value (bankVersionVal, 0);
+          }
 
         std::size_t nb_branches = meta_class.propertyCount();
+        DT_THROW_IF (! _cell_keys_ && ! _cell_ids_, std::logic_error,
+                     "Cell keys or cell identifiers must be stored !");
 
+        // Boolean leaves tagged with the same 'bitfield' are packed in a single branch :
+        std::map<std::string, std::vector<std::string> > bitfields;
+        if (_pack_bitfields_)
+          {
+            std::map<std::string, std::string> bitfield_topics;
+            for (size_t ibranch = 0; ibranch < nb_branches; ibranch++)
+              {
+                const camp::Property & branch_prop =  meta_class.property(ibranch);
+                if (! branch_prop.hasTag ("bitfield")) continue;
+                const std::string bitfield = branch_prop.tag ("bitfield").to<std::string>();
+                DT_THROW_IF (branch_prop.type () != camp::boolType, std::logic_error,
+                             "Bitfield member '" << branch_prop.name () << "' of class '" << camp_class_id_
+                             << "' is not a boolean !");
+                DT_THROW_IF (meta_class.hasProperty (bitfield), std::logic_error,
+                             "Bitfield '" << bitfield << "' of class '" << camp_class_id_
+                             << "' has the name of a property !");
+                std::string topic;
+                if (branch_prop.hasTag ("topic"))
+                  {
+                    topic = branch_prop.tag ("topic").to<std::string>();
+                  }
+                if (bitfields.count (bitfield))
+                  {
+                    DT_THROW_IF (bitfield_topics[bitfield] != topic, std::logic_error,
+                                 "Members of bitfield '" << bitfield << "' of class '" << camp_class_id_
+                                 << "' have different topics !");
+                  }
+                bitfield_topics[bitfield] = topic;
+                bitfields[bitfield].push_back (branch_prop.name ());
+              }
+          }
+
+        std::vector<std::string> nullable_members;
         for (size_t ibranch = 0; ibranch < nb_branches; ibranch++)
           {
             const camp::Property & branch_prop =  meta_class.property(ibranch);
-            const std::string & branch_name = branch_prop.name();
+            std::string branch_name = branch_prop.name();
+            const std::vector<std::string> * bitfield_members = 0;
+            if (_pack_bitfields_ && branch_prop.hasTag ("bitfield"))
+              {
+                const std::string bitfield = branch_prop.tag ("bitfield").to<std::string>();
+                bitfield_members = &bitfields[bitfield];
+                // The packed branch is created with its first member :
+                if (bitfield_members->front () != branch_name) continue;
+                branch_name = bitfield;
+              }
             std::ostringstream branch_label_oss;
             branch_label_oss << bank_name_ << '.'
                              << branch_name;
@@ -1050,20 +1446,63 @@ namespace snemo {
               {
                 branch_title = branch_prop.tag ("title").to<std::string>();
               }
+            if (bitfield_members != 0)
+              {
+                branch_title = boost::join (*bitfield_members, ",");
+              }
             std::string branch_topic;
             if (branch_prop.hasTag ("topic"))
               {
                 branch_topic = branch_prop.tag ("topic").to<std::string>();
               }
 
+            // Leaves constant within an event are stored once per event, not once per element,
+            // with their own counter (1, or the bank size if the elements of the event disagree) :
+            const bool event_scope = array_ && _hoist_event_constants_
+              && branch_prop.hasTag ("scope")
+              && branch_prop.tag ("scope").to<std::string>() == "event";
+
+            // Optional leaves only store their non missing values, with their own counter :
+            const bool nullable = array_ && _null_bitmaps_ && ! event_scope
+              && bitfield_members == 0 && branch_prop.hasTag ("nullable");
+            branch_entry_type * be_counter = 0;
+            if (nullable || event_scope)
+              {
+                be_counter = &add_branch_entry (branch_label + "@size",
+                                                branch_entry_type::TYPE_UINT32,
+                                                branch_entry_type::SCALAR_DATA);
+                be_counter->set_store_bit (store_bit_);
+                be_counter->set_parent_name (bank_name_);
+                be_counter->set_leaf_name (branch_name + "@size");
+              }
+
+            int branch_type_id = branch_entry_type::get_branch_type_from_label(branch_type);
+            if (bitfield_members != 0)
+              {
+                branch_type_id = get_bitfield_type (bitfield_members->size ());
+              }
             branch_entry_type & be =
               add_branch_entry (branch_label,
-                                branch_entry_type::get_branch_type_from_label(branch_type),
+                                branch_type_id,
                                 array_);
-            if (array_)
+            if (event_scope)
+              {
+                be.set_array_size_name (be_counter->get_name ());
+                be.set_event_scope (true);
+              }
+            else if (nullable)
+              {
+                be.set_array_size_name (be_counter->get_name ());
+                be.set_nullable (true);
+              }
+            else if (array_)
               {
                 be.set_array_size_name (branch_array_size_name);
               }
+            if (bitfield_members != 0)
+              {
+                be.set_bitfield_members (*bitfield_members);
+              }
             if (! branch_unit.empty ())
               {
                 be.set_unit (branch_unit);
@@ -1080,16 +1519,77 @@ namespace snemo {
                     be.set_inhibit(true);
                   }
               }
+            // Cell addresses are stored packed, unpacked or both :
+            if (branch_prop.hasTag ("cell_key") && ! _cell_keys_)
+              {
+                be.set_inhibit(true);
+              }
+            if (branch_prop.hasTag ("cell_id") && ! _cell_ids_)
+              {
+                be.set_inhibit(true);
+              }
+            // Row indexes stored next to the IDs of the referenced rows :
+            if (branch_prop.hasTag ("row_index") && ! _row_indexes_)
+              {
+                be.set_inhibit(true);
+              }
+            // Offsets of the members in the flat hit ID banks :
+            if (branch_prop.hasTag ("membership_offset") && ! _offset_memberships_)
+              {
+                be.set_inhibit(true);
+              }
             be.set_store_bit (store_bit_);
             be.set_parent_name (bank_name_);
             be.set_leaf_name (branch_name);
             be.lock ();
+            if (be_counter != 0)
+              {
+                be_counter->set_inhibit (be.is_inhibited ());
+                if (! be.is_inhibited ())
+                  {
+                    if (nullable) nullable_members.push_back (branch_name);
+                    if (_group_size_counters_)
+                      {
+                        add_to_group (SIZE_GROUP_NAME, *be_counter);
+                      }
+                  }
+                be_counter->lock ();
+              }
             if (is_debug ())
               {
                 DT_LOG_DEBUG (datatools::logger::PRIO_DEBUG, "Branch entry :");
                 be.print (std::clog);
               }
           }
+
+        // The validity bitmap flags the non missing values of the nullable leaves :
+        if (! nullable_members.empty ())
+          {
+            branch_entry_type & be_valid =
+              add_branch_entry (bank_name_ + "@valid",
+                                get_bitfield_type (nullable_members.size ()),
+                                branch_entry_type::ARRAY_DATA);
+            be_valid.set_array_size_name (branch_array_size_name);
+            be_valid.set_bitfield_members (nullable_members);
+            be_valid.set_validity_bitmap (true);
+            be_valid.set_title (boost::join (nullable_members, ","));
+            be_valid.set_store_bit (store_bit_);
+            be_valid.set_parent_name (bank_name_);
+            be_valid.set_leaf_name ("@valid");
+            be_valid.lock ();
+          }
+
+        // The leaves of a scalar bank may be stored in a single multi-leaf branch :
+        if (! array_ && _leaflist_scalar_banks_)
+          {
+            for (size_t i = 0; i < _branch_infos_.size (); i++)
+              {
+                branch_entry_type & be = *_branch_infos_[i];
+                if (be.get_parent_name () != bank_name_) continue;
+                if (be.is_inhibited ()) continue;
+                add_to_group (bank_name_, be);
+              }
+          }
         return;
       }
 
@@ -22,6 +22,9 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <algorithm>
+
+#include <limits>
 
 #include <boost/cstdint.hpp>
 #include <camp/type.hpp>
@@ -38,6 +41,12 @@ namespace snemo {
 
     namespace exports {
 
+      template<class T> class typed_branch_entry;
+
+      /// \brief Description and value storage of a branch
+      ///
+      /// The values are stored by the typed_branch_entry<T> class matching
+      /// the branch type (see the 'create' factory).
       struct branch_entry_type
       {
         enum branch_type
@@ -63,13 +72,24 @@ namespace snemo {
     
         static int get_branch_type_from_label (const std::string & label_);
 
+        static std::string get_branch_type_label (int);
+
         static char get_leaf_type_symbol (int); 
 
         static std::string get_leaf_type_name (int, bool); 
- 
-        branch_entry_type ();
- 
-        ~branch_entry_type ();
+
+        static unsigned int get_type_size (int);
+
+        /// Check if a value stands for a missing value (NaN for reals, -1 for integers)
+        static bool is_null_value (const camp::Value & value_);
+
+        /// Return the value standing for a missing value of a given type
+        static camp::Value get_null_value (int type_);
+
+        /// Create a branch entry storing values of a given type
+        static branch_entry_type * create (int type_);
+
+        virtual ~branch_entry_type ();
 
         branch_entry_type & set_name (const std::string & name_);
 
@@ -85,6 +105,16 @@ namespace snemo {
 
         branch_entry_type & set_array_size_name (const std::string & name_);
 
+        branch_entry_type & set_bitfield_members (const std::vector<std::string> & members_);
+
+        branch_entry_type & set_event_scope (bool event_scope_);
+
+        branch_entry_type & set_nullable (bool nullable_);
+
+        branch_entry_type & set_validity_bitmap (bool validity_bitmap_);
+
+        branch_entry_type & set_group_name (const std::string & group_name_);
+
         branch_entry_type & set_type (int type_);
 
         branch_entry_type & set_array (bool array_);
@@ -138,12 +168,41 @@ namespace snemo {
 
         const std::string & get_array_size_name () const;
 
+        bool is_bitfield () const;
+
+        const std::vector<std::string> & get_bitfield_members () const;
+
+        int get_bitfield_rank (const std::string & member_) const;
+
+        bool is_event_scope () const;
+
+        bool is_nullable () const;
+
+        /// Check if the branch counts the stored values of a nullable or event scope leaf
+        bool is_leaf_counter () const;
+
+        bool is_validity_bitmap () const;
+
+        /// Check if the branch is a leaf of a multi-leaf branch (see branch_group_type)
+        bool is_grouped () const;
+
+        const std::string & get_group_name () const;
+
         int get_type () const;
 
         bool is_array () const;
 
         unsigned int get_buffer_size () const;
 
+        /// Return the size of the value storage (bytes)
+        std::size_t get_memory_usage () const;
+
+        /// Exchange the values of an entry of the same type (the branch addresses follow the storages)
+        void swap_values (branch_entry_type & other_);
+
+        /// Release the storage of a variable size array beyond its first value (the branch address is updated)
+        void shrink_values ();
+
         unsigned int get_array_fixed_size () const;
        
         void set_size (unsigned int size_ = 0);
@@ -160,16 +219,34 @@ namespace snemo {
 
         void set_branch_value (const camp::Value & camp_value_, 
                                unsigned int rank_ = 0);
-        
+
+        camp::Value get_branch_value (unsigned int rank_ = 0) const;
+
+        /// Return the typed storage (T must match the branch type)
+        template<class T>
+        typed_branch_entry<T> & as ();
+
+        template<class T>
+        const typed_branch_entry<T> & as () const;
+
       protected:
-        
+
+        branch_entry_type ();
         void _set_size (unsigned int size_);
         void _compute_address ();
         void _update_branch_address ();
-        template<class T>
-        void _set_value_in_vector (std::vector<T> & v_, 
-                                   const T & value_address_, 
-                                   unsigned int rank_);
+        void _check_type (int type_) const;
+        void _check_rank (unsigned int rank_, unsigned int size_) const;
+        /// Store a value converted to the branch type
+        virtual void _store_value (const camp::Value & camp_value_, unsigned int rank_) = 0;
+        virtual camp::Value _load_value (unsigned int rank_) const = 0;
+        /// Resize the storage, the values are set to the missing value
+        virtual void _resize (unsigned int size_) = 0;
+        virtual void * _data () = 0;
+        virtual void _clear_values () = 0;
+        virtual std::size_t _memory_usage () const = 0;
+        virtual void _swap_values (branch_entry_type & other_) = 0;
+        virtual void _shrink_values () = 0;
  
       public:
 
@@ -187,25 +264,234 @@ namespace snemo {
         unsigned int _buffer_size_;        /// Branch buffer size
         unsigned int _array_fixed_size_;   /// Branch array's fixed size
         std::string  _array_size_name_;    /// The name of the branch that defined the size of an array
-        std::vector<UChar_t>   _bvalues_;  /// Boolean value storage (as unsigned chars)
-        std::vector<Char_t>    _cvalues_;  /// Char value storage
-        std::vector<UChar_t>   _ucvalues_; /// Unsigned char value storage
-        std::vector<Short_t>   _svalues_;  /// Short value storage
-        std::vector<UShort_t>  _usvalues_; /// Unsigned short value storage
-        std::vector<Int_t>     _ivalues_;  /// Int value storage
-        std::vector<UInt_t>    _uivalues_; /// Unsigned int value storage
-        std::vector<Long64_t>  _lvalues_;  /// Long value storage
-        std::vector<ULong64_t> _ulvalues_; /// Unsigned long value storage
-        std::vector<Float_t>   _fvalues_;  /// Float value storage
-        std::vector<Double_t>  _dvalues_;  /// Double value storage
+        std::vector<std::string> _bitfield_members_; /// Names of the boolean leaves packed in a bitfield (bit rank order)
+        bool         _event_scope_; /// Flag for a leaf of an array bank stored once per event when constant
+        bool         _nullable_;    /// Flag for a leaf storing only its non missing values (own size counter)
+        bool         _validity_bitmap_; /// Flag for the bitfield of the non missing values of a bank
+        std::string  _group_name_;  /// Name of the multi-leaf branch storing this scalar leaf (empty : own branch)
         void * _address_;   /// The current address to storage
         TBranch * _branch_; /// The current associated branch
       };
 
+      /// \brief Branch type, storage type and missing value of a C++ value type
+      template<class T> struct branch_value_traits;
+
+#define SNEMO_EXPORTS_BRANCH_VALUE_TRAITS(Type, Storage, Code, Null)     \
+      template<> struct branch_value_traits<Type>                       \
+      {                                                                 \
+        typedef Storage storage_type;                                   \
+        static const int TYPE = branch_entry_type::Code;                \
+        static storage_type null_value () { return Null; }              \
+        static storage_type store (Type value_) { return static_cast<storage_type> (value_); } \
+        static Type value (storage_type stored_) { return static_cast<Type> (stored_); } \
+      };
+
+      SNEMO_EXPORTS_BRANCH_VALUE_TRAITS(Char_t,    Char_t,    TYPE_CHAR,   0)
+      SNEMO_EXPORTS_BRANCH_VALUE_TRAITS(UChar_t,   UChar_t,   TYPE_UCHAR,  0)
+      SNEMO_EXPORTS_BRANCH_VALUE_TRAITS(Short_t,   Short_t,   TYPE_INT16,  -1)
+      SNEMO_EXPORTS_BRANCH_VALUE_TRAITS(UShort_t,  UShort_t,  TYPE_UINT16, 0xFFFF)
+      SNEMO_EXPORTS_BRANCH_VALUE_TRAITS(Int_t,     Int_t,     TYPE_INT32,  -1)
+      SNEMO_EXPORTS_BRANCH_VALUE_TRAITS(UInt_t,    UInt_t,    TYPE_UINT32, 0xFFFFFFFF)
+      SNEMO_EXPORTS_BRANCH_VALUE_TRAITS(Long64_t,  Long64_t,  TYPE_INT64,  -1L)
+      SNEMO_EXPORTS_BRANCH_VALUE_TRAITS(ULong64_t, ULong64_t, TYPE_UINT64, 0xFFFFFFFFFFFFFFFF)
+      SNEMO_EXPORTS_BRANCH_VALUE_TRAITS(Float_t,   Float_t,   TYPE_FLOAT,  std::numeric_limits<Float_t>::quiet_NaN ())
+      SNEMO_EXPORTS_BRANCH_VALUE_TRAITS(Double_t,  Double_t,  TYPE_DOUBLE, std::numeric_limits<Double_t>::quiet_NaN ())
+
+#undef SNEMO_EXPORTS_BRANCH_VALUE_TRAITS
+
+      /// Booleans are stored as unsigned chars
+      template<> struct branch_value_traits<bool>
+      {
+        typedef UChar_t storage_type;
+        static const int TYPE = branch_entry_type::TYPE_BOOLEAN;
+        static storage_type null_value () { return 0; }
+        static storage_type store (bool value_) { return value_ ? 1 : 0; }
+        static bool value (storage_type stored_) { return stored_ != 0; }
+      };
+
+      /// \brief Branch entry storing the values of type T in a contiguous buffer
+      template<class T>
+      class typed_branch_entry : public branch_entry_type
+      {
+      public:
+
+        typedef branch_value_traits<T> traits_type;
+        typedef typename traits_type::storage_type storage_type;
+
+        typed_branch_entry ()
+        {
+          _type_ = traits_type::TYPE;
+          return;
+        }
+
+        virtual ~typed_branch_entry ()
+        {
+          return;
+        }
+
+        /// Set a value (no conversion nor check : the storage only grows to the rank)
+        void set_value (T value_, unsigned int rank_ = 0)
+        {
+          if (rank_ >= _values_.size ())
+            {
+              _grow (rank_ + 1);
+            }
+          _values_[rank_] = traits_type::store (value_);
+          return;
+        }
+
+        /// Return a value (no range check)
+        T get_value (unsigned int rank_ = 0) const
+        {
+          return traits_type::value (_values_[rank_]);
+        }
+
+        /// Return the storage grown to a given size (bulk filling)
+        storage_type * grab_values (unsigned int size_)
+        {
+          if (size_ > _values_.size ())
+            {
+              _grow (size_);
+            }
+          return _values_.data ();
+        }
+
+      protected:
+
+        void _grow (unsigned int size_)
+        {
+          const storage_type * current_addr = _values_.data ();
+          _values_.resize (size_);
+          if (_values_.data () != current_addr)
+            {
+              _compute_address ();
+            }
+          return;
+        }
+
+        virtual void _store_value (const camp::Value & camp_value_, unsigned int rank_)
+        {
+          set_value (camp_value_.to<T> (), rank_);
+          return;
+        }
+
+        virtual camp::Value _load_value (unsigned int rank_) const
+        {
+          _check_rank (rank_, _values_.size ());
+          return camp::Value (get_value (rank_));
+        }
+
+        virtual void _resize (unsigned int size_)
+        {
+          _values_.assign (size_, traits_type::null_value ());
+          return;
+        }
+
+        virtual void * _data ()
+        {
+          _values_.reserve (1);
+          return static_cast<void *>(_values_.data ());
+        }
+
+        virtual void _clear_values ()
+        {
+          _values_.clear ();
+          return;
+        }
+
+        virtual std::size_t _memory_usage () const
+        {
+          return _values_.capacity () * sizeof (storage_type);
+        }
+
+        virtual void _swap_values (branch_entry_type & other_)
+        {
+          _values_.swap (static_cast<typed_branch_entry<T> &>(other_)._values_);
+          return;
+        }
+
+        virtual void _shrink_values ()
+        {
+          if (_values_.capacity () <= 1) return;
+          std::vector<storage_type> (_values_.begin (), _values_.begin () + std::min<std::size_t> (_values_.size (), 1)).swap (_values_);
+          _compute_address ();
+          return;
+        }
+
+      private:
+
+        std::vector<storage_type> _values_; /// Value storage
+
+      };
+
+      template<class T>
+      typed_branch_entry<T> & branch_entry_type::as ()
+      {
+        _check_type (branch_value_traits<T>::TYPE);
+        return static_cast<typed_branch_entry<T> &>(*this);
+      }
+
+      template<class T>
+      const typed_branch_entry<T> & branch_entry_type::as () const
+      {
+        _check_type (branch_value_traits<T>::TYPE);
+        return static_cast<const typed_branch_entry<T> &>(*this);
+      }
+
+      /// \brief Scalar leaves stored together in a single multi-leaf branch
+      ///
+      /// The leaves are laid out in a contiguous buffer, largest types first
+      /// so that all of them are aligned. The member values are copied to the
+      /// buffer before a fill and from the buffer after a read.
+      struct branch_group_type
+      {
+      public:
+        branch_group_type (const std::string & name_ = "");
+        const std::string & get_name () const;
+        void add_member (branch_entry_type & member_);
+        const std::vector<branch_entry_type *> & get_members () const;
+        /// Return the leaf list ("a/D:b/I:c/O"), largest types first
+        std::string get_leaflist () const;
+        /// Create the branch in an output tree
+        TBranch * make_branch (TTree * tree_,
+                               unsigned int buffer_size_ = branch_entry_type::DEFAULT_BUFFER_SIZE);
+        /// Bind the branch of an input tree (the leaf offsets are taken from the file)
+        void bind_branch (TBranch * branch_);
+        void detach_branch ();
+        TBranch * get_branch () const;
+        /// Copy the member values in the buffer
+        void pack ();
+        /// Copy the buffer in the member values
+        void unpack ();
+        /// Return the size of the buffer (bytes)
+        std::size_t get_memory_usage () const;
+      protected:
+        void _layout ();
+      private:
+        std::string _name_;                       /// Name of the branch
+        std::vector<branch_entry_type *> _members_; /// Leaves (layout order)
+        std::vector<unsigned int> _offsets_;      /// Offsets of the leaves in the buffer (bytes)
+        std::vector<ULong64_t>    _buffer_;       /// Storage of the leaves (8 bytes aligned)
+        TBranch *                 _branch_;       /// The current associated branch
+      };
+
       struct branch_manager
       {
       public:
+        /// Name of the multi-leaf branch grouping the size counters of the banks
+        static const std::string SIZE_GROUP_NAME;
+        /// Description of a bank initialized from CAMP
+        struct bank_entry_type
+        {
+          std::string  name;      /// Name of the bank (ex: "calibTrackerHits")
+          std::string  class_id;  /// CAMP class identifier
+          int32_t      version;   /// Export version
+          bool         array;     /// Array flag
+          unsigned int store_bit; /// Store bit
+        };
         typedef std::vector<branch_entry_type *> bi_col_type;
+        typedef std::vector<bank_entry_type> bank_col_type;
+        typedef std::vector<branch_group_type *> group_col_type;
         static bool check_camp_type (const std::string & branch_name_,
                                      camp::Type camp_type_,
                                      const std::string & ctype_);
@@ -229,8 +515,59 @@ namespace snemo {
         branch_entry_type & grab_branch (const std::string & branch_name_);
         void add_topic (const std::string & topic_label_, int activity_level_ = 1);
         bool is_active_topic (const std::string & topic_label_) const;
+        unsigned int get_array_size (branch_entry_type & branch_entry_);
+        const std::map<std::string, bool> & get_topics () const;
+        const bank_col_type & get_banks () const;
+        bool has_version_branches () const;
+        void set_version_branches (bool);
+        bool is_pack_bitfields () const;
+        void set_pack_bitfields (bool);
+        static int get_bitfield_type (unsigned int number_of_members_);
+        bool is_cell_keys () const;
+        void set_cell_keys (bool);
+        bool is_cell_ids () const;
+        void set_cell_ids (bool);
+        bool is_hoist_event_constants () const;
+        void set_hoist_event_constants (bool);
+        bool is_null_bitmaps () const;
+        void set_null_bitmaps (bool);
+        bool is_row_indexes () const;
+        void set_row_indexes (bool);
+        bool is_offset_memberships () const;
+        void set_offset_memberships (bool);
+        bool is_unified_scin_hits () const;
+        void set_unified_scin_hits (bool);
+        bool is_leaflist_scalar_banks () const;
+        void set_leaflist_scalar_banks (bool);
+        bool is_group_size_counters () const;
+        void set_group_size_counters (bool);
+        /// Return the labels of the optional leaves stored by the manager (ex: "cell_keys")
+        void get_layout_flags (std::vector<std::string> & flags_) const;
+        /// Add a scalar branch to a multi-leaf branch (created if needed)
+        void add_to_group (const std::string & group_name_, branch_entry_type & branch_entry_);
+        const group_col_type & get_groups () const;
+        group_col_type & grab_groups ();
+        /// Return the size of the storage addressed by the branches (bytes)
+        std::size_t get_memory_usage () const;
+        /// Exchange the values of the branches with a manager of the same structure (no copy)
+        void swap_values (branch_manager & other_);
+        /// Release the storage of the variable size arrays (the buffers of the groups have a fixed size)
+        void shrink_values ();
       protected:
         bool _debug_;
+        bool _version_branches_; /// Flag to store the bank versions in per-entry '@version' branches (legacy)
+        bool _pack_bitfields_;   /// Flag to pack the boolean leaves tagged with 'bitfield' in a single branch
+        bool _cell_keys_;        /// Flag to store the packed cell keys (leaves tagged with 'cell_key')
+        bool _cell_ids_;         /// Flag to store the unpacked cell identifiers (leaves tagged with 'cell_id')
+        bool _hoist_event_constants_; /// Flag to store the array leaves tagged with 'scope'='event' once per event
+        bool _null_bitmaps_;     /// Flag to store the array leaves tagged with 'nullable' with a validity bitmap
+        bool _row_indexes_;      /// Flag to store the row indexes of the referenced rows (leaves tagged with 'row_index')
+        bool _offset_memberships_; /// Flag to store the memberships as offsets in the parents (leaves tagged with 'membership_offset')
+        bool _unified_scin_hits_;  /// Flag to store the true scintillator hits of all block types in a single bank
+        bool _leaflist_scalar_banks_; /// Flag to store each scalar bank as a single multi-leaf branch
+        bool _group_size_counters_;   /// Flag to store the size counters of all banks in a single multi-leaf branch
+        group_col_type _groups_;
+        bank_col_type _banks_;
         bi_col_type _branch_infos_;
         std::map<std::string,branch_entry_type*> _branch_dict_; 
         std::map<std::string, bool>              _active_topics_;
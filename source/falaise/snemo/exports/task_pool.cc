@@ -0,0 +1,128 @@
+// -*- mode: c++ ; -*-
+/* task_pool.cc */
+
+#include <falaise/snemo/exports/task_pool.h>
+
+#include <stdexcept>
+
+#include <datatools/exception.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      task_pool::task_pool (unsigned int nthreads_)
+      {
+        DT_THROW_IF (nthreads_ == 0, std::domain_error, "Invalid number of threads !");
+        _tasks_ = 0;
+        _next_ = 0;
+        _pending_ = 0;
+        _generation_ = 0;
+        _stop_ = false;
+        // The calling thread is the first one :
+        for (unsigned int i = 1; i < nthreads_; i++)
+          {
+            _workers_.push_back (std::thread (&task_pool::_run_worker, this));
+          }
+        return;
+      }
+
+      task_pool::~task_pool ()
+      {
+        {
+          std::lock_guard<std::mutex> lock (_mutex_);
+          _stop_ = true;
+        }
+        _work_ready_.notify_all ();
+        for (size_t i = 0; i < _workers_.size (); i++)
+          {
+            _workers_[i].join ();
+          }
+        return;
+      }
+
+      unsigned int task_pool::get_number_of_threads () const
+      {
+        return _workers_.size () + 1;
+      }
+
+      void task_pool::run (const std::vector<task_type> & tasks_)
+      {
+        if (tasks_.empty ()) return;
+        std::unique_lock<std::mutex> lock (_mutex_);
+        _tasks_ = &tasks_;
+        _next_ = 0;
+        _pending_ = tasks_.size ();
+        _error_ = std::exception_ptr ();
+        _generation_++;
+        _work_ready_.notify_all ();
+        _run_tasks (lock);
+        while (_pending_ > 0)
+          {
+            _work_done_.wait (lock);
+          }
+        _tasks_ = 0;
+        std::exception_ptr error = _error_;
+        _error_ = std::exception_ptr ();
+        lock.unlock ();
+        if (error)
+          {
+            std::rethrow_exception (error);
+          }
+        return;
+      }
+
+      void task_pool::_run_tasks (std::unique_lock<std::mutex> & lock_)
+      {
+        while (_tasks_ != 0 && _next_ < _tasks_->size ())
+          {
+            const task_type & task = (*_tasks_)[_next_++];
+            lock_.unlock ();
+            std::exception_ptr error;
+            try
+              {
+                task ();
+              }
+            catch (...)
+              {
+                error = std::current_exception ();
+              }
+            lock_.lock ();
+            if (error && ! _error_)
+              {
+                _error_ = error;
+              }
+            if (--_pending_ == 0)
+              {
+                _work_done_.notify_all ();
+              }
+          }
+        return;
+      }
+
+      void task_pool::_run_worker ()
+      {
+        std::unique_lock<std::mutex> lock (_mutex_);
+        unsigned long generation = _generation_;
+        while (true)
+          {
+            while (! _stop_ && _generation_ == generation)
+              {
+                _work_ready_.wait (lock);
+              }
+            if (_stop_) break;
+            generation = _generation_;
+            _run_tasks (lock);
+          }
+        return;
+      }
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of task_pool.cc
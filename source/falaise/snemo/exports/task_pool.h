@@ -0,0 +1,90 @@
+// -*- mode: c++ ; -*-
+/* task_pool.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Pool of worker threads running sets of independent tasks
+ *
+ *   The workers are started once and wait for the next set of tasks. The
+ *   calling thread takes part in the run and returns when all the tasks of
+ *   the set are done. The first exception thrown by a task is rethrown by
+ *   the calling thread.
+ *
+ * History:
+ *
+ */
+
+#ifndef SNRECONSTRUCTION_EXPORTS_TASK_POOL_H
+#define SNRECONSTRUCTION_EXPORTS_TASK_POOL_H 1
+
+#include <vector>
+#include <functional>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+
+      /// \brief Pool of worker threads
+      class task_pool
+      {
+      public:
+
+        typedef std::function<void ()> task_type;
+
+        /// Constructor (the number of threads includes the calling thread)
+        explicit task_pool (unsigned int nthreads_);
+
+        /// Destructor
+        ~task_pool ();
+
+        /// Return the number of threads (including the calling thread)
+        unsigned int get_number_of_threads () const;
+
+        /// Run a set of tasks and wait for their completion
+        void run (const std::vector<task_type> & tasks_);
+
+      protected:
+
+        /// Main loop of a worker thread
+        void _run_worker ();
+
+        /// Run the next tasks of the current set, return when none is left
+        void _run_tasks (std::unique_lock<std::mutex> & lock_);
+
+      private:
+
+        task_pool (const task_pool &);
+        task_pool & operator= (const task_pool &);
+
+      private:
+
+        std::vector<std::thread>        _workers_;    /// Worker threads
+        std::mutex                      _mutex_;      /// Lock of the shared state
+        std::condition_variable         _work_ready_; /// Notification of a new set of tasks
+        std::condition_variable         _work_done_;  /// Notification of the end of a set of tasks
+        const std::vector<task_type> *  _tasks_;      /// Current set of tasks
+        std::size_t                     _next_;       /// Index of the next task to run
+        std::size_t                     _pending_;    /// Number of tasks not yet completed
+        unsigned long                   _generation_; /// Index of the current set of tasks
+        std::exception_ptr              _error_;      /// First error of the current set
+        bool                            _stop_;       /// Stop flag
+
+      };
+
+    } // end of namespace exports
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // SNRECONSTRUCTION_EXPORTS_TASK_POOL_H
+
+// end of task_pool.h
@@ -124,6 +124,8 @@ namespace snemo {
         datatools::properties exporter_setup;
         setup_.export_starting_with (exporter_setup, "export.");
         _exporter_.initialize (exporter_setup);
+        DT_THROW_IF (_exporter_.are_true_scin_hits_unified (), std::logic_error,
+                     "Module '" << get_name () << "' : the ASCII format has no unified 'trueScinHits' bank !");
 
         // Initialize the export ASCII event :
         _ascii_event_.reset (new snemo::reconstruction::exports::export_ascii_event);
@@ -0,0 +1,269 @@
+// -*- mode: c++ ; -*-
+/* export_columnar_module.cc
+ */
+
+#include <stdexcept>
+#include <sstream>
+
+#include <falaise/snemo/processing/export_columnar_module.h>
+#include <falaise/snemo/exports/export_root_event.h>
+#include <falaise/snemo/exports/column_sink.h>
+
+#include <datatools/service_manager.h>
+#include <datatools/utils.h>
+
+#include <falaise/snemo/datamodels/data_model.h>
+
+#include <geomtools/geometry_service.h>
+#include <geomtools/manager.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace processing {
+
+      // Registration instantiation macro :
+      DPP_MODULE_REGISTRATION_IMPLEMENT(export_columnar_module,
+                                        "snemo::reconstruction::processing::export_columnar_module");
+
+      bool export_columnar_module::is_terminated () const
+      {
+        return _io_accounting_.terminated;
+      }
+
+      void export_columnar_module::_set_defaults ()
+      {
+        _filenames_.reset ();
+        _export_event_.reset (0);
+        _sink_.reset (0);
+        _io_accounting_.reset ();
+        return;
+      }
+
+      void export_columnar_module::initialize(const datatools::properties  & setup_,
+                                              datatools::service_manager   & service_manager_,
+                                              dpp::module_handle_dict_type & module_dict_)
+      {
+        DT_THROW_IF (is_initialized (), std::logic_error,
+                     "Module '" << get_name () << "' is already initialized ! ");
+
+        dpp::base_module::_common_initialize (setup_);
+
+        // I/O accounting :
+        _io_accounting_.initialize (setup_);
+
+
+        // Output format :
+        std::string format = "native";
+        if (setup_.has_key ("format"))
+          {
+            format = setup_.fetch_string ("format");
+          }
+        DT_THROW_IF (! exports::column_sink::has_format (format), std::logic_error,
+                     "Module '" << get_name () << "' : unsupported columnar format '" << format << "' !");
+        _sink_.reset (exports::column_sink::create (format));
+        datatools::properties sink_setup;
+        setup_.export_and_rename_starting_with (sink_setup, format + ".", "");
+        if (! sink_setup.has_key ("logging.priority"))
+          {
+            sink_setup.store_string ("logging.priority",
+                                     datatools::logger::get_priority_label (get_logging_priority ()));
+          }
+        _sink_.get ()->initialize (sink_setup);
+
+        // File names :
+        if (_filenames_.is_valid ())
+          {
+            _filenames_.reset ();
+          }
+        _filenames_.initialize (setup_);
+        DT_THROW_IF (! _filenames_.is_valid (), std::logic_error,
+                     "Module '" << get_name () << "' : invalid list of filenames !");
+
+        // Service labels :
+        DT_THROW_IF (! setup_.has_key ("Geo_label"), std::logic_error,
+                     "Module '" << get_name () << "' has no valid '" << "Geo_label" << "' property !");
+        const std::string geo_label = setup_.fetch_string ("Geo_label");
+        // Geometry manager :
+        DT_THROW_IF (! service_manager_.has (geo_label) ||
+                     ! service_manager_.is_a<geomtools::geometry_service> (geo_label),
+                     std::logic_error,
+                     "Module '" << get_name () << "' has no '" << geo_label << "' service !");
+        const geomtools::geometry_service & Geo
+          = service_manager_.get<geomtools::geometry_service> (geo_label);
+        _exporter_.set_geom_manager (Geo.get_geom_manager ());
+
+        // Initialize the exporter :
+        datatools::properties exporter_setup;
+        setup_.export_starting_with (exporter_setup, "export.");
+        _exporter_.initialize (exporter_setup);
+
+        // Initialize the export event (only used for its branch memory) :
+        _export_event_.reset (new snemo::reconstruction::exports::export_root_event);
+        // Boolean leaves tagged as bitfield members are packed in one column per group :
+        if (setup_.has_flag ("pack_bitfields"))
+          {
+            _export_event_.get()->grab_branch_manager ().set_pack_bitfields (true);
+          }
+        // Array leaves tagged as constant within an event are stored once per event :
+        if (setup_.has_flag ("hoist_event_constants"))
+          {
+            _export_event_.get()->grab_branch_manager ().set_hoist_event_constants (true);
+          }
+        // Leaves tagged as nullable only store their non missing values, flagged in a validity bitmap :
+        if (setup_.has_flag ("null_bitmaps"))
+          {
+            _export_event_.get()->grab_branch_manager ().set_null_bitmaps (true);
+          }
+        // Cell addresses are stored as packed keys, with or without the unpacked identifiers :
+        if (setup_.has_flag ("cell_keys"))
+          {
+            _export_event_.get()->grab_branch_manager ().set_cell_keys (true);
+            if (setup_.has_flag ("drop_cell_ids"))
+              {
+                _export_event_.get()->grab_branch_manager ().set_cell_ids (false);
+              }
+          }
+        // Storage modes and topics are taken from the exporter :
+        _export_event_.get()->construct (_exporter_);
+
+        _set_initialized (true);
+        return;
+      }
+
+      void export_columnar_module::reset()
+      {
+        DT_THROW_IF (! is_initialized (), std::logic_error,
+                     "Module '" << get_name () << "' is not initialized !");
+
+        // Reset the output file :
+        _close_file ();
+
+        _set_defaults ();
+
+        _set_initialized (false);
+        return;
+      }
+
+      // Constructor :
+      export_columnar_module::export_columnar_module(datatools::logger::priority logging_priority_)
+        : dpp::base_module(logging_priority_)
+      {
+        _set_defaults ();
+        return;
+      }
+
+      // Destructor :
+      export_columnar_module::~export_columnar_module()
+      {
+        if (is_initialized ()) export_columnar_module::reset ();
+        return;
+      }
+
+      // Processing :
+      dpp::base_module::process_status export_columnar_module::process(datatools::things & data_record_)
+      {
+        DT_THROW_IF (! is_initialized (), std::logic_error,
+                     "Module '" << get_name () << "' is not initialized !");
+
+        // Main processing method :
+        return _process_event (data_record_);
+      }
+
+      dpp::base_module::process_status export_columnar_module::_process_event (const datatools::things & data_record_)
+      {
+        dpp::base_module::process_status store_status = dpp::base_module::PROCESS_SUCCESS;
+        DT_LOG_TRACE (get_logging_priority (), "Entering...");
+
+        if (_io_accounting_.terminated)
+          {
+            // The module has now finished its job : we do not process this event
+            store_status = dpp::base_module::PROCESS_STOP;
+            return store_status;
+          }
+
+        if (! _sink_.get ()->is_open ())
+          {
+            std::string sink_label;
+            if (! _io_accounting_.open_next_file (_filenames_, sink_label, get_name (), get_logging_priority ()))
+              {
+                store_status = dpp::base_module::PROCESS_FATAL;
+                return store_status;
+              }
+            DT_LOG_DEBUG (get_logging_priority (), "Opening columnar sink '" << sink_label << "'...");
+            store_status = _open_file (sink_label);
+            if (store_status != dpp::base_module::PROCESS_SUCCESS)
+              {
+                return store_status;
+              }
+          }
+
+        // Invoke the effective storage of the event data :
+        _store_event (data_record_);
+
+        // Statistics and rotation of the output files :
+        if (_io_accounting_.count_record (_filenames_, get_name (), get_logging_priority ()))
+          {
+            _close_file ();
+          }
+
+        DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+        return store_status;
+      }
+
+      dpp::base_module::process_status export_columnar_module::_open_file (const std::string & sink_label_)
+      {
+        DT_LOG_TRACE (get_logging_priority (), "Entering...");
+        snemo::reconstruction::exports::export_root_event & EE = *_export_event_.get ();
+        try
+          {
+            _sink_.get ()->open (sink_label_, EE.grab_branch_manager (), EE.get_store_bits ());
+          }
+        catch (std::exception & error)
+          {
+            DT_LOG_ERROR (get_logging_priority (), "Cannot open the columnar output file ('"
+                          << sink_label_ << "') : " << error.what ());
+            return dpp::base_module::PROCESS_FATAL;
+          }
+        DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+        return dpp::base_module::PROCESS_SUCCESS;
+      }
+
+      int export_columnar_module::_close_file ()
+      {
+        DT_LOG_TRACE (get_logging_priority (), "Entering...");
+        if (_sink_.get () != 0 && _sink_.get ()->is_open ())
+          {
+            _sink_.get ()->close ();
+            DT_LOG_DEBUG (get_logging_priority (), "Columnar file is closed.");
+          }
+        DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+        return 0;
+      }
+
+      int export_columnar_module::_store_event (const datatools::things & event_record_)
+      {
+        DT_LOG_TRACE (get_logging_priority (), "Entering...");
+        snemo::reconstruction::exports::export_root_event & EE = *_export_event_.get ();
+
+        // Export the SN@ilWare event data model to the export event:
+        _exporter_.run (event_record_, EE);
+        DT_LOG_DEBUG (get_logging_priority (), "SN@ilWare event has been exported.");
+
+        // Fill the branch memory (no ROOT tree is attached) :
+        EE.fill_memory ();
+
+        // Append the branch memory to the current column pages :
+        _sink_.get ()->store_entry ();
+        DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+        return 0;
+      }
+
+    } // end of namespace processing
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of export_columnar_module.cc
@@ -0,0 +1,100 @@
+// -*- mode: c++ ; -*-
+/* export_columnar_module.h
+ *
+ * License:
+ *
+ * Description:
+ *
+ *   Module for exporting the SuperNEMO event model in column oriented
+ *   (non-ROOT) file(s)
+ *
+ * History:
+ *
+ */
+
+#ifndef __snreconstruction__processing__export_columnar_module_h
+#define __snreconstruction__processing__export_columnar_module_h 1
+
+#include <string>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <dpp/base_module.h>
+
+#include <falaise/snemo/exports/event_exporter.h>
+#include <falaise/snemo/processing/export_io_accounting.h>
+
+#include <datatools/smart_filename.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace exports {
+      class export_root_event;
+      class column_sink;
+    }
+
+    namespace processing {
+
+      class export_columnar_module : public dpp::base_module
+      {
+      public:
+
+        typedef export_io_accounting io_accounting_type;
+
+        bool is_terminated () const;
+
+        /// Constructor
+        export_columnar_module(datatools::logger::priority = datatools::logger::PRIO_FATAL);
+
+        /// Destructor
+        virtual ~export_columnar_module();
+
+        /// Initialization
+        virtual void initialize(const datatools::properties  & setup_,
+                                datatools::service_manager   & service_manager_,
+                                dpp::module_handle_dict_type & module_dict_);
+
+        /// Reset
+        virtual void reset();
+
+        /// Data record processing
+        virtual process_status process(datatools::things & data_);
+
+      protected:
+
+        process_status _process_event (const datatools::things & data_);
+
+        process_status _open_file (const std::string & filename_);
+
+        int _store_event (const datatools::things & data_);
+
+        int _close_file ();
+
+        /// Give default values to specific class members
+        void _set_defaults ();
+
+      private:
+
+        exports::event_exporter   _exporter_;  //!< The exporter
+        datatools::smart_filename _filenames_; //!< Filenames
+
+        boost::scoped_ptr<exports::export_root_event> _export_event_; //!< Branch memory
+        boost::scoped_ptr<exports::column_sink>       _sink_;         //!< The column sink
+        io_accounting_type                            _io_accounting_;
+
+        // Macro to automate the registration of the module :
+        DPP_MODULE_REGISTRATION_INTERFACE(export_columnar_module);
+
+      };
+
+    } // end of namespace processing
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // __snreconstruction__processing__export_columnar_module_h
+
+// end of export_columnar_module.h
@@ -0,0 +1,167 @@
+// -*- mode: c++ ; -*-
+/* export_io_accounting.cc
+ */
+
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+#include <falaise/snemo/processing/export_io_accounting.h>
+
+#include <datatools/properties.h>
+#include <datatools/smart_filename.h>
+#include <datatools/exception.h>
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace processing {
+
+      export_io_accounting::export_io_accounting ()
+      {
+        reset ();
+        return;
+      }
+
+      void export_io_accounting::reset ()
+      {
+        max_records_per_file = 0;
+        max_records_total = 0;
+        max_files = 0;
+        terminated = false;
+        file_record_counter = 0;
+        record_counter = 0;
+        file_index = -1;
+        return;
+      }
+
+      void export_io_accounting::initialize (const datatools::properties & setup_)
+      {
+        if (setup_.has_key ("max_records_total"))
+          {
+            max_records_total = setup_.fetch_integer ("max_records_total");
+            if (max_records_total < 0) max_records_total = 0;
+          }
+
+        if (setup_.has_key ("max_records_per_file"))
+          {
+            max_records_per_file = setup_.fetch_integer ("max_records_per_file");
+            if (max_records_per_file < 0) max_records_per_file = 0;
+          }
+
+        if (setup_.has_key ("max_files"))
+          {
+            max_files = setup_.fetch_integer ("max_files");
+            if (max_files < 0) max_files = 0;
+          }
+        return;
+      }
+
+      bool export_io_accounting::open_next_file (const datatools::smart_filename & filenames_,
+                                                 std::string & filename_,
+                                                 const std::string & module_name_,
+                                                 datatools::logger::priority logging_priority_)
+      {
+        file_index++;
+        if (file_index >= (int) filenames_.size ())
+          {
+            return false;
+          }
+        DT_LOG_TRACE (logging_priority_, "Module '" << module_name_ << "' : file index is " << file_index << ".");
+        filename_ = filenames_[file_index];
+        boost::filesystem::path sink_path (filename_.c_str ());
+        boost::filesystem::path sink_dir_path = sink_path.parent_path ();
+        std::string sink_dir_str = boost::filesystem::basename (sink_dir_path);
+        if (! sink_dir_str.empty ())
+          {
+            DT_THROW_IF (boost::filesystem::exists (sink_dir_path)
+                         && ! boost::filesystem::is_directory (sink_dir_path),
+                         std::logic_error,
+                         "Path '" << sink_dir_path << "' is not a directory !");
+            if (! boost::filesystem::is_directory (sink_dir_path))
+              {
+                DT_LOG_NOTICE (logging_priority_,
+                               "Module '" << module_name_ << "' : creating base directory for sink '"
+                               << filename_ << "'...");
+                boost::filesystem::create_directories (sink_dir_path);
+              }
+            else
+              {
+                DT_LOG_DEBUG (logging_priority_, "Base directory for sink '"
+                              << filename_ << "' already exists...");
+              }
+          }
+        file_record_counter = 0;
+        return true;
+      }
+
+      bool export_io_accounting::count_record (const datatools::smart_filename & filenames_,
+                                               const std::string & module_name_,
+                                               datatools::logger::priority logging_priority_)
+      {
+        file_record_counter++;
+        record_counter++;
+
+        bool stop_file   = false;
+        bool stop_output = false;
+
+        if (max_records_total > 0)
+          {
+            if (record_counter >= max_records_total)
+              {
+                stop_output = true;
+                stop_file   = true;
+                DT_LOG_NOTICE (logging_priority_,
+                               "Module '" << module_name_ << "' has reached the maximum number of records "
+                               << "stored in the output data source (" << max_records_total << ") !");
+              }
+          }
+
+        if (max_records_per_file > 0)
+          {
+            if (file_record_counter >= max_records_per_file)
+              {
+                stop_file = true;
+                DT_LOG_NOTICE (logging_priority_,
+                               "Module '" << module_name_ << "' has reached the maximum number of records "
+                               << "to be stored in the current output file (" << max_records_per_file << ") !");
+              }
+          }
+
+        if (stop_file)
+          {
+            file_record_counter = 0;
+            if (max_files > 0)
+              {
+                if ((file_index + 1) >= max_files)
+                  {
+                    stop_output = true;
+                    DT_LOG_NOTICE (logging_priority_,
+                                   "Module '" << module_name_ << "' has reached "
+                                   << "the requested maximum number of output files (" << max_files << ") !");
+                  }
+              }
+            if ((file_index + 1) >= (int) filenames_.size ())
+              {
+                stop_output = true;
+                DT_LOG_NOTICE (logging_priority_,
+                               "Module '" << module_name_ << "' has filled "
+                               << "the last requested output file (total is " << filenames_.size () << " files)!");
+              }
+          }
+
+        if (stop_output)
+          {
+            terminated = true;
+          }
+        return stop_file;
+      }
+
+    } // end of namespace processing
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+// end of export_io_accounting.cc
@@ -0,0 +1,70 @@
+// -*- mode: c++ ; -*-
+/* export_io_accounting.h
+ *
+ * Description:
+ *
+ *   I/O accounting of the export modules : limits on the number of
+ *   records and files, rotation of the output files along a list of
+ *   filenames and creation of their directories
+ *
+ * History:
+ *
+ */
+
+#ifndef __snreconstruction__processing__export_io_accounting_h
+#define __snreconstruction__processing__export_io_accounting_h 1
+
+#include <string>
+
+#include <datatools/logger.h>
+
+namespace datatools {
+  class properties;
+  class smart_filename;
+}
+
+namespace snemo {
+
+  namespace reconstruction {
+
+    namespace processing {
+
+      struct export_io_accounting
+      {
+        int max_records_per_file; //!< Maximum number of event records per file
+        int max_records_total;    //!< Maximum number of event records to be processed
+        int max_files;            //!< Maximum number of data files to be processed
+        bool terminated;          //!< Termination flag
+        int file_record_counter;  //!< Event record counter in the current file
+        int record_counter;       //!< Total event record counter
+        int file_index;           //!<Index of the current datafile index
+
+        export_io_accounting ();
+
+        void reset ();
+
+        /// Set the limits from the 'max_records_total', 'max_records_per_file' and 'max_files' properties
+        void initialize (const datatools::properties & setup_);
+
+        /// Select the next output file and create its directory, return false if the list of filenames is exhausted
+        bool open_next_file (const datatools::smart_filename & filenames_,
+                             std::string & filename_,
+                             const std::string & module_name_,
+                             datatools::logger::priority logging_priority_);
+
+        /// Count a stored record, return true if the current file must be closed (the termination flag is updated)
+        bool count_record (const datatools::smart_filename & filenames_,
+                           const std::string & module_name_,
+                           datatools::logger::priority logging_priority_);
+
+      };
+
+    } // end of namespace processing
+
+  } // end of namespace reconstruction
+
+} // end of namespace snemo
+
+#endif // __snreconstruction__processing__export_io_accounting_h
+
+// end of export_io_accounting.h
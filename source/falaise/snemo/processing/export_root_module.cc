@@ -4,12 +4,15 @@
 
 #include <stdexcept>
 #include <sstream>
+#include <functional>
+#include <memory>
 
 #include <boost/foreach.hpp>
-#include <boost/filesystem.hpp>
 
 #include <falaise/snemo/processing/export_root_module.h>
 #include <falaise/snemo/exports/export_root_event.h>
+#include <falaise/snemo/exports/export_metadata.h>
+#include <falaise/snemo/exports/export_pipeline.h>
 
 #include <datatools/service_manager.h>
 #include <datatools/utils.h>
@@ -23,6 +26,7 @@
 
 #include <TFile.h>
 #include <TTree.h>
+#include <TROOT.h>
 
 namespace snemo {
 
@@ -39,27 +43,14 @@ namespace snemo {
         return _io_accounting_.terminated;
       }
 
-      export_root_module::io_accounting_type::io_accounting_type ()
-      {
-        reset ();
-        return;
-      }
-
-      void export_root_module::io_accounting_type::reset ()
-      {
-        max_records_per_file = 0;
-        max_records_total = 0;
-        max_files = 0;
-        terminated = false;
-        file_record_counter = 0;
-        record_counter = 0;
-        file_index = -1;
-        return;
-      }
-
       void export_root_module::_set_defaults ()
       {
         _root_filenames_.reset ();
+        // The pipeline commits in the export ROOT event :
+        _release_pipeline ();
+        _pipeline_depth_ = 0;
+        _pipeline_workers_ = 0;
+        _memory_budget_ = snemo::reconstruction::exports::memory_budget ();
         _root_event_.reset (0);
         _io_accounting_.reset ();
         return;
@@ -75,22 +66,45 @@ namespace snemo {
         dpp::base_module::_common_initialize (setup_);
 
         // I/O accounting :
-        if (setup_.has_key ("max_records_total"))
+        _io_accounting_.initialize (setup_);
+
+        if (setup_.has_key ("pipeline_depth"))
           {
-            _io_accounting_.max_records_total = setup_.fetch_integer ("max_records_total");
-            if (_io_accounting_.max_records_total < 0) _io_accounting_.max_records_total = 0;
+            const int pipeline_depth = setup_.fetch_integer ("pipeline_depth");
+            DT_THROW_IF (pipeline_depth < 0, std::logic_error,
+                         "Module '" << get_name () << "' has an invalid pipeline depth (" << pipeline_depth << ") !");
+            _pipeline_depth_ = pipeline_depth;
           }
 
-        if (setup_.has_key ("max_records_per_file"))
+        if (setup_.has_key ("pipeline_workers"))
+          {
+            const int pipeline_workers = setup_.fetch_integer ("pipeline_workers");
+            DT_THROW_IF (pipeline_workers < 0, std::logic_error,
+                         "Module '" << get_name () << "' has an invalid number of pipeline workers (" << pipeline_workers << ") !");
+            _pipeline_workers_ = pipeline_workers;
+          }
+        // Each worker needs a few slots to convert the next record while the previous ones wait for their commit :
+        if (_pipeline_workers_ > 0 && _pipeline_depth_ == 0)
           {
-            _io_accounting_.max_records_per_file = setup_.fetch_integer ("max_records_per_file");
-            if (_io_accounting_.max_records_per_file < 0) _io_accounting_.max_records_per_file = 0;
+            _pipeline_depth_ = 2 * _pipeline_workers_;
+          }
+        if (_pipeline_depth_ > 0 && _pipeline_workers_ == 0)
+          {
+            _pipeline_workers_ = 1;
           }
 
-        if (setup_.has_key ("max_files"))
+        // Memory budget of the baskets, branch buffers and export events (MB) :
+        if (setup_.has_key ("memory_budget"))
           {
-            _io_accounting_.max_files = setup_.fetch_integer ("max_files");
-            if (_io_accounting_.max_files < 0) _io_accounting_.max_files = 0;
+            const int memory_budget = setup_.fetch_integer ("memory_budget");
+            DT_THROW_IF (memory_budget < 0, std::logic_error,
+                         "Module '" << get_name () << "' has an invalid memory budget (" << memory_budget << " MB) !");
+            _memory_budget_.set_limit (static_cast<std::size_t> (memory_budget) * 1024 * 1024);
+          }
+
+        if (setup_.has_key ("memory_budget.flush_fraction"))
+          {
+            _memory_budget_.set_flush_fraction (setup_.fetch_real ("memory_budget.flush_fraction"));
           }
 
         // File names :
@@ -121,20 +135,84 @@ namespace snemo {
         _exporter_.initialize (exporter_setup);
 
         // Initialize the export event :
-        _root_event_.reset (new snemo::reconstruction::exports::export_root_event);
-        std::map<std::string,int> topics;
-        if (_exporter_.get_topic_export_level("CAT")
-            == snemo::reconstruction::exports::event_exporter::EXPORT_TOPIC_INCLUDE)
+        _root_event_.reset (_create_root_event (setup_));
+
+        if (_pipeline_depth_ > 0)
           {
-            topics["CAT"] = snemo::reconstruction::exports::event_exporter::EXPORT_TOPIC_INCLUDE;
+            // The slots are packed on the worker threads while the committer fills the tree :
+            ROOT::EnableThreadSafety ();
+            // Each worker has its own exporter, the intra-event threads are not used :
+            datatools::properties worker_setup (exporter_setup);
+            worker_setup.erase ("export.threads");
+            for (unsigned int i = 0; i < _pipeline_workers_; i++)
+              {
+                _pipeline_exporters_.push_back (new snemo::reconstruction::exports::event_exporter);
+                _pipeline_exporters_.back ().set_geom_manager (Geo.get_geom_manager ());
+                _pipeline_exporters_.back ().initialize (worker_setup);
+              }
+            // The records are converted and packed by the workers, then committed in order by the pipeline thread :
+            _pipeline_.reset (new snemo::reconstruction::exports::export_pipeline
+                              (_pipeline_depth_,
+                               _pipeline_workers_,
+                               std::bind (&export_root_module::_create_root_event, this, std::cref (setup_)),
+                               std::bind (&export_root_module::_convert_event, this,
+                                          std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+                               std::bind (&export_root_module::_commit_event, this, std::placeholders::_1)));
           }
-        _root_event_.get()->construct (_exporter_.get_export_flags (),
-                                       topics);
 
         _set_initialized (true);
         return;
       }
 
+      snemo::reconstruction::exports::export_root_event *
+      export_root_module::_create_root_event (const datatools::properties & setup_) const
+      {
+        std::unique_ptr<snemo::reconstruction::exports::export_root_event>
+          root_event (new snemo::reconstruction::exports::export_root_event);
+        // Bank versions are stored as file level metadata unless the legacy branches are requested :
+        if (setup_.has_flag ("legacy_version_branches"))
+          {
+            root_event.get()->grab_branch_manager ().set_version_branches (true);
+          }
+        // Boolean leaves tagged as bitfield members are packed in one branch per group :
+        if (setup_.has_flag ("pack_bitfields"))
+          {
+            root_event.get()->grab_branch_manager ().set_pack_bitfields (true);
+          }
+        // Array leaves tagged as constant within an event are stored once per event :
+        if (setup_.has_flag ("hoist_event_constants"))
+          {
+            root_event.get()->grab_branch_manager ().set_hoist_event_constants (true);
+          }
+        // Leaves tagged as nullable only store their non missing values, flagged in a validity bitmap :
+        if (setup_.has_flag ("null_bitmaps"))
+          {
+            root_event.get()->grab_branch_manager ().set_null_bitmaps (true);
+          }
+        // Scalar banks are stored as one multi-leaf branch per bank :
+        if (setup_.has_flag ("leaflist_scalar_banks"))
+          {
+            root_event.get()->grab_branch_manager ().set_leaflist_scalar_banks (true);
+          }
+        // The size counters of all banks are stored in one multi-leaf branch :
+        if (setup_.has_flag ("group_size_counters"))
+          {
+            root_event.get()->grab_branch_manager ().set_group_size_counters (true);
+          }
+        // Cell addresses are stored as packed keys, with or without the unpacked identifiers :
+        if (setup_.has_flag ("cell_keys"))
+          {
+            root_event.get()->grab_branch_manager ().set_cell_keys (true);
+            if (setup_.has_flag ("drop_cell_ids"))
+              {
+                root_event.get()->grab_branch_manager ().set_cell_ids (false);
+              }
+          }
+        // Storage modes and topics are taken from the exporter :
+        root_event.get()->construct (_exporter_);
+        return root_event.release ();
+      }
+
       void export_root_module::reset()
       {
         DT_THROW_IF (! is_initialized (), std::logic_error,
@@ -190,39 +268,14 @@ namespace snemo {
 
         if (_root_sink_ == 0)
           {
-            _io_accounting_.file_index++;
-            if (_io_accounting_.file_index >= (int)_root_filenames_.size ())
+            std::string sink_label;
+            if (! _io_accounting_.open_next_file (_root_filenames_, sink_label, get_name (), get_logging_priority ()))
               {
                 store_status = dpp::base_module::PROCESS_FATAL;
                 return store_status;
               }
-            DT_LOG_TRACE (get_logging_priority (), "_io_accounting_.file_index === "
-                          << _io_accounting_.file_index << "'...");
-            std::string sink_label = _root_filenames_[_io_accounting_.file_index];
             DT_LOG_DEBUG (get_logging_priority (), "Opening ROOT sink '" << sink_label << "'...");
-            boost::filesystem::path sink_path(sink_label.c_str ());
-            boost::filesystem::path sink_dir_path = sink_path.parent_path();
-            std::string sink_dir_str = boost::filesystem::basename (sink_dir_path);
-            if (! sink_dir_str.empty () )
-              {
-                DT_THROW_IF ( boost::filesystem::exists (sink_dir_path)
-                              && ! boost::filesystem::is_directory (sink_dir_path),
-                              std::logic_error,
-                              "Path '" << sink_dir_path << "' is not a directory !");
-                if (! boost::filesystem::is_directory (sink_dir_path))
-                  {
-                    DT_LOG_NOTICE (get_logging_priority (),
-                                   "Creating base directory for ROOT sink '" << sink_label << "'...");
-                    boost::filesystem::create_directories(sink_dir_path);
-                  }
-                else
-                  {
-                    DT_LOG_DEBUG (get_logging_priority (), "Base directory for ROOT sink '"
-                                  << sink_label << "' already exists...");
-                  }
-              }
             _open_file (sink_label);
-            _io_accounting_.file_record_counter = 0;
           }
 
         // force storage of the current event record :
@@ -235,66 +288,12 @@ namespace snemo {
             // Invoke the effective storage of the event data :
             _store_event (data_record_);
 
-            // Statistics :
-            _io_accounting_.file_record_counter++;
-            _io_accounting_.record_counter++;
-          }
-
-        bool stop_file   = false;
-        bool stop_output = false;
-
-        if (_io_accounting_.max_records_total > 0)
-          {
-            if (_io_accounting_.record_counter >= _io_accounting_.max_records_total)
-              {
-                stop_output = true;
-                stop_file   = true;
-                DT_LOG_NOTICE (get_logging_priority (),
-                               "Module '" << get_name () << "' has reached the maximum number of records "
-                               << "stored in the output data source (" << _io_accounting_.max_records_total << ") !");
-              }
-          }
-
-        if (_io_accounting_.max_records_per_file > 0)
-          {
-            if (_io_accounting_.file_record_counter >= _io_accounting_.max_records_per_file)
-              {
-                stop_file = true;
-                DT_LOG_NOTICE (get_logging_priority (),
-                               "Module '" << get_name () << "' has reached the maximum number of records "
-                               << "to be stored in the current output file (" <<_io_accounting_.max_records_per_file << ") !");
-              }
-          }
-
-        if (stop_file)
-          {
-            if (_root_sink_ != 0)
+            // Statistics and rotation of the output files :
+            if (_io_accounting_.count_record (_root_filenames_, get_name (), get_logging_priority ())
+                && _root_sink_ != 0)
               {
                 _close_file ();
               }
-            _io_accounting_.file_record_counter = 0;
-            if (_io_accounting_.max_files > 0)
-              {
-                if ((_io_accounting_.file_index + 1) >= _io_accounting_.max_files)
-                  {
-                    stop_output = true;
-                    DT_LOG_NOTICE (get_logging_priority (),
-                                   "Module '" << get_name () << "' has reached "
-                                   << "the requested maximum number of output files (" << _io_accounting_.max_files << ") !");
-                  }
-              }
-            if ((_io_accounting_.file_index + 1) >= (int)_root_filenames_.size ())
-              {
-                stop_output = true;
-                DT_LOG_NOTICE (get_logging_priority (),
-                               "Module '" << get_name () << "' has filled "
-                               << "the last requested output file (total is " << _root_filenames_.size () << " files)!");
-              }
-          }
-
-        if (stop_output)
-          {
-            _io_accounting_.terminated = true;
           }
 
         DT_LOG_TRACE (get_logging_priority (), "Exiting.");
@@ -334,9 +333,40 @@ namespace snemo {
         DT_LOG_TRACE (get_logging_priority (), "Entering...");
         if (_root_tree_ != 0)
           {
+            // The pending events belong to this tree :
+            if (_pipeline_)
+              {
+                _pipeline_->drain ();
+                const snemo::reconstruction::exports::export_pipeline::statistics_type pipeline_stats
+                  = _pipeline_->get_statistics ();
+                DT_LOG_NOTICE (get_logging_priority (),
+                               "Module '" << get_name () << "' event pipeline : committed = "
+                               << pipeline_stats.committed << ", producer waits = " << pipeline_stats.producer_waits
+                               << ", committer waits = " << pipeline_stats.committer_waits << " !");
+              }
+            if (_memory_budget_.is_active ())
+              {
+                const snemo::reconstruction::exports::memory_budget::statistics_type & budget_stats
+                  = _memory_budget_.get_statistics ();
+                DT_LOG_NOTICE (get_logging_priority (),
+                               "Module '" << get_name () << "' memory : peak = "
+                               << budget_stats.peak.get_total () << " bytes (baskets = " << budget_stats.peak.baskets
+                               << ", buffers = " << budget_stats.peak.buffers << ", events = " << budget_stats.peak.events
+                               << "), budget = " << _memory_budget_.get_limit () << " bytes, flushes = "
+                               << budget_stats.flushes << ", shrinks = " << budget_stats.shrinks << " !");
+              }
             _root_tree_->Print ();
             snemo::reconstruction::exports::export_root_event & EE = *_root_event_.get ();
             EE.detach_branches ();
+            if (EE.arena.is_active ())
+              {
+                const snemo::reconstruction::exports::event_arena::statistics_type & arena_stats
+                  = EE.arena.get_statistics ();
+                DT_LOG_NOTICE (get_logging_priority (),
+                               "Module '" << get_name () << "' event arena : high-water mark = "
+                               << arena_stats.high_water << " bytes, capacity = " << arena_stats.capacity
+                               << " bytes, heap blocks = " << arena_stats.blocks << " !");
+              }
             _root_tree_->SetDirectory (_root_sink_);
             // Ensure the ROOT file is the current directory :
             _root_sink_->cd ();
@@ -357,6 +387,20 @@ namespace snemo {
 
         snemo::reconstruction::exports::export_root_event & EE = *_root_event_.get ();
         EE.setup_tree (_root_tree_);
+
+        // The peak memory usage is reported per file :
+        if (! _memory_budget_.setup_tree (*_root_tree_))
+          {
+            DT_LOG_WARNING (get_logging_priority (), "The auto-flush of the ROOT tree ("
+                            << _root_tree_->GetAutoFlush () << " entries) is kept : "
+                            << "the memory budget only relies on its checks !");
+          }
+        _memory_budget_.reset_statistics ();
+
+        // Store the export configuration once per file :
+        snemo::reconstruction::exports::export_metadata metadata;
+        metadata.build (EE.grab_branch_manager (), EE.get_store_bits ());
+        metadata.store (*_root_tree_);
         _root_tree_->Print ();
         DT_LOG_TRACE (get_logging_priority (), "Exiting.");
         return 0;
@@ -387,6 +431,24 @@ namespace snemo {
         snemo::reconstruction::exports::export_root_event & EE = *_root_event_.get ();
         DT_LOG_DEBUG (get_logging_priority (), "Reference to exported ROOT event is ok.");
 
+        if (_pipeline_)
+          {
+            // The record only lives during the processing : the workers convert a copy of it
+            datatools::things & record = _pipeline_->acquire ();
+            try
+              {
+                _exporter_.copy_record (event_record_, record);
+              }
+            catch (...)
+              {
+                _pipeline_->release ();
+                throw;
+              }
+            _pipeline_->submit ();
+            DT_LOG_TRACE (get_logging_priority (), "Exiting.");
+            return 0;
+          }
+
         // Export the SN@ilWare event data model to the export event:
         _exporter_.run (event_record_, EE);
         DT_LOG_DEBUG (get_logging_priority (), "SN@ilWare event has been exported.");
@@ -398,10 +460,85 @@ namespace snemo {
         // Final store, using the 'export setup' of the exporter  :
         _root_tree_->SetDirectory (_root_sink_);
         _root_tree_->Fill ();
+        _check_memory_budget (EE);
         DT_LOG_TRACE (get_logging_priority (), "Exiting.");
         return 0;
       }
 
+      void export_root_module::_release_pipeline ()
+      {
+        // The pending records are committed by the destruction of the pipeline :
+        _pipeline_.reset (0);
+        for (size_t i = 0; i < _pipeline_exporters_.size (); i++)
+          {
+            _exporter_.merge_reference_counters (_pipeline_exporters_[i].get_reference_counters ());
+          }
+        _pipeline_exporters_.clear ();
+        return;
+      }
+
+      void export_root_module::_convert_event (unsigned int worker_,
+                                               const datatools::things & event_record_,
+                                               snemo::reconstruction::exports::export_event & event_)
+      {
+        snemo::reconstruction::exports::export_root_event & slot_event
+          = static_cast<snemo::reconstruction::exports::export_root_event &>(event_);
+        _pipeline_exporters_[worker_].run (event_record_, slot_event);
+        // The columns are packed in the branch buffers of the slot :
+        slot_event.fill_memory ();
+        return;
+      }
+
+      void export_root_module::_commit_event (snemo::reconstruction::exports::export_event & event_)
+      {
+        // The tree is only used by the committer thread until the pipeline is drained :
+        snemo::reconstruction::exports::export_root_event & EE = *_root_event_.get ();
+        snemo::reconstruction::exports::export_root_event & slot_event
+          = static_cast<snemo::reconstruction::exports::export_root_event &>(event_);
+        // The branches of the tree are re-pointed at the packed columns of the slot, which gets the previous ones :
+        EE.grab_branch_manager ().swap_values (slot_event.grab_branch_manager ());
+        _root_tree_->SetDirectory (_root_sink_);
+        _root_tree_->Fill ();
+        _check_memory_budget (event_);
+        return;
+      }
+
+      void export_root_module::_check_memory_budget (snemo::reconstruction::exports::export_event & event_)
+      {
+        if (! _memory_budget_.is_active ()) return;
+        snemo::reconstruction::exports::export_root_event & EE = *_root_event_.get ();
+        snemo::reconstruction::exports::memory_budget::usage_type usage;
+        usage.baskets = snemo::reconstruction::exports::memory_budget::compute_basket_memory (*_root_tree_);
+        usage.buffers = EE.grab_branch_manager ().get_memory_usage ();
+        // The events of a pipeline are assumed to be as large as the last one :
+        std::size_t number_of_events = 1;
+        if (_pipeline_)
+          {
+            number_of_events = _pipeline_->get_depth ();
+            // Each slot of the pipeline has its own branch buffers :
+            snemo::reconstruction::exports::export_root_event & slot_event
+              = static_cast<snemo::reconstruction::exports::export_root_event &>(event_);
+            usage.buffers += number_of_events * slot_event.grab_branch_manager ().get_memory_usage ();
+          }
+        usage.events = event_.get_memory_usage () * number_of_events;
+        if (&event_ != &EE)
+          {
+            usage.events += EE.get_memory_usage ();
+          }
+        if (_memory_budget_.check (*_root_tree_, usage))
+          {
+            // The storages are allocated again by the next large events only :
+            event_.shrink_data ();
+            EE.grab_branch_manager ().shrink_values ();
+            if (_pipeline_)
+              {
+                static_cast<snemo::reconstruction::exports::export_root_event &>(event_).grab_branch_manager ().shrink_values ();
+              }
+            DT_LOG_DEBUG (get_logging_priority (), "Export event and branch storages have been released (memory budget).");
+          }
+        return;
+      }
+
     } // end of namespace processing
 
   } // end of namespace reconstruction
@@ -18,13 +18,17 @@
 #define __snreconstruction__processing__export_root_module_h 1
 
 #include <string>
+#include <vector>
 #include <fstream>
 
 #include <boost/scoped_ptr.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
 
 #include <dpp/base_module.h>
 
 #include <falaise/snemo/exports/event_exporter.h>
+#include <falaise/snemo/processing/export_io_accounting.h>
+#include <falaise/snemo/exports/memory_budget.h>
 
 #include <datatools/smart_filename.h>
 
@@ -36,7 +40,9 @@ namespace snemo {
   namespace reconstruction {
 
     namespace exports {
+      class export_event;
       class export_root_event;
+      class export_pipeline;
     }
 
     namespace processing {
@@ -45,19 +51,7 @@ namespace snemo {
       {
       public:
 
-        struct io_accounting_type
-        {
-          int max_records_per_file; //!< Maximum number of event records per file
-          int max_records_total;    //!< Maximum number of event records to be processed
-          int max_files;            //!< Maximum number of data files to be processed
-          bool terminated;          //!< Termination flag
-          int file_record_counter;  //!< Event record counter in the current file
-          int record_counter;       //!< Total event record counter
-          int file_index;           //!<Index of the current datafile index
-
-          io_accounting_type ();
-          void reset ();
-        };
+        typedef export_io_accounting io_accounting_type;
 
         bool is_terminated () const;
 
@@ -92,6 +86,23 @@ namespace snemo {
 
         int _close_file ();
 
+        /// Create an export event with the branch structure of the module
+        exports::export_root_event * _create_root_event (const datatools::properties & setup_) const;
+
+        /// Convert a record and pack its columns in an export event of the pipeline (worker threads)
+        void _convert_event (unsigned int worker_,
+                             const datatools::things & event_record_,
+                             exports::export_event & event_);
+
+        /// Commit a converted event of the pipeline in the tree (committer thread)
+        void _commit_event (exports::export_event & event_);
+
+        /// Commit the pending events and destroy the pipeline and its exporters
+        void _release_pipeline ();
+
+        /// Check the memory budget after the fill of the tree with a converted event
+        void _check_memory_budget (exports::export_event & event_);
+
         /// Give default values to specific class members
         void _set_defaults ();
 
@@ -104,6 +115,11 @@ namespace snemo {
         TFile *                                       _root_sink_;
         TTree *                                       _root_tree_;
         io_accounting_type                            _io_accounting_;
+        unsigned int                                  _pipeline_depth_; //!< Number of records in the pipeline (0 : no pipeline)
+        unsigned int                                  _pipeline_workers_; //!< Number of threads converting the records of the pipeline
+        boost::ptr_vector<exports::event_exporter>    _pipeline_exporters_; //!< Exporters of the workers of the pipeline
+        boost::scoped_ptr<exports::export_pipeline>   _pipeline_;     //!< Pipeline of the records converted concurrently and committed in order
+        exports::memory_budget                        _memory_budget_; //!< Memory budget of the export
 
         // Macro to automate the registration of the module :
         DPP_MODULE_REGISTRATION_INTERFACE(export_root_module);
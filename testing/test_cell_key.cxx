@@ -0,0 +1,159 @@
+// test_cell_key.cxx
+
+// Standard library:
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+
+// Third party:
+#include <datatools/exception.h>
+
+// This project:
+#include <falaise/snemo/exports/export_event.h>
+
+namespace sre = snemo::reconstruction::exports;
+
+void check_tracker (int32_t module_, int32_t side_, int32_t layer_, int32_t row_)
+{
+  const uint32_t key = sre::cell_key::make_tracker (module_, side_, layer_, row_);
+  DT_THROW_IF (key == sre::cell_key::INVALID_KEY, std::logic_error,
+               "Geiger cell [" << module_ << ':' << side_ << ':' << layer_ << ':' << row_
+               << "] has no key !");
+  int32_t module, side, layer, row;
+  sre::cell_key::decode_tracker (key, module, side, layer, row);
+  DT_THROW_IF (module != module_ || side != side_ || layer != layer_ || row != row_,
+               std::logic_error,
+               "Geiger cell [" << module_ << ':' << side_ << ':' << layer_ << ':' << row_
+               << "] is decoded as [" << module << ':' << side << ':' << layer << ':' << row << "] !");
+  return;
+}
+
+void check_calorimeter (int32_t type_, int32_t module_, int32_t side_,
+                        int32_t wall_, int32_t column_, int32_t row_)
+{
+  const uint32_t key = sre::cell_key::make_calorimeter (type_, module_, side_, wall_, column_, row_);
+  DT_THROW_IF (key == sre::cell_key::INVALID_KEY, std::logic_error,
+               "Calorimeter block of type " << type_ << " has no key !");
+  int32_t type, module, side, wall, column, row;
+  sre::cell_key::decode_calorimeter (key, type, module, side, wall, column, row);
+  DT_THROW_IF (type != type_ || module != module_ || side != side_
+               || wall != wall_ || column != column_ || row != row_,
+               std::logic_error,
+               "Calorimeter block [" << type_ << ':' << module_ << ':' << side_ << ':'
+               << wall_ << ':' << column_ << ':' << row_ << "] is decoded as ["
+               << type << ':' << module << ':' << side << ':'
+               << wall << ':' << column << ':' << row << "] !");
+  return;
+}
+
+void test_round_trips ()
+{
+  check_tracker (0, 0, 0, 0);
+  check_tracker (0, 1, 8, 112);
+  check_tracker (253, 13, 253, 4093);
+  check_calorimeter (sre::constants::CALO_TYPE, 0, 1, -1, 19, 12);
+  check_calorimeter (sre::constants::XCALO_TYPE, 0, 0, 1, 15, 15);
+  check_calorimeter (sre::constants::GVETO_TYPE, 0, 1, 0, 15, -1);
+  check_calorimeter (13, 253, 13, 13, 61, 61);
+
+  // Missing addresses are restored as invalid identifiers :
+  check_tracker (-1, -1, -1, -1);
+
+  // The invalid key is decoded as invalid identifiers :
+  int32_t module, side, layer, row;
+  sre::cell_key::decode_tracker (sre::cell_key::INVALID_KEY, module, side, layer, row);
+  DT_THROW_IF (module != sre::constants::INVALID_ID || side != sre::constants::INVALID_ID
+               || layer != sre::constants::INVALID_ID || row != sre::constants::INVALID_ID,
+               std::logic_error,
+               "The invalid tracker key is decoded as a valid cell !");
+  return;
+}
+
+void test_overflows ()
+{
+  // Each field stores its address plus one :
+  DT_THROW_IF (sre::cell_key::make_tracker (255, 0, 0, 0) != sre::cell_key::INVALID_KEY,
+               std::logic_error, "Tracker module overflow is not detected !");
+  DT_THROW_IF (sre::cell_key::make_tracker (0, 15, 0, 0) != sre::cell_key::INVALID_KEY,
+               std::logic_error, "Tracker side overflow is not detected !");
+  DT_THROW_IF (sre::cell_key::make_tracker (0, 0, 255, 0) != sre::cell_key::INVALID_KEY,
+               std::logic_error, "Tracker layer overflow is not detected !");
+  DT_THROW_IF (sre::cell_key::make_tracker (0, 0, 0, 4095) != sre::cell_key::INVALID_KEY,
+               std::logic_error, "Tracker row overflow is not detected !");
+  DT_THROW_IF (sre::cell_key::make_calorimeter (15, 0, 0, 0, 0, 0) != sre::cell_key::INVALID_KEY,
+               std::logic_error, "Calorimeter type overflow is not detected !");
+  DT_THROW_IF (sre::cell_key::make_calorimeter (0, 255, 0, 0, 0, 0) != sre::cell_key::INVALID_KEY,
+               std::logic_error, "Calorimeter module overflow is not detected !");
+  DT_THROW_IF (sre::cell_key::make_calorimeter (0, 0, 0, 15, 0, 0) != sre::cell_key::INVALID_KEY,
+               std::logic_error, "Calorimeter wall overflow is not detected !");
+  DT_THROW_IF (sre::cell_key::make_calorimeter (0, 0, 0, 0, 63, 0) != sre::cell_key::INVALID_KEY,
+               std::logic_error, "Calorimeter column overflow is not detected !");
+  DT_THROW_IF (sre::cell_key::make_calorimeter (0, 0, 0, 0, 0, 63) != sre::cell_key::INVALID_KEY,
+               std::logic_error, "Calorimeter row overflow is not detected !");
+
+  // The largest addresses of all fields would build the reserved all-ones key :
+  DT_THROW_IF (sre::cell_key::make_tracker (254, 14, 254, 4094) != sre::cell_key::INVALID_KEY,
+               std::logic_error, "The reserved tracker key is built !");
+  DT_THROW_IF (sre::cell_key::make_calorimeter (14, 254, 14, 14, 62, 62) != sre::cell_key::INVALID_KEY,
+               std::logic_error, "The reserved calorimeter key is built !");
+  return;
+}
+
+void test_ordering ()
+{
+  // The keys sort the cells by module, side, layer then row :
+  std::vector<sre::calib_tracker_hit_type> hits (6);
+  hits[0].module = 0; hits[0].side = 1; hits[0].layer = 0; hits[0].row = 3;
+  hits[1].module = 0; hits[1].side = 0; hits[1].layer = 8; hits[1].row = 112;
+  hits[2].module = 0; hits[2].side = 0; hits[2].layer = 2; hits[2].row = 5;
+  hits[3].module = 1; hits[3].side = 0; hits[3].layer = 0; hits[3].row = 0;
+  hits[4].module = 0; hits[4].side = 0; hits[4].layer = 2; hits[4].row = 4;
+  hits[5].module = 0; hits[5].side = 1; hits[5].layer = -1; hits[5].row = 0;
+  for (size_t i = 0; i < hits.size (); i++)
+    {
+      hits[i].hit_id = i;
+      hits[i].encode_cell_key ();
+    }
+  std::sort (hits.begin (), hits.end (), sre::cell_key::less<sre::calib_tracker_hit_type>);
+  const int32_t expected_ids[] = { 4, 2, 1, 5, 0, 3 };
+  for (size_t i = 0; i < hits.size (); i++)
+    {
+      DT_THROW_IF (hits[i].hit_id != expected_ids[i], std::logic_error,
+                   "Hit #" << hits[i].hit_id << " is sorted at rank " << i
+                   << " instead of hit #" << expected_ids[i] << " !");
+    }
+
+  // The block type is the most significant field of the calorimeter keys :
+  DT_THROW_IF (sre::cell_key::make_calorimeter (sre::constants::CALO_TYPE, 1, 1, -1, 19, 12)
+               >= sre::cell_key::make_calorimeter (sre::constants::XCALO_TYPE, 0, 0, 0, 0, 0),
+               std::logic_error, "Main wall blocks do not sort before the X-wall blocks !");
+  return;
+}
+
+int main (int /* argc_ */, char ** /* argv_ */)
+{
+  int error_code = EXIT_SUCCESS;
+  try
+    {
+      std::clog << "Test program for the packed cell keys." << std::endl;
+      test_round_trips ();
+      test_overflows ();
+      test_ordering ();
+      std::clog << "The end." << std::endl;
+    }
+  catch (std::exception & x)
+    {
+      std::cerr << "error: " << x.what () << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  catch (...)
+    {
+      std::cerr << "error: " << "unexpected error !" << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  return (error_code);
+}
+
+// end of test_cell_key.cxx
@@ -0,0 +1,184 @@
+// test_event_arena.cxx
+
+// Standard library:
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+
+// Third party:
+#include <datatools/exception.h>
+
+// This project:
+#include <falaise/snemo/exports/event_arena.h>
+#include <falaise/snemo/exports/export_event.h>
+
+namespace sre = snemo::reconstruction::exports;
+
+void test_inactive_arena ()
+{
+  // An inactive region returns no storage, the payloads are allocated from the heap :
+  sre::event_arena arena;
+  DT_THROW_IF (arena.allocate (16, 8) != 0, std::logic_error,
+               "The inactive arena has returned some storage !");
+  sre::lazy_payload<sre::calib_tracker_hit_cat_type> payload;
+  payload.grab (arena).cat_helix_x = 3.0;
+  DT_THROW_IF (! payload.has () || payload.is_in_arena (), std::logic_error,
+               "The payload is not allocated from the heap !");
+  DT_THROW_IF (arena.get_statistics ().allocations != 0, std::logic_error,
+               "The inactive arena has counted some allocations !");
+  return;
+}
+
+void test_spill_and_merge ()
+{
+  const std::size_t block_size = 64;
+  const std::size_t size = 24;
+  const std::size_t alignment = 8;
+  sre::event_arena arena (block_size);
+  arena.set_active (true);
+
+  // The first event spills over several blocks :
+  std::vector<char *> storages;
+  for (size_t i = 0; i < 10; i++)
+    {
+      char * storage = static_cast<char *> (arena.allocate (size, alignment));
+      DT_THROW_IF (storage == 0, std::logic_error, "The active arena has returned no storage !");
+      DT_THROW_IF (reinterpret_cast<std::size_t> (storage) % alignment != 0, std::logic_error,
+                   "Allocation #" << i << " is misaligned !");
+      for (size_t j = 0; j < storages.size (); j++)
+        {
+          DT_THROW_IF (storage < storages[j] + size && storages[j] < storage + size, std::logic_error,
+                       "Allocation #" << i << " overlaps allocation #" << j << " !");
+        }
+      std::fill (storage, storage + size, static_cast<char> (i));
+      storages.push_back (storage);
+    }
+  const sre::event_arena::statistics_type first = arena.get_statistics ();
+  DT_THROW_IF (first.blocks < 2, std::logic_error, "The first event has not spilled !");
+  DT_THROW_IF (first.allocations != 10, std::logic_error, "Invalid number of allocations !");
+  DT_THROW_IF (first.used < 10 * size || first.high_water != first.used, std::logic_error,
+               "Invalid usage of the first event (" << first.used << " bytes) !");
+
+  // The blocks are merged in a single block as large as the high-water mark :
+  arena.release ();
+  const sre::event_arena::statistics_type merged = arena.get_statistics ();
+  DT_THROW_IF (merged.used != 0 || merged.releases != 1, std::logic_error,
+               "The arena has not been released !");
+  DT_THROW_IF (merged.capacity != first.high_water || merged.blocks != first.blocks + 1, std::logic_error,
+               "The blocks have not been merged (capacity " << merged.capacity << " bytes) !");
+
+  // The next events fit in the merged block :
+  for (size_t ievent = 0; ievent < 3; ievent++)
+    {
+      for (size_t i = 0; i < 10; i++)
+        {
+          DT_THROW_IF (arena.allocate (size, alignment) == 0, std::logic_error,
+                       "The active arena has returned no storage !");
+        }
+      DT_THROW_IF (arena.get_statistics ().used > merged.capacity, std::logic_error,
+                   "Event #" << ievent << " has spilled out of the merged block !");
+      arena.release ();
+    }
+  DT_THROW_IF (arena.get_statistics ().blocks != merged.blocks
+               || arena.get_statistics ().capacity != merged.capacity, std::logic_error,
+               "The merged block has not been reused !");
+
+  // Freeing the blocks keeps the settings :
+  arena.clear ();
+  DT_THROW_IF (arena.get_statistics ().capacity != 0 || ! arena.is_active (), std::logic_error,
+               "The arena has not been cleared !");
+  return;
+}
+
+void test_lazy_payload ()
+{
+  sre::event_arena arena;
+  arena.set_active (true);
+
+  // A payload allocated from the arena is tagged so :
+  sre::lazy_payload<sre::tracker_cluster_cat_type> payload;
+  DT_THROW_IF (payload.has () || payload.is_in_arena (), std::logic_error,
+               "The default payload is allocated !");
+  payload.grab (arena).cat_charge = -1.0;
+  DT_THROW_IF (! payload.has () || ! payload.is_in_arena (), std::logic_error,
+               "The payload is not allocated from the arena !");
+  DT_THROW_IF (arena.get_statistics ().allocations != 1, std::logic_error,
+               "Invalid number of arena allocations !");
+  payload.grab (arena).cat_has_charge = true;
+  DT_THROW_IF (arena.get_statistics ().allocations != 1, std::logic_error,
+               "The payload has been allocated twice !");
+
+  // A copy is allocated from the heap, a move keeps the arena storage :
+  sre::lazy_payload<sre::tracker_cluster_cat_type> copy (payload);
+  DT_THROW_IF (! copy.has () || copy.is_in_arena () || copy.get ().cat_charge != -1.0, std::logic_error,
+               "Invalid copy of an arena payload !");
+  sre::lazy_payload<sre::tracker_cluster_cat_type> moved (std::move (payload));
+  DT_THROW_IF (payload.has () || ! moved.is_in_arena () || ! moved.get ().cat_has_charge, std::logic_error,
+               "Invalid move of an arena payload !");
+
+  // Setting a default value does not allocate the payload :
+  payload.set (&sre::tracker_cluster_cat_type::cat_charge, sre::constants::INVALID_DOUBLE);
+  DT_THROW_IF (payload.has (), std::logic_error, "A default value has allocated the payload !");
+  const double charge = payload.get (&sre::tracker_cluster_cat_type::cat_charge);
+  DT_THROW_IF (charge == charge, std::logic_error,
+               "The missing payload does not read as the default one !");
+
+  // The arena payloads are destroyed by the records and freed with the arena :
+  moved.reset ();
+  copy.reset ();
+  DT_THROW_IF (moved.has () || copy.has (), std::logic_error, "The payloads have not been released !");
+  arena.release ();
+  return;
+}
+
+void test_event_clear ()
+{
+  // The payloads of the event data are allocated from its arena :
+  sre::export_event event;
+  event.arena.set_active (true);
+  sre::calib_tracker_hit_type hit;
+  event.calib_gg_hits.push_back (hit);
+  event.calib_gg_hits.back ().has_cat_infos = true;
+  event.calib_gg_hits.back ().cat.grab (event.arena).cat_tangency_x = 2.0;
+  const sre::calib_tracker_hit_type & stored = event.calib_gg_hits.front ();
+  DT_THROW_IF (! stored.cat.is_in_arena ()
+               || stored.get_cat<&sre::calib_tracker_hit_cat_type::cat_tangency_x> () != 2.0,
+               std::logic_error, "The payload is not stored in the arena of the event !");
+
+  // Clearing the data releases the arena :
+  const std::size_t releases = event.arena.get_statistics ().releases;
+  event.clear_data ();
+  DT_THROW_IF (! event.calib_gg_hits.empty (), std::logic_error, "The data have not been cleared !");
+  DT_THROW_IF (event.arena.get_statistics ().used != 0 || event.arena.get_statistics ().releases != releases + 1,
+               std::logic_error, "The arena has not been released with the data !");
+  return;
+}
+
+int main (int /* argc_ */, char ** /* argv_ */)
+{
+  int error_code = EXIT_SUCCESS;
+  try
+    {
+      std::clog << "Test program for the event arena and the out of line payloads." << std::endl;
+      test_inactive_arena ();
+      test_spill_and_merge ();
+      test_lazy_payload ();
+      test_event_clear ();
+      std::clog << "The end." << std::endl;
+    }
+  catch (std::exception & x)
+    {
+      std::cerr << "error: " << x.what () << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  catch (...)
+    {
+      std::cerr << "error: " << "unexpected error !" << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  return (error_code);
+}
+
+// end of test_event_arena.cxx
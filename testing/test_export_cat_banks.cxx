@@ -0,0 +1,154 @@
+// test_export_cat_banks.cxx
+
+// Standard library:
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+// Third party:
+#include <datatools/exception.h>
+
+// This project:
+#include <falaise/snemo/exports/export_event.h>
+
+namespace sre = snemo::reconstruction::exports;
+
+void add_hit (sre::export_event & event_, int32_t hit_id_, double tangency_x_, double helix_x_)
+{
+  sre::calib_tracker_hit_type hit;
+  hit.hit_id = hit_id_;
+  hit.has_cat_infos = (tangency_x_ == tangency_x_) || (helix_x_ == helix_x_);
+  hit.set_cat<&sre::calib_tracker_hit_cat_type::cat_tangency_x> (tangency_x_);
+  hit.set_cat<&sre::calib_tracker_hit_cat_type::cat_helix_x> (helix_x_);
+  event_.calib_gg_hits.push_back (hit);
+  return;
+}
+
+void add_cluster (sre::export_event & event_, int32_t cluster_id_, bool has_charge_, double charge_)
+{
+  sre::tracker_cluster_type cluster;
+  cluster.cluster_id = cluster_id_;
+  cluster.has_cat_infos = has_charge_;
+  cluster.set_cat<bool, &sre::tracker_cluster_cat_type::cat_has_charge> (has_charge_);
+  cluster.set_cat<double, &sre::tracker_cluster_cat_type::cat_charge> (charge_);
+  event_.tracker_clusters.push_back (cluster);
+  return;
+}
+
+void test_cat_banks ()
+{
+  const double missing = sre::constants::INVALID_DOUBLE;
+  sre::export_event event;
+  add_hit (event, 0, 1.5, missing);
+  add_hit (event, 1, missing, missing);
+  add_hit (event, 2, missing, -2.5);
+  add_hit (event, 3, 4.0, 8.0);
+  add_cluster (event, 0, false, missing);
+  add_cluster (event, 1, true, -1.0);
+  add_cluster (event, 2, false, missing);
+
+  // A hit flagged with CAT informations but without any value has no row :
+  event.calib_gg_hits[1].has_cat_infos = true;
+  event.calib_gg_hits[1].cat.grab ();
+
+  // Only the hits and clusters with some CAT informations have a row :
+  event.build_cat_banks ();
+  DT_THROW_IF (event.calib_gg_hits_cat.size () != 3, std::logic_error,
+               "Invalid number of CAT hit rows (" << event.calib_gg_hits_cat.size () << ") !");
+  const int32_t expected_hit_parents[] = { 0, 2, 3 };
+  for (size_t i = 0; i < event.calib_gg_hits_cat.size (); i++)
+    {
+      DT_THROW_IF (event.calib_gg_hits_cat[i].parent_index != expected_hit_parents[i], std::logic_error,
+                   "CAT hit row #" << i << " has parent " << event.calib_gg_hits_cat[i].parent_index
+                   << " instead of " << expected_hit_parents[i] << " !");
+    }
+  DT_THROW_IF (event.tracker_clusters_cat.size () != 1, std::logic_error,
+               "Invalid number of CAT cluster rows (" << event.tracker_clusters_cat.size () << ") !");
+  DT_THROW_IF (event.tracker_clusters_cat[0].parent_index != 1, std::logic_error,
+               "The CAT cluster row has an invalid parent !");
+
+  // The CAT informations are restored in their parents :
+  const std::vector<sre::calib_tracker_hit_type> hits = event.calib_gg_hits;
+  const std::vector<sre::tracker_cluster_type> clusters = event.tracker_clusters;
+  for (size_t i = 0; i < event.calib_gg_hits.size (); i++)
+    {
+      event.calib_gg_hits[i].reset_cat ();
+    }
+  for (size_t i = 0; i < event.tracker_clusters.size (); i++)
+    {
+      event.tracker_clusters[i].reset_cat ();
+    }
+  event.expand_cat_banks ();
+  for (size_t i = 0; i < hits.size (); i++)
+    {
+      const sre::calib_tracker_hit_type & restored = event.calib_gg_hits[i];
+      const bool present = (i != 1);
+      DT_THROW_IF (restored.has_cat_infos != present || restored.cat.has () != present, std::logic_error,
+                   "Hit #" << i << " has invalid CAT informations !");
+      if (! present) continue;
+      const double tangency_x = restored.get_cat<&sre::calib_tracker_hit_cat_type::cat_tangency_x> ();
+      const double expected_tangency_x = hits[i].get_cat<&sre::calib_tracker_hit_cat_type::cat_tangency_x> ();
+      DT_THROW_IF (tangency_x != expected_tangency_x && expected_tangency_x == expected_tangency_x,
+                   std::logic_error, "Hit #" << i << " has an invalid tangency point !");
+      const double helix_x = restored.get_cat<&sre::calib_tracker_hit_cat_type::cat_helix_x> ();
+      const double expected_helix_x = hits[i].get_cat<&sre::calib_tracker_hit_cat_type::cat_helix_x> ();
+      DT_THROW_IF (helix_x != expected_helix_x && expected_helix_x == expected_helix_x,
+                   std::logic_error, "Hit #" << i << " has an invalid helix point !");
+    }
+  for (size_t i = 0; i < clusters.size (); i++)
+    {
+      const sre::tracker_cluster_type & restored = event.tracker_clusters[i];
+      const bool present = (i == 1);
+      DT_THROW_IF (restored.has_cat_infos != present || restored.cat.has () != present, std::logic_error,
+                   "Cluster #" << i << " has invalid CAT informations !");
+      if (! present) continue;
+      const bool has_charge = restored.get_cat<bool, &sre::tracker_cluster_cat_type::cat_has_charge> ();
+      const double charge = restored.get_cat<double, &sre::tracker_cluster_cat_type::cat_charge> ();
+      DT_THROW_IF (! has_charge || charge != -1.0, std::logic_error,
+                   "Cluster #" << i << " has an invalid charge !");
+    }
+  return;
+}
+
+void test_invalid_parents ()
+{
+  // Rows pointing outside of their parent bank are ignored :
+  sre::export_event event;
+  add_hit (event, 0, sre::constants::INVALID_DOUBLE, sre::constants::INVALID_DOUBLE);
+  sre::calib_tracker_hit_cat_type hit_cat;
+  hit_cat.cat_tangency_x = 1.0;
+  hit_cat.parent_index = 1;
+  event.calib_gg_hits_cat.push_back (hit_cat);
+  hit_cat.parent_index = -1;
+  event.calib_gg_hits_cat.push_back (hit_cat);
+  event.expand_cat_banks ();
+  DT_THROW_IF (event.calib_gg_hits[0].has_cat_infos || event.calib_gg_hits[0].cat.has (), std::logic_error,
+               "A CAT row with an invalid parent has been restored !");
+  return;
+}
+
+int main (int /* argc_ */, char ** /* argv_ */)
+{
+  int error_code = EXIT_SUCCESS;
+  try
+    {
+      std::clog << "Test program for the sparse CAT banks." << std::endl;
+      test_cat_banks ();
+      test_invalid_parents ();
+      std::clog << "The end." << std::endl;
+    }
+  catch (std::exception & x)
+    {
+      std::cerr << "error: " << x.what () << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  catch (...)
+    {
+      std::cerr << "error: " << "unexpected error !" << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  return (error_code);
+}
+
+// end of test_export_cat_banks.cxx
@@ -0,0 +1,182 @@
+// test_export_memberships.cxx
+
+// Standard library:
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+// Third party:
+#include <datatools/exception.h>
+
+// This project:
+#include <falaise/snemo/exports/export_event.h>
+
+namespace sre = snemo::reconstruction::exports;
+
+void add_cluster (sre::export_event & event_, int32_t solution_id_, int32_t cluster_id_,
+                  const std::vector<int32_t> & hit_ids_)
+{
+  sre::tracker_cluster_type cluster;
+  cluster.solution_id = solution_id_;
+  cluster.cluster_id = cluster_id_;
+  cluster.number_of_hits = hit_ids_.size ();
+  event_.tracker_clusters.push_back (cluster);
+  for (size_t i = 0; i < hit_ids_.size (); i++)
+    {
+      sre::tracker_clustered_hit_type hit;
+      hit.solution_id = solution_id_;
+      hit.cluster_id = cluster_id_;
+      hit.cluster_index = event_.tracker_clusters.size () - 1;
+      hit.hit_id = hit_ids_[i];
+      hit.hit_index = hit_ids_[i] + 100;
+      event_.tracker_clustered_hits.push_back (hit);
+    }
+  return;
+}
+
+void add_unclustered_hit (sre::export_event & event_, int32_t solution_id_, int32_t hit_id_)
+{
+  sre::tracker_clustered_hit_type hit;
+  hit.solution_id = solution_id_;
+  hit.cluster_id = -1;
+  hit.hit_id = hit_id_;
+  hit.hit_index = hit_id_ + 100;
+  event_.tracker_clustered_hits.push_back (hit);
+  return;
+}
+
+void add_trajectory (sre::export_event & event_, int32_t solution_id_, int32_t trajectory_id_,
+                     const std::vector<int32_t> & orphan_ids_)
+{
+  sre::tracker_trajectory_type trajectory;
+  trajectory.solution_id = solution_id_;
+  trajectory.trajectory_id = trajectory_id_;
+  trajectory.number_of_orphans = orphan_ids_.size ();
+  event_.tracker_trajectories.push_back (trajectory);
+  for (size_t i = 0; i < orphan_ids_.size (); i++)
+    {
+      sre::tracker_trajectory_orphan_hit_type hit;
+      hit.solution_id = solution_id_;
+      hit.trajectory_id = trajectory_id_;
+      hit.trajectory_index = event_.tracker_trajectories.size () - 1;
+      hit.hit_id = orphan_ids_[i];
+      hit.hit_index = orphan_ids_[i] + 100;
+      event_.tracker_trajectory_orphan_hits.push_back (hit);
+    }
+  return;
+}
+
+// Encode the memberships as offsets, then restore the member rows :
+void round_trip (sre::export_event & event_)
+{
+  const std::vector<sre::tracker_clustered_hit_type> clustered_hits = event_.tracker_clustered_hits;
+  const std::vector<sre::tracker_trajectory_orphan_hit_type> orphan_hits = event_.tracker_trajectory_orphan_hits;
+  event_.build_membership_banks ();
+  DT_THROW_IF (event_.tracker_cluster_hit_ids.size () != clustered_hits.size (), std::logic_error,
+               "Invalid number of cluster hit IDs !");
+  event_.tracker_clustered_hits.clear ();
+  event_.tracker_trajectory_orphan_hits.clear ();
+  event_.expand_membership_banks ();
+
+  DT_THROW_IF (event_.tracker_clustered_hits.size () != clustered_hits.size (), std::logic_error,
+               "Invalid number of restored clustered hits !");
+  for (size_t i = 0; i < clustered_hits.size (); i++)
+    {
+      const sre::tracker_clustered_hit_type & expected = clustered_hits[i];
+      const sre::tracker_clustered_hit_type & restored = event_.tracker_clustered_hits[i];
+      DT_THROW_IF (restored.solution_id != expected.solution_id, std::logic_error,
+                   "Clustered hit #" << i << " has solution ID " << restored.solution_id
+                   << " instead of " << expected.solution_id << " !");
+      DT_THROW_IF (restored.cluster_id != expected.cluster_id, std::logic_error,
+                   "Clustered hit #" << i << " has an invalid cluster ID !");
+      DT_THROW_IF (restored.cluster_index != expected.cluster_index, std::logic_error,
+                   "Clustered hit #" << i << " has an invalid cluster index !");
+      DT_THROW_IF (restored.hit_id != expected.hit_id, std::logic_error,
+                   "Clustered hit #" << i << " has an invalid hit ID !");
+      DT_THROW_IF (restored.hit_index != expected.hit_index, std::logic_error,
+                   "Clustered hit #" << i << " has an invalid hit index !");
+    }
+
+  DT_THROW_IF (event_.tracker_trajectory_orphan_hits.size () != orphan_hits.size (), std::logic_error,
+               "Invalid number of restored orphan hits !");
+  for (size_t i = 0; i < orphan_hits.size (); i++)
+    {
+      const sre::tracker_trajectory_orphan_hit_type & expected = orphan_hits[i];
+      const sre::tracker_trajectory_orphan_hit_type & restored = event_.tracker_trajectory_orphan_hits[i];
+      DT_THROW_IF (restored.solution_id != expected.solution_id, std::logic_error,
+                   "Orphan hit #" << i << " has an invalid solution ID !");
+      DT_THROW_IF (restored.trajectory_id != expected.trajectory_id, std::logic_error,
+                   "Orphan hit #" << i << " has an invalid trajectory ID !");
+      DT_THROW_IF (restored.trajectory_index != expected.trajectory_index, std::logic_error,
+                   "Orphan hit #" << i << " has an invalid trajectory index !");
+      DT_THROW_IF (restored.hit_id != expected.hit_id, std::logic_error,
+                   "Orphan hit #" << i << " has an invalid hit ID !");
+      DT_THROW_IF (restored.hit_index != expected.hit_index, std::logic_error,
+                   "Orphan hit #" << i << " has an invalid hit index !");
+    }
+  return;
+}
+
+void test_clusters ()
+{
+  sre::export_event event;
+  std::vector<int32_t> hits;
+  hits.push_back (3);
+  hits.push_back (1);
+  hits.push_back (4);
+  add_cluster (event, 7, 0, hits);
+  add_cluster (event, 7, 1, std::vector<int32_t> ());
+  hits.clear ();
+  hits.push_back (5);
+  hits.push_back (9);
+  add_cluster (event, 7, 2, hits);
+  add_unclustered_hit (event, 7, 2);
+  add_unclustered_hit (event, 7, 6);
+  hits.clear ();
+  hits.push_back (2);
+  add_trajectory (event, 3, 0, hits);
+  add_trajectory (event, 3, 1, std::vector<int32_t> ());
+  hits.clear ();
+  hits.push_back (6);
+  hits.push_back (8);
+  add_trajectory (event, 3, 2, hits);
+  round_trip (event);
+  return;
+}
+
+void test_unclustered_hits ()
+{
+  // The solution of the unclustered hits is kept with no cluster :
+  sre::export_event event;
+  add_unclustered_hit (event, 4, 0);
+  add_unclustered_hit (event, 4, 1);
+  add_unclustered_hit (event, 4, 2);
+  round_trip (event);
+  return;
+}
+
+int main (int /* argc_ */, char ** /* argv_ */)
+{
+  int error_code = EXIT_SUCCESS;
+  try
+    {
+      std::clog << "Test program for the offset encoding of the cluster and trajectory memberships." << std::endl;
+      test_clusters ();
+      test_unclustered_hits ();
+      std::clog << "The end." << std::endl;
+    }
+  catch (std::exception & x)
+    {
+      std::cerr << "error: " << x.what () << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  catch (...)
+    {
+      std::cerr << "error: " << "unexpected error !" << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  return (error_code);
+}
+
+// end of test_export_memberships.cxx
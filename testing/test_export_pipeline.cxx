@@ -0,0 +1,275 @@
+// test_export_pipeline.cxx
+
+// Standard library:
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+// Third party:
+#include <datatools/exception.h>
+#include <datatools/things.h>
+#include <datatools/properties.h>
+
+// This project:
+#include <falaise/snemo/exports/export_pipeline.h>
+#include <falaise/snemo/exports/export_event.h>
+
+namespace sre = snemo::reconstruction::exports;
+
+sre::export_event * new_event ()
+{
+  return new sre::export_event;
+}
+
+// The index of a record is stored in a bank of properties :
+void store_index (datatools::things & record_, int index_)
+{
+  record_.add<datatools::properties> ("Index").store_integer ("value", index_);
+  return;
+}
+
+int fetch_index (const datatools::things & record_)
+{
+  return record_.get<datatools::properties> ("Index").fetch_integer ("value");
+}
+
+// Conversion of variable duration, so that the workers finish out of order :
+void convert_index (unsigned int /* worker_ */,
+                    const datatools::things & record_,
+                    sre::export_event & event_)
+{
+  const int index = fetch_index (record_);
+  volatile double sum = 0.0;
+  for (int i = 0; i < (index % 7) * 500; i++) sum += i;
+  event_.event_header.event_number = index;
+  return;
+}
+
+void test_ring ()
+{
+  int items[5] = {0, 1, 2, 3, 4};
+  sre::spsc_ring<int> ring (3);
+  DT_THROW_IF (ring.get_capacity () != 3, std::logic_error, "Invalid capacity !");
+  DT_THROW_IF (! ring.empty (), std::logic_error, "New ring is not empty !");
+  DT_THROW_IF (ring.pop () != 0, std::logic_error, "Pop from an empty ring !");
+  // Several turns around the storage :
+  int next_push = 0;
+  int next_pop = 0;
+  for (int turn = 0; turn < 10; turn++)
+    {
+      while (ring.push (&items[next_push % 5])) next_push++;
+      DT_THROW_IF (next_push - next_pop != 3, std::logic_error,
+                   "Full ring holds " << next_push - next_pop << " items !");
+      // Pop one item less at each other turn to move the head :
+      const int npops = (turn % 2 == 0) ? 3 : 2;
+      for (int i = 0; i < npops; i++)
+        {
+          int * item = ring.pop ();
+          DT_THROW_IF (item != &items[next_pop % 5], std::logic_error,
+                       "Unexpected item at turn " << turn << " !");
+          next_pop++;
+        }
+    }
+  while (ring.pop () != 0) next_pop++;
+  DT_THROW_IF (next_pop != next_push, std::logic_error, "Lost items !");
+  DT_THROW_IF (! ring.empty (), std::logic_error, "Ring is not empty !");
+  return;
+}
+
+void test_ring_threads ()
+{
+  // One producer thread and one consumer thread :
+  const int nitems = 100000;
+  std::vector<int> items (nitems);
+  sre::spsc_ring<int> ring (7);
+  bool ordered = true;
+  std::thread consumer ([&ring, &items, &ordered, nitems] ()
+                        {
+                          for (int i = 0; i < nitems; i++)
+                            {
+                              int * item = ring.pop ();
+                              while (item == 0)
+                                {
+                                  std::this_thread::yield ();
+                                  item = ring.pop ();
+                                }
+                              if (item != &items[i]) ordered = false;
+                            }
+                        });
+  for (int i = 0; i < nitems; i++)
+    {
+      while (! ring.push (&items[i])) std::this_thread::yield ();
+    }
+  consumer.join ();
+  DT_THROW_IF (! ordered, std::logic_error, "Items are not popped in order !");
+  DT_THROW_IF (! ring.empty (), std::logic_error, "Ring is not empty !");
+  return;
+}
+
+void test_order (unsigned int depth_, unsigned int nworkers_)
+{
+  // Only the committer thread fills the list of committed events :
+  std::vector<int> committed;
+  {
+    sre::export_pipeline pipeline (depth_, nworkers_, new_event, convert_index,
+                                   [&committed] (sre::export_event & event_)
+                                   {
+                                     committed.push_back (event_.event_header.event_number);
+                                   });
+    DT_THROW_IF (pipeline.get_depth () != depth_, std::logic_error, "Invalid depth !");
+    DT_THROW_IF (pipeline.get_number_of_workers () != nworkers_, std::logic_error,
+                 "Invalid number of workers !");
+    const int nrecords = 5000;
+    for (int i = 0; i < nrecords; i++)
+      {
+        datatools::things & record = pipeline.acquire ();
+        if (i % 97 == 0)
+          {
+            // A released slot is given back at the next acquisition :
+            pipeline.release ();
+            datatools::things & record2 = pipeline.acquire ();
+            DT_THROW_IF (&record2 != &record, std::logic_error, "Released slot is not reused !");
+          }
+        store_index (record, i);
+        pipeline.submit ();
+        if (i % 1000 == 999)
+          {
+            pipeline.drain ();
+            DT_THROW_IF (committed.size () != (size_t) (i + 1), std::logic_error,
+                         "Only " << committed.size () << " events are committed after the drain !");
+          }
+      }
+    // The destructor converts and commits the last records :
+    for (int i = 0; i < (int) depth_; i++)
+      {
+        store_index (pipeline.acquire (), nrecords + i);
+        pipeline.submit ();
+      }
+    const sre::export_pipeline::statistics_type statistics = pipeline.get_statistics ();
+    DT_THROW_IF (statistics.submitted != (uint64_t) (nrecords + depth_), std::logic_error,
+                 "Invalid number of submitted records !");
+  }
+  DT_THROW_IF (committed.size () != 5000 + depth_, std::logic_error,
+               "Records are not committed by the destructor !");
+  for (size_t i = 0; i < committed.size (); i++)
+    {
+      DT_THROW_IF (committed[i] != (int) i, std::logic_error,
+                   "Event " << committed[i] << " is committed at rank " << i << " !");
+    }
+  return;
+}
+
+void test_convert_error ()
+{
+  std::atomic<int> committed (0);
+  sre::export_pipeline pipeline (3, 2, new_event,
+                                 [] (unsigned int worker_,
+                                     const datatools::things & record_,
+                                     sre::export_event & event_)
+                                 {
+                                   if (fetch_index (record_) == 7) throw std::runtime_error ("convert 7");
+                                   convert_index (worker_, record_, event_);
+                                 },
+                                 [&committed] (sre::export_event & event_)
+                                 {
+                                   DT_THROW_IF (event_.event_header.event_number >= 7, std::logic_error,
+                                                "Event " << event_.event_header.event_number
+                                                << " is committed after an error !");
+                                   committed++;
+                                 });
+  bool caught = false;
+  try
+    {
+      for (int i = 0; i < 100; i++)
+        {
+          store_index (pipeline.acquire (), i);
+          pipeline.submit ();
+        }
+      pipeline.drain ();
+    }
+  catch (std::runtime_error & x)
+    {
+      caught = true;
+      DT_THROW_IF (std::string (x.what ()) != "convert 7", std::logic_error,
+                   "Unexpected error '" << x.what () << "' !");
+    }
+  DT_THROW_IF (! caught, std::logic_error, "The conversion error was not rethrown !");
+  // The events submitted before the error are committed :
+  DT_THROW_IF (committed != 7, std::logic_error, committed << " events are committed !");
+  return;
+}
+
+void test_commit_error ()
+{
+  int committed = 0;
+  sre::export_pipeline pipeline (4, 3, new_event, convert_index,
+                                 [&committed] (sre::export_event & event_)
+                                 {
+                                   if (event_.event_header.event_number == 11) throw std::runtime_error ("commit 11");
+                                   committed++;
+                                 });
+  bool caught = false;
+  try
+    {
+      for (int i = 0; i < 12; i++)
+        {
+          store_index (pipeline.acquire (), i);
+          pipeline.submit ();
+        }
+      // The error of the last record is only known after the drain :
+      pipeline.drain ();
+    }
+  catch (std::runtime_error & x)
+    {
+      caught = true;
+      DT_THROW_IF (std::string (x.what ()) != "commit 11", std::logic_error,
+                   "Unexpected error '" << x.what () << "' !");
+    }
+  DT_THROW_IF (! caught, std::logic_error, "The commit error was not rethrown !");
+  DT_THROW_IF (committed != 11, std::logic_error, committed << " events are committed !");
+  // The error is rethrown at the next acquisition :
+  caught = false;
+  try
+    {
+      pipeline.acquire ();
+    }
+  catch (std::runtime_error & x)
+    {
+      caught = true;
+    }
+  DT_THROW_IF (! caught, std::logic_error, "The commit error was not rethrown again !");
+  return;
+}
+
+int main (int /* argc_ */, char ** /* argv_ */)
+{
+  int error_code = EXIT_SUCCESS;
+  try
+    {
+      std::clog << "Test program for the 'export_pipeline' class." << std::endl;
+      test_ring ();
+      test_ring_threads ();
+      test_order (1, 1);
+      test_order (2, 1);
+      test_order (6, 4);
+      test_convert_error ();
+      test_commit_error ();
+      std::clog << "The end." << std::endl;
+    }
+  catch (std::exception & x)
+    {
+      std::cerr << "error: " << x.what () << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  catch (...)
+    {
+      std::cerr << "error: " << "unexpected error !" << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  return (error_code);
+}
+
+// end of test_export_pipeline.cxx
@@ -0,0 +1,102 @@
+// test_task_pool.cxx
+
+// Standard library:
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <atomic>
+
+// Third party:
+#include <datatools/exception.h>
+
+// This project:
+#include <falaise/snemo/exports/task_pool.h>
+
+namespace sre = snemo::reconstruction::exports;
+
+void test_run (sre::task_pool & pool_)
+{
+  // Each generation of tasks fills its own slots :
+  for (int generation = 0; generation < 100; generation++)
+    {
+      std::vector<int> results (37, -1);
+      std::vector<sre::task_pool::task_type> tasks;
+      for (size_t i = 0; i < results.size (); i++)
+        {
+          tasks.push_back ([&results, i, generation] () { results[i] = generation + i; });
+        }
+      pool_.run (tasks);
+      for (size_t i = 0; i < results.size (); i++)
+        {
+          DT_THROW_IF (results[i] != (int) (generation + i), std::logic_error,
+                       "Task " << i << " of generation " << generation << " was not run !");
+        }
+    }
+  // An empty set of tasks returns at once :
+  pool_.run (std::vector<sre::task_pool::task_type> ());
+  return;
+}
+
+void test_error (sre::task_pool & pool_)
+{
+  std::atomic<int> counter (0);
+  std::vector<sre::task_pool::task_type> tasks;
+  for (int i = 0; i < 20; i++)
+    {
+      tasks.push_back ([&counter, i] ()
+                       {
+                         counter++;
+                         if (i == 5) throw std::runtime_error ("task 5");
+                       });
+    }
+  bool caught = false;
+  try
+    {
+      pool_.run (tasks);
+    }
+  catch (std::runtime_error & x)
+    {
+      caught = true;
+      DT_THROW_IF (std::string (x.what ()) != "task 5", std::logic_error,
+                   "Unexpected error '" << x.what () << "' !");
+    }
+  DT_THROW_IF (! caught, std::logic_error, "The error of a task was not rethrown !");
+  // All the tasks of the set are run, even after an error :
+  DT_THROW_IF (counter != 20, std::logic_error, "Only " << counter << " tasks were run !");
+
+  // The pool is still usable and the error is not rethrown again :
+  test_run (pool_);
+  return;
+}
+
+int main (int /* argc_ */, char ** /* argv_ */)
+{
+  int error_code = EXIT_SUCCESS;
+  try
+    {
+      std::clog << "Test program for the 'task_pool' class." << std::endl;
+      for (unsigned int nthreads = 1; nthreads <= 4; nthreads++)
+        {
+          sre::task_pool pool (nthreads);
+          DT_THROW_IF (pool.get_number_of_threads () != nthreads, std::logic_error,
+                       "Invalid number of threads !");
+          test_run (pool);
+          test_error (pool);
+        }
+      std::clog << "The end." << std::endl;
+    }
+  catch (std::exception & x)
+    {
+      std::cerr << "error: " << x.what () << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  catch (...)
+    {
+      std::cerr << "error: " << "unexpected error !" << std::endl;
+      error_code = EXIT_FAILURE;
+    }
+  return (error_code);
+}
+
+// end of test_task_pool.cxx